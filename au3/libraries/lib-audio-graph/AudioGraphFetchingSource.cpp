@@ -0,0 +1,75 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file AudioGraphFetchingSource.cpp
+
+  Dominic Mazzoni
+  Vaughan Johnson
+  Martyn Shaw
+
+  Paul Licameli split from WideSampleSource.cpp
+
+**********************************************************************/
+#include "AudioGraphFetchingSource.h"
+
+#include "AudioGraphBuffers.h"
+#include <algorithm>
+#include <cassert>
+
+AudioGraph::FetchingSource::FetchingSource(sampleCount length)
+   : mOutputRemaining{ length }
+{
+}
+
+AudioGraph::FetchingSource::~FetchingSource() = default;
+
+bool AudioGraph::FetchingSource::AcceptsBlockSize(size_t) const
+{
+   return true;
+}
+
+sampleCount AudioGraph::FetchingSource::Remaining() const
+{
+   return std::max<sampleCount>(0, mOutputRemaining);
+}
+
+std::optional<size_t>
+AudioGraph::FetchingSource::Acquire(Buffers &data, size_t bound)
+{
+   assert(bound <= data.BlockSize());
+   assert(data.BlockSize() <= data.Remaining());
+   assert(AcceptsBuffers(data));
+   assert(AcceptsBlockSize(data.BlockSize()));
+
+   if (!mInitialized || mFetched < bound) {
+      // Need to fill sufficent data in the buffers
+      // Calculate the number of samples to get
+      const auto fetch =
+         limitSampleBufferSize(data.Remaining() - mFetched, Remaining());
+      // guarantees write won't overflow
+      assert(mFetched + fetch <= data.Remaining());
+      Fetch(data, mFetched, fetch);
+      mFetched += fetch;
+      mInitialized = true;
+   }
+   assert(data.Remaining() > 0);
+   auto result = mLastProduced = std::min(bound,
+      limitSampleBufferSize(data.Remaining(), Remaining()));
+   // assert post
+   assert(result <= bound);
+   assert(result <= data.Remaining());
+   assert(result <= Remaining());
+   // true because the three terms of the min would be positive
+   assert(bound == 0 || Remaining() == 0 || result > 0);
+   return { result };
+}
+
+bool AudioGraph::FetchingSource::Release()
+{
+   mOutputRemaining -= mLastProduced;
+   mFetched -= mLastProduced;
+   mLastProduced = 0;
+   assert(mOutputRemaining >= 0);
+   return true;
+}
@@ -0,0 +1,55 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file AudioGraphFetchingSource.h
+  @brief Source that fills Buffers from consecutive frames of some input
+
+  Paul Licameli split from WideSampleSource.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_AUDIO_GRAPH_FETCHING_SOURCE__
+#define __AUDACITY_AUDIO_GRAPH_FETCHING_SOURCE__
+
+#include "AudioGraphSource.h" // to inherit
+#include "SampleCount.h"
+
+namespace AudioGraph {
+
+//! Source of a known number of frames, fetched in order into the Buffers
+/*!
+ Fetches as much as the buffers can take, ahead of what the caller has
+ released, and then produces it a block at a time
+ */
+class AUDIO_GRAPH_API FetchingSource /* not final */ : public Source {
+public:
+   //! @post `Remaining() == length`
+   explicit FetchingSource(sampleCount length);
+   ~FetchingSource() override;
+
+   //! Always true
+   bool AcceptsBlockSize(size_t blockSize) const override;
+
+   std::optional<size_t> Acquire(Buffers &data, size_t bound) final;
+   sampleCount Remaining() const final;
+   bool Release() override;
+
+protected:
+   //! Write the next `len` frames of each channel
+   /*!
+    @param offset where to write, past the write position of each channel of
+    `data`
+    @pre `offset + len <= data.Remaining()`
+    */
+   virtual void Fetch(Buffers &data, size_t offset, size_t len) = 0;
+
+private:
+   sampleCount mOutputRemaining;
+   size_t mLastProduced{};
+   size_t mFetched{};
+   bool mInitialized{ false };
+};
+
+}
+#endif
@@ -70,6 +70,7 @@ time warp info and AudioIOListener and whether the playback is looped.
 #include <math.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <chrono>
 #include <numeric>
 #include <optional>
 
@@ -126,14 +127,15 @@ AudioIO *AudioIO::Get()
 struct AudioIoCallback::TransportState {
    TransportState(std::weak_ptr<AudacityProject> wOwningProject,
       const ConstPlayableSequences &playbackSequences,
-      unsigned numPlaybackChannels, double sampleRate)
+      unsigned numPlaybackChannels, double sampleRate, size_t maxSamples)
    {
       if (auto pOwningProject = wOwningProject.lock();
           pOwningProject && numPlaybackChannels > 0) {
          // Setup for realtime playback at the rate of the realtime
          // stream, not the rate of the sample sequence.
          mpRealtimeInitialization.emplace(
-            move(wOwningProject), sampleRate, numPlaybackChannels);
+            move(wOwningProject), sampleRate, numPlaybackChannels,
+            maxSamples);
          // The following adds a new effect processor for each logical sequence.
          for (size_t i = 0, cnt = playbackSequences.size(); i < cnt; ++i) {
             // An array only of non-null pointers should be given to us
@@ -331,6 +333,7 @@ AudioIO::~AudioIO()
    // wxTheApp->Yield();
 
    mFinishAudioThread.store(true, std::memory_order_release);
+   WakeAudioThread();
    mAudioThread.join();
 }
 
@@ -1000,7 +1003,7 @@ int AudioIO::StartStream(const TransportSequences &sequences,
    }
 
    mpTransportState = std::make_unique<TransportState>(mOwningProject,
-      mPlaybackSequences, mNumPlaybackChannels, mRate);
+      mPlaybackSequences, mNumPlaybackChannels, mRate, mPlaybackBufferSize);
 
    if (pStartTime)
    {
@@ -1026,6 +1029,7 @@ int AudioIO::StartStream(const TransportSequences &sequences,
    // SequenceBufferExchange will ALWAYS get called from the Audio thread.
    mAudioThreadShouldCallSequenceBufferExchangeOnce
       .store(true, std::memory_order_release);
+   WakeAudioThread();
 
    while( mAudioThreadShouldCallSequenceBufferExchangeOnce
       .load(std::memory_order_acquire)) {
@@ -1197,6 +1201,7 @@ bool AudioIO::AllocateBuffers(
    do
    {
       bDone = true; // assume success
+      mPlaybackBufferSize = 0;
       try
       {
          if( mNumPlaybackChannels > 0 ) {
@@ -1211,6 +1216,7 @@ bool AudioIO::AllocateBuffers(
 
             // Adjust mPlaybackRingBufferSecs correspondingly
             mPlaybackRingBufferSecs = PlaybackPolicy::Duration { playbackBufferSize / mRate };
+            mPlaybackBufferSize = playbackBufferSize;
 
             mPlaybackBuffers.resize(0);
             mProcessingBuffers.resize(0);
@@ -1235,9 +1241,18 @@ bool AudioIO::AllocateBuffers(
                for(auto& buffer : mMasterBuffers)
                   buffer.reserve(playbackBufferSize);
 
+               // Looped play of a short selection may make more slices,
+               // and then these grow once
+               constexpr size_t slices = 16;
+               mSliceFrames.clear();
+               mSliceFrames.reserve(slices);
+               mSlicePositions.clear();
+               mSlicePositions.reserve(slices * mPlaybackSequences.size());
+
                // Number of scratch buffers depends on device playback channels
+               // (the master effects need one for each, and one dummy)
                if (mNumPlaybackChannels > 0) {
-                  mScratchBuffers.resize(mNumPlaybackChannels * 2 + 1);
+                  mScratchBuffers.resize(mNumPlaybackChannels + 1);
                   mScratchPointers.clear();
                   for (auto &buffer : mScratchBuffers) {
                      buffer.Allocate(playbackBufferSize, floatSample);
@@ -1255,6 +1270,9 @@ bool AudioIO::AllocateBuffers(
 
             mPlaybackMixers.clear();
 
+            mPrefetcher.Reset(AudioIOPrefetchDepth.Read(),
+               std::max(0, AudioIOPrefetchBlocks.Read()));
+
             const auto &warpOptions =
                policy.MixerWarpOptions(mPlaybackSchedule);
 
@@ -1546,6 +1564,7 @@ void AudioIO::StopStream()
    mScratchBuffers.clear();
    mScratchPointers.clear();
    mPlaybackMixers.clear();
+   mPrefetcher.Stop();
    mPlaybackSchedule.mTimeQueue.Clear();
 
    if (mStreamToken > 0)
@@ -1817,7 +1836,15 @@ void AudioIO::AudioThread(std::atomic<bool> &finish)
       gAudioIO->mAudioThreadSequenceBufferExchangeLoopActive
          .store(false, std::memory_order_relaxed);
 
-      std::this_thread::sleep_until( loopPassStart + interval );
+      // Sleep until the PortAudio callback or the main thread has work for
+      // us; the policy's interval bounds the wait in case no signal comes
+      std::unique_lock lock{ gAudioIO->mAudioThreadWakeMutex };
+      gAudioIO->mAudioThreadWakeup.wait_until(lock, loopPassStart + interval,
+         [&]{
+            return finish.load(std::memory_order_acquire) ||
+               gAudioIO->mAudioThreadWakeRequested
+                  .exchange(false, std::memory_order_acq_rel);
+         });
    }
 }
 
@@ -1938,6 +1965,25 @@ void AudioIO::FillPlayBuffers()
       // Might increase because the reader consumed some
       nAvailable = GetCommonlyFreePlayback();
    }
+
+   PrefetchPlayback();
+}
+
+void AudioIO::PrefetchPlayback()
+{
+   const auto depth = mPrefetcher.GetDepth();
+   if (depth <= 0)
+      return;
+
+   // mPlaybackMixers correspond one-to-one with mPlaybackSequences
+   const auto reversed = mPlaybackSchedule.ReversedTime();
+   for (size_t ii = 0; ii < mPlaybackMixers.size(); ++ii) {
+      const auto time = mPlaybackMixers[ii]->MixGetCurrentTime();
+      if (reversed)
+         mPrefetcher.Request(*mPlaybackSequences[ii], time - depth, time);
+      else
+         mPrefetcher.Request(*mPlaybackSequences[ii], time, time + depth);
+   }
 }
 
 #define stackAllocate(T, count) static_cast<T*>(alloca(count * sizeof(T)))
@@ -1962,6 +2008,13 @@ bool AudioIO::ProcessPlaybackSlices(
    for(unsigned n = 0; n < mProcessingBuffers.size(); ++n)
       processingBufferOffsets[n] = mProcessingBuffers[n].size();
 
+   // Reuse the storage of the slice lists, so that playback seldom allocates
+   auto &sliceFrames = mSliceFrames;
+   auto &slicePositions = mSlicePositions;
+   sliceFrames.clear();
+   slicePositions.clear();
+   const auto nSequences = mPlaybackSequences.size();
+
    do {
       const auto slice =
          policy.GetPlaybackSlice(mPlaybackSchedule, available);
@@ -1975,6 +2028,11 @@ bool AudioIO::ProcessPlaybackSlices(
       // atomic variables, the time queue doesn't.
       mPlaybackSchedule.mTimeQueue.Producer(mPlaybackSchedule, slice);
 
+      if (frames > 0) {
+         sliceFrames.push_back(frames);
+         slicePositions.resize(slicePositions.size() + nSequences, -1);
+      }
+
       // mPlaybackMixers correspond one-to-one with mPlaybackSequences
       size_t iSequence = 0;
       // mPlaybackBuffers correspond many-to-one with mPlaybackSequences
@@ -1986,9 +2044,28 @@ bool AudioIO::ProcessPlaybackSlices(
          if (frames > 0) {
             size_t produced = 0;
 
-            if (toProduce)
+            if (toProduce) {
+               // Approximate the interval to be read, ignoring any warping
+               const auto time = mixer->MixGetCurrentTime();
+               const auto duration = toProduce / mRate;
+               if (mPlaybackSchedule.ReversedTime())
+                  mPrefetcher.Account(*mPlaybackSequences[iSequence],
+                     time - duration, time);
+               else
+                  mPrefetcher.Account(*mPlaybackSequences[iSequence],
+                     time, time + duration);
                produced = mixer->Process(toProduce);
 
+               // Realtime effects may reuse their output for this slice
+               // when it is played again, if its samples are the ones at
+               // its position at the playback rate
+               const auto advance = mixer->MixGetCurrentTime() - time;
+               if (!mPlaybackSchedule.ReversedTime() && toProduce == frames &&
+                   fabs(advance - frames / mRate) < 0.5 / mRate)
+                  slicePositions[slicePositions.size() - nSequences + iSequence]
+                     = sampleCount(llrint(time * mRate));
+            }
+
             //wxASSERT(produced <= toProduce);
             // Copy (non-interleaved) mixer outputs to one or more ring buffers
             const auto nChannels = mPlaybackSequences[iSequence]->NChannels();
@@ -2035,54 +2112,80 @@ bool AudioIO::ProcessPlaybackSlices(
       return progress;
 
    // Do any realtime effect processing for each individual sample source,
-   // after all the little slices have been written.
+   // after all the little slices have been written.  Process each slice
+   // separately, because they may be discontinuous, as in looped play.
    if (pScope)
    {
-      const auto pointers = stackAllocate(float*, mNumPlaybackChannels);
-
-      int bufferIndex = 0;
-      for(const auto& seq : mPlaybackSequences)
+      struct Processed {
+         const PlayableSequence *pSequence;
+         size_t iSequence;
+         size_t bufferIndex;
+         size_t offset;
+      };
+      const auto groups =
+         stackAllocate(RealtimeEffects::GroupBuffers, nSequences);
+      const auto processed = stackAllocate(Processed, nSequences);
+      const auto pointers =
+         stackAllocate(float *, nSequences * mNumPlaybackChannels);
+      // Samples discarded for latency shift the following slices
+      const auto discarded = stackAllocate(size_t, nSequences);
+      std::fill_n(discarded, nSequences, 0);
+
+      size_t sliceStart = 0;
+      for(size_t iSlice = 0; iSlice < sliceFrames.size(); ++iSlice)
       {
-         if(!seq)
-            continue;//no similar check in convert-to-float part
-         const auto channelGroup = seq->FindChannelGroup();
-         if(!channelGroup)
-            continue;
-
-         // Are there more output device channels than channels of vt?
-         // Such as when a mono sequence is processed for stereo play?
-         // Then supply some non-null fake input buffers, because the
-         // various ProcessBlock overrides of effects may crash without it.
-         // But it would be good to find the fixes to make this unnecessary.
-         auto scratch = &mScratchPointers[mNumPlaybackChannels + 1];
-
-         //skip samples that are already processed
-         const auto offset = processingBufferOffsets[bufferIndex];
-         //number of newly written samples
-         const auto len = mProcessingBuffers[bufferIndex].size() - offset;
-
-         if(len > 0)
+         const auto len = sliceFrames[iSlice];
+         size_t nGroups = 0;
+
+         int bufferIndex = 0;
+         for(size_t iSequence = 0; iSequence < nSequences; ++iSequence)
          {
-            for(unsigned i = 0, cnt = std::min(seq->NChannels(), mNumPlaybackChannels); i < cnt; ++i)
-               pointers[i] = mProcessingBuffers[bufferIndex + i].data() + offset;
+            const auto &seq = mPlaybackSequences[iSequence];
+            if(!seq)
+               continue;//no similar check in convert-to-float part
+            const auto channelGroup = seq->FindChannelGroup();
+            if(!channelGroup)
+               continue;
 
-            for(unsigned i = seq->NChannels(); i < mNumPlaybackChannels; ++i)
-            {
+            //skip samples that are already processed
+            const auto offset = processingBufferOffsets[bufferIndex] +
+               sliceStart - discarded[iSequence];
+
+            // Are there more output device channels than channels of vt?
+            // Such as when a mono sequence is processed for stereo play?
+            // Then the null pointers are replaced with silent buffers,
+            // because the various ProcessBlock overrides of effects may
+            // crash without them.
+            const auto groupPointers =
+               pointers + nGroups * mNumPlaybackChannels;
+            for(unsigned i = 0; i < mNumPlaybackChannels; ++i)
+               groupPointers[i] = i < seq->NChannels()
+                  ? mProcessingBuffers[bufferIndex + i].data() + offset
+                  : nullptr;
+
+            groups[nGroups] = { channelGroup, groupPointers, len,
+               slicePositions[iSlice * nSequences + iSequence] };
+            processed[nGroups] =
+               { seq.get(), iSequence, size_t(bufferIndex), offset };
+            ++nGroups;
+
+            bufferIndex += seq->NChannels();
+         }
 
-               pointers[i] = *scratch++;
-               std::fill_n(pointers[i], len, .0f);
-            }
+         // The groups are independent, and may be transformed in parallel
+         pScope->ProcessGroups(groups, nGroups);
 
-            const auto discardable = pScope->Process(channelGroup, &pointers[0],
-               mScratchPointers.data(),
-               // The single dummy output buffer:
-               mScratchPointers[mNumPlaybackChannels],
-               mNumPlaybackChannels, len);
+         for(size_t iGroup = 0; iGroup < nGroups; ++iGroup)
+         {
+            const auto [pSequence, iSequence, iBuffer, offset] =
+               processed[iGroup];
+            const auto discardable = groups[iGroup].discardable;
+            discarded[iSequence] += discardable;
             // Check for asynchronous user changes in mute, solo status
-            const auto silenced = SequenceShouldBeSilent(*seq);
-            for(int i = 0; i < seq->NChannels(); ++i)
+            const auto silenced = SequenceShouldBeSilent(*pSequence);
+            for(int i = 0; i < pSequence->NChannels(); ++i)
             {
-               auto& buffer = mProcessingBuffers[bufferIndex + i];
+               auto& buffer = mProcessingBuffers[iBuffer + i];
                buffer.erase(buffer.begin() + offset, buffer.begin() + offset + discardable);
                if(silenced)
                {
@@ -2092,7 +2195,7 @@ bool AudioIO::ProcessPlaybackSlices(
             }
          }
 
-         bufferIndex += seq->NChannels();
+         sliceStart += len;
       }
    }
 
@@ -2543,44 +2646,38 @@ bool AudioIoCallback::FillOutputBuffers(
    // I would expect us not to need the fast paths, since linearly interpolated volume
    // is very cheap to process.
 
-   // ------ MEMORY ALLOCATION ----------------------
-   // These are small structures.
-   const auto tempBufs = stackAllocate(float *, numPlaybackChannels);
-
-   // And these are larger structures....
-   for (unsigned int c = 0; c < numPlaybackChannels; c++)
-      tempBufs[c] = stackAllocate(float, framesPerBuffer);
-   // ------ End of MEMORY ALLOCATION ---------------
-
    auto playbackVolume = ExpGain(GetMixerOutputVol());
    if (mForceFadeOut.load(std::memory_order_relaxed) || IsPaused())
       playbackVolume = 0.0;
 
    for(unsigned n = 0; n < numPlaybackChannels; ++n)
    {
-      decltype(framesPerBuffer) len = mPlaybackBuffers[n]->Get(
-         reinterpret_cast<samplePtr>(tempBufs[n]),
-         floatSample,
-         toGet
-      );
-      if(len < framesPerBuffer)
-      {
-         // This used to happen normally at the end of non-looping
-         // plays, but it can also be an anomalous case where the
-         // supply from SequenceBufferExchange fails to keep up with the
-         // real-time demand in this thread (see bug 1932).  We
-         // must supply something to the sound card, so pad it with
-         // zeroes and not random garbage.
-         memset((void*)&tempBufs[n][len], 0,
-            (framesPerBuffer - len) * sizeof(float));
-      }
+      // Read the ring buffer in place, rather than copying out of it first
+      auto &ringBuffer = *mPlaybackBuffers[n];
+      const auto blocks = ringBuffer.GetReadable(toGet);
+      decltype(framesPerBuffer) got = blocks[0].second + blocks[1].second;
+
+      // Samples past `got` are taken as zero.
+      // This used to happen normally at the end of non-looping
+      // plays, but it can also be an anomalous case where the
+      // supply from SequenceBufferExchange fails to keep up with the
+      // real-time demand in this thread (see bug 1932).  We
+      // must supply something to the sound card, so pad it with
+      // zeroes and not random garbage.
+      const auto forEachSample = [&](auto &&visit) {
+         size_t i = 0;
+         for (const auto &[ptr, size] : blocks) {
+            const auto floats = reinterpret_cast<const float *>(ptr);
+            for (size_t j = 0; j < size; ++j)
+               visit(i++, floats[j]);
+         }
+      };
 
       // PRL:  More recent rewrites of SequenceBufferExchange should guarantee a
       // padding out of the ring buffers so that equal lengths are
       // available, so maxLen ought to increase from 0 only once
-      mMaxFramesOutput = std::max(mMaxFramesOutput, len);
-
-      len = mMaxFramesOutput;
+      mMaxFramesOutput = std::max(mMaxFramesOutput, got);
+      auto len = mMaxFramesOutput;
 
       // Realtime effect transformation of the sound used to happen here
       // but it is now done already on the producer side of the RingBuffer
@@ -2600,9 +2697,10 @@ bool AudioIoCallback::FillOutputBuffers(
          // apply volume, then copy to the output buffer
          if(outputMeterFloats != outputFloats)
          {
-            for ( unsigned i = 0; i < len; ++i)
+            forEachSample([&](size_t i, float sample) {
                outputMeterFloats[numPlaybackChannels*i+n] +=
-                  playbackVolume*tempBufs[n][i];
+                  playbackVolume*sample;
+            });
          }
 
          auto oldVolume = mOldPlaybackVolume;
@@ -2615,12 +2713,12 @@ bool AudioIoCallback::FillOutputBuffers(
          // framesPerBuffer, which is influenced by the portAudio implementation in
          // opaque ways
          const float deltaVolume = (playbackVolume - oldVolume) / len;
-         for (unsigned i = 0; i < len; i++)
-         {
+         forEachSample([&](size_t i, float sample) {
             outputFloats[numPlaybackChannels * i + n] +=
-               (oldVolume + deltaVolume * i) * tempBufs[n][i];
-         }
+               (oldVolume + deltaVolume * i) * sample;
+         });
       }
+      ringBuffer.Consume(got);
       CallbackCheckCompletion(mCallbackReturn, len);
    }
 
@@ -2655,8 +2753,7 @@ void AudioIoCallback::UpdateTimePosition(unsigned long framesPerBuffer)
 void AudioIoCallback::DrainInputBuffers(
    constSamplePtr inputBuffer,
    unsigned long framesPerBuffer,
-   const PaStreamCallbackFlags statusFlags,
-   float * tempFloats
+   const PaStreamCallbackFlags statusFlags
 )
 {
    const auto numPlaybackChannels = mNumPlaybackChannels;
@@ -2727,52 +2824,49 @@ void AudioIoCallback::DrainInputBuffers(
    if (len <= 0)
       return;
 
-   // We have an ASSERT in the AudioIO constructor to alert us to
-   // possible issues with the (short*) cast.  We'd have a problem if
-   // sizeof(short) > sizeof(float) since our buffers are sized for floats.
    for(unsigned t = 0; t < numCaptureChannels; t++) {
-
-      // dmazzoni:
-      // Un-interleave.  Ugly special-case code required because the
-      // capture channels could be in three different sample formats;
-      // it'd be nice to be able to call CopySamples, but it can't
-      // handle multiplying by the gain and then clipping.  Bummer.
-
-      switch(mCaptureFormat) {
-         case floatSample: {
-            auto inputFloats = (const float *)inputBuffer;
-            for(unsigned i = 0; i < len; i++)
-               tempFloats[i] =
-                  inputFloats[numCaptureChannels*i+t];
-         } break;
-         case int24Sample:
-            // We should never get here. Audacity's int24Sample format
-            // is different from PortAudio's sample format and so we
-            // make PortAudio return float samples when recording in
-            // 24-bit samples.
-            wxASSERT(false);
-            break;
-         case int16Sample: {
-            auto inputShorts = (const short *)inputBuffer;
-            short *tempShorts = (short *)tempFloats;
-            for( unsigned i = 0; i < len; i++) {
-               float tmp = inputShorts[numCaptureChannels*i+t];
-               tmp = std::clamp(tmp, -32768.0f, 32767.0f);
-               tempShorts[i] = (short)(tmp);
-            }
-         } break;
-      } // switch
-
-      // JKC: mCaptureFormat must be for samples with sizeof(float) or
-      // fewer bytes (because tempFloats is sized for floats).  All
-      // formats are 2 or 4 bytes, so we are OK.
-      const auto put =
-         mCaptureBuffers[t]->Put(
-            (samplePtr)tempFloats, mCaptureFormat, len);
+      // Un-interleave straight into the ring buffer, which has the capture
+      // format; len is no more than AvailForPut()
+      auto &ringBuffer = *mCaptureBuffers[t];
+      size_t i = 0;
+      for (const auto &[ptr, size] : ringBuffer.GetWritable(len)) {
+         // dmazzoni:
+         // Un-interleave.  Ugly special-case code required because the
+         // capture channels could be in three different sample formats;
+         // it'd be nice to be able to call CopySamples, but it can't
+         // handle multiplying by the gain and then clipping.  Bummer.
+
+         switch(mCaptureFormat) {
+            case floatSample: {
+               auto inputFloats = (const float *)inputBuffer;
+               auto outputFloats = (float *)ptr;
+               for(size_t j = 0; j < size; j++, i++)
+                  outputFloats[j] =
+                     inputFloats[numCaptureChannels*i+t];
+            } break;
+            case int24Sample:
+               // We should never get here. Audacity's int24Sample format
+               // is different from PortAudio's sample format and so we
+               // make PortAudio return float samples when recording in
+               // 24-bit samples.
+               wxASSERT(false);
+               break;
+            case int16Sample: {
+               auto inputShorts = (const short *)inputBuffer;
+               auto outputShorts = (short *)ptr;
+               for(size_t j = 0; j < size; j++, i++) {
+                  float tmp = inputShorts[numCaptureChannels*i+t];
+                  tmp = std::clamp(tmp, -32768.0f, 32767.0f);
+                  outputShorts[j] = (short)(tmp);
+               }
+            } break;
+         } // switch
+      }
+      const auto put = ringBuffer.Commit(len);
       // wxASSERT(put == len);
       // but we can't assert in this thread
       wxUnusedVar(put);
-      mCaptureBuffers[t]->Flush();
+      ringBuffer.Flush();
    }
 }
 
@@ -3038,8 +3132,9 @@ int AudioIoCallback::AudioCallback(
    DrainInputBuffers(
       inputBuffer,
       framesPerBuffer,
-      statusFlags,
-      tempFloats);
+      statusFlags);
+
+   WakeAudioThreadIfNeeded();
 
    SendVuOutputMeterData( outputMeterFloats, framesPerBuffer);
 
@@ -3133,6 +3228,7 @@ auto AudioIoCallback::AudioIOExtIterator::operator *() const -> AudioIOExt &
 void AudioIoCallback::StartAudioThread()
 {
    mAudioThreadSequenceBufferExchangeLoopRunning.store(true, std::memory_order_release);
+   WakeAudioThread();
 }
 
 void AudioIoCallback::WaitForAudioThreadStarted()
@@ -3148,6 +3244,7 @@ void AudioIoCallback::WaitForAudioThreadStarted()
 void AudioIoCallback::StopAudioThread()
 {
    mAudioThreadSequenceBufferExchangeLoopRunning.store(false, std::memory_order_release);
+   WakeAudioThread();
 }
 
 void AudioIoCallback::WaitForAudioThreadStopped()
@@ -3164,6 +3261,7 @@ void AudioIoCallback::ProcessOnceAndWait(std::chrono::milliseconds sleepTime)
 {
    mAudioThreadShouldCallSequenceBufferExchangeOnce
       .store(true, std::memory_order_release);
+   WakeAudioThread();
 
    while (mAudioThreadShouldCallSequenceBufferExchangeOnce
       .load(std::memory_order_acquire))
@@ -3173,6 +3271,34 @@ void AudioIoCallback::ProcessOnceAndWait(std::chrono::milliseconds sleepTime)
    }
 }
 
+void AudioIoCallback::WakeAudioThread()
+{
+   // Notify only on the transition, so that a callback finding the buffers
+   // still low does not signal again before the audio thread has run.
+   // Notifying without the mutex may let the signal arrive just before the
+   // audio thread waits; then the flag is seen at its next timed pass.
+   if (!mAudioThreadWakeRequested.exchange(true, std::memory_order_acq_rel))
+      mAudioThreadWakeup.notify_one();
+}
+
+void AudioIoCallback::WakeAudioThreadIfNeeded()
+{
+   if (!mAudioThreadSequenceBufferExchangeLoopRunning
+      .load(std::memory_order_relaxed))
+      return;
+
+   // The same thresholds at which FillPlayBuffers and DrainRecordBuffers
+   // find a batch worth copying
+   const bool playbackLow = !mPlaybackBuffers.empty() &&
+      MinValue(mPlaybackBuffers, &RingBuffer::AvailForPut) >=
+         mPlaybackSamplesToCopy;
+   const bool captureHigh = !mCaptureBuffers.empty() &&
+      MinValue(mCaptureBuffers, &RingBuffer::AvailForGet) >=
+         mMinCaptureSecsToCopy * mRate;
+   if (playbackLow || captureHigh)
+      WakeAudioThread();
+}
+
 
 
 bool AudioIO::IsCapturing() const
@@ -3185,3 +3311,5 @@ bool AudioIO::IsCapturing() const
 }
 
 BoolSetting SoundActivatedRecord{ "/AudioIO/SoundActivatedRecord", false };
+DoubleSetting AudioIOPrefetchDepth{ "/AudioIO/PrefetchDepth", 8.0 };
+IntSetting AudioIOPrefetchBlocks{ "/AudioIO/PrefetchBlocks", 64 };
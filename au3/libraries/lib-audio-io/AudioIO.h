@@ -15,8 +15,10 @@
 
 #include "AudioIOBase.h" // to inherit
 #include "AudioIOSequences.h"
+#include "PlaybackPrefetcher.h" // member variable
 #include "PlaybackSchedule.h" // member variable
 
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -199,8 +201,7 @@ public:
    void DrainInputBuffers(
       constSamplePtr inputBuffer,
       unsigned long framesPerBuffer,
-      const PaStreamCallbackFlags statusFlags,
-      float * tempFloats
+      const PaStreamCallbackFlags statusFlags
    );
    void UpdateTimePosition(
       unsigned long framesPerBuffer
@@ -248,6 +249,13 @@ public:
    std::vector<std::vector<float>> mMasterBuffers;
    /*! Read by worker threads but unchanging during playback */
    RingBuffers mPlaybackBuffers;
+   //! Capacity of each of mPlaybackBuffers, so no slice of playback is longer
+   size_t mPlaybackBufferSize{};
+   //! Lengths of the slices of one pass of ProcessPlaybackSlices(), and for
+   //! each slice and sequence, the position of the slice in the sequence's
+   //! timeline, or negative if not contiguous; kept to reuse their storage
+   std::vector<size_t> mSliceFrames;
+   std::vector<sampleCount> mSlicePositions;
    ConstPlayableSequences      mPlaybackSequences;
    // Old volume is used in playback in linearly interpolating
    // the volume.
@@ -257,6 +265,8 @@ public:
    std::vector<float *> mScratchPointers; //!< pointing into mScratchBuffers
 
    std::vector<std::unique_ptr<Mixer>> mPlaybackMixers;
+   //! Loads sample data ahead of the mixers, in worker threads
+   PlaybackPrefetcher mPrefetcher;
 
    std::atomic<float>  mMixerOutputVol{ 1.0 };
    static int          mNextStreamToken;
@@ -296,6 +306,19 @@ public:
 
    std::atomic<Acknowledge>  mAudioThreadAcknowledge;
 
+   //! Guards nothing but the waits on mAudioThreadWakeup
+   std::mutex mAudioThreadWakeMutex;
+   std::condition_variable mAudioThreadWakeup;
+   //! Set when the audio thread has work to do before its next timed pass
+   std::atomic<bool> mAudioThreadWakeRequested{ false };
+
+   //! Lets the audio thread begin its next pass at once
+   /*! Does not lock, so it is callable from the PortAudio callback */
+   void WakeAudioThread();
+   //! Called from the PortAudio callback after it consumes or produces
+   //! samples; wakes the audio thread if a batch is ready to exchange
+   void WakeAudioThreadIfNeeded();
+
    // Async start/stop + wait of AudioThread processing.
    // Provided to allow more flexibility, however use with caution:
    // never call Stop between Start and the wait for Started (and the converse)
@@ -538,6 +561,11 @@ public:
     */
    double GetStreamTime();
 
+   //! How often the audio thread found sample data already loaded by the
+   //! prefetcher, since the start of the most recent stream
+   PlaybackPrefetcher::Statistics GetPrefetchStatistics() const
+   { return mPrefetcher.GetStatistics(); }
+
    static void AudioThread(std::atomic<bool> &finish);
 
    static void Init();
@@ -582,6 +610,10 @@ private:
    //! First part of SequenceBufferExchange
    void FillPlayBuffers();
 
+   //! Part of FillPlayBuffers; request loading of what the mixers will read
+   //! next
+   void PrefetchPlayback();
+
    bool ProcessPlaybackSlices(
       std::optional<RealtimeEffects::ProcessingScope> &pScope,
       size_t available);
@@ -626,5 +658,9 @@ private:
 };
 
 AUDIO_IO_API extern BoolSetting SoundActivatedRecord;
+//! Seconds of sequence time ahead of playback to load in worker threads
+AUDIO_IO_API extern DoubleSetting AudioIOPrefetchDepth;
+//! Most sample blocks to hold in memory for playback
+AUDIO_IO_API extern IntSetting AudioIOPrefetchBlocks;
 
 #endif
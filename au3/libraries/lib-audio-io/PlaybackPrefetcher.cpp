@@ -0,0 +1,224 @@
+/**********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file PlaybackPrefetcher.cpp
+
+ **********************************************************************/
+
+#include "PlaybackPrefetcher.h"
+
+#include "AudioIOSequences.h"
+#include "MemoryX.h"
+#include "concurrency/ThreadPool.h"
+
+#include <chrono>
+
+using audacity::concurrency::ThreadPool;
+using namespace std::chrono_literals;
+
+namespace {
+// Enough for some seconds of audio thread iterations with many sequences
+constexpr size_t MessageQueueSize = 1024;
+
+// Bounds the wait of the service thread, in case a wake-up was missed
+constexpr auto ServiceInterval = 50ms;
+}
+
+PlaybackPrefetcher::PlaybackPrefetcher()
+   : mMessages{ MessageQueueSize }
+{
+}
+
+PlaybackPrefetcher::~PlaybackPrefetcher()
+{
+   StopService();
+   // The pool outlives this; wait for the loads that would store here
+   std::unique_lock lock{ mMutex };
+   mLoaded.wait(lock, [this]{ return mLoading == 0; });
+}
+
+void PlaybackPrefetcher::Reset(double depth, size_t capacity)
+{
+   Stop();
+   mDepth = depth;
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mCapacity = capacity;
+   }
+   mHits.store(0, std::memory_order_relaxed);
+   mMisses.store(0, std::memory_order_relaxed);
+   if (mDepth > 0 && mCapacity > 0)
+      mServiceThread = std::thread{ [this]{ Service(); } };
+}
+
+void PlaybackPrefetcher::Stop()
+{
+   StopService();
+   Clear();
+}
+
+void PlaybackPrefetcher::StopService()
+{
+   if (!mServiceThread.joinable())
+      return;
+   {
+      // Under the mutex, so that the signal cannot come between the service
+      // thread's test of the flag and its wait
+      std::lock_guard<std::mutex> lock{ mWakeMutex };
+      mStopping.store(true, std::memory_order_relaxed);
+   }
+   mWakeup.notify_one();
+   mServiceThread.join();
+   mStopping.store(false, std::memory_order_relaxed);
+}
+
+void PlaybackPrefetcher::Clear()
+{
+   // Destroy the data outside of the lock
+   Entries entries;
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      // Messages still queued may point to sequences about to be destroyed;
+      // the service thread discards them
+      mGeneration.fetch_add(1, std::memory_order_relaxed);
+      entries.swap(mEntries);
+      mIndex.clear();
+      mPending.clear();
+      mAccounted.clear();
+   }
+}
+
+void PlaybackPrefetcher::Account(
+   const PlayableSequence &sequence, double t0, double t1)
+{
+   Post(sequence, t0, t1, false);
+}
+
+void PlaybackPrefetcher::Request(
+   const PlayableSequence &sequence, double t0, double t1)
+{
+   Post(sequence, t0, t1, true);
+}
+
+void PlaybackPrefetcher::Post(
+   const PlayableSequence &sequence, double t0, double t1, bool request)
+{
+   if (mDepth <= 0 || mCapacity == 0)
+      return;
+   // If the service thread falls behind, drop the message; prefetching is
+   // only advisory
+   if (!mMessages.TryPush(Message{ &sequence, t0, t1,
+      mGeneration.load(std::memory_order_relaxed), request }))
+      return;
+   // As AudioIoCallback::WakeAudioThread does:  notify without the mutex,
+   // and only on the transition; a missed signal is seen at the next timed
+   // pass
+   if (!mWakeRequested.exchange(true, std::memory_order_acq_rel))
+      mWakeup.notify_one();
+}
+
+void PlaybackPrefetcher::Service()
+{
+   Message message;
+   while (true) {
+      while (mMessages.TryPop(message)) {
+         if (message.request)
+            DoRequest(message);
+         else
+            DoAccount(message);
+      }
+
+      std::unique_lock lock{ mWakeMutex };
+      mWakeup.wait_for(lock, ServiceInterval, [this]{
+         return mStopping.load(std::memory_order_relaxed) ||
+            mWakeRequested.exchange(false, std::memory_order_acq_rel);
+      });
+      if (mStopping.load(std::memory_order_relaxed))
+         return;
+   }
+}
+
+void PlaybackPrefetcher::DoAccount(const Message &message)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   // The generation changes only under the lock, so the sequence is still
+   // alive if it matches
+   if (message.generation != mGeneration.load(std::memory_order_relaxed))
+      return;
+   message.pSequence->VisitPrefetchItems(message.t0, message.t1,
+      [this](PlayableSequence::PrefetchItem item) {
+         const auto iter = mIndex.find(item.key);
+         if (iter != mIndex.end())
+            mEntries.splice(mEntries.begin(), mEntries, iter->second);
+         if (!mAccounted.insert(item.key).second)
+            return;
+         if (iter != mIndex.end())
+            mHits.fetch_add(1, std::memory_order_relaxed);
+         else
+            mMisses.fetch_add(1, std::memory_order_relaxed);
+      });
+}
+
+void PlaybackPrefetcher::DoRequest(const Message &message)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   const auto generation = mGeneration.load(std::memory_order_relaxed);
+   if (message.generation != generation)
+      return;
+   message.pSequence->VisitPrefetchItems(message.t0, message.t1,
+      [this, generation](PlayableSequence::PrefetchItem item) {
+         if (mIndex.count(item.key) || !mPending.insert(item.key).second)
+            return;
+         ++mLoading;
+         ThreadPool::Shared().Enqueue([this, generation,
+            key = item.key, load = std::move(item.load)]{
+               Data data;
+               try {
+                  data = load();
+               }
+               catch (...) {
+                  // Leave the reading and any error reporting to the
+                  // audio thread
+               }
+               Store(generation, key, std::move(data));
+            });
+      });
+}
+
+auto PlaybackPrefetcher::GetStatistics() const -> Statistics
+{
+   return {
+      mHits.load(std::memory_order_relaxed),
+      mMisses.load(std::memory_order_relaxed)
+   };
+}
+
+void PlaybackPrefetcher::Store(unsigned generation, Key key, Data data)
+{
+   // Destroy evicted data outside of the lock
+   Entries evicted;
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      // Notify under the lock, so that the destructor can not finish first
+      Finally Do{ [this]{
+         if (--mLoading == 0)
+            mLoaded.notify_all();
+      } };
+      if (generation != mGeneration.load(std::memory_order_relaxed))
+         return;
+      mPending.erase(key);
+      if (!data || mIndex.count(key))
+         return;
+
+      mEntries.emplace_front(key, std::move(data));
+      mIndex[key] = mEntries.begin();
+
+      while (mEntries.size() > mCapacity) {
+         // Count it again if it is read again
+         mAccounted.erase(mEntries.back().first);
+         mIndex.erase(mEntries.back().first);
+         evicted.splice(evicted.end(), mEntries, std::prev(mEntries.end()));
+      }
+   }
+}
@@ -0,0 +1,154 @@
+/**********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file PlaybackPrefetcher.h
+ @brief Warms sample data ahead of the playback position
+
+ **********************************************************************/
+
+#ifndef __AUDACITY_PLAYBACK_PREFETCHER__
+#define __AUDACITY_PLAYBACK_PREFETCHER__
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "SPSCQueue.h"
+
+struct PlayableSequence;
+
+//! Loads the sample data that playback will soon need, in worker threads,
+//! and holds it in a bounded least-recently-used cache
+/*!
+ The audio thread, which fills the playback ring buffers, then finds the data
+ in memory rather than waiting on the database.
+
+ The audio thread only pushes intervals into a wait-free queue and wakes a
+ service thread, which visits the sequences, does the bookkeeping under a
+ lock, and starts the loads.  The service thread runs only from Reset() to
+ Stop().
+ */
+class AUDIO_IO_API PlaybackPrefetcher final
+{
+public:
+   struct Statistics {
+      //! Pieces of data found resident when first about to be read
+      size_t hits{};
+      //! Pieces of data not yet resident when first about to be read
+      size_t misses{};
+   };
+
+   PlaybackPrefetcher();
+   ~PlaybackPrefetcher();
+
+   //! @section Called by the main thread while the audio thread is idle
+
+   //! Empty the cache and the statistics, apply new limits, and start the
+   //! service thread if prefetching
+   /*!
+    @param depth seconds of sequence time to look ahead; no prefetching if
+    not positive
+    @param capacity most pieces of data to hold
+    */
+   void Reset(double depth, size_t capacity);
+
+   //! Stop the service thread and release all cached data, but keep the
+   //! statistics
+   void Stop();
+
+   //! Release all cached data, but keep the statistics
+   void Clear();
+
+   //! @section Called by the audio thread
+
+   double GetDepth() const { return mDepth; }
+
+   //! Count hits and misses for data about to be read, and mark hits as
+   //! recently used
+   /*!
+    Does not block or allocate.  Each piece of data is counted once, until
+    it is evicted.
+    @pre `t0 <= t1`
+    */
+   void Account(const PlayableSequence &sequence, double t0, double t1);
+
+   //! Start loading of data in the interval that is not yet resident or
+   //! pending
+   /*!
+    Does not block or allocate.
+    @pre `t0 <= t1`
+    */
+   void Request(const PlayableSequence &sequence, double t0, double t1);
+
+   //! @section Called by any thread
+
+   Statistics GetStatistics() const;
+
+private:
+   using Key = long long;
+   using Data = std::shared_ptr<const void>;
+   using Entries = std::list<std::pair<Key, Data>>;
+
+   //! What the audio thread hands to the service thread
+   struct Message {
+      const PlayableSequence *pSequence{};
+      double t0{};
+      double t1{};
+      unsigned generation{};
+      bool request{};
+   };
+
+   void Post(
+      const PlayableSequence &sequence, double t0, double t1, bool request);
+
+   //! Stop and join the service thread, if it runs
+   void StopService();
+
+   //! @section Called by the service thread
+
+   void Service();
+   void DoAccount(const Message &message);
+   void DoRequest(const Message &message);
+
+   //! Called by a worker thread, last, for each load started
+   void Store(unsigned generation, Key key, Data data);
+
+   SPSCQueue<Message> mMessages;
+
+   mutable std::mutex mMutex;
+   //! Most recently used first
+   Entries mEntries;
+   std::unordered_map<Key, Entries::iterator> mIndex;
+   std::unordered_set<Key> mPending;
+   //! Keys already counted as hits or misses
+   std::unordered_set<Key> mAccounted;
+   //! Loads started in the shared pool and not yet stored, which the
+   //! destructor waits for
+   size_t mLoading{ 0 };
+   std::condition_variable mLoaded;
+   //! Incremented by Reset and Clear, so that late loads and messages are
+   //! discarded; changed only under mMutex
+   std::atomic<unsigned> mGeneration{ 0 };
+
+   double mDepth{ 0 };
+   size_t mCapacity{ 0 };
+
+   std::atomic<size_t> mHits{ 0 };
+   std::atomic<size_t> mMisses{ 0 };
+
+   //! Guards nothing but the waits on mWakeup
+   std::mutex mWakeMutex;
+   std::condition_variable mWakeup;
+   //! Set when messages were posted since the service thread last woke
+   std::atomic<bool> mWakeRequested{ false };
+   std::atomic<bool> mStopping{ false };
+   std::thread mServiceThread;
+};
+
+#endif
@@ -207,6 +207,32 @@ std::pair<samplePtr, size_t> RingBuffer::GetUnflushed(unsigned iBlock)
          size1 };
 }
 
+auto RingBuffer::GetWritable(size_t samples) -> Blocks<samplePtr>
+{
+   // Acquire, as in Put(), so that reading done by the reader before it
+   // released this space happens-before our writing
+   auto start = mStart.load( std::memory_order_acquire );
+   samples = std::min( samples, Free( start, mWritten ) );
+
+   const size_t size0 = std::min( samples, mBufferSize - mWritten );
+   const size_t size1 = samples - size0;
+   const auto sampleSize = SAMPLE_SIZE(mFormat);
+   return {{
+      { size0 ? mBuffer.ptr() + mWritten * sampleSize : nullptr, size0 },
+      { size1 ? mBuffer.ptr() : nullptr, size1 },
+   }};
+}
+
+size_t RingBuffer::Commit(size_t samples)
+{
+   // The reader may only have freed more space since GetWritable()
+   auto start = mStart.load( std::memory_order_relaxed );
+   samples = std::min( samples, Free( start, mWritten ) );
+   mWritten = (mWritten + samples) % mBufferSize;
+   mLastPadding = 0;
+   return samples;
+}
+
 void RingBuffer::Flush()
 {
    // Atomically update the end pointer with release, so the nonatomic writes
@@ -276,3 +302,33 @@ size_t RingBuffer::Discard(size_t samplesToDiscard)
 
    return samplesToDiscard;
 }
+
+auto RingBuffer::GetReadable(size_t samples) const -> Blocks<constSamplePtr>
+{
+   // Must match the writer's release with acquire for well defined reads of
+   // the buffer.  Take one snapshot, so that the blocks are consistent
+   auto end = mEnd.load( std::memory_order_acquire );
+   auto start = mStart.load( std::memory_order_relaxed );
+   samples = std::min( samples, Filled( start, end ) );
+
+   const size_t size0 = std::min( samples, mBufferSize - start );
+   const size_t size1 = samples - size0;
+   const auto sampleSize = SAMPLE_SIZE(mFormat);
+   return {{
+      { size0 ? mBuffer.ptr() + start * sampleSize : nullptr, size0 },
+      { size1 ? mBuffer.ptr() : nullptr, size1 },
+   }};
+}
+
+size_t RingBuffer::Consume(size_t samples)
+{
+   auto end = mEnd.load( std::memory_order_relaxed ); // get away with it here
+   auto start = mStart.load( std::memory_order_relaxed );
+   samples = std::min( samples, Filled( start, end ) );
+
+   // Unlike Discard(), the caller has read the samples in place, so that
+   // must happen-before the writer reuses the space
+   mStart.store((start + samples) % mBufferSize, std::memory_order_release);
+
+   return samples;
+}
@@ -12,10 +12,16 @@
 #define __AUDACITY_RING_BUFFER__
 
 #include "SampleFormat.h"
+#include <array>
 #include <atomic>
 
 class RingBuffer final : public NonInterferingBase {
  public:
+   //! A region of the buffer is contiguous in at most two blocks; the second
+   //! is empty unless the region wraps around the end of the buffer
+   template<typename Ptr>
+   using Blocks = std::array<std::pair<Ptr, size_t>, 2>;
+
    RingBuffer(sampleFormat format, size_t size);
    ~RingBuffer();
 
@@ -39,7 +45,18 @@ class RingBuffer final : public NonInterferingBase {
    //! Get access to written but unflushed data, which is in at most two blocks
    //! Excludes the padding of the most recent Put()
    std::pair<samplePtr, size_t> GetUnflushed(unsigned iBlock);
-   //! Flush after a sequence of Put (and/or Clear) calls to let consumer see
+   //! Get access to free space for writing in place, in the buffer's format
+   /*!
+    @return blocks of total size `min(samples, AvailForPut())`
+    */
+   Blocks<samplePtr> GetWritable(size_t samples);
+   //! Count as Put the first samples of what GetWritable() last exposed
+   /*!
+    @return how many were committed
+    */
+   size_t Commit(size_t samples);
+   //! Flush after a sequence of Put (and/or Clear, Commit) calls to let
+   //! consumer see
    void Flush();
 
    //
@@ -50,6 +67,17 @@ class RingBuffer final : public NonInterferingBase {
    //! Does not apply dithering
    size_t Get(samplePtr buffer, sampleFormat format, size_t samples);
    size_t Discard(size_t samples);
+   //! Get access to flushed data for reading in place, in the buffer's format
+   /*!
+    @return blocks of total size at most `samples`
+    */
+   Blocks<constSamplePtr> GetReadable(size_t samples) const;
+   //! Release the first samples of what GetReadable() exposed, after reading
+   //! them, so that the writer may reuse the space
+   /*!
+    @return how many were consumed
+    */
+   size_t Consume(size_t samples);
 
  private:
    size_t Filled(size_t start, size_t end) const;
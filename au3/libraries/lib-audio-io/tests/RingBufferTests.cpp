@@ -0,0 +1,189 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RingBufferTests.cpp
+
+**********************************************************************/
+#include "RingBuffer.h"
+
+#include <catch2/catch.hpp>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+// The smallest buffer; it holds 4 fewer samples than its size
+constexpr size_t Size = 64;
+constexpr size_t Capacity = Size - 4;
+
+template<typename Ptr> size_t Total(const RingBuffer::Blocks<Ptr> &blocks)
+{
+   return blocks[0].second + blocks[1].second;
+}
+
+//! Fill the writable blocks with consecutive values from `first`
+void Write(const RingBuffer::Blocks<samplePtr> &blocks, float first)
+{
+   for (auto [ptr, size] : blocks) {
+      auto floats = reinterpret_cast<float *>(ptr);
+      std::iota(floats, floats + size, first);
+      first += size;
+   }
+}
+
+//! Concatenate the readable blocks
+std::vector<float> Read(const RingBuffer::Blocks<constSamplePtr> &blocks)
+{
+   std::vector<float> result;
+   for (auto [ptr, size] : blocks) {
+      auto floats = reinterpret_cast<const float *>(ptr);
+      result.insert(result.end(), floats, floats + size);
+   }
+   return result;
+}
+
+std::vector<float> Ramp(float first, size_t size)
+{
+   std::vector<float> result(size);
+   std::iota(result.begin(), result.end(), first);
+   return result;
+}
+
+//! Put and take `size` samples, so that both positions move to `size`
+void Advance(RingBuffer &buffer, size_t size)
+{
+   REQUIRE(buffer.Commit(Total(buffer.GetWritable(size))) == size);
+   buffer.Flush();
+   REQUIRE(buffer.Consume(size) == size);
+}
+}
+
+TEST_CASE("RingBuffer in place access")
+{
+   RingBuffer buffer{ floatSample, Size };
+
+   SECTION("empty buffer exposes nothing to read")
+   {
+      const auto blocks = buffer.GetReadable(Size);
+      REQUIRE(blocks[0] == std::pair<constSamplePtr, size_t>{ nullptr, 0 });
+      REQUIRE(blocks[1] == std::pair<constSamplePtr, size_t>{ nullptr, 0 });
+      REQUIRE(buffer.Consume(1) == 0);
+      REQUIRE(buffer.AvailForGet() == 0);
+   }
+
+   SECTION("written samples are readable only after Flush")
+   {
+      Write(buffer.GetWritable(10), 0);
+      REQUIRE(buffer.Commit(10) == 10);
+      REQUIRE(Total(buffer.GetReadable(Size)) == 0);
+      buffer.Flush();
+      REQUIRE(Read(buffer.GetReadable(Size)) == Ramp(0, 10));
+   }
+
+   SECTION("full buffer exposes nothing to write")
+   {
+      const auto blocks = buffer.GetWritable(Size);
+      REQUIRE(Total(blocks) == Capacity);
+      Write(blocks, 0);
+      REQUIRE(buffer.Commit(Size) == Capacity);
+      buffer.Flush();
+      REQUIRE(buffer.AvailForPut() == 0);
+      REQUIRE(Total(buffer.GetWritable(1)) == 0);
+      REQUIRE(buffer.Commit(1) == 0);
+      REQUIRE(Read(buffer.GetReadable(Size)) == Ramp(0, Capacity));
+
+      // Consuming makes room again
+      REQUIRE(buffer.Consume(5) == 5);
+      REQUIRE(Total(buffer.GetWritable(Size)) == 5);
+   }
+
+   SECTION("regions wrap around the end of the buffer")
+   {
+      Advance(buffer, 50);
+
+      const auto writable = buffer.GetWritable(40);
+      REQUIRE(writable[0].second == Size - 50);
+      REQUIRE(writable[1].second == 40 - (Size - 50));
+      // The second block begins the storage
+      REQUIRE(writable[1].first == writable[0].first - 50 * sizeof(float));
+      Write(writable, 0);
+      REQUIRE(buffer.Commit(40) == 40);
+      buffer.Flush();
+
+      const auto readable = buffer.GetReadable(Size);
+      REQUIRE(readable[0].second == Size - 50);
+      REQUIRE(readable[1].second == 40 - (Size - 50));
+      REQUIRE(Read(readable) == Ramp(0, 40));
+      REQUIRE(buffer.Consume(40) == 40);
+      REQUIRE(buffer.AvailForGet() == 0);
+   }
+
+   SECTION("partial Commit and Consume across the wrap")
+   {
+      Advance(buffer, 50);
+
+      // Expose 40, fill them all, but count only 20 as written; they
+      // cross the end of the buffer
+      Write(buffer.GetWritable(40), 0);
+      REQUIRE(buffer.Commit(20) == 20);
+      buffer.Flush();
+      REQUIRE(buffer.AvailForGet() == 20);
+      REQUIRE(Read(buffer.GetReadable(Size)) == Ramp(0, 20));
+
+      // Consume a part that stays before the end
+      REQUIRE(buffer.Consume(10) == 10);
+      auto readable = buffer.GetReadable(Size);
+      REQUIRE(readable[0].second == Size - 60);
+      REQUIRE(readable[1].second == 6);
+      REQUIRE(Read(readable) == Ramp(10, 10));
+
+      // Consume a part that crosses the end
+      REQUIRE(buffer.Consume(7) == 7);
+      readable = buffer.GetReadable(Size);
+      REQUIRE(readable[1].second == 0);
+      REQUIRE(Read(readable) == Ramp(17, 3));
+
+      // The uncommitted samples are overwritten by the next writes
+      Write(buffer.GetWritable(5), 100);
+      REQUIRE(buffer.Commit(5) == 5);
+      buffer.Flush();
+      REQUIRE(Read(buffer.GetReadable(Size)) ==
+         std::vector<float>{ 17, 18, 19, 100, 101, 102, 103, 104 });
+
+      // A partial read of the blocks
+      readable = buffer.GetReadable(4);
+      REQUIRE(Total(readable) == 4);
+      REQUIRE(Read(readable) == std::vector<float>{ 17, 18, 19, 100 });
+   }
+
+   SECTION("Consume and Commit are bounded")
+   {
+      Write(buffer.GetWritable(8), 0);
+      REQUIRE(buffer.Commit(8) == 8);
+      buffer.Flush();
+      REQUIRE(buffer.Consume(Size) == 8);
+      REQUIRE(buffer.AvailForGet() == 0);
+      REQUIRE(buffer.Commit(Size) == Capacity);
+   }
+
+   SECTION("in place access agrees with Put and Get")
+   {
+      Advance(buffer, 55);
+
+      const auto samples = Ramp(0, 30);
+      REQUIRE(buffer.Put(reinterpret_cast<constSamplePtr>(samples.data()),
+         floatSample, samples.size()) == samples.size());
+      buffer.Flush();
+      REQUIRE(Read(buffer.GetReadable(Size)) == samples);
+
+      Write(buffer.GetWritable(20), 30);
+      REQUIRE(buffer.Commit(20) == 20);
+      buffer.Flush();
+      std::vector<float> got(50);
+      REQUIRE(buffer.Get(reinterpret_cast<samplePtr>(got.data()),
+         floatSample, got.size()) == got.size());
+      REQUIRE(got == Ramp(0, 50));
+   }
+}
@@ -179,11 +179,11 @@ size_t CompressorInstance::RealtimeProcess(
       newPacket.actualCompressionDb = frameStats.dbGainOfMaxInputSample;
       newPacket.inputDb = frameStats.maxInputSampleDb;
       newPacket.outputDb = GetOutputDb(frameStats, compressorSettings);
-      queue->Put(newPacket);
+      queue->TryPush(newPacket);
    }
 
    if (const auto queue = slave.mCompressionValueQueue.lock())
-      queue->Put(MeterValues {
+      queue->TryPush(MeterValues {
          compressor.GetLastFrameStats().dbGainOfMaxInputSample,
          GetOutputDb(
             compressor.GetLastFrameStats(), compressor.GetSettings()) });
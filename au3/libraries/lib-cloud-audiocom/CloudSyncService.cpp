@@ -231,24 +231,28 @@ bool HasAutosave(const std::string& path)
    if (!connection)
       return false;
 
-   if (!connection->CheckTableExists("autosave"))
-      return false;
+   // The autosave document may be whole, or in parts
+   for (auto table : { "autosave", "autosaveparts" })
+   {
+      if (!connection->CheckTableExists(table))
+         continue;
 
-   auto statement =
-      connection->CreateStatement("SELECT COUNT(1) FROM autosave");
+      auto statement = connection->CreateStatement(
+         std::string("SELECT COUNT(1) FROM ") + table);
 
-   if (!statement)
-      return false;
+      if (!statement)
+         return false;
 
-   auto result = statement->Prepare().Run();
+      auto result = statement->Prepare().Run();
 
-   if (!result.IsOk())
-      return false;
+      if (!result.IsOk())
+         return false;
 
-   for (const auto& row : result)
-   {
-      if (row.GetOr(0, 0) > 0)
-         return true;
+      for (const auto& row : result)
+      {
+         if (row.GetOr(0, 0) > 0)
+            return true;
+      }
    }
 
    return false;
@@ -272,7 +276,19 @@ bool DropAutosave(const std::string& path)
 
    auto result = statement->Prepare().Run();
 
-   return result.IsOk();
+   if (!result.IsOk())
+      return false;
+
+   if (!connection->CheckTableExists("autosaveparts"))
+      return true;
+
+   auto partsStatement =
+      connection->CreateStatement("DELETE FROM autosaveparts");
+
+   if (!partsStatement)
+      return false;
+
+   return partsStatement->Prepare().Run().IsOk();
 }
 
 } // namespace
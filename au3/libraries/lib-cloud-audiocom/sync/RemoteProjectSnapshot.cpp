@@ -526,6 +526,47 @@ void RemoteProjectSnapshot::OnProjectBlobDownloaded(
       return;
    }
 
+   // The local autosave document may also be in parts
+   auto partsExistStatement = db->CreateStatement(
+      "SELECT COUNT(1) FROM " + mSnapshotDBName +
+      ".sqlite_master WHERE type = 'table' AND name = 'autosaveparts'");
+
+   bool partsExist = false;
+
+   if (partsExistStatement)
+   {
+      auto partsExistResult = partsExistStatement->Prepare().Run();
+
+      for (auto row : partsExistResult)
+         partsExist = row.GetOr(0, 0) > 0;
+   }
+
+   if (partsExist)
+   {
+      auto deletePartsStatement = db->CreateStatement(
+         "DELETE FROM " + mSnapshotDBName + ".autosaveparts");
+
+      if (!deletePartsStatement)
+      {
+         OnFailure({ SyncResultCode::InternalClientError,
+                     audacity::ToUTF8(deletePartsStatement.GetError()
+                                         .GetErrorString()
+                                         .Translation()) });
+         return;
+      }
+
+      result = deletePartsStatement->Prepare().Run();
+
+      if (!result.IsOk())
+      {
+         OnFailure(
+            { SyncResultCode::InternalClientError,
+              audacity::ToUTF8(
+                 result.GetErrors().front().GetErrorString().Translation()) });
+         return;
+      }
+   }
+
    if (auto error = transaction.Commit(); error.IsError())
    {
       OnFailure({ SyncResultCode::InternalClientError,
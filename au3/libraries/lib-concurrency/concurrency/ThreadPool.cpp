@@ -0,0 +1,102 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: ThreadPool.cpp
+ */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace audacity::concurrency
+{
+ThreadPool& ThreadPool::Shared()
+{
+   // Leave a core for the thread that enqueues, which works too
+   static ThreadPool pool { std::max(2u, std::thread::hardware_concurrency()) -
+                            1 };
+   return pool;
+}
+
+ThreadPool::ThreadPool(size_t threadsCount)
+{
+   assert(threadsCount > 0);
+
+   mThreads.reserve(threadsCount);
+   for (size_t i = 0; i < threadsCount; ++i)
+      mThreads.emplace_back([this] { Run(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      auto lock = std::lock_guard { mMutex };
+      mStopping = true;
+      mTasks.clear();
+   }
+
+   mTaskAvailable.notify_all();
+
+   for (auto& thread : mThreads)
+      thread.join();
+}
+
+void ThreadPool::Enqueue(Task task)
+{
+   {
+      auto lock = std::lock_guard { mMutex };
+      mTasks.push_back(std::move(task));
+   }
+
+   mTaskAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+   auto lock = std::unique_lock { mMutex };
+   mAllDone.wait(lock, [this] { return mTasks.empty() && mBusyCount == 0; });
+}
+
+size_t ThreadPool::GetThreadsCount() const noexcept
+{
+   return mThreads.size();
+}
+
+void ThreadPool::Run()
+{
+   auto lock = std::unique_lock { mMutex };
+
+   while (true)
+   {
+      mTaskAvailable.wait(
+         lock, [this] { return mStopping || !mTasks.empty(); });
+
+      if (mStopping)
+         return;
+
+      auto task = std::move(mTasks.front());
+      mTasks.pop_front();
+      ++mBusyCount;
+
+      lock.unlock();
+
+      try
+      {
+         task();
+      }
+      catch (...)
+      {
+         // A failing task must not take the worker down with it
+      }
+
+      // Destroy captures of the task outside of the lock
+      task = {};
+
+      lock.lock();
+      --mBusyCount;
+
+      if (mTasks.empty() && mBusyCount == 0)
+         mAllDone.notify_all();
+   }
+}
+} // namespace audacity::concurrency
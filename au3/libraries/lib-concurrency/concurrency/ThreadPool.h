@@ -0,0 +1,63 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: ThreadPool.h
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace audacity::concurrency
+{
+//! A fixed set of worker threads running tasks in order of submission
+class CONCURRENCY_API ThreadPool final
+{
+public:
+   using Task = std::function<void()>;
+
+   //! The pool for work of all subsystems, one thread fewer than the cores
+   /*!
+    Its tasks must not wait for other tasks of this pool, and its users
+    must not call Wait(), which waits for the tasks of all of them.  A
+    thread that needs results should do some of the work itself, so that it
+    waits only for tasks already begun.
+    */
+   static ThreadPool& Shared();
+
+   //! @pre `threadsCount > 0`
+   explicit ThreadPool(size_t threadsCount);
+   //! Discards the tasks not yet started and joins the workers
+   ~ThreadPool();
+
+   ThreadPool(const ThreadPool&)            = delete;
+   ThreadPool(ThreadPool&&)                 = delete;
+   ThreadPool& operator=(const ThreadPool&) = delete;
+   ThreadPool& operator=(ThreadPool&&)      = delete;
+
+   //! Callable from any thread.  Exceptions escaping the task are ignored
+   void Enqueue(Task task);
+
+   //! Blocks until all the tasks enqueued so far are done
+   /*! @pre not called from a task of this pool */
+   void Wait();
+
+   size_t GetThreadsCount() const noexcept;
+
+private:
+   void Run();
+
+   std::mutex mMutex;
+   std::condition_variable mTaskAvailable;
+   std::condition_variable mAllDone;
+   std::deque<Task> mTasks;
+   size_t mBusyCount { 0 };
+   bool mStopping { false };
+
+   std::vector<std::thread> mThreads;
+}; // class ThreadPool
+} // namespace audacity::concurrency
@@ -10,7 +10,7 @@
 **********************************************************************/
 #pragma once
 
-#include "LockFreeQueue.h"
+#include "SPSCQueue.h"
 #include <array>
 #include <limits>
 #include <memory>
@@ -27,7 +27,7 @@ struct DynamicRangeProcessorOutputPacket
 };
 
 using DynamicRangeProcessorOutputPacketQueue =
-   LockFreeQueue<DynamicRangeProcessorOutputPacket>;
+   SPSCQueue<DynamicRangeProcessorOutputPacket>;
 
 struct MeterValues
 {
@@ -35,7 +35,7 @@ struct MeterValues
    float outputDb = std::numeric_limits<float>::lowest();
 };
 
-using DynamicRangeProcessorMeterValuesQueue = LockFreeQueue<MeterValues>;
+using DynamicRangeProcessorMeterValuesQueue = SPSCQueue<MeterValues>;
 
 struct InitializeProcessingSettings
 {
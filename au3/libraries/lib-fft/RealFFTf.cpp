@@ -37,11 +37,17 @@
 */
 
 #include "RealFFTf.h"
+#include "PowerSpectrumGetter.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <vector>
 #include <stdlib.h>
 #include <math.h>
 
+#include <pffft.h>
+
 #include <wx/thread.h>
 
 #ifndef M_PI
@@ -83,6 +89,10 @@ HFFT InitializeFFT(size_t fftlen)
       h->SinTable[h->BitReversed[i]+1]=(fft_type)-cos(2*M_PI*i/(2*h->Points));
    }
 
+   if (fftlen >= static_cast<size_t>(pffft_min_fft_size(PFFFT_REAL)))
+      if (const auto setup = pffft_new_setup(fftlen, PFFFT_REAL))
+         h->PffftSetup = { setup, pffft_destroy_setup };
+
    return h;
 }
 
@@ -151,7 +161,7 @@ void FFTDeleter::operator() (FFTParam *hFFT) const
 *        values would be similar in amplitude to the input values, which is
 *        good when using fixed point arithmetic)
 */
-void RealFFTf(fft_type *buffer, const FFTParam *h)
+static void ReferenceRealFFTf(fft_type *buffer, const FFTParam *h)
 {
    fft_type *A,*B;
    const fft_type *sptr;
@@ -253,7 +263,7 @@ void RealFFTf(fft_type *buffer, const FFTParam *h)
 *        values would be similar in amplitude to the input values, which is
 *        good when using fixed point arithmetic)
 */
-void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
+static void ReferenceInverseRealFFTf(fft_type *buffer, const FFTParam *h)
 {
    fft_type *A,*B;
    const fft_type *sptr;
@@ -336,6 +346,111 @@ void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
    }
 }
 
+/*
+*  pffft transforms, rearranged to the layouts of the reference ones
+*
+*  pffft wants aligned buffers, and on the stack it would allocate a work
+*  buffer too big for large transforms, so each thread has its own
+*/
+static float *PffftScratch(size_t fftlen)
+{
+   // The transformed data, then the work buffer
+   thread_local PffftFloatVector scratch;
+   if (scratch.size() < 2 * fftlen)
+      scratch.resize(2 * fftlen);
+   return scratch.data();
+}
+
+static void PffftRealFFTf(fft_type *buffer, const FFTParam *h)
+{
+   const auto fftlen = 2 * h->Points;
+   const auto data = PffftScratch(fftlen);
+   std::copy(buffer, buffer + fftlen, data);
+   pffft_transform_ordered(h->PffftSetup.get(),
+      data, data, data + fftlen, PFFFT_FORWARD);
+   // Both put the Fs/2 bin in place of the imaginary part of the DC bin
+   buffer[0] = data[0];
+   buffer[1] = data[1];
+   for (size_t i = 1; i < h->Points; ++i) {
+      buffer[h->BitReversed[i]    ] = data[2 * i    ];
+      buffer[h->BitReversed[i] + 1] = data[2 * i + 1];
+   }
+}
+
+static void PffftInverseRealFFTf(fft_type *buffer, const FFTParam *h)
+{
+   const auto fftlen = 2 * h->Points;
+   const auto data = PffftScratch(fftlen);
+   // Input is in the same order for both
+   std::copy(buffer, buffer + fftlen, data);
+   pffft_transform_ordered(h->PffftSetup.get(),
+      data, data, data + fftlen, PFFFT_BACKWARD);
+   // pffft does not scale; the reference divides by the size
+   const auto scale = 1.0f / fftlen;
+   for (size_t i = 0; i < h->Points; ++i) {
+      buffer[h->BitReversed[i]    ] = data[2 * i    ] * scale;
+      buffer[h->BitReversed[i] + 1] = data[2 * i + 1] * scale;
+   }
+}
+
+static std::atomic<FFTBackend> sBackend{ FFTBackend::PFFFT };
+
+bool IsFFTBackendAvailable(FFTBackend backend, const FFTParam *h)
+{
+   switch (backend) {
+   case FFTBackend::Reference:
+      return true;
+   case FFTBackend::PFFFT:
+      return h->PffftSetup != nullptr;
+   default:
+      return false;
+   }
+}
+
+FFTBackend GetFFTBackend()
+{
+   return sBackend.load(std::memory_order_relaxed);
+}
+
+void SetFFTBackend(FFTBackend backend)
+{
+   sBackend.store(backend, std::memory_order_relaxed);
+}
+
+static FFTBackend ChooseBackend(const FFTParam *h)
+{
+   const auto backend = GetFFTBackend();
+   return IsFFTBackendAvailable(backend, h) ? backend : FFTBackend::Reference;
+}
+
+void RealFFTf(fft_type *buffer, const FFTParam *h)
+{
+   RealFFTf(ChooseBackend(h), buffer, h);
+}
+
+void InverseRealFFTf(fft_type *buffer, const FFTParam *h)
+{
+   InverseRealFFTf(ChooseBackend(h), buffer, h);
+}
+
+void RealFFTf(FFTBackend backend, fft_type *buffer, const FFTParam *h)
+{
+   assert(IsFFTBackendAvailable(backend, h));
+   if (backend == FFTBackend::PFFFT)
+      PffftRealFFTf(buffer, h);
+   else
+      ReferenceRealFFTf(buffer, h);
+}
+
+void InverseRealFFTf(FFTBackend backend, fft_type *buffer, const FFTParam *h)
+{
+   assert(IsFFTBackendAvailable(backend, h));
+   if (backend == FFTBackend::PFFFT)
+      PffftInverseRealFFTf(buffer, h);
+   else
+      ReferenceInverseRealFFTf(buffer, h);
+}
+
 void ReorderToFreq(const FFTParam *hFFT, const fft_type *buffer,
 		   fft_type *RealOut, fft_type *ImagOut)
 {
@@ -3,11 +3,15 @@
 
 #include "MemoryX.h"
 
+struct PFFFT_Setup;
+
 using fft_type = float;
 struct FFTParam {
    ArrayOf<int> BitReversed;
    ArrayOf<fft_type> SinTable;
    size_t Points;
+   //! Null if pffft does not support the size
+   std::shared_ptr<PFFFT_Setup> PffftSetup;
 };
 
 struct FFT_API FFTDeleter{
@@ -18,9 +22,35 @@ using HFFT = std::unique_ptr<
    FFTParam, FFTDeleter
 >;
 
+//! Implementations of RealFFTf and InverseRealFFTf
+/*!
+ All give the same layout of results, which agree up to rounding
+ */
+enum class FFTBackend {
+   //! The original, portable implementation, for reference
+   Reference,
+   //! pffft, using SIMD instructions where available
+   PFFFT,
+};
+
+//! Whether the backend supports transforms of the given handle's size
+FFT_API bool IsFFTBackendAvailable(FFTBackend backend, const FFTParam *);
+
+//! The backend that RealFFTf and InverseRealFFTf use when available,
+//! else falling back to Reference; initially PFFFT
+FFT_API FFTBackend GetFFTBackend();
+FFT_API void SetFFTBackend(FFTBackend backend);
+
 FFT_API HFFT GetFFT(size_t);
 FFT_API void RealFFTf(fft_type *, const FFTParam *);
 FFT_API void InverseRealFFTf(fft_type *, const FFTParam *);
+//! Like the other overload, but using the given backend
+/*! @pre `IsFFTBackendAvailable(backend, h)` */
+FFT_API void RealFFTf(FFTBackend backend, fft_type *, const FFTParam *h);
+//! Like the other overload, but using the given backend
+/*! @pre `IsFFTBackendAvailable(backend, h)` */
+FFT_API void InverseRealFFTf(
+   FFTBackend backend, fft_type *, const FFTParam *h);
 FFT_API void ReorderToTime(const FFTParam *hFFT, const fft_type *buffer, fft_type *TimeOut);
 FFT_API void ReorderToFreq(const FFTParam *hFFT, const fft_type *buffer,
 		   fft_type *RealOut, fft_type *ImagOut);
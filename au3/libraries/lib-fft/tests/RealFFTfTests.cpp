@@ -0,0 +1,134 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealFFTfTests.cpp
+
+**********************************************************************/
+#include "RealFFTf.h"
+#include "BenchmarkUtils.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using BenchmarkUtils::RandomSamples;
+
+namespace
+{
+const auto allBackends = { FFTBackend::Reference, FFTBackend::PFFFT };
+
+const char* BackendName(FFTBackend backend)
+{
+   switch (backend)
+   {
+   case FFTBackend::Reference:
+      return "Reference";
+   case FFTBackend::PFFFT:
+      return "PFFFT";
+   default:
+      return "?";
+   }
+}
+
+float MaxDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+   float result = 0;
+   for (size_t ii = 0; ii < a.size(); ++ii)
+      result = std::max(result, std::abs(a[ii] - b[ii]));
+   return result;
+}
+} // namespace
+
+TEST_CASE("FFT backends", "[FFTBackend]")
+{
+   for (size_t fftLen = 8; fftLen <= 65536; fftLen *= 2)
+   {
+      INFO("size " << fftLen);
+      const auto hFFT = GetFFT(fftLen);
+      REQUIRE(IsFFTBackendAvailable(FFTBackend::Reference, hFFT.get()));
+      // pffft has a minimum size
+      REQUIRE(
+         IsFFTBackendAvailable(FFTBackend::PFFFT, hFFT.get()) ==
+         (fftLen >= 32));
+      if (!IsFFTBackendAvailable(FFTBackend::PFFFT, hFFT.get()))
+         continue;
+
+      const auto input = RandomSamples(fftLen, fftLen);
+      // Rounding errors grow with the size
+      const auto tolerance = 1e-5f * fftLen;
+
+      SECTION("forward transforms agree")
+      {
+         auto expected = input, actual = input;
+         RealFFTf(FFTBackend::Reference, expected.data(), hFFT.get());
+         RealFFTf(FFTBackend::PFFFT, actual.data(), hFFT.get());
+         REQUIRE(MaxDifference(expected, actual) < tolerance);
+      }
+
+      SECTION("inverse transforms agree")
+      {
+         auto expected = input, actual = input;
+         InverseRealFFTf(FFTBackend::Reference, expected.data(), hFFT.get());
+         InverseRealFFTf(FFTBackend::PFFFT, actual.data(), hFFT.get());
+         REQUIRE(MaxDifference(expected, actual) < tolerance);
+      }
+
+      SECTION("round trips restore the input")
+      {
+         for (const auto backend : allBackends)
+         {
+            INFO(BackendName(backend));
+            auto buffer = input;
+            RealFFTf(backend, buffer.data(), hFFT.get());
+            // The forward output is bit-reversed; the inverse wants it in
+            // order
+            std::vector<float> reordered(fftLen);
+            reordered[0] = buffer[0];
+            reordered[1] = buffer[1];
+            for (size_t ii = 1; ii < fftLen / 2; ++ii)
+            {
+               reordered[2 * ii] = buffer[hFFT->BitReversed[ii]];
+               reordered[2 * ii + 1] = buffer[hFFT->BitReversed[ii] + 1];
+            }
+            InverseRealFFTf(backend, reordered.data(), hFFT.get());
+            std::vector<float> output(fftLen);
+            ReorderToTime(hFFT.get(), reordered.data(), output.data());
+            // The inverse divides by the size, so no scaling is needed
+            REQUIRE(MaxDifference(input, output) < 1e-4f);
+         }
+      }
+   }
+}
+
+TEST_CASE("FFT backends benchmark", "[.][benchmark][FFTBackend]")
+{
+   // Spectrogram, noise reduction and equalization sizes
+   for (size_t fftLen = 256; fftLen <= 65536; fftLen *= 2)
+   {
+      const auto hFFT = GetFFT(fftLen);
+      const auto input = RandomSamples(fftLen, 0);
+      auto buffer = input;
+      const auto repetitions = std::max<size_t>(10, (1 << 22) / fftLen);
+      for (const auto backend : allBackends)
+      {
+         if (!IsFFTBackendAvailable(backend, hFFT.get()))
+            continue;
+         float total = 0;
+         const auto elapsed = BenchmarkUtils::MeanTime(repetitions, [&] {
+            std::copy(input.begin(), input.end(), buffer.begin());
+            RealFFTf(backend, buffer.data(), hFFT.get());
+            InverseRealFFTf(backend, buffer.data(), hFFT.get());
+            total += buffer[1];
+         });
+         std::cout << "size " << fftLen << ", " << BackendName(backend)
+                   << ": " << elapsed.count()
+                   << " us per forward and inverse pair"
+                   << " (checksum " << total << ")\n";
+      }
+   }
+}
@@ -0,0 +1,152 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ExportMixer.cpp
+
+**********************************************************************/
+
+#include "ExportMixer.h"
+
+#include <cstring>
+
+#include "Mix.h"
+#include "Prefs.h"
+
+IntSetting ExportMixer::MixAheadSetting{ L"/Export/MixAheadBuffers", 4 };
+
+ExportMixer::ExportMixer(std::unique_ptr<Mixer> pMixer, unsigned numChannels,
+   bool interleaved, sampleFormat format, size_t depth)
+   : mpMixer{ move(pMixer) }
+   , mNumChannels{ numChannels }
+   , mInterleaved{ interleaved }
+   , mFormat{ format }
+   , mBufferSize{ mpMixer->BufferSize() }
+{
+   if (depth == 0)
+      return;
+
+   // One slot more than the depth, for the buffers being encoded
+   mSlots.resize(depth + 1);
+   for (auto& slot : mSlots)
+      slot.buffer.Allocate(mNumChannels * mBufferSize, mFormat);
+
+   mThread = std::thread{ [this]{ Run(); } };
+}
+
+ExportMixer::~ExportMixer()
+{
+   if (!MixesAhead())
+      return;
+   {
+      std::lock_guard lock{ mMutex };
+      mStopping = true;
+   }
+   mSlotFreed.notify_one();
+   // The thread may first finish one call to Mixer::Process()
+   mThread.join();
+}
+
+size_t ExportMixer::Process()
+{
+   if (!MixesAhead())
+      return mpMixer->Process();
+
+   std::unique_lock lock{ mMutex };
+   if (mpCurrent) {
+      mpCurrent = nullptr;
+      mReadIndex = (mReadIndex + 1) % mSlots.size();
+      --mUsedCount;
+      mSlotFreed.notify_one();
+   }
+   mSlotFilled.wait(lock, [this]{ return mFilledCount > 0 || mFinished; });
+   if (mFilledCount == 0) {
+      if (mError)
+         std::rethrow_exception(mError);
+      return 0;
+   }
+   --mFilledCount;
+   mpCurrent = &mSlots[mReadIndex];
+   return mpCurrent->count;
+}
+
+constSamplePtr ExportMixer::GetBuffer()
+{
+   if (!MixesAhead())
+      return mpMixer->GetBuffer();
+   return mpCurrent ? mpCurrent->buffer.ptr() : nullptr;
+}
+
+constSamplePtr ExportMixer::GetBuffer(int channel)
+{
+   if (!MixesAhead())
+      return mpMixer->GetBuffer(channel);
+   return mpCurrent
+      ? mpCurrent->buffer.ptr() + channel * mBufferSize * SAMPLE_SIZE(mFormat)
+      : nullptr;
+}
+
+double ExportMixer::MixGetCurrentTime()
+{
+   if (!MixesAhead())
+      return mpMixer->MixGetCurrentTime();
+   return mpCurrent ? mpCurrent->time : 0;
+}
+
+void ExportMixer::Run()
+{
+   size_t writeIndex = 0;
+   while (true) {
+      {
+         std::unique_lock lock{ mMutex };
+         mSlotFreed.wait(lock,
+            [this]{ return mStopping || mUsedCount < mSlots.size(); });
+         if (mStopping)
+            return;
+      }
+
+      // The slot is not visible to the encoding thread until counted below
+      auto& slot = mSlots[writeIndex];
+      std::exception_ptr error;
+      try {
+         Fill(slot);
+      }
+      catch (...) {
+         error = std::current_exception();
+      }
+
+      const bool done = error || slot.count == 0;
+      {
+         std::lock_guard lock{ mMutex };
+         if (done) {
+            mError = error;
+            mFinished = true;
+         }
+         else {
+            ++mFilledCount;
+            ++mUsedCount;
+         }
+      }
+      mSlotFilled.notify_one();
+      if (done)
+         return;
+      writeIndex = (writeIndex + 1) % mSlots.size();
+   }
+}
+
+void ExportMixer::Fill(Slot& slot)
+{
+   slot.count = mpMixer->Process();
+   slot.time = mpMixer->MixGetCurrentTime();
+   if (slot.count == 0)
+      return;
+
+   const auto sampleSize = SAMPLE_SIZE(mFormat);
+   if (mInterleaved)
+      memcpy(slot.buffer.ptr(), mpMixer->GetBuffer(),
+         slot.count * mNumChannels * sampleSize);
+   else
+      for (unsigned channel = 0; channel < mNumChannels; ++channel)
+         memcpy(slot.buffer.ptr() + channel * mBufferSize * sampleSize,
+            mpMixer->GetBuffer(channel), slot.count * sampleSize);
+}
@@ -0,0 +1,102 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ExportMixer.h
+
+**********************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SampleFormat.h"
+
+class IntSetting;
+class Mixer;
+
+//! Mixer for export, which mixes ahead on a thread of its own while the
+//! encoder consumes what was mixed before
+/*!
+ Mixed buffers are copied into a bounded ring, so the encoder never waits for
+ the mixer unless the ring is empty, and the mixer stops when the ring is full.
+ Exceptions from mixing are rethrown by Process(), after the buffers mixed
+ before them.
+ */
+class IMPORT_EXPORT_API ExportMixer final
+{
+public:
+   //! How many mixed buffers may wait for the encoder; 0 mixes on the thread
+   //! of the encoder
+   static IntSetting MixAheadSetting;
+
+   /*!
+    @pre `pMixer != nullptr`
+    @param numChannels, interleaved, format as given to `pMixer` when made
+    @param depth the capacity of the ring; if 0, mixing happens in Process()
+    */
+   ExportMixer(std::unique_ptr<Mixer> pMixer, unsigned numChannels,
+      bool interleaved, sampleFormat format, size_t depth);
+
+   ExportMixer(const ExportMixer&) = delete;
+   ExportMixer& operator=(const ExportMixer&) = delete;
+
+   //! Stops the mixing thread; discards what is not yet consumed
+   ~ExportMixer();
+
+   //! Like Mixer::Process(); the buffers from the previous call become invalid
+   size_t Process();
+
+   //! Retrieve the main buffer or the interleaved buffer
+   constSamplePtr GetBuffer();
+
+   //! Retrieve one of the non-interleaved buffers
+   constSamplePtr GetBuffer(int channel);
+
+   //! Time reached by the mixer when it made the buffers last returned
+   double MixGetCurrentTime();
+
+private:
+   struct Slot {
+      SampleBuffer buffer;
+      size_t count { 0 };
+      double time { 0 };
+   };
+
+   bool MixesAhead() const { return !mSlots.empty(); }
+
+   // Mixing thread
+   void Run();
+   void Fill(Slot& slot);
+
+   const std::unique_ptr<Mixer> mpMixer;
+   const unsigned mNumChannels;
+   const bool mInterleaved;
+   const sampleFormat mFormat;
+   const size_t mBufferSize;
+
+   std::vector<Slot> mSlots;
+
+   std::mutex mMutex;
+   std::condition_variable mSlotFilled;
+   std::condition_variable mSlotFreed;
+   //! Slots filled and not yet taken by Process()
+   size_t mFilledCount { 0 };
+   //! Slots filled and not yet released, including the one being encoded
+   size_t mUsedCount { 0 };
+   bool mFinished { false };
+   bool mStopping { false };
+   std::exception_ptr mError;
+
+   // Owned by the encoding thread
+   size_t mReadIndex { 0 };
+   const Slot* mpCurrent { nullptr };
+
+   //! Runs for the whole export, so it is not taken from a shared pool
+   std::thread mThread;
+};
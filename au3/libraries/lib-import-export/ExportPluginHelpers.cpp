@@ -11,16 +11,18 @@
 **********************************************************************/
 
 #include "ExportPluginHelpers.h"
+#include "ExportMixer.h"
 #include "Track.h"
 #include "Mix.h"
 #include "WaveTrack.h"
 #include "MixAndRender.h"
 #include "ExportUtils.h"
 #include "ExportPlugin.h"
+#include "Prefs.h"
 #include "StretchingSequence.h"
 
 //Create a mixer by computing the time warp factor
-std::unique_ptr<Mixer> ExportPluginHelpers::CreateMixer(
+std::unique_ptr<ExportMixer> ExportPluginHelpers::CreateMixer(
    const AudacityProject& project, bool selectionOnly, double startTime,
    double stopTime, unsigned numOutChannels, size_t outBufferSize,
    bool outInterleaved, double outRate, sampleFormat outFormat,
@@ -36,18 +38,22 @@ std::unique_ptr<Mixer> ExportPluginHelpers::CreateMixer(
    //custom channel mapping isn't support with master effects on
    assert(masterEffectStages.empty() || (numOutChannels <= 2 && mixerSpec == nullptr));
    // MB: the stop time should not be warped, this was a bug.
-   return std::make_unique<Mixer>(
+   auto pMixer = std::make_unique<Mixer>(
       std::move(inputs), std::move(masterEffectStages),
       // Throw, to stop exporting, if read fails:
       true, Mixer::WarpOptions { tracks.GetOwner() }, startTime, stopTime,
       numOutChannels, outBufferSize, outInterleaved, outRate, outFormat, true,
       mixerSpec,
-      mixerSpec ? Mixer::ApplyVolume::MapChannels : Mixer::ApplyVolume::Mixdown);
+      mixerSpec ? Mixer::ApplyVolume::MapChannels : Mixer::ApplyVolume::Mixdown,
+      MixerParallelSources.Read());
+   const auto depth = std::max(0, ExportMixer::MixAheadSetting.Read());
+   return std::make_unique<ExportMixer>(
+      std::move(pMixer), numOutChannels, outInterleaved, outFormat, depth);
 }
 
 namespace
 {
-   double EvalExportProgress(Mixer &mixer, double t0, double t1)
+   double EvalExportProgress(ExportMixer &mixer, double t0, double t1)
    {
       const auto duration = t1 - t0;
       if(duration > 0)
@@ -56,7 +62,7 @@ namespace
    }
 }
 
-ExportResult ExportPluginHelpers::UpdateProgress(ExportProcessorDelegate& delegate, Mixer &mixer, double t0, double t1)
+ExportResult ExportPluginHelpers::UpdateProgress(ExportProcessorDelegate& delegate, ExportMixer &mixer, double t0, double t1)
 {
    delegate.OnProgress(EvalExportProgress(mixer, t0, t1));
    if(delegate.IsStopped())
@@ -20,7 +20,7 @@
 
 class TrackList;
 class WaveTrack;
-class Mixer;
+class ExportMixer;
 
 namespace MixerOptions
 {
@@ -31,7 +31,7 @@ class Downmix;
 class IMPORT_EXPORT_API ExportPluginHelpers final
 {
 public:
-   static std::unique_ptr<Mixer> CreateMixer(
+   static std::unique_ptr<ExportMixer> CreateMixer(
       const AudacityProject& project, bool selectionOnly, double startTime,
       double stopTime, unsigned numOutChannels, size_t outBufferSize,
       bool outInterleaved, double outRate, sampleFormat outFormat,
@@ -39,7 +39,7 @@ public:
 
    ///\brief Sends progress update to delegate and retrieves state update from it.
    ///Typically used inside each export iteration.
-   static ExportResult UpdateProgress(ExportProcessorDelegate& delegate, Mixer& mixer, double t0, double t1);
+   static ExportResult UpdateProgress(ExportProcessorDelegate& delegate, ExportMixer& mixer, double t0, double t1);
 
    template<typename T>
    static T GetParameterValue(const ExportProcessor::Parameters& parameters, int id, T defaultValue = T())
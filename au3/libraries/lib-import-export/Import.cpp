@@ -47,6 +47,7 @@ ImportFileHandle
 #include "Prefs.h"
 
 #include "ImportProgressListener.h"
+#include "ImportStream.h"
 #include "BasicUI.h"
 
 namespace {
@@ -857,4 +858,33 @@ bool Importer::Import(
    return false;
 }
 
+std::unique_ptr<ImportStream> Importer::OpenStream(
+   AudacityProject& project, const FilePath& fName)
+{
+   const FileExtension extension{ fName.AfterLast(wxT('.')) };
+
+   // LOF and AUP files are not audio
+   if (extension.IsSameAs(wxT("lof"), false) ||
+       extension.IsSameAs(wxT("aup"), false))
+      return nullptr;
+
+   // Only plugins claiming the extension are tried; streaming is an
+   // optimization, and Import() remains for anything else
+   for (const auto &plugin : sImportPluginList())
+   {
+      if (!plugin->SupportsExtension(extension))
+         continue;
+      auto inFile = plugin->Open(fName, &project);
+      if (!inFile || inFile->GetStreamCount() != 1)
+         continue;
+      if (auto pStream = inFile->OpenStream())
+      {
+         wxLogMessage(wxT("Streaming %s with %s"),
+            fName, plugin->GetPluginStringID());
+         return pStream;
+      }
+   }
+   return nullptr;
+}
+
 BoolSetting NewImportingSession{ L"/NewImportingSession", false };
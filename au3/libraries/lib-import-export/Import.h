@@ -28,6 +28,7 @@ class Track;
 class TrackList;
 class ImportPlugin;
 class ImportProgressListener;
+class ImportStream;
 class UnusableImportPlugin;
 typedef bool (*progress_callback_t)( void *userData, float percent );
 
@@ -182,6 +183,18 @@ public:
        std::optional<LibFileFormats::AcidizerTags>& outAcidTags,
        TranslatableString& errorMessage);
 
+   //! Find a plugin that can decode the file without making tracks
+   /*!
+    @param project passed to plugins as for Import(); no tracks are added
+    @return null if the file cannot be streamed; then Import() may still
+    succeed
+
+    Nothing in the application calls this yet: Mixer and the exporters read
+    WideSampleSequence, which needs random access
+    */
+   std::unique_ptr<ImportStream> OpenStream(
+      AudacityProject& project, const FilePath& fName);
+
  private:
     struct Traits : Registry::DefaultTraits
     {
@@ -9,6 +9,7 @@ Paul Licameli split from Import.cpp
 **********************************************************************/
 
 #include "ImportPlugin.h"
+#include "ImportStream.h"
 
 #include <wx/filename.h>
 
@@ -80,3 +81,8 @@ TranslatableString ImportFileHandle::GetErrorMessage() const
 {
    return {};
 }
+
+std::unique_ptr<ImportStream> ImportFileHandle::OpenStream()
+{
+   return nullptr;
+}
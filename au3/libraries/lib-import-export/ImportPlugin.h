@@ -62,6 +62,7 @@ class Tags;
 class ImportFileHandle;
 
 class ImportProgressListener;
+class ImportStream;
 
 class IMPORT_EXPORT_API ImportPlugin /* not final */
 {
@@ -150,6 +151,14 @@ public:
       TrackHolders& outTracks, Tags* tags,
       std::optional<LibFileFormats::AcidizerTags>& acidTags) = 0;
 
+   //! Alternative to Import() that decodes without making tracks
+   /*!
+    Default implementation returns null, for formats that cannot stream.
+    @return null, or else a stream independent of this handle; then Import()
+    may no longer be called
+    */
+   virtual std::unique_ptr<ImportStream> OpenStream();
+
    virtual void Cancel() = 0;
 
    virtual void Stop() = 0;
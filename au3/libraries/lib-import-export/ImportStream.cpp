@@ -0,0 +1,39 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ImportStream.cpp
+
+**********************************************************************/
+#include "ImportStream.h"
+
+#include <algorithm>
+
+#include "AudioGraphBuffers.h"
+
+ImportStream::~ImportStream() = default;
+
+ImportStreamSource::ImportStreamSource(ImportStream &stream)
+   : FetchingSource{ stream.GetLength() }
+   , mStream{ stream }
+   , mPositions(stream.NChannels())
+{
+}
+
+ImportStreamSource::~ImportStreamSource() = default;
+
+bool ImportStreamSource::AcceptsBuffers(const Buffers &buffers) const
+{
+   return Remaining() == 0 || buffers.Channels() == mPositions.size();
+}
+
+void ImportStreamSource::Fetch(Buffers &data, size_t offset, size_t len)
+{
+   for (size_t iChannel = 0; iChannel < mPositions.size(); ++iChannel)
+      mPositions[iChannel] = &data.GetWritePosition(iChannel) + offset;
+   const auto decoded = mStream.Read(mPositions.data(), len);
+   // A truncated file ends in silence
+   if (decoded < len)
+      for (auto position : mPositions)
+         std::fill(position + decoded, position + len, 0.0f);
+}
@@ -0,0 +1,62 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ImportStream.h
+  @brief Sequential decoding of a file, without making tracks
+
+**********************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "AudioGraphFetchingSource.h" // to inherit
+
+//! Decoded audio of one file, read once from start to end
+/*!
+ Samples go straight from the decoder to the caller, so that neither memory
+ nor the project database grow with the length of the file
+ */
+class IMPORT_EXPORT_API ImportStream /* not final */
+{
+public:
+   virtual ~ImportStream();
+
+   virtual double GetRate() const = 0;
+   virtual size_t NChannels() const = 0;
+
+   //! Number of frames the file declares
+   virtual sampleCount GetLength() const = 0;
+
+   //! Decode the next frames into non-interleaved buffers
+   /*!
+    @pre `buffers` has `NChannels()` pointers, each to room for `len` floats
+    @return the number of frames decoded, less than `len` only at the end of
+    the stream or after an unrecoverable error
+    */
+   virtual size_t Read(float *const *buffers, size_t len) = 0;
+};
+
+//! Adapts ImportStream to the interface AudioGraph::Source
+/*!
+ Produces exactly `GetLength()` frames; if the file ends early, the rest is
+ silence
+ */
+class IMPORT_EXPORT_API ImportStreamSource final
+   : public AudioGraph::FetchingSource
+{
+public:
+   //! @post `Remaining() == stream.GetLength()`
+   explicit ImportStreamSource(ImportStream &stream);
+   ~ImportStreamSource() override;
+
+   //! Accepts buffers only with as many channels as the stream
+   bool AcceptsBuffers(const Buffers &buffers) const override;
+
+private:
+   void Fetch(Buffers &data, size_t offset, size_t len) override;
+
+   ImportStream &mStream;
+   std::vector<float *> mPositions;
+};
@@ -0,0 +1,161 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ExportMixerTests.cpp
+
+**********************************************************************/
+#include "ExportMixer.h"
+
+#include "Mix.h"
+#include "WideSampleSequence.h"
+
+#include <catch2/catch.hpp>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+constexpr double Rate = 44100;
+constexpr size_t BlockSize = 512;
+
+//! Mono samples that differ with the position; reading at or after
+//! `failAt` throws
+class RampSequence final : public WideSampleSequence
+{
+public:
+   RampSequence(size_t length, std::optional<size_t> failAt)
+      : mLength{ length }, mFailAt{ failAt }
+   {
+   }
+
+   AudioGraph::ChannelType GetChannelType() const override
+   {
+      return AudioGraph::MonoChannel;
+   }
+
+   size_t NChannels() const override { return 1; }
+   float GetChannelVolume(int) const override { return 1.f; }
+
+   bool DoGet(
+      size_t, size_t, const samplePtr buffers[], sampleFormat format,
+      sampleCount start, size_t len, bool, fillFormat, bool,
+      sampleCount* pNumWithinClips) const override
+   {
+      REQUIRE(format == floatSample);
+      const auto first = start.as_long_long();
+      if (mFailAt && first + static_cast<long long>(len) > *mFailAt)
+         throw std::runtime_error{ "read failed" };
+      const auto dest = reinterpret_cast<float*>(buffers[0]);
+      for (size_t i = 0; i < len; ++i)
+      {
+         const auto position = first + i;
+         dest[i] = position < mLength ? (position % 1000) / 1000.f - 0.5f : 0;
+      }
+      if (pNumWithinClips)
+         *pNumWithinClips = len;
+      return true;
+   }
+
+   double GetStartTime() const override { return 0; }
+   double GetEndTime() const override { return mLength / Rate; }
+   double GetRate() const override { return Rate; }
+   sampleFormat WidestEffectiveFormat() const override { return floatSample; }
+   bool HasTrivialEnvelope() const override { return true; }
+
+   void GetEnvelopeValues(
+      double* buffer, size_t bufferLen, double, bool) const override
+   {
+      std::fill(buffer, buffer + bufferLen, 1.0);
+   }
+
+private:
+   const size_t mLength;
+   const std::optional<size_t> mFailAt;
+};
+
+struct Output
+{
+   std::vector<float> samples;
+   std::vector<double> times;
+   bool failed { false };
+};
+
+//! Export the sequence through an ExportMixer of the given depth
+Output Mix(const std::shared_ptr<RampSequence>& pSequence, size_t depth)
+{
+   Mixer::Inputs inputs { Mixer::Input { pSequence } };
+   auto pMixer = std::make_unique<Mixer>(
+      move(inputs), std::nullopt, true, Mixer::WarpOptions { 1.0, 1.0 }, 0.0,
+      pSequence->GetEndTime(), 1, BlockSize, true, Rate, floatSample, false);
+   ExportMixer mixer { move(pMixer), 1, true, floatSample, depth };
+
+   Output output;
+   try
+   {
+      while (const auto count = mixer.Process())
+      {
+         const auto samples = reinterpret_cast<const float*>(mixer.GetBuffer());
+         output.samples.insert(output.samples.end(), samples, samples + count);
+         output.times.push_back(mixer.MixGetCurrentTime());
+      }
+   }
+   catch (const std::runtime_error&)
+   {
+      output.failed = true;
+   }
+   return output;
+}
+} // namespace
+
+TEST_CASE("ExportMixer")
+{
+   SECTION("mixes ahead the same output as on the encoder's thread")
+   {
+      const auto pSequence =
+         std::make_shared<RampSequence>(10 * BlockSize + 100, std::nullopt);
+      const auto expected = Mix(pSequence, 0);
+      REQUIRE(!expected.failed);
+      REQUIRE(expected.samples.size() == 10 * BlockSize + 100);
+      for (const size_t depth : { 1, 2, 4, 16 })
+      {
+         const auto actual = Mix(pSequence, depth);
+         REQUIRE(!actual.failed);
+         REQUIRE(actual.samples == expected.samples);
+         REQUIRE(actual.times == expected.times);
+      }
+   }
+
+   SECTION("rethrows a failure after what was mixed before it")
+   {
+      const auto pSequence =
+         std::make_shared<RampSequence>(10 * BlockSize, 6 * BlockSize + 1);
+      const auto expected = Mix(pSequence, 0);
+      REQUIRE(expected.failed);
+      REQUIRE(expected.samples.size() == 6 * BlockSize);
+      for (const size_t depth : { 1, 4, 16 })
+      {
+         const auto actual = Mix(pSequence, depth);
+         REQUIRE(actual.failed);
+         REQUIRE(actual.samples == expected.samples);
+         REQUIRE(actual.times == expected.times);
+      }
+   }
+
+   SECTION("stops mixing when destroyed before the end")
+   {
+      const auto pSequence =
+         std::make_shared<RampSequence>(100 * BlockSize, std::nullopt);
+      Mixer::Inputs inputs { Mixer::Input { pSequence } };
+      ExportMixer mixer {
+         std::make_unique<Mixer>(
+            move(inputs), std::nullopt, true, Mixer::WarpOptions { 1.0, 1.0 },
+            0.0, pSequence->GetEndTime(), 1, BlockSize, true, Rate,
+            floatSample, false),
+         1, true, floatSample, 4
+      };
+      REQUIRE(mixer.Process() == BlockSize);
+   }
+}
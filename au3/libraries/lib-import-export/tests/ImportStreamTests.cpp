@@ -0,0 +1,131 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ImportStreamTests.cpp
+
+**********************************************************************/
+#include "ImportStream.h"
+
+#include "AudioGraphBuffers.h"
+#include "AudioGraphSink.h"
+#include "AudioGraphTask.h"
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <vector>
+
+namespace
+{
+//! Channel c of frame i is `c * 1000 + i`, for `decodable` frames of `length`
+class RampStream final : public ImportStream
+{
+public:
+   RampStream(size_t nChannels, size_t length, size_t decodable)
+      : mnChannels{ nChannels }, mLength{ length }, mDecodable{ decodable }
+   {
+   }
+
+   double GetRate() const override { return 44100; }
+   size_t NChannels() const override { return mnChannels; }
+   sampleCount GetLength() const override { return mLength; }
+
+   size_t Read(float *const *buffers, size_t len) override
+   {
+      const auto count = std::min(len, mDecodable - mPos);
+      for (size_t c = 0; c < mnChannels; ++c)
+         for (size_t i = 0; i < count; ++i)
+            buffers[c][i] = c * 1000 + mPos + i;
+      mPos += count;
+      return count;
+   }
+
+private:
+   const size_t mnChannels;
+   const size_t mLength;
+   const size_t mDecodable;
+   size_t mPos{};
+};
+
+class CollectingSink final : public AudioGraph::Sink
+{
+public:
+   explicit CollectingSink(size_t nChannels) : mChannels(nChannels) {}
+
+   bool AcceptsBuffers(const Buffers &buffers) const override
+   {
+      return buffers.Channels() == mChannels.size();
+   }
+
+   bool Acquire(Buffers &data) override
+   {
+      if (data.Remaining() < data.BlockSize())
+         data.Rotate();
+      return true;
+   }
+
+   bool Release(const Buffers &data, size_t curBlockSize) override
+   {
+      for (size_t c = 0; c < mChannels.size(); ++c) {
+         // The released block begins at the current position
+         auto samples =
+            reinterpret_cast<const float *>(data.GetReadPosition(c)) +
+            data.Position();
+         mChannels[c].insert(
+            mChannels[c].end(), samples, samples + curBlockSize);
+      }
+      return true;
+   }
+
+   std::vector<std::vector<float>> mChannels;
+};
+
+std::vector<std::vector<float>> Run(
+   size_t nChannels, size_t length, size_t decodable, size_t blockSize)
+{
+   RampStream stream{ nChannels, length, decodable };
+   ImportStreamSource source{ stream };
+   AudioGraph::Buffers buffers{
+      static_cast<unsigned>(nChannels), blockSize, 3 };
+   CollectingSink sink{ nChannels };
+   AudioGraph::Task task{ source, buffers, sink };
+   REQUIRE(task.RunLoop());
+   REQUIRE(source.Remaining() == 0);
+   return sink.mChannels;
+}
+}
+
+TEST_CASE("ImportStreamSource")
+{
+   SECTION("produces every frame in order")
+   {
+      for (size_t blockSize : { 1, 7, 64, 1000 }) {
+         const auto channels = Run(2, 300, 300, blockSize);
+         REQUIRE(channels.size() == 2);
+         for (size_t c = 0; c < 2; ++c) {
+            REQUIRE(channels[c].size() == 300);
+            for (size_t i = 0; i < 300; ++i)
+               REQUIRE(channels[c][i] == c * 1000 + i);
+         }
+      }
+   }
+
+   SECTION("pads a truncated stream with silence")
+   {
+      const auto channels = Run(1, 100, 60, 16);
+      REQUIRE(channels[0].size() == 100);
+      for (size_t i = 0; i < 60; ++i)
+         REQUIRE(channels[0][i] == i);
+      for (size_t i = 60; i < 100; ++i)
+         REQUIRE(channels[0][i] == 0);
+   }
+
+   SECTION("accepts only buffers matching the stream")
+   {
+      RampStream stream{ 2, 10, 10 };
+      ImportStreamSource source{ stream };
+      REQUIRE(source.AcceptsBuffers(AudioGraph::Buffers{ 2, 4, 1 }));
+      REQUIRE(!source.AcceptsBuffers(AudioGraph::Buffers{ 1, 4, 1 }));
+   }
+}
@@ -0,0 +1,513 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ConversionKernels.cpp
+
+**********************************************************************/
+
+#include "ConversionKernels.h"
+
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_AMD64) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONVERSION_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define CONVERSION_KERNELS_AVX2_TARGET
+#else
+#define CONVERSION_KERNELS_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+constexpr auto Int16Scale = float(1 << 15);
+constexpr auto Int24Scale = float(1 << 23);
+
+// Bounds of the integer formats, all exact in single precision
+constexpr float Int16Min = -32768.f, Int16Max = 32767.f;
+constexpr float Int24Min = -8388608.f, Int24Max = 8388607.f;
+
+// Clipping is as for the maxps and minps instructions, which give the
+// second operand if either is NaN, so that NaN becomes the lower bound
+inline float Clip(float x, float lower, float upper)
+{
+   x = x > lower ? x : lower;
+   return x < upper ? x : upper;
+}
+
+inline uint32_t Xorshift(uint32_t x)
+{
+   x ^= x << 13;
+   x ^= x >> 17;
+   return x ^ (x << 5);
+}
+
+//! Reinterpret as signed and scale into -0.5...0.5
+inline float NoiseToFloat(uint32_t x)
+{
+   return static_cast<float>(static_cast<int32_t>(x)) * 0x1p-32f;
+}
+
+void ScalarInt16ToFloat(const short *src, float *dst, size_t start, size_t len)
+{
+   for (auto ii = start; ii < len; ++ii)
+      dst[ii] = src[ii] / Int16Scale;
+}
+
+void ScalarInt24ToFloat(const int *src, float *dst, size_t start, size_t len)
+{
+   for (auto ii = start; ii < len; ++ii)
+      dst[ii] = src[ii] / Int24Scale;
+}
+
+void ScalarInt16ToInt24(const short *src, int *dst, size_t start, size_t len)
+{
+   for (auto ii = start; ii < len; ++ii)
+      dst[ii] = static_cast<int>(src[ii]) * 256;
+}
+
+void ScalarClipAndScale(
+   const float *src, float *dst, size_t start, size_t len, float scale)
+{
+   for (auto ii = start; ii < len; ++ii) {
+      const auto x = src[ii] == src[ii] ? src[ii] : 0.f;
+      dst[ii] = Clip(x, -1.f, 1.f) * scale;
+   }
+}
+
+void ScalarInt24ToScaled(
+   const int *src, float *dst, size_t start, size_t len, float scale)
+{
+   for (auto ii = start; ii < len; ++ii)
+      dst[ii] = static_cast<float>(src[ii]) * scale;
+}
+
+void ScalarRoundToInt16(const float *src, short *dst, size_t start, size_t len)
+{
+   for (auto ii = start; ii < len; ++ii)
+      dst[ii] =
+         static_cast<short>(std::lrint(Clip(src[ii], Int16Min, Int16Max)));
+}
+
+void ScalarRoundToInt24(const float *src, int *dst, size_t start, size_t len)
+{
+   for (auto ii = start; ii < len; ++ii)
+      dst[ii] = static_cast<int>(std::lrint(Clip(src[ii], Int24Min, Int24Max)));
+}
+
+void ScalarGenerateDitherNoise(DitherNoise &noise, float *dst, size_t len)
+{
+   for (size_t ii = 0; ii < len; ii += DitherNoise::Lanes)
+      for (size_t lane = 0; lane < DitherNoise::Lanes; ++lane) {
+         auto &state = noise.lanes[lane];
+         state = Xorshift(state);
+         dst[ii + lane] = NoiseToFloat(state);
+      }
+}
+
+void ScalarAddRectangleDither(
+   float *samples, const float *noise, size_t start, size_t len)
+{
+   for (auto ii = start; ii < len; ++ii)
+      samples[ii] = samples[ii] - noise[ii];
+}
+
+void ScalarAddTriangleDither(
+   float *samples, const float *noise, size_t start, size_t len)
+{
+   for (auto ii = start; ii < len; ++ii)
+      samples[ii] = samples[ii] + noise[ii + 1] - noise[ii];
+}
+
+#ifdef CONVERSION_KERNELS_X86
+
+// SSE2 kernels, each doing what it can in whole vectors and leaving the
+// rest to the scalar loop.  The functions return the count done.
+
+size_t SSE2Int16ToFloat(const short *src, float *dst, size_t len)
+{
+   const auto scale = _mm_set1_ps(1 / Int16Scale);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto x =
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ii));
+      // Interleave into the upper halves, then shift back with sign
+      const auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+      const auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+      _mm_storeu_ps(dst + ii, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+      _mm_storeu_ps(dst + ii + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+   }
+   return ii;
+}
+
+size_t SSE2Int24ToScaled(const int *src, float *dst, size_t len, float factor)
+{
+   const auto scale = _mm_set1_ps(factor);
+   size_t ii = 0;
+   for (; ii + 4 <= len; ii += 4) {
+      const auto x =
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ii));
+      _mm_storeu_ps(dst + ii, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+   }
+   return ii;
+}
+
+size_t SSE2Int16ToInt24(const short *src, int *dst, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto x =
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ii));
+      // Interleave into the upper halves over zeros, then shift back
+      const auto zero = _mm_setzero_si128();
+      const auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 8);
+      const auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, x), 8);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ii), lo);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ii + 4), hi);
+   }
+   return ii;
+}
+
+size_t SSE2ClipAndScale(const float *src, float *dst, size_t len, float factor)
+{
+   const auto scale = _mm_set1_ps(factor);
+   const auto lower = _mm_set1_ps(-1.f);
+   const auto upper = _mm_set1_ps(1.f);
+   size_t ii = 0;
+   for (; ii + 4 <= len; ii += 4) {
+      auto x = _mm_loadu_ps(src + ii);
+      x = _mm_and_ps(x, _mm_cmpord_ps(x, x));
+      x = _mm_min_ps(_mm_max_ps(x, lower), upper);
+      _mm_storeu_ps(dst + ii, _mm_mul_ps(x, scale));
+   }
+   return ii;
+}
+
+size_t SSE2RoundToInt16(const float *src, short *dst, size_t len)
+{
+   const auto lower = _mm_set1_ps(Int16Min);
+   const auto upper = _mm_set1_ps(Int16Max);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto x0 =
+         _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + ii), lower), upper);
+      const auto x1 =
+         _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + ii + 4), lower), upper);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ii),
+         _mm_packs_epi32(_mm_cvtps_epi32(x0), _mm_cvtps_epi32(x1)));
+   }
+   return ii;
+}
+
+size_t SSE2RoundToInt24(const float *src, int *dst, size_t len)
+{
+   const auto lower = _mm_set1_ps(Int24Min);
+   const auto upper = _mm_set1_ps(Int24Max);
+   size_t ii = 0;
+   for (; ii + 4 <= len; ii += 4) {
+      const auto x =
+         _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + ii), lower), upper);
+      _mm_storeu_si128(
+         reinterpret_cast<__m128i*>(dst + ii), _mm_cvtps_epi32(x));
+   }
+   return ii;
+}
+
+inline __m128i SSE2Xorshift(__m128i x)
+{
+   x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+   x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+   return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+void SSE2GenerateDitherNoise(DitherNoise &noise, float *dst, size_t len)
+{
+   const auto scale = _mm_set1_ps(0x1p-32f);
+   auto state0 = _mm_loadu_si128(reinterpret_cast<__m128i*>(noise.lanes));
+   auto state1 = _mm_loadu_si128(reinterpret_cast<__m128i*>(noise.lanes + 4));
+   for (size_t ii = 0; ii < len; ii += DitherNoise::Lanes) {
+      state0 = SSE2Xorshift(state0);
+      state1 = SSE2Xorshift(state1);
+      _mm_storeu_ps(dst + ii, _mm_mul_ps(_mm_cvtepi32_ps(state0), scale));
+      _mm_storeu_ps(dst + ii + 4, _mm_mul_ps(_mm_cvtepi32_ps(state1), scale));
+   }
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(noise.lanes), state0);
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(noise.lanes + 4), state1);
+}
+
+size_t SSE2AddRectangleDither(float *samples, const float *noise, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + 4 <= len; ii += 4)
+      _mm_storeu_ps(samples + ii,
+         _mm_sub_ps(_mm_loadu_ps(samples + ii), _mm_loadu_ps(noise + ii)));
+   return ii;
+}
+
+size_t SSE2AddTriangleDither(float *samples, const float *noise, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + 4 <= len; ii += 4) {
+      const auto sum =
+         _mm_add_ps(_mm_loadu_ps(samples + ii), _mm_loadu_ps(noise + ii + 1));
+      _mm_storeu_ps(samples + ii, _mm_sub_ps(sum, _mm_loadu_ps(noise + ii)));
+   }
+   return ii;
+}
+
+// AVX2 kernels, likewise
+
+CONVERSION_KERNELS_AVX2_TARGET
+size_t AVX2Int16ToFloat(const short *src, float *dst, size_t len)
+{
+   const auto scale = _mm256_set1_ps(1 / Int16Scale);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto x = _mm256_cvtepi16_epi32(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ii)));
+      _mm256_storeu_ps(dst + ii, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+   }
+   return ii;
+}
+
+CONVERSION_KERNELS_AVX2_TARGET
+size_t AVX2Int24ToScaled(const int *src, float *dst, size_t len, float factor)
+{
+   const auto scale = _mm256_set1_ps(factor);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto x =
+         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + ii));
+      _mm256_storeu_ps(dst + ii, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+   }
+   return ii;
+}
+
+CONVERSION_KERNELS_AVX2_TARGET
+size_t AVX2Int16ToInt24(const short *src, int *dst, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto x = _mm256_cvtepi16_epi32(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ii)));
+      _mm256_storeu_si256(
+         reinterpret_cast<__m256i*>(dst + ii), _mm256_slli_epi32(x, 8));
+   }
+   return ii;
+}
+
+CONVERSION_KERNELS_AVX2_TARGET
+size_t AVX2ClipAndScale(const float *src, float *dst, size_t len, float factor)
+{
+   const auto scale = _mm256_set1_ps(factor);
+   const auto lower = _mm256_set1_ps(-1.f);
+   const auto upper = _mm256_set1_ps(1.f);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      auto x = _mm256_loadu_ps(src + ii);
+      x = _mm256_and_ps(x, _mm256_cmp_ps(x, x, _CMP_ORD_Q));
+      x = _mm256_min_ps(_mm256_max_ps(x, lower), upper);
+      _mm256_storeu_ps(dst + ii, _mm256_mul_ps(x, scale));
+   }
+   return ii;
+}
+
+CONVERSION_KERNELS_AVX2_TARGET
+size_t AVX2RoundToInt16(const float *src, short *dst, size_t len)
+{
+   const auto lower = _mm256_set1_ps(Int16Min);
+   const auto upper = _mm256_set1_ps(Int16Max);
+   size_t ii = 0;
+   for (; ii + 16 <= len; ii += 16) {
+      const auto x0 =
+         _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + ii), lower), upper);
+      const auto x1 = _mm256_min_ps(
+         _mm256_max_ps(_mm256_loadu_ps(src + ii + 8), lower), upper);
+      // Packing works within 128 bit halves; restore the order after
+      const auto packed =
+         _mm256_packs_epi32(_mm256_cvtps_epi32(x0), _mm256_cvtps_epi32(x1));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + ii),
+         _mm256_permute4x64_epi64(packed, 0xD8));
+   }
+   return ii;
+}
+
+CONVERSION_KERNELS_AVX2_TARGET
+size_t AVX2RoundToInt24(const float *src, int *dst, size_t len)
+{
+   const auto lower = _mm256_set1_ps(Int24Min);
+   const auto upper = _mm256_set1_ps(Int24Max);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto x =
+         _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + ii), lower), upper);
+      _mm256_storeu_si256(
+         reinterpret_cast<__m256i*>(dst + ii), _mm256_cvtps_epi32(x));
+   }
+   return ii;
+}
+
+CONVERSION_KERNELS_AVX2_TARGET
+void AVX2GenerateDitherNoise(DitherNoise &noise, float *dst, size_t len)
+{
+   const auto scale = _mm256_set1_ps(0x1p-32f);
+   auto state = _mm256_loadu_si256(reinterpret_cast<__m256i*>(noise.lanes));
+   for (size_t ii = 0; ii < len; ii += DitherNoise::Lanes) {
+      state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+      state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+      state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+      _mm256_storeu_ps(
+         dst + ii, _mm256_mul_ps(_mm256_cvtepi32_ps(state), scale));
+   }
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(noise.lanes), state);
+}
+
+CONVERSION_KERNELS_AVX2_TARGET
+size_t AVX2AddRectangleDither(float *samples, const float *noise, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8)
+      _mm256_storeu_ps(samples + ii, _mm256_sub_ps(
+         _mm256_loadu_ps(samples + ii), _mm256_loadu_ps(noise + ii)));
+   return ii;
+}
+
+CONVERSION_KERNELS_AVX2_TARGET
+size_t AVX2AddTriangleDither(float *samples, const float *noise, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto sum = _mm256_add_ps(
+         _mm256_loadu_ps(samples + ii), _mm256_loadu_ps(noise + ii + 1));
+      _mm256_storeu_ps(
+         samples + ii, _mm256_sub_ps(sum, _mm256_loadu_ps(noise + ii)));
+   }
+   return ii;
+}
+
+#endif
+
+} // namespace
+
+#ifdef CONVERSION_KERNELS_X86
+// Evaluate `done` as the count of samples processed by the vector kernel
+// with the given prefix, or zero for the scalar kernel
+#define VECTOR_KERNEL(kernel, name, ...) \
+   ((kernel) == SummaryKernel::AVX2 ? AVX2##name(__VA_ARGS__) : \
+    (kernel) == SummaryKernel::SSE2 ? SSE2##name(__VA_ARGS__) : size_t{ 0 })
+#else
+#define VECTOR_KERNEL(kernel, name, ...) size_t{ 0 }
+#endif
+
+void DitherNoise::Seed(uint32_t seed)
+{
+   // Spread the seed over the lanes with the splitmix32 finalizer, which
+   // never gives the zero state that xorshift can't leave
+   for (size_t lane = 0; lane < Lanes; ++lane) {
+      auto z = seed + 0x9E3779B9u * static_cast<uint32_t>(lane + 1);
+      z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+      z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+      z ^= z >> 16;
+      lanes[lane] = z ? z : 1;
+   }
+}
+
+void Int16ToFloat(
+   SummaryKernel kernel, const short *src, float *dst, size_t len)
+{
+   assert(IsSummaryKernelAvailable(kernel));
+   const auto done = VECTOR_KERNEL(kernel, Int16ToFloat, src, dst, len);
+   ScalarInt16ToFloat(src, dst, done, len);
+}
+
+void Int24ToFloat(
+   SummaryKernel kernel, const int *src, float *dst, size_t len)
+{
+   // Division by a power of two is the same as multiplication by its
+   // reciprocal
+   assert(IsSummaryKernelAvailable(kernel));
+   const auto done =
+      VECTOR_KERNEL(kernel, Int24ToScaled, src, dst, len, 1 / Int24Scale);
+   ScalarInt24ToFloat(src, dst, done, len);
+}
+
+void Int16ToInt24(
+   SummaryKernel kernel, const short *src, int *dst, size_t len)
+{
+   assert(IsSummaryKernelAvailable(kernel));
+   const auto done = VECTOR_KERNEL(kernel, Int16ToInt24, src, dst, len);
+   ScalarInt16ToInt24(src, dst, done, len);
+}
+
+void ClipAndScale(SummaryKernel kernel,
+   const float *src, float *dst, size_t len, float scale)
+{
+   assert(IsSummaryKernelAvailable(kernel));
+   const auto done =
+      VECTOR_KERNEL(kernel, ClipAndScale, src, dst, len, scale);
+   ScalarClipAndScale(src, dst, done, len, scale);
+}
+
+void Int24ToScaled(SummaryKernel kernel,
+   const int *src, float *dst, size_t len, float scale)
+{
+   assert(IsSummaryKernelAvailable(kernel));
+   const auto done =
+      VECTOR_KERNEL(kernel, Int24ToScaled, src, dst, len, scale);
+   ScalarInt24ToScaled(src, dst, done, len, scale);
+}
+
+void RoundToInt16(
+   SummaryKernel kernel, const float *src, short *dst, size_t len)
+{
+   assert(IsSummaryKernelAvailable(kernel));
+   const auto done = VECTOR_KERNEL(kernel, RoundToInt16, src, dst, len);
+   ScalarRoundToInt16(src, dst, done, len);
+}
+
+void RoundToInt24(
+   SummaryKernel kernel, const float *src, int *dst, size_t len)
+{
+   assert(IsSummaryKernelAvailable(kernel));
+   const auto done = VECTOR_KERNEL(kernel, RoundToInt24, src, dst, len);
+   ScalarRoundToInt24(src, dst, done, len);
+}
+
+void GenerateDitherNoise(
+   SummaryKernel kernel, DitherNoise &noise, float *dst, size_t len)
+{
+   assert(IsSummaryKernelAvailable(kernel));
+   assert(len % DitherNoise::Lanes == 0);
+   switch (kernel) {
+#ifdef CONVERSION_KERNELS_X86
+   case SummaryKernel::AVX2:
+      return AVX2GenerateDitherNoise(noise, dst, len);
+   case SummaryKernel::SSE2:
+      return SSE2GenerateDitherNoise(noise, dst, len);
+#endif
+   default:
+      return ScalarGenerateDitherNoise(noise, dst, len);
+   }
+}
+
+void AddRectangleDither(SummaryKernel kernel,
+   float *samples, const float *noise, size_t len)
+{
+   assert(IsSummaryKernelAvailable(kernel));
+   const auto done =
+      VECTOR_KERNEL(kernel, AddRectangleDither, samples, noise, len);
+   ScalarAddRectangleDither(samples, noise, done, len);
+}
+
+void AddTriangleDither(SummaryKernel kernel,
+   float *samples, const float *noise, size_t len)
+{
+   assert(IsSummaryKernelAvailable(kernel));
+   const auto done =
+      VECTOR_KERNEL(kernel, AddTriangleDither, samples, noise, len);
+   ScalarAddTriangleDither(samples, noise, done, len);
+}
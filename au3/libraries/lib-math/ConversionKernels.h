@@ -0,0 +1,79 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ConversionKernels.h
+  @brief Vectorized conversion and dithering of contiguous samples
+
+  The kernels are those of SummaryKernels.h, chosen the same way; each one
+  gives results bit-identical to the scalar kernel.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_CONVERSION_KERNELS__
+#define __AUDACITY_CONVERSION_KERNELS__
+
+#include "SummaryKernels.h"
+
+#include <cstdint>
+
+//! Deterministic source of uniformly distributed dither noise
+/*!
+ Eight xorshift generators interleave, so that vectors of noise can be
+ made at once
+ */
+struct MATH_API DitherNoise
+{
+   static constexpr size_t Lanes = 8;
+
+   explicit DitherNoise(uint32_t seed = 0) { Seed(seed); }
+
+   //! Restart the stream; equal seeds give equal streams
+   void Seed(uint32_t seed);
+
+   uint32_t lanes[Lanes];
+};
+
+//! Scale 16 bit samples to the range -1.0...1.0
+MATH_API void Int16ToFloat(
+   SummaryKernel kernel, const short *src, float *dst, size_t len);
+
+//! Scale 24 bit samples to the range -1.0...1.0
+MATH_API void Int24ToFloat(
+   SummaryKernel kernel, const int *src, float *dst, size_t len);
+
+//! Promote 16 bit samples to 24 bits
+MATH_API void Int16ToInt24(
+   SummaryKernel kernel, const short *src, int *dst, size_t len);
+
+//! Replace NaN with zero, clip to -1.0...1.0, then multiply by `scale`
+MATH_API void ClipAndScale(SummaryKernel kernel,
+   const float *src, float *dst, size_t len, float scale);
+
+//! Multiply 24 bit samples by `scale`
+MATH_API void Int24ToScaled(SummaryKernel kernel,
+   const int *src, float *dst, size_t len, float scale);
+
+//! Round to nearest (ties to even) and clip to the 16 bit range
+MATH_API void RoundToInt16(
+   SummaryKernel kernel, const float *src, short *dst, size_t len);
+
+//! Round to nearest (ties to even) and clip to the 24 bit range
+MATH_API void RoundToInt24(
+   SummaryKernel kernel, const float *src, int *dst, size_t len);
+
+//! Fill `dst` with noise in -0.5...0.5
+/*! @pre `len` is a multiple of `DitherNoise::Lanes` */
+MATH_API void GenerateDitherNoise(
+   SummaryKernel kernel, DitherNoise &noise, float *dst, size_t len);
+
+//! Subtract `noise[ii]` from each `samples[ii]`
+MATH_API void AddRectangleDither(SummaryKernel kernel,
+   float *samples, const float *noise, size_t len);
+
+//! Add high-passed noise:  `noise[ii + 1] - noise[ii]` to each `samples[ii]`
+/*! @pre `noise` has `len + 1` elements */
+MATH_API void AddTriangleDither(SummaryKernel kernel,
+   float *samples, const float *noise, size_t len);
+
+#endif
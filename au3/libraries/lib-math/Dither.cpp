@@ -32,6 +32,10 @@ state. Call Dither::Apply() to apply the dither. You can call
 Reset() between subsequent dithers to reset the dither state
 and get deterministic behaviour.
 
+Samples are converted and dithered a chunk at a time with the vectorized
+kernels of ConversionKernels.h.  The dither noise comes from a seeded
+generator, so results do not depend on the kernel.
+
 *//*******************************************************************/
 
 
@@ -45,7 +49,7 @@ and get deterministic behaviour.
 // (Note: this file should be included first)
 #include "float_cast.h"
 
-#include <stdlib.h>
+#include <algorithm>
 #include <math.h>
 #include <string.h>
 //#include <sys/types.h>
@@ -63,142 +67,133 @@ constexpr int BUF_MASK = 7;
 // Lipshitz's minimally audible FIR
 const float SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
 
-// Dither state
-struct State {
-    int mPhase;
-    float mTriangleState;
-    float mBuffer[8 /* = BUF_SIZE */];
-} mState;
+using State = Dither::State;
 
-using Ditherer = float (*)(State &, float);
-
-// This is supposed to produce white noise and no dc
-static inline float DITHER_NOISE()
-{
-    return rand() / (float)RAND_MAX - 0.5f;
-}
+// Samples are converted and dithered this many at a time, in contiguous
+// buffers on the stack; a multiple of DitherNoise::Lanes
+constexpr size_t ChunkSize = 256;
 
 // Defines for sample conversion
 constexpr auto CONVERT_DIV16 = float(1<<15);
 constexpr auto CONVERT_DIV24 = float(1<<23);
 
-// Dereference sample pointer and convert to float sample
-static inline float FROM_INT16(const short *ptr)
-{
-    return *ptr / CONVERT_DIV16;
-}
-
-static inline float FROM_INT24(const int *ptr)
-{
-    return *ptr / CONVERT_DIV24;
-}
-
-// For float, we internally allow values greater than 1.0, which
-// would blow up the dithering to int values.  FROM_FLOAT is
-// only used to dither to int, so clip here.
-static inline float FROM_FLOAT(const float *ptr)
+// Copy strided samples into 'buffer', unless they are contiguous already
+template<typename type>
+static inline const type *GATHER(
+    const type *src, size_t stride, type *buffer, size_t len)
 {
-    return *((float*)(ptr)) > 1.0
-        ?  1.0 :
-        *((float*)(ptr)) < -1.0
-            ? -1.0 :
-            *((float*)(ptr));
+    if (stride == 1)
+        return src;
+    for (size_t ii = 0; ii < len; ii++, src += stride)
+        buffer[ii] = *src;
+    return buffer;
 }
 
-// Store float sample 'sample' into pointer 'ptr', clip it, if necessary
-template<typename dst_type>
-static inline void IMPLEMENT_STORE(
-    dst_type *ptr, float sample, dst_type min_bound, dst_type max_bound)
+// Copy contiguous samples to strided destination, unless already there
+template<typename type>
+static inline void SCATTER(
+    const type *buffer, type *dst, size_t stride, size_t len)
 {
-    int x = lrintf(sample);
-    if (x > max_bound)
-        *ptr = max_bound;
-    else if (x<(min_bound))
-        *ptr = min_bound;
-    else
-        *ptr = static_cast<dst_type>(x);
+    if (buffer == dst)
+        return;
+    for (size_t ii = 0; ii < len; ii++, dst += stride)
+        *dst = buffer[ii];
 }
 
-// Dither single float 'sample' and store it in pointer 'dst', using 'dither' as algorithm
-static inline void DITHER_TO_INT16(Ditherer dither, State &state,
-   short *dst, float sample)
+// Implement a conversion loop.  'convert' takes contiguous samples; strided
+// samples pass through buffers a chunk at a time.
+template<typename srcType, typename dstType, typename Convert>
+static inline void CONVERT_LOOP(const srcType *src, size_t srcStride,
+    dstType *dst, size_t dstStride, size_t len, const Convert &convert)
 {
-    IMPLEMENT_STORE<short>(dst,
-        dither(state, sample * CONVERT_DIV16),
-        short(-32768), short(32767));
+    if (srcStride == 1 && dstStride == 1) {
+        convert(src, dst, len);
+        return;
+    }
+    srcType srcBuffer[ChunkSize];
+    dstType dstBuffer[ChunkSize];
+    while (len > 0) {
+        const auto count = std::min(len, ChunkSize);
+        const auto s = GATHER(src, srcStride, srcBuffer, count);
+        const auto d = dstStride == 1 ? dst : dstBuffer;
+        convert(s, d, count);
+        SCATTER(d, dst, dstStride, count);
+        src += count * srcStride;
+        dst += count * dstStride;
+        len -= count;
+    }
 }
 
-// Dither single float 'sample' and store it in pointer 'dst', using 'dither' as algorithm
-static inline void DITHER_TO_INT24(Ditherer dither, State &state,
-   int *dst, float sample)
+static inline size_t NOISE_LENGTH(size_t len)
 {
-    IMPLEMENT_STORE<int>(dst,
-        dither(state, sample * CONVERT_DIV24), -8388608, 8388607);
+    return (len + DitherNoise::Lanes - 1) / DitherNoise::Lanes
+        * DitherNoise::Lanes;
 }
 
-// Implement one single dither step
+static inline float ShapedDither(State &state, float sample, float r);
 
-// Implement a dithering loop
-template<typename srcType, typename dstType>
-static inline void DITHER_LOOP( Ditherer dither, State &state,
-    void (*store)(Ditherer, State &, dstType *, float),
-    float (*load)(const srcType *),
-    samplePtr dst, sampleFormat dstFormat, size_t dstStride,
-    constSamplePtr src, sampleFormat srcFormat, size_t srcStride, size_t len)
+// Dither a chunk of samples, already scaled to the destination format but
+// not yet rounded
+static void DITHER_CHUNK(SummaryKernel kernel, DitherType ditherType,
+    State &state, DitherNoise &noise, float *samples, size_t len)
 {
-    char *d;
-    const char *s;
-    unsigned int ii;
-    for (d = (char*)dst, s = (char*)src, ii = 0;
-        ii < len;
-        ii++, d += SAMPLE_SIZE(dstFormat) * dstStride,
-        s += SAMPLE_SIZE(srcFormat) * srcStride) {
-            store(dither, state, reinterpret_cast<dstType *>(d), load(reinterpret_cast<const srcType *>(s)));
-        }
+    // Room for the previous noise sample too, or two samples each
+    float buffer[2 * ChunkSize + 1];
+    switch (ditherType)
+    {
+    case DitherType::none:
+        break;
+    case DitherType::rectangle:
+        GenerateDitherNoise(kernel, noise, buffer, NOISE_LENGTH(len));
+        AddRectangleDither(kernel, samples, buffer, len);
+        break;
+    case DitherType::triangle:
+        // High pass filtered: subtract the previous noise sample
+        buffer[0] = state.mTriangleState;
+        GenerateDitherNoise(kernel, noise, buffer + 1, NOISE_LENGTH(len));
+        AddTriangleDither(kernel, samples, buffer, len);
+        state.mTriangleState = buffer[len];
+        break;
+    case DitherType::shaped:
+        // The error feedback makes each sample depend on the previous one,
+        // so only the noise is vectorized
+        GenerateDitherNoise(kernel, noise, buffer, 2 * NOISE_LENGTH(len));
+        for (size_t ii = 0; ii < len; ii++)
+            samples[ii] = ShapedDither(state, samples[ii],
+                buffer[2 * ii] + buffer[2 * ii + 1]);
+        break;
+    default:
+        wxASSERT(false); // unknown dither algorithm
+    }
 }
 
-// Implement a dither. There are only 3 cases where we must dither,
-// in all other cases, no dithering is necessary.
-static inline void DITHER( Ditherer dither, State &state,
-   samplePtr dst, sampleFormat dstFormat, size_t dstStride,
-   constSamplePtr src, sampleFormat srcFormat, size_t srcStride, size_t len)
+Dither::Dither()
+    : Dither{ GetSummaryKernel() }
 {
-    if (srcFormat == int24Sample && dstFormat == int16Sample)
-        DITHER_LOOP<int, short>(dither, state,
-            DITHER_TO_INT16, FROM_INT24, dst,
-            int16Sample, dstStride, src, int24Sample, srcStride, len);
-    else if (srcFormat == floatSample && dstFormat == int16Sample)
-        DITHER_LOOP<float, short>(dither, state,
-            DITHER_TO_INT16, FROM_FLOAT, dst,
-            int16Sample, dstStride, src, floatSample, srcStride, len);
-    else if (srcFormat == floatSample && dstFormat == int24Sample)
-        DITHER_LOOP<float, int>(dither, state,
-            DITHER_TO_INT24, FROM_FLOAT, dst,
-            int24Sample, dstStride, src, floatSample, srcStride, len);
-    else { wxASSERT(false); }
 }
 
-
-static inline float NoDither(State &, float sample);
-static inline float RectangleDither(State &, float sample);
-static inline float TriangleDither(State &state, float sample);
-static inline float ShapedDither(State &state, float sample);
-
-Dither::Dither()
+Dither::Dither(SummaryKernel kernel)
+    : mKernel{ kernel }
 {
     // On startup, initialize dither by resetting values
     Reset();
 }
 
 void Dither::Reset()
+{
+    ResetFilter();
+    mNoise.Seed(0);
+}
+
+void Dither::ResetFilter()
 {
     mState.mTriangleState = 0;
     mState.mPhase = 0;
     memset(mState.mBuffer, 0, sizeof(float) * BUF_SIZE);
 }
 
-// This only decides if we must dither at all, the dithers
-// are all implemented using macros.
+// This only decides if we must dither at all; the conversions and dithers
+// are done in contiguous chunks by the kernels of ConversionKernels.h.
 //
 // "source" and "dest" can contain either interleaved or non-interleaved
 // samples.  They do not have to be the same...one can be interleaved while
@@ -236,6 +231,8 @@ void Dither::Apply(enum DitherType ditherType,
     if (len == 0)
         return; // nothing to do
 
+    const auto kernel = mKernel;
+
     if (destFormat == sourceFormat)
     {
         // No need to dither, because source and destination
@@ -279,84 +276,88 @@ void Dither::Apply(enum DitherType ditherType,
         auto d = (float*)dest;
 
         if (sourceFormat == int16Sample)
-        {
-            auto s = (const short*)source;
-            for (i = 0; i < len; i++, d += destStride, s += sourceStride)
-                *d = FROM_INT16(s);
-        } else
+            CONVERT_LOOP((const short*)source, sourceStride,
+                d, destStride, len,
+                [&](const short *s, float *d, size_t count) {
+                    Int16ToFloat(kernel, s, d, count); });
+        else
         if (sourceFormat == int24Sample)
-        {
-            auto s = (const int*)source;
-            for (i = 0; i < len; i++, d += destStride, s += sourceStride)
-                *d = FROM_INT24(s);
-        } else {
+            CONVERT_LOOP((const int*)source, sourceStride,
+                d, destStride, len,
+                [&](const int *s, float *d, size_t count) {
+                    Int24ToFloat(kernel, s, d, count); });
+        else {
             wxASSERT(false); // source format unknown
         }
     } else
     if (destFormat == int24Sample && sourceFormat == int16Sample)
     {
         // Special case when promoting 16 bit to 24 bit
-        auto d = (int*)dest;
-        auto s = (const short*)source;
-        for (i = 0; i < len; i++, d += destStride, s += sourceStride)
-            *d = ((int)*s) << 8;
+        CONVERT_LOOP((const short*)source, sourceStride,
+            (int*)dest, destStride, len,
+            [&](const short *s, int *d, size_t count) {
+                Int16ToInt24(kernel, s, d, count); });
     } else
     {
-        // We must do dithering
-        switch (ditherType)
-        {
-        case DitherType::none:
-            DITHER(NoDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::rectangle:
-            DITHER(RectangleDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::triangle:
-            Reset(); // reset dither filter for this NEW conversion
-            DITHER(TriangleDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::shaped:
-            Reset(); // reset dither filter for this NEW conversion
-            DITHER(ShapedDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        default:
-            wxASSERT(false); // unknown dither algorithm
-        }
+        // We must do dithering.  There are only 3 cases where we must
+        // dither, in all other cases, no dithering is necessary.
+        if (ditherType == DitherType::triangle ||
+            ditherType == DitherType::shaped)
+            ResetFilter(); // reset dither filter for this NEW conversion
+
+        // Samples in a chunk, scaled to the destination format
+        float samples[ChunkSize];
+        auto &state = mState;
+        auto &noise = mNoise;
+        const auto dither = [&](size_t count) {
+            DITHER_CHUNK(kernel, ditherType, state, noise, samples, count);
+        };
+
+        if (sourceFormat == int24Sample && destFormat == int16Sample)
+            CONVERT_LOOP((const int*)source, sourceStride,
+                (short*)dest, destStride, len,
+                [&](const int *s, short *d, size_t count) {
+                    for (size_t done = 0; done < count; done += ChunkSize) {
+                        const auto n = std::min(count - done, ChunkSize);
+                        Int24ToScaled(kernel, s + done, samples, n,
+                            CONVERT_DIV16 / CONVERT_DIV24);
+                        dither(n);
+                        RoundToInt16(kernel, samples, d + done, n);
+                    }
+                });
+        else if (sourceFormat == floatSample && destFormat == int16Sample)
+            CONVERT_LOOP((const float*)source, sourceStride,
+                (short*)dest, destStride, len,
+                [&](const float *s, short *d, size_t count) {
+                    for (size_t done = 0; done < count; done += ChunkSize) {
+                        const auto n = std::min(count - done, ChunkSize);
+                        ClipAndScale(kernel, s + done, samples, n,
+                            CONVERT_DIV16);
+                        dither(n);
+                        RoundToInt16(kernel, samples, d + done, n);
+                    }
+                });
+        else if (sourceFormat == floatSample && destFormat == int24Sample)
+            CONVERT_LOOP((const float*)source, sourceStride,
+                (int*)dest, destStride, len,
+                [&](const float *s, int *d, size_t count) {
+                    for (size_t done = 0; done < count; done += ChunkSize) {
+                        const auto n = std::min(count - done, ChunkSize);
+                        ClipAndScale(kernel, s + done, samples, n,
+                            CONVERT_DIV24);
+                        dither(n);
+                        RoundToInt24(kernel, samples, d + done, n);
+                    }
+                });
+        else { wxASSERT(false); }
     }
 }
 
 // Dither implementations
 
-// No dither, just return sample
-inline float NoDither(State &, float sample)
-{
-    return sample;
-}
-
-// Rectangle dithering, apply one-step noise
-inline float RectangleDither(State &, float sample)
-{
-    return sample - DITHER_NOISE();
-}
-
-// Triangle dither - high pass filtered
-inline float TriangleDither(State &state, float sample)
-{
-    float r = DITHER_NOISE();
-    float result = sample + r - state.mTriangleState;
-    state.mTriangleState = r;
-
-    return result;
-}
-
-// Shaped dither
-inline float ShapedDither(State &state, float sample)
+// Shaped dither, given triangular noise 'r'
+inline float ShapedDither(State &state, float sample, float r)
 {
-    // Generate triangular dither, +-1 LSB, flat psd
-    float r = DITHER_NOISE() + DITHER_NOISE();
-    if(sample != sample)  // test for NaN
-       sample = 0; // and do the best we can with it
-
     // Run FIR
     float xe = sample + state.mBuffer[state.mPhase] * SHAPED_BS[0]
         + state.mBuffer[(state.mPhase - 1) & BUF_MASK] * SHAPED_BS[1]
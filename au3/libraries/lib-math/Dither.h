@@ -10,6 +10,7 @@
 #ifndef __AUDACITY_DITHER_H__
 #define __AUDACITY_DITHER_H__
 
+#include "ConversionKernels.h"
 #include "SampleFormat.h"
 
 template< typename Enum > class EnumSetting;
@@ -28,10 +29,22 @@ public:
     static EnumSetting< DitherType > FastSetting;
     static EnumSetting< DitherType > BestSetting;
 
-    /// Default constructor
+    //! State carried from sample to sample
+    struct State {
+        int mPhase;
+        float mTriangleState;
+        float mBuffer[8];
+    };
+
+    /// Default constructor, using the widest available kernel
     Dither();
 
-    /// Reset state of the dither.
+    /// Construct with the given kernel, for comparisons and benchmarks
+    /*! @pre `IsSummaryKernelAvailable(kernel)` */
+    explicit Dither(SummaryKernel kernel);
+
+    /// Reset state of the dither, including the noise stream, so that
+    /// the same sequence of calls to Apply() gives the same results.
     void Reset();
 
     /// Apply the actual dithering. Expects the source sample in the
@@ -44,6 +57,13 @@ public:
                unsigned int len,
                unsigned int sourceStride = 1,
                unsigned int destStride = 1);
+
+private:
+    void ResetFilter();
+
+    const SummaryKernel mKernel;
+    State mState;
+    DitherNoise mNoise;
 };
 
 #endif /* __AUDACITY_DITHER_H__ */
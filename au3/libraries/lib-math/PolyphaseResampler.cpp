@@ -0,0 +1,253 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file PolyphaseResampler.cpp
+
+**********************************************************************/
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace {
+constexpr double pi = 3.14159265358979323846;
+
+struct Design {
+   //! Stopband attenuation in dB
+   double attenuation;
+   //! Width of the transition band, as a fraction of the Nyquist frequency
+   double transition;
+};
+
+// Indexed by quality
+const Design designs[] = {
+   { 60, 0.3 },
+   { 90, 0.15 },
+   { 120, 0.08 },
+   { 140, 0.05 },
+};
+
+const Design &GetDesign(int quality)
+{
+   return designs[std::clamp(quality, 0, 3)];
+}
+
+size_t TapsPerPhase(size_t upFactor, size_t downFactor, int quality)
+{
+   // Kaiser's estimate of the length of the prototype
+   const auto &design = GetDesign(quality);
+   const auto width =
+      design.transition * pi / std::max(upFactor, downFactor);
+   const auto length = (design.attenuation - 7.95) / (2.285 * width);
+   return std::max<size_t>(4, std::ceil(length / upFactor));
+}
+
+double BesselI0(double x)
+{
+   double sum = 1, term = 1;
+   for (int k = 1; term > sum * 1e-12; ++k) {
+      term *= (x / (2 * k)) * (x / (2 * k));
+      sum += term;
+   }
+   return sum;
+}
+
+double KaiserBeta(double attenuation)
+{
+   if (attenuation > 50)
+      return 0.1102 * (attenuation - 8.7);
+   if (attenuation > 21)
+      return 0.5842 * std::pow(attenuation - 21, 0.4) +
+         0.07886 * (attenuation - 21);
+   return 0;
+}
+
+float Dot(const float *coefficients, const float *samples, size_t len)
+{
+   // Independent partial sums, so that the loop pipelines
+   float sums[4]{};
+   size_t i = 0;
+   for (; i + 4 <= len; i += 4)
+      for (size_t j = 0; j < 4; ++j)
+         sums[j] += coefficients[i + j] * samples[i + j];
+   for (; i < len; ++i)
+      sums[0] += coefficients[i] * samples[i];
+   return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+}
+
+std::pair<size_t, size_t> PolyphaseKernel::Ratio(double factor)
+{
+   if (!(factor > 0))
+      return { 0, 0 };
+   // Continued fraction expansion, until the convergent is close enough
+   long long p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+   auto x = factor;
+   for (int iteration = 0; iteration < 32; ++iteration) {
+      const auto a = static_cast<long long>(std::floor(x));
+      const auto p2 = a * p1 + p0, q2 = a * q1 + q0;
+      if (p2 > static_cast<long long>(MaxUpFactor) ||
+          q2 > static_cast<long long>(MaxCoefficients))
+         break;
+      p0 = p1, q0 = q1, p1 = p2, q1 = q2;
+      if (std::abs(static_cast<double>(p1) / q1 - factor) <= factor * 1e-12)
+         return { p1, q1 };
+      const auto fraction = x - a;
+      if (fraction < 1e-15)
+         break;
+      x = 1 / fraction;
+   }
+   return { 0, 0 };
+}
+
+std::shared_ptr<const PolyphaseKernel>
+PolyphaseKernel::Get(double factor, int quality)
+{
+   const auto [upFactor, downFactor] = Ratio(factor);
+   if (upFactor == 0 ||
+       upFactor * TapsPerPhase(upFactor, downFactor, quality) >
+          MaxCoefficients)
+      return nullptr;
+
+   static std::mutex mutex;
+   static std::map<std::tuple<size_t, size_t, int>,
+      std::shared_ptr<const PolyphaseKernel>> cache;
+
+   const auto key = std::tuple{ upFactor, downFactor, quality };
+   std::lock_guard lock{ mutex };
+   if (auto iter = cache.find(key); iter != cache.end())
+      return iter->second;
+
+   // Keep only kernels still in use, if there are many
+   if (cache.size() >= 16) {
+      for (auto iter = cache.begin(); iter != cache.end();) {
+         if (iter->second.use_count() == 1)
+            iter = cache.erase(iter);
+         else
+            ++iter;
+      }
+   }
+
+   auto result =
+      std::make_shared<const PolyphaseKernel>(upFactor, downFactor, quality);
+   cache.emplace(key, result);
+   return result;
+}
+
+PolyphaseKernel::PolyphaseKernel(
+   size_t upFactor, size_t downFactor, int quality)
+   : mUpFactor{ upFactor }
+   , mDownFactor{ downFactor }
+   , mTaps{ TapsPerPhase(upFactor, downFactor, quality) }
+{
+   const auto &design = GetDesign(quality);
+   const auto length = mUpFactor * mTaps;
+   // Odd length, so that the delay is a whole number of samples at the
+   // up-rate; if needed, the last coefficient is left zero
+   const auto odd = length - (1 - length % 2);
+   const auto center = (odd - 1) / 2.0;
+   // Cutoff in the middle of the transition band, in cycles per sample
+   const auto cutoff =
+      (1 - design.transition / 2) / (2 * std::max(upFactor, downFactor));
+   const auto beta = KaiserBeta(design.attenuation);
+   const auto scale = 1 / BesselI0(beta);
+
+   std::vector<double> prototype(length);
+   for (size_t j = 0; j < odd; ++j) {
+      const auto t = j - center;
+      const auto sinc = t == 0
+         ? 2 * cutoff
+         : std::sin(2 * pi * cutoff * t) / (pi * t);
+      const auto r = t / (center + 1);
+      prototype[j] = sinc * BesselI0(beta * std::sqrt(1 - r * r)) * scale;
+   }
+
+   // Output at up-rate position u takes the sum over k of
+   // prototype[u % L + k * L] times input[u / L - k]; store each phase
+   // reversed, to be in order of increasing input time
+   mCoefficients.resize(length);
+   for (size_t phase = 0; phase < mUpFactor; ++phase) {
+      double sum = 0;
+      for (size_t k = 0; k < mTaps; ++k)
+         sum += prototype[phase + k * mUpFactor];
+      const auto gain = sum != 0 ? 1 / sum : 1;
+      const auto coefficients = mCoefficients.data() + phase * mTaps;
+      for (size_t k = 0; k < mTaps; ++k)
+         coefficients[mTaps - 1 - k] =
+            prototype[phase + k * mUpFactor] * gain;
+   }
+}
+
+PolyphaseResampler::PolyphaseResampler(
+   std::shared_ptr<const PolyphaseKernel> pKernel)
+   : mpKernel{ move(pKernel) }
+   // History before the start is silence
+   , mBuffer(mpKernel->Taps() - 1)
+   , mBase{ -static_cast<long long>(mpKernel->Taps() - 1) }
+{
+}
+
+PolyphaseResampler::~PolyphaseResampler() = default;
+
+std::pair<size_t, size_t> PolyphaseResampler::Process(
+   const float *inBuffer, size_t inBufferLen, bool lastFlag,
+   float *outBuffer, size_t outBufferLen)
+{
+   const auto &kernel = *mpKernel;
+   const long long L = kernel.UpFactor();
+   const long long M = kernel.DownFactor();
+   const long long T = kernel.Taps();
+   // Delay of the filter at the up-rate; makes output align with input
+   const auto delay = (L * T - 1) / 2;
+   // Index of the newest input sample needed for output n
+   const auto newest = [&](long long n) { return (n * M + delay) / L; };
+
+   size_t consumed = 0;
+   if (mTotal < 0) {
+      // Take no more input than needed to fill the output
+      const auto bufferEnd = mBase + static_cast<long long>(mBuffer.size());
+      if (outBufferLen > 0) {
+         const auto needed =
+            newest(mProduced + outBufferLen - 1) + 1 - bufferEnd;
+         consumed = std::clamp<long long>(needed, 0, inBufferLen);
+      }
+      mBuffer.insert(mBuffer.end(), inBuffer, inBuffer + consumed);
+      if (lastFlag && consumed == inBufferLen) {
+         const auto inputLength = bufferEnd + consumed;
+         mTotal = (inputLength * L + M - 1) / M;
+         // Input after the end is silence
+         if (mTotal > 0) {
+            const auto end = newest(mTotal - 1) + 1;
+            mBuffer.resize(std::max<long long>(mBuffer.size(), end - mBase));
+         }
+      }
+   }
+
+   const auto bufferEnd = mBase + static_cast<long long>(mBuffer.size());
+   size_t produced = 0;
+   for (; produced < outBufferLen; ++produced) {
+      const auto n = mProduced + static_cast<long long>(produced);
+      if (mTotal >= 0 && n >= mTotal)
+         break;
+      const auto u = n * M + delay;
+      const auto i = u / L;
+      if (i >= bufferEnd)
+         break;
+      outBuffer[produced] = Dot(kernel.Phase(u % L),
+         mBuffer.data() + (i - (T - 1) - mBase), T);
+   }
+   mProduced += produced;
+
+   // Discard input that no later output needs
+   const auto oldest = newest(mProduced) - (T - 1);
+   const auto discard =
+      std::clamp<long long>(oldest - mBase, 0, mBuffer.size());
+   mBuffer.erase(mBuffer.begin(), mBuffer.begin() + discard);
+   mBase += discard;
+
+   return { consumed, produced };
+}
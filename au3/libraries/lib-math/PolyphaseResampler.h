@@ -0,0 +1,94 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file PolyphaseResampler.h
+  @brief Constant-rate resampling with shared polyphase filters
+
+**********************************************************************/
+
+#ifndef __AUDACITY_POLYPHASE_RESAMPLER__
+#define __AUDACITY_POLYPHASE_RESAMPLER__
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//! Immutable bank of filters for resampling by a ratio of small integers
+/*!
+ The prototype is a Kaiser-windowed sinc at the rate of the input times
+ UpFactor(), cut off below the Nyquist frequency of the slower of the input
+ and output.  It is split into UpFactor() phases of Taps() coefficients, each
+ normalized to unit gain at DC.
+ */
+class MATH_API PolyphaseKernel final
+{
+public:
+   //! Kernels that are never constructed, because they would be too big
+   static constexpr size_t MaxUpFactor = 1024;
+   static constexpr size_t MaxCoefficients = 1 << 18;
+
+   //! Get a kernel from a cache shared by all threads, making it if needed
+   /*!
+    @param factor output rate divided by input rate
+    @param quality 0 (fastest) to 3 (best), as for Resample
+    @return null if factor is not near enough to a ratio of small integers
+    */
+   static std::shared_ptr<const PolyphaseKernel>
+   Get(double factor, int quality);
+
+   //! Find the ratio of small integers equal to factor
+   /*! @return {0, 0} if there is none */
+   static std::pair<size_t, size_t> Ratio(double factor);
+
+   PolyphaseKernel(size_t upFactor, size_t downFactor, int quality);
+
+   size_t UpFactor() const { return mUpFactor; }
+   size_t DownFactor() const { return mDownFactor; }
+   size_t Taps() const { return mTaps; }
+
+   //! Coefficients of one phase, in order of increasing input time
+   const float *Phase(size_t phase) const
+   {
+      return mCoefficients.data() + phase * mTaps;
+   }
+
+private:
+   const size_t mUpFactor;
+   const size_t mDownFactor;
+   size_t mTaps{};
+   std::vector<float> mCoefficients;
+};
+
+//! Per-stream state of constant-rate resampling with a shared kernel
+/*!
+ Output is aligned with input, compensating the delay of the filter; flushing
+ makes `ceil(input length * UpFactor() / DownFactor())` samples in all.
+ */
+class MATH_API PolyphaseResampler final
+{
+public:
+   explicit PolyphaseResampler(std::shared_ptr<const PolyphaseKernel> pKernel);
+   ~PolyphaseResampler();
+
+   PolyphaseResampler(PolyphaseResampler&&) noexcept = default;
+   PolyphaseResampler& operator=(PolyphaseResampler&&) noexcept = default;
+
+   //! Same contract as Resample::Process, but without the factor
+   std::pair<size_t, size_t> Process(const float *inBuffer, size_t inBufferLen,
+      bool lastFlag, float *outBuffer, size_t outBufferLen);
+
+private:
+   std::shared_ptr<const PolyphaseKernel> mpKernel;
+
+   //! Input samples from index mBase on; earlier samples are not needed
+   std::vector<float> mBuffer;
+   long long mBase;
+   //! Count of output samples made so far
+   long long mProduced{ 0 };
+   //! Total output count, once the last input is known
+   long long mTotal{ -1 };
+};
+
+#endif
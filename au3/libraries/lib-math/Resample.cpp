@@ -23,6 +23,7 @@
 *//*******************************************************************/
 
 #include "Resample.h"
+#include "PolyphaseResampler.h"
 #include "Prefs.h"
 #include "Internat.h"
 #include "ComponentInterface.h"
@@ -36,6 +37,14 @@ Resample::Resample(const bool useBestMethod, const double dMinFactor, const doub
    if (dMinFactor == dMaxFactor)
    {
       mbWantConstRateResampling = true; // constant rate resampling
+      auto pKernel = SharedFiltersSetting.Read()
+         ? PolyphaseKernel::Get(dMinFactor, mMethod)
+         : nullptr;
+      if (pKernel) {
+         mpPolyphase =
+            std::make_unique<PolyphaseResampler>(std::move(pKernel));
+         return;
+      }
       q_spec = soxr_quality_spec("\0\1\4\6"[mMethod], 0);
    }
    else
@@ -50,6 +59,9 @@ Resample::~Resample()
 {
 }
 
+Resample::Resample(Resample&&) noexcept = default;
+Resample& Resample::operator=(Resample&&) noexcept = default;
+
 //////////
 static const std::initializer_list<EnumValueSymbol> methodNames{
    { wxT("LowQuality"), XO("Low Quality (Fastest)") },
@@ -83,6 +95,9 @@ EnumSetting< int > Resample::BestMethodSetting
    wxT("/Quality/LibsoxrHQSampleRateConverter")
 };
 
+BoolSetting Resample::SharedFiltersSetting{
+   wxT("/Quality/SharedResamplerFilters"), false };
+
 //////////
 std::pair<size_t, size_t>
       Resample::Process(double       factor,
@@ -92,6 +107,10 @@ std::pair<size_t, size_t>
                         float       *outBuffer,
                         size_t       outBufferLen)
 {
+   if (mpPolyphase)
+      return mpPolyphase->Process(
+         inBuffer, inBufferLen, lastFlag, outBuffer, outBufferLen);
+
    size_t idone, odone;
    if (mbWantConstRateResampling)
    {
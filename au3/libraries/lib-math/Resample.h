@@ -14,7 +14,9 @@
 
 #include "SampleFormat.h"
 
+class BoolSetting;
 template< typename Enum > class EnumSetting;
+class PolyphaseResampler;
 
 struct soxr;
 extern "C" void soxr_delete(soxr*);
@@ -39,14 +41,17 @@ class MATH_API Resample final
    Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
    ~Resample();
 
-   Resample( Resample&&) noexcept = default;
-   Resample& operator=(Resample&&) noexcept = default;
+   Resample( Resample&&) noexcept;
+   Resample& operator=(Resample&&) noexcept;
 
    Resample(const Resample&) = delete;
    Resample& operator=(const Resample&) = delete;
 
    static EnumSetting< int > FastMethodSetting;
    static EnumSetting< int > BestMethodSetting;
+   //! Whether constant-rate resampling by ratios of small integers uses
+   //! PolyphaseResampler, with filters shared by all instances, not libsoxr
+   static BoolSetting SharedFiltersSetting;
 
    /** @brief Main processing function. Resamples from the input buffer to the
     * output buffer.
@@ -84,6 +89,7 @@ class MATH_API Resample final
  protected:
    int   mMethod; // resampler-specific enum for resampling method
    soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
+   std::unique_ptr<PolyphaseResampler> mpPolyphase; // instead of mHandle
    bool mbWantConstRateResampling;
 };
 
@@ -46,7 +46,9 @@
 
 DitherType gLowQualityDither = DitherType::none;
 DitherType gHighQualityDither = DitherType::shaped;
-static Dither gDitherAlgorithm;
+// Shaped dither carries error from call to call, and CopySamples is called
+// from many threads, so each thread has its own
+static thread_local Dither gDitherAlgorithm;
 
 void InitDitherers()
 {
@@ -0,0 +1,247 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SummaryKernels.cpp
+
+**********************************************************************/
+
+#include "SummaryKernels.h"
+
+#include <cassert>
+#include <initializer_list>
+
+// Contraction of multiplication and addition into fused operations would
+// round differently in some kernels than in others
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__SSE2__) || defined(_M_AMD64) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SUMMARY_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SUMMARY_KERNELS_AVX2_TARGET
+#else
+#define SUMMARY_KERNELS_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+constexpr size_t Lanes = 8;
+
+//! Running results for each of the lanes
+struct Partials
+{
+   float min[Lanes];
+   float max[Lanes];
+   double sumsq[Lanes];
+
+   explicit Partials(float first)
+   {
+      for (size_t lane = 0; lane < Lanes; ++lane) {
+         min[lane] = max[lane] = first;
+         sumsq[lane] = 0;
+      }
+   }
+
+   // Comparisons are as for the minps and maxps instructions, which give
+   // the second operand if either is NaN
+   void Accumulate(size_t lane, float x)
+   {
+      min[lane] = x < min[lane] ? x : min[lane];
+      max[lane] = x > max[lane] ? x : max[lane];
+      const double dx = x;
+      sumsq[lane] = sumsq[lane] + dx * dx;
+   }
+
+   //! Accumulate the samples not filling a whole vector
+   void AccumulateTail(const float *samples, size_t start, size_t len)
+   {
+      for (size_t ii = start; ii < len; ++ii)
+         Accumulate(ii % Lanes, samples[ii]);
+   }
+
+   MinMaxSumSq Reduce() const
+   {
+      auto rmin = min[0];
+      auto rmax = max[0];
+      for (size_t lane = 1; lane < Lanes; ++lane) {
+         rmin = min[lane] < rmin ? min[lane] : rmin;
+         rmax = max[lane] > rmax ? max[lane] : rmax;
+      }
+      // The order in which a horizontal vector sum also adds
+      const auto s0 = sumsq[0] + sumsq[4];
+      const auto s1 = sumsq[1] + sumsq[5];
+      const auto s2 = sumsq[2] + sumsq[6];
+      const auto s3 = sumsq[3] + sumsq[7];
+      return { rmin, rmax, (s0 + s2) + (s1 + s3) };
+   }
+};
+
+MinMaxSumSq ScalarKernel(const float *samples, size_t len)
+{
+   Partials partials{ samples[0] };
+   size_t ii = 0;
+   for (; ii + Lanes <= len; ii += Lanes)
+      for (size_t lane = 0; lane < Lanes; ++lane)
+         partials.Accumulate(lane, samples[ii + lane]);
+   partials.AccumulateTail(samples, ii, len);
+   return partials.Reduce();
+}
+
+#ifdef SUMMARY_KERNELS_X86
+
+MinMaxSumSq SSE2Kernel(const float *samples, size_t len)
+{
+   // Two registers make the eight lanes of extremes, and four the eight
+   // lanes of sums
+   auto min0 = _mm_set1_ps(samples[0]);
+   auto min1 = min0;
+   auto max0 = min0;
+   auto max1 = min0;
+   auto sum0 = _mm_setzero_pd();
+   auto sum1 = sum0;
+   auto sum2 = sum0;
+   auto sum3 = sum0;
+
+   size_t ii = 0;
+   for (; ii + Lanes <= len; ii += Lanes) {
+      const auto x0 = _mm_loadu_ps(samples + ii);
+      const auto x1 = _mm_loadu_ps(samples + ii + 4);
+      min0 = _mm_min_ps(x0, min0);
+      min1 = _mm_min_ps(x1, min1);
+      max0 = _mm_max_ps(x0, max0);
+      max1 = _mm_max_ps(x1, max1);
+      const auto d0 = _mm_cvtps_pd(x0);
+      const auto d1 = _mm_cvtps_pd(_mm_movehl_ps(x0, x0));
+      const auto d2 = _mm_cvtps_pd(x1);
+      const auto d3 = _mm_cvtps_pd(_mm_movehl_ps(x1, x1));
+      sum0 = _mm_add_pd(sum0, _mm_mul_pd(d0, d0));
+      sum1 = _mm_add_pd(sum1, _mm_mul_pd(d1, d1));
+      sum2 = _mm_add_pd(sum2, _mm_mul_pd(d2, d2));
+      sum3 = _mm_add_pd(sum3, _mm_mul_pd(d3, d3));
+   }
+
+   Partials partials{ samples[0] };
+   _mm_storeu_ps(partials.min, min0);
+   _mm_storeu_ps(partials.min + 4, min1);
+   _mm_storeu_ps(partials.max, max0);
+   _mm_storeu_ps(partials.max + 4, max1);
+   _mm_storeu_pd(partials.sumsq, sum0);
+   _mm_storeu_pd(partials.sumsq + 2, sum1);
+   _mm_storeu_pd(partials.sumsq + 4, sum2);
+   _mm_storeu_pd(partials.sumsq + 6, sum3);
+   partials.AccumulateTail(samples, ii, len);
+   return partials.Reduce();
+}
+
+SUMMARY_KERNELS_AVX2_TARGET
+MinMaxSumSq AVX2Kernel(const float *samples, size_t len)
+{
+   // Two registers make the eight lanes of sums
+   auto min = _mm256_set1_ps(samples[0]);
+   auto max = min;
+   auto sum0 = _mm256_setzero_pd();
+   auto sum1 = sum0;
+
+   size_t ii = 0;
+   for (; ii + Lanes <= len; ii += Lanes) {
+      const auto x = _mm256_loadu_ps(samples + ii);
+      min = _mm256_min_ps(x, min);
+      max = _mm256_max_ps(x, max);
+      const auto d0 = _mm256_cvtps_pd(_mm256_castps256_ps128(x));
+      const auto d1 = _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1));
+      sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(d0, d0));
+      sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(d1, d1));
+   }
+
+   Partials partials{ samples[0] };
+   _mm256_storeu_ps(partials.min, min);
+   _mm256_storeu_ps(partials.max, max);
+   _mm256_storeu_pd(partials.sumsq, sum0);
+   _mm256_storeu_pd(partials.sumsq + 4, sum1);
+   partials.AccumulateTail(samples, ii, len);
+   return partials.Reduce();
+}
+
+bool HasAVX2()
+{
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+   __cpuid(info, 1);
+   constexpr int osxsave = 1 << 27, avx = 1 << 28;
+   if ((info[2] & (osxsave | avx)) != (osxsave | avx))
+      return false;
+   // The operating system must save the upper halves of the registers
+   if ((_xgetbv(0) & 6) != 6)
+      return false;
+   __cpuidex(info, 7, 0);
+   return (info[1] & (1 << 5)) != 0;
+#else
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+} // namespace
+
+bool IsSummaryKernelAvailable(SummaryKernel kernel)
+{
+   switch (kernel) {
+   case SummaryKernel::Scalar:
+      return true;
+#ifdef SUMMARY_KERNELS_X86
+   case SummaryKernel::SSE2:
+      return true;
+   case SummaryKernel::AVX2: {
+      static const bool result = HasAVX2();
+      return result;
+   }
+#endif
+   default:
+      return false;
+   }
+}
+
+SummaryKernel GetSummaryKernel()
+{
+   static const auto result = []{
+      for (auto kernel : { SummaryKernel::AVX2, SummaryKernel::SSE2 })
+         if (IsSummaryKernelAvailable(kernel))
+            return kernel;
+      return SummaryKernel::Scalar;
+   }();
+   return result;
+}
+
+MinMaxSumSq ComputeMinMaxSumSq(const float *samples, size_t len)
+{
+   return ComputeMinMaxSumSq(GetSummaryKernel(), samples, len);
+}
+
+MinMaxSumSq ComputeMinMaxSumSq(
+   SummaryKernel kernel, const float *samples, size_t len)
+{
+   assert(len > 0);
+   assert(IsSummaryKernelAvailable(kernel));
+   switch (kernel) {
+#ifdef SUMMARY_KERNELS_X86
+   case SummaryKernel::AVX2:
+      return AVX2Kernel(samples, len);
+   case SummaryKernel::SSE2:
+      return SSE2Kernel(samples, len);
+#endif
+   default:
+      return ScalarKernel(samples, len);
+   }
+}
@@ -0,0 +1,56 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SummaryKernels.h
+  @brief Vectorized extremes and sums of squares of sample ranges
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SUMMARY_KERNELS__
+#define __AUDACITY_SUMMARY_KERNELS__
+
+#include <cstddef>
+
+//! Extremes and sum of squares of a range of samples
+struct MinMaxSumSq
+{
+   float min;
+   float max;
+   double sumsq;
+};
+
+//! Implementations of ComputeMinMaxSumSq
+enum class SummaryKernel
+{
+   Scalar,
+   SSE2,
+   AVX2,
+};
+
+//! Whether the kernel was compiled in and the processor supports it
+MATH_API bool IsSummaryKernelAvailable(SummaryKernel kernel);
+
+//! The kernel that ComputeMinMaxSumSq uses:  the widest available
+MATH_API SummaryKernel GetSummaryKernel();
+
+//! Find extremes and sum of squares of samples
+/*!
+ Squares, which are exact in double precision, accumulate in double
+ precision into eight partial sums, the i-th taking every eighth sample
+ starting at the i-th, which are then added pairwise in a fixed order.  So
+ all kernels give bit-identical results, and long ranges lose no more
+ precision than a sequential sum in double precision.
+
+ A NaN sample is ignored by min and max, unless it is the first.
+
+ @pre `len > 0`
+ */
+MATH_API MinMaxSumSq ComputeMinMaxSumSq(const float *samples, size_t len);
+
+//! Like the other overload, but using the given kernel
+/*! @pre `IsSummaryKernelAvailable(kernel)` */
+MATH_API MinMaxSumSq ComputeMinMaxSumSq(
+   SummaryKernel kernel, const float *samples, size_t len);
+
+#endif
@@ -0,0 +1,363 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ConversionKernelsTests.cpp
+
+**********************************************************************/
+#include "ConversionKernels.h"
+#include "BenchmarkUtils.h"
+#include "Dither.h"
+#include "KernelTestUtils.h"
+#include "SampleFormat.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+using namespace KernelTestUtils;
+
+namespace
+{
+const auto allDithers = { DitherType::none, DitherType::rectangle,
+                          DitherType::triangle, DitherType::shaped };
+
+const char* FormatName(sampleFormat format)
+{
+   switch (format)
+   {
+   case sampleFormat::int16Sample:
+      return "int16";
+   case sampleFormat::int24Sample:
+      return "int24";
+   default:
+      return "float";
+   }
+}
+
+const char* DitherName(DitherType dither)
+{
+   switch (dither)
+   {
+   case DitherType::rectangle:
+      return "rectangle";
+   case DitherType::triangle:
+      return "triangle";
+   case DitherType::shaped:
+      return "shaped";
+   default:
+      return "none";
+   }
+}
+
+struct FormatPair
+{
+   sampleFormat src;
+   sampleFormat dst;
+   bool dithers;
+};
+
+const FormatPair allPairs[] = {
+   { sampleFormat::int16Sample, sampleFormat::floatSample, false },
+   { sampleFormat::int24Sample, sampleFormat::floatSample, false },
+   { sampleFormat::int16Sample, sampleFormat::int24Sample, false },
+   { sampleFormat::int24Sample, sampleFormat::int16Sample, true },
+   { sampleFormat::floatSample, sampleFormat::int16Sample, true },
+   { sampleFormat::floatSample, sampleFormat::int24Sample, true },
+};
+
+//! Samples somewhat beyond -1.0...1.0 in the given format, interleaved
+//! with the given stride
+SampleBuffer RandomSamples(
+   sampleFormat format, size_t len, size_t stride, unsigned seed)
+{
+   std::mt19937 engine { seed };
+   std::uniform_real_distribution<float> distribution { -1.1f, 1.1f };
+   SampleBuffer result { len * stride, format };
+   for (size_t ii = 0; ii < len * stride; ++ii)
+   {
+      const auto x = distribution(engine);
+      switch (format)
+      {
+      case sampleFormat::int16Sample:
+         reinterpret_cast<short*>(result.ptr())[ii] =
+            static_cast<short>(std::max(-1.f, std::min(x, 1.f)) * 32767);
+         break;
+      case sampleFormat::int24Sample:
+         reinterpret_cast<int*>(result.ptr())[ii] =
+            static_cast<int>(std::max(-1.f, std::min(x, 1.f)) * 8388607);
+         break;
+      default:
+         reinterpret_cast<float*>(result.ptr())[ii] = x;
+      }
+   }
+   return result;
+}
+
+SampleBuffer Zeroes(size_t len, sampleFormat format)
+{
+   SampleBuffer result { len, format };
+   std::memset(result.ptr(), 0, len * SAMPLE_SIZE(format));
+   return result;
+}
+
+bool SameBytes(const SampleBuffer& a, const SampleBuffer& b, size_t size)
+{
+   return std::memcmp(a.ptr(), b.ptr(), size) == 0;
+}
+
+// The conversions as they were before the kernels, one sample at a time,
+// for comparison in the benchmark
+namespace Legacy
+{
+float Noise()
+{
+   return rand() / (float)RAND_MAX - 0.5f;
+}
+
+float Load(const short* ptr)
+{
+   return *ptr / float(1 << 15);
+}
+
+float Load(const int* ptr)
+{
+   return *ptr / float(1 << 23);
+}
+
+float Load(const float* ptr)
+{
+   return *ptr > 1.0 ? 1.0 : *ptr < -1.0 ? -1.0 : *ptr;
+}
+
+template<typename Dst>
+void Store(Dst* ptr, float sample, int lower, int upper)
+{
+   const int x = std::lrint(sample);
+   *ptr = static_cast<Dst>(x > upper ? upper : x < lower ? lower : x);
+}
+
+template<typename Src, typename Dst>
+void Convert(DitherType dither, const Src* src, Dst* dst, size_t len)
+{
+   if constexpr (std::is_same_v<Dst, float>)
+   {
+      for (size_t ii = 0; ii < len; ++ii)
+         dst[ii] = Load(src + ii);
+   }
+   else if constexpr (std::is_same_v<Src, short>)
+   {
+      for (size_t ii = 0; ii < len; ++ii)
+         dst[ii] = static_cast<int>(src[ii]) << 8;
+   }
+   else
+   {
+      const auto is16 = std::is_same_v<Dst, short>;
+      const auto scale = float(is16 ? 1 << 15 : 1 << 23);
+      const auto lower = is16 ? -32768 : -8388608;
+      const auto upper = is16 ? 32767 : 8388607;
+      float previous = 0;
+      for (size_t ii = 0; ii < len; ++ii)
+      {
+         auto sample = Load(src + ii) * scale;
+         if (dither == DitherType::triangle)
+         {
+            const auto r = Noise();
+            sample = sample + r - previous;
+            previous = r;
+         }
+         Store(dst + ii, sample, lower, upper);
+      }
+   }
+}
+
+void Apply(DitherType dither, constSamplePtr src, sampleFormat srcFormat,
+   samplePtr dst, sampleFormat dstFormat, size_t len)
+{
+   using F = sampleFormat;
+   if (srcFormat == F::int16Sample && dstFormat == F::floatSample)
+      Convert(dither, (const short*)src, (float*)dst, len);
+   else if (srcFormat == F::int24Sample && dstFormat == F::floatSample)
+      Convert(dither, (const int*)src, (float*)dst, len);
+   else if (srcFormat == F::int16Sample && dstFormat == F::int24Sample)
+      Convert(dither, (const short*)src, (int*)dst, len);
+   else if (srcFormat == F::int24Sample && dstFormat == F::int16Sample)
+      Convert(dither, (const int*)src, (short*)dst, len);
+   else if (srcFormat == F::floatSample && dstFormat == F::int16Sample)
+      Convert(dither, (const float*)src, (short*)dst, len);
+   else
+      Convert(dither, (const float*)src, (int*)dst, len);
+}
+} // namespace Legacy
+} // namespace
+
+TEST_CASE("Conversion kernels")
+{
+   SECTION("Dither gives bit-identical results with every kernel")
+   {
+      const auto len = GENERATE(1, 7, 8, 17, 255, 256, 257, 1000);
+      const auto stride = GENERATE(1, 2);
+      for (const auto& pair : allPairs)
+      {
+         const auto source = RandomSamples(pair.src, len, stride, len);
+         for (const auto ditherType : allDithers)
+         {
+            // Zeroes, so that interleaved samples not written compare equal
+            auto expected = Zeroes(len * stride, pair.dst);
+            Dither { SummaryKernel::Scalar }.Apply(
+               ditherType, source.ptr(), pair.src, expected.ptr(), pair.dst,
+               len, stride, stride);
+            for (const auto kernel : allKernels)
+            {
+               if (!IsSummaryKernelAvailable(kernel))
+                  continue;
+               auto actual = Zeroes(len * stride, pair.dst);
+               Dither { kernel }.Apply(
+                  ditherType, source.ptr(), pair.src, actual.ptr(), pair.dst,
+                  len, stride, stride);
+               REQUIRE(SameBytes(
+                  actual, expected, len * stride * SAMPLE_SIZE(pair.dst)));
+            }
+         }
+      }
+   }
+
+   SECTION("Reset restarts the noise stream")
+   {
+      constexpr size_t len = 300;
+      const auto source = RandomSamples(sampleFormat::floatSample, len, 1, 0);
+      Dither dither;
+      SampleBuffer first { len, sampleFormat::int16Sample };
+      SampleBuffer second { len, sampleFormat::int16Sample };
+      dither.Apply(
+         DitherType::shaped, source.ptr(), sampleFormat::floatSample,
+         first.ptr(), sampleFormat::int16Sample, len);
+      dither.Reset();
+      dither.Apply(
+         DitherType::shaped, source.ptr(), sampleFormat::floatSample,
+         second.ptr(), sampleFormat::int16Sample, len);
+      REQUIRE(SameBytes(first, second, len * sizeof(short)));
+   }
+
+   SECTION("Undithered conversions round, clip and map NaN to zero")
+   {
+      const std::vector<float> source { 0.f,     0.5f,    -0.5f,
+                                        1.f,     -1.f,    2.f,
+                                        -2.f,    1.5f / 32768, 2.5f / 32768,
+                                        std::numeric_limits<float>::quiet_NaN() };
+      const std::vector<short> expected { 0,     16384,  -16384, 32767, -32768,
+                                          32767, -32768, 2,      2,     0 };
+      for (const auto kernel : allKernels)
+      {
+         if (!IsSummaryKernelAvailable(kernel))
+            continue;
+         std::vector<short> actual(source.size());
+         Dither { kernel }.Apply(
+            DitherType::none,
+            reinterpret_cast<constSamplePtr>(source.data()),
+            sampleFormat::floatSample,
+            reinterpret_cast<samplePtr>(actual.data()),
+            sampleFormat::int16Sample, source.size());
+         REQUIRE(actual == expected);
+      }
+   }
+
+   SECTION("16 bit samples survive the round trip through float")
+   {
+      std::vector<short> source(1 << 16);
+      for (size_t ii = 0; ii < source.size(); ++ii)
+         source[ii] = static_cast<short>(int(ii) - 32768);
+      for (const auto kernel : allKernels)
+      {
+         if (!IsSummaryKernelAvailable(kernel))
+            continue;
+         std::vector<float> floats(source.size());
+         std::vector<short> actual(source.size());
+         Int16ToFloat(kernel, source.data(), floats.data(), source.size());
+         ClipAndScale(
+            kernel, floats.data(), floats.data(), source.size(), 32768.f);
+         RoundToInt16(kernel, floats.data(), actual.data(), source.size());
+         REQUIRE(actual == source);
+      }
+   }
+
+   SECTION("Dither noise is the same from every kernel")
+   {
+      constexpr size_t len = 64;
+      std::vector<float> expected(len);
+      DitherNoise scalarNoise { 42 };
+      GenerateDitherNoise(
+         SummaryKernel::Scalar, scalarNoise, expected.data(), len);
+      for (const auto x : expected)
+         REQUIRE((x >= -0.5f && x <= 0.5f));
+      for (const auto kernel : allKernels)
+      {
+         if (!IsSummaryKernelAvailable(kernel))
+            continue;
+         std::vector<float> actual(len);
+         DitherNoise noise { 42 };
+         GenerateDitherNoise(kernel, noise, actual.data(), len);
+         REQUIRE(actual == expected);
+      }
+   }
+}
+
+TEST_CASE("Conversion kernels benchmark", "[.][benchmark]")
+{
+   constexpr size_t len = 1 << 18;
+   constexpr auto repetitions = 50;
+
+   const auto report = [](const FormatPair& pair, DitherType ditherType,
+                          const char* kernelName,
+                          BenchmarkUtils::Microseconds elapsed) {
+      std::cout << FormatName(pair.src) << " to " << FormatName(pair.dst)
+                << ", " << DitherName(ditherType) << " dither, " << kernelName
+                << ": " << len / elapsed.count()
+                << " million samples per second\n";
+   };
+
+   for (const auto& pair : allPairs)
+   {
+      const auto source = RandomSamples(pair.src, len, 1, 0);
+      SampleBuffer dest { len, pair.dst };
+      // Rectangle dither costs the same as triangle
+      for (const auto ditherType :
+           { DitherType::none, DitherType::triangle, DitherType::shaped })
+      {
+         if (!pair.dithers && ditherType != DitherType::none)
+            continue;
+
+         if (ditherType != DitherType::shaped)
+            report(
+               pair, ditherType, "per sample",
+               BenchmarkUtils::MeanTime(repetitions, [&] {
+                  Legacy::Apply(
+                     ditherType, source.ptr(), pair.src, dest.ptr(), pair.dst,
+                     len);
+               }));
+
+         for (const auto kernel : allKernels)
+         {
+            if (!IsSummaryKernelAvailable(kernel))
+               continue;
+            Dither dither { kernel };
+            report(
+               pair, ditherType, KernelName(kernel),
+               BenchmarkUtils::MeanTime(repetitions, [&] {
+                  dither.Apply(
+                     ditherType, source.ptr(), pair.src, dest.ptr(), pair.dst,
+                     len);
+               }));
+         }
+      }
+   }
+}
@@ -0,0 +1,32 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  KernelTestUtils.h
+
+**********************************************************************/
+#pragma once
+
+#include "SummaryKernels.h"
+
+namespace KernelTestUtils
+{
+//! Tests skip those not available
+inline const auto allKernels = {
+   SummaryKernel::Scalar, SummaryKernel::SSE2, SummaryKernel::AVX2
+};
+
+inline const char* KernelName(SummaryKernel kernel)
+{
+   switch (kernel)
+   {
+   case SummaryKernel::SSE2:
+      return "SSE2";
+   case SummaryKernel::AVX2:
+      return "AVX2";
+   default:
+      return "scalar";
+   }
+}
+} // namespace KernelTestUtils
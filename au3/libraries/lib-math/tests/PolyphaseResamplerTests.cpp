@@ -0,0 +1,99 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PolyphaseResamplerTests.cpp
+
+**********************************************************************/
+#include "PolyphaseResampler.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+constexpr double pi = 3.14159265358979323846;
+
+std::vector<float> Sine(double frequency, double rate, size_t len)
+{
+   std::vector<float> result(len);
+   for (size_t i = 0; i < len; ++i)
+      result[i] = std::sin(2 * pi * frequency * i / rate);
+   return result;
+}
+
+//! Resample all of input, giving at most inChunk and outChunk per call
+std::vector<float> Resample(PolyphaseResampler &resampler,
+   const std::vector<float> &input, size_t inChunk, size_t outChunk)
+{
+   std::vector<float> result;
+   std::vector<float> out(outChunk);
+   size_t pos = 0;
+   while (true) {
+      const auto len = std::min(inChunk, input.size() - pos);
+      const bool last = pos + len == input.size();
+      const auto [used, made] = resampler.Process(
+         input.data() + pos, len, last, out.data(), out.size());
+      pos += used;
+      result.insert(result.end(), out.begin(), out.begin() + made);
+      if (last && used == len && made == 0)
+         break;
+   }
+   return result;
+}
+}
+
+TEST_CASE("PolyphaseKernel")
+{
+   SECTION("finds ratios of small integers")
+   {
+      using Ratio = std::pair<size_t, size_t>;
+      REQUIRE(PolyphaseKernel::Ratio(48000.0 / 44100) == Ratio{ 160, 147 });
+      REQUIRE(PolyphaseKernel::Ratio(44100.0 / 48000) == Ratio{ 147, 160 });
+      REQUIRE(PolyphaseKernel::Ratio(2.0) == Ratio{ 2, 1 });
+      REQUIRE(PolyphaseKernel::Ratio(std::sqrt(2.0)) == Ratio{ 0, 0 });
+   }
+
+   SECTION("is shared")
+   {
+      const auto pKernel = PolyphaseKernel::Get(48000.0 / 44100, 1);
+      REQUIRE(pKernel);
+      REQUIRE(pKernel == PolyphaseKernel::Get(48000.0 / 44100, 1));
+      REQUIRE(pKernel != PolyphaseKernel::Get(48000.0 / 44100, 2));
+      REQUIRE(!PolyphaseKernel::Get(std::sqrt(2.0), 1));
+   }
+}
+
+TEST_CASE("PolyphaseResampler")
+{
+   for (auto [inRate, outRate] : { std::pair{ 44100.0, 48000.0 },
+                                   std::pair{ 48000.0, 44100.0 },
+                                   std::pair{ 22050.0, 44100.0 } })
+      for (int quality = 0; quality <= 3; ++quality) {
+         const auto factor = outRate / inRate;
+         const auto pKernel = PolyphaseKernel::Get(factor, quality);
+         REQUIRE(pKernel);
+         const auto input = Sine(1000, inRate, 10000);
+         const auto expectedLength = static_cast<size_t>(
+            std::ceil(input.size() * factor - 1e-9));
+
+         PolyphaseResampler whole{ pKernel };
+         const auto output = Resample(whole, input, input.size(), 100000);
+         REQUIRE(output.size() == expectedLength);
+
+         // Aligned with the input, away from the ends
+         const auto expected = Sine(1000, outRate, output.size());
+         const auto margin = output.size() / 10;
+         const auto tolerance = quality == 0 ? 1e-2 : 1e-3;
+         for (size_t i = margin; i < output.size() - margin; ++i)
+            REQUIRE(std::abs(output[i] - expected[i]) < tolerance);
+
+         // Independent of how the input and output are divided
+         PolyphaseResampler chunked{ pKernel };
+         REQUIRE(Resample(chunked, input, 333, 77) == output);
+      }
+}
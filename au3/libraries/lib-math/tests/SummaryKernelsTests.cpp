@@ -0,0 +1,158 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SummaryKernelsTests.cpp
+
+**********************************************************************/
+#include "SummaryKernels.h"
+#include "BenchmarkUtils.h"
+#include "Dither.h"
+#include "KernelTestUtils.h"
+#include "SampleFormat.h"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+using namespace KernelTestUtils;
+using BenchmarkUtils::RandomSamples;
+
+namespace
+{
+bool BitIdentical(float a, float b)
+{
+   return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+//! The loop that summarized waveforms before there were kernels
+double ScalarSumOfSquares(const float* samples, size_t len)
+{
+   double sqSum = 0.0;
+   for (size_t ii = 0; ii < len; ++ii)
+   {
+      const double dbl = samples[ii];
+      sqSum += dbl * dbl;
+   }
+   return sqSum;
+}
+
+} // namespace
+
+TEST_CASE("ComputeMinMaxSumSq")
+{
+   SECTION("kernels agree bit for bit")
+   {
+      // Lengths exercising whole vectors, tails and a 256 sample summary
+      const auto len = GENERATE(1, 3, 7, 8, 9, 15, 16, 17, 255, 256, 1000);
+      const auto samples = RandomSamples(len, len);
+      const auto expected =
+         ComputeMinMaxSumSq(SummaryKernel::Scalar, samples.data(), len);
+      for (const auto kernel : allKernels)
+      {
+         if (!IsSummaryKernelAvailable(kernel))
+            continue;
+         const auto actual = ComputeMinMaxSumSq(kernel, samples.data(), len);
+         REQUIRE(BitIdentical(actual.min, expected.min));
+         REQUIRE(BitIdentical(actual.max, expected.max));
+         REQUIRE(BitIdentical(actual.sumsq, expected.sumsq));
+      }
+   }
+
+   SECTION("extremes and sum of squares are correct")
+   {
+      const std::vector<float> samples { 0.5f, -0.25f, 1.f, 0.f, -1.f,
+                                         0.75f, 0.5f, -0.5f, 0.25f };
+      for (const auto kernel : allKernels)
+      {
+         if (!IsSummaryKernelAvailable(kernel))
+            continue;
+         const auto actual =
+            ComputeMinMaxSumSq(kernel, samples.data(), samples.size());
+         REQUIRE(actual.min == -1.f);
+         REQUIRE(actual.max == 1.f);
+         // All squares are exact in single precision
+         REQUIRE(actual.sumsq == 3.4375f);
+      }
+   }
+
+   SECTION("sum of squares is as accurate as the scalar loop in double")
+   {
+      // Long enough that sums in single precision would be off in the
+      // fifth or sixth digit
+      const auto len = GENERATE(256, 65536, 1 << 20);
+      const auto samples = RandomSamples(len, 2);
+      const auto expected = ScalarSumOfSquares(samples.data(), len);
+      for (const auto kernel : allKernels)
+      {
+         if (!IsSummaryKernelAvailable(kernel))
+            continue;
+         const auto actual = ComputeMinMaxSumSq(kernel, samples.data(), len);
+         REQUIRE(actual.sumsq == Approx(expected).epsilon(1e-12));
+      }
+   }
+
+   SECTION("NaN after the first sample is ignored by min and max")
+   {
+      auto samples = RandomSamples(37, 1);
+      samples[0] = 0.f;
+      samples[10] = std::numeric_limits<float>::quiet_NaN();
+      for (const auto kernel : allKernels)
+      {
+         if (!IsSummaryKernelAvailable(kernel))
+            continue;
+         const auto actual =
+            ComputeMinMaxSumSq(kernel, samples.data(), samples.size());
+         REQUIRE(!std::isnan(actual.min));
+         REQUIRE(!std::isnan(actual.max));
+      }
+   }
+}
+
+TEST_CASE("ComputeMinMaxSumSq benchmark", "[.][benchmark]")
+{
+   // As when summarizing a block of the default maximum size
+   constexpr size_t blockLen = 1 << 18;
+   constexpr size_t summaryLen = 256;
+   constexpr auto repetitions = 100;
+   const auto floats = RandomSamples(blockLen, 0);
+
+   using Format = std::pair<sampleFormat, const char*>;
+   for (const auto& [format, formatName] :
+        { Format { sampleFormat::int16Sample, "int16" },
+          Format { sampleFormat::int24Sample, "int24" },
+          Format { sampleFormat::floatSample, "float" } })
+   {
+      // Stored samples, to be converted to float before summarizing, as
+      // sample blocks do
+      SampleBuffer stored { blockLen, format };
+      CopySamples(
+         reinterpret_cast<constSamplePtr>(floats.data()),
+         sampleFormat::floatSample, stored.ptr(), format, blockLen,
+         DitherType::none);
+      std::vector<float> converted(blockLen);
+
+      for (const auto kernel : allKernels)
+      {
+         if (!IsSummaryKernelAvailable(kernel))
+            continue;
+         double total = 0;
+         const auto elapsed = BenchmarkUtils::MeanTime(repetitions, [&] {
+            SamplesToFloats(stored.ptr(), format, converted.data(), blockLen);
+            for (size_t jj = 0; jj < blockLen; jj += summaryLen)
+               total +=
+                  ComputeMinMaxSumSq(kernel, converted.data() + jj, summaryLen)
+                     .sumsq;
+         });
+         std::cout << formatName << " samples, " << KernelName(kernel) << ": "
+                   << elapsed.count() << " us per block"
+                   << " (checksum " << total << ")\n";
+      }
+   }
+}
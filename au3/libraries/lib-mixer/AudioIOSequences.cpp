@@ -11,6 +11,11 @@
 
 PlayableSequence::~PlayableSequence() = default;
 
+void PlayableSequence::VisitPrefetchItems(
+   double, double, const PrefetchVisitor &) const
+{
+}
+
 RecordableSequence::~RecordableSequence() = default;
 
 OtherPlayableSequence::~OtherPlayableSequence() = default;
@@ -13,6 +13,10 @@
 #define __AUDACITY_AUDIO_IO_SEQUENCES__
 
 #include "WideSampleSequence.h"
+
+#include <functional>
+#include <memory>
+
 class ChannelGroup;
 
 /*!
@@ -30,6 +34,24 @@ struct MIXER_API PlayableSequence : WideSampleSequence {
 
    //! May vary asynchronously
    virtual bool GetMute() const = 0;
+
+   //! A piece of sample data that a cache can keep resident in memory
+   struct PrefetchItem {
+      //! Identifies the piece among all pieces of all sequences of a project
+      long long key;
+      //! Reads the piece; it stays in memory while the result is held
+      /*! May be called in a worker thread */
+      std::function<std::shared_ptr<const void>()> load;
+   };
+   using PrefetchVisitor = std::function<void(PrefetchItem)>;
+
+   //! Visit the pieces of sample data needed to play the given time interval
+   /*!
+    Called in the thread that reads the sequence.  The default visits nothing.
+    @pre `t0 <= t1`
+    */
+   virtual void VisitPrefetchItems(
+      double t0, double t1, const PrefetchVisitor &visitor) const;
 };
 
 using ConstPlayableSequences =
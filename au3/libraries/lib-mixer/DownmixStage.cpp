@@ -12,11 +12,16 @@
 
 #include "DownmixStage.h"
 
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <mutex>
 #include <numeric>
+#include <utility>
 
 #include "SampleCount.h"
 #include "DownmixSource.h"
+#include "concurrency/ThreadPool.h"
 
 #define stackAllocate(T, count) static_cast<T*>(alloca(count * sizeof(T)))
 
@@ -42,7 +47,8 @@ void MixBuffers(unsigned numChannels,
 DownmixStage::DownmixStage(std::vector<std::unique_ptr<DownmixSource>> downmixSources,
              size_t numChannels,
              size_t bufferSize,
-             ApplyVolume applyGain)
+             ApplyVolume applyGain,
+             audacity::concurrency::ThreadPool* pPool)
    : mDownmixSources(std::move(downmixSources))
  // PRL:  Bug2536: see other comments below for the last, padding argument
  // TODO: more-than-two-channels
@@ -53,8 +59,17 @@ DownmixStage::DownmixStage(std::vector<std::unique_ptr<DownmixSource>> downmixSo
    , mFloatBuffers { 3, bufferSize, 1, 1 }
    , mNumChannels(numChannels)
    , mApplyVolume(applyGain)
+   , mpPool(mDownmixSources.size() > 1 ? pPool : nullptr)
 {
-   
+   if (mpPool)
+   {
+      // Reserve first, because positions of buffers point into their storage
+      mSourceBuffers.reserve(mDownmixSources.size());
+      for (size_t i = 0; i < mDownmixSources.size(); ++i)
+         mSourceBuffers.emplace_back(3, bufferSize, 1, 1);
+      mSourceResults.resize(mDownmixSources.size());
+      mSourceErrors.resize(mDownmixSources.size());
+   }
 }
 
 DownmixStage::~DownmixStage() = default;
@@ -83,14 +98,26 @@ std::optional<size_t> DownmixStage::Acquire(Buffers& data, size_t maxToProcess)
    for (auto c = 0;c < data.Channels(); ++c)
       data.ClearBuffer(c, maxToProcess);
 
-   for (auto& downmixSource : mDownmixSources)
+   if (mpPool)
+      RenderSources(maxToProcess);
+
+   // Mix in the order of the sources, whether they rendered in parallel or
+   // not, so that the sums are the same
+   for (size_t i = 0; i < mDownmixSources.size(); ++i)
    {
-      auto oResult = downmixSource->GetDownstream().Acquire(mFloatBuffers, maxToProcess);
+      auto& downmixSource = mDownmixSources[i];
+      auto& floatBuffers = mpPool ? mSourceBuffers[i] : mFloatBuffers;
+      auto oResult = mpPool
+         ? mSourceResults[i]
+         : downmixSource->GetDownstream().Acquire(mFloatBuffers, maxToProcess);
       // One of MixVariableRates or MixSameRate assigns into mTemp[*][*]
       // which are the sources for the CopySamples calls, and they copy into
       // mBuffer[*][*]
-      if (!oResult)
+      if (!oResult) {
+         if (mpPool)
+            ReleaseSources(i + 1);
          return 0;
+      }
       const auto result = *oResult;
       maxOut = std::max(maxOut, result);
 
@@ -99,7 +126,7 @@ std::optional<size_t> DownmixStage::Acquire(Buffers& data, size_t maxToProcess)
       const auto limit = std::min<size_t>(downmixSource->NChannels(), maxChannels);
       for (size_t j = 0; j < limit; ++j)
       {
-         const auto pFloat = (const float*)mFloatBuffers.GetReadPosition(j);
+         const auto pFloat = (const float*)floatBuffers.GetReadPosition(j);
          if (mApplyVolume != ApplyVolume::Discard)
          {
             for (size_t c = 0; c < mNumChannels; ++c)
@@ -122,8 +149,8 @@ std::optional<size_t> DownmixStage::Acquire(Buffers& data, size_t maxToProcess)
       }
 
       downmixSource->GetDownstream().Release();
-      mFloatBuffers.Advance(result);
-      mFloatBuffers.Rotate();
+      floatBuffers.Advance(result);
+      floatBuffers.Rotate();
    }
 
    // MB: this doesn't take warping into account, replaced with code based on mSamplePos
@@ -132,6 +159,67 @@ std::optional<size_t> DownmixStage::Acquire(Buffers& data, size_t maxToProcess)
    assert(maxOut <= maxToProcess);
    return maxOut;
 }
+
+void DownmixStage::RenderSources(size_t maxToProcess)
+{
+   const auto nSources = mDownmixSources.size();
+   // Each thread takes the next source not yet taken, so that a few slow
+   // sources (as with expensive effect stages) don't leave threads idle
+   std::atomic<size_t> next { 0 };
+   const auto render = [&] {
+      for (size_t i; (i = next.fetch_add(1)) < nSources;)
+      {
+         try
+         {
+            mSourceResults[i] =
+               mDownmixSources[i]->GetDownstream().Acquire(
+                  mSourceBuffers[i], maxToProcess);
+         }
+         catch (...)
+         {
+            mSourceResults[i] = std::nullopt;
+            mSourceErrors[i] = std::current_exception();
+         }
+      }
+   };
+
+   // The pool may be shared with other stages, so wait only for the tasks
+   // enqueued here
+   std::mutex mutex;
+   std::condition_variable done;
+   auto nTasks = std::min(mpPool->GetThreadsCount(), nSources - 1);
+   for (size_t i = 0; i < nTasks; ++i)
+      mpPool->Enqueue([&] {
+         render();
+         std::lock_guard<std::mutex> lock { mutex };
+         if (--nTasks == 0)
+            done.notify_one();
+      });
+   render();
+   {
+      std::unique_lock<std::mutex> lock { mutex };
+      done.wait(lock, [&] { return nTasks == 0; });
+   }
+
+   std::exception_ptr error;
+   for (auto& sourceError : mSourceErrors)
+      if (auto e = std::exchange(sourceError, nullptr); e && !error)
+         error = e;
+   if (error)
+   {
+      // Don't leave the sources that did produce holding their output
+      ReleaseSources(0);
+      std::rethrow_exception(error);
+   }
+}
+
+void DownmixStage::ReleaseSources(size_t first)
+{
+   for (size_t i = first; i < mDownmixSources.size(); ++i)
+      if (std::exchange(mSourceResults[i], std::nullopt))
+         mDownmixSources[i]->GetDownstream().Release();
+}
+
 sampleCount DownmixStage::Remaining() const
 {
    return std::accumulate(
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <exception>
+#include <optional>
 #include <vector>
 #include <memory>
 
@@ -16,6 +18,11 @@
 
 class DownmixSource;
 
+namespace audacity::concurrency
+{
+class ThreadPool;
+}
+
 //! Combines multiple audio graph sources into a single source
 class DownmixStage final : public AudioGraph::Source
 {
@@ -34,12 +41,34 @@ private:
    size_t mNumChannels;
    ApplyVolume mApplyVolume;
 
+   //! When not null, sources render concurrently, each into its own buffers
+   audacity::concurrency::ThreadPool* const mpPool;
+   std::vector<AudioGraph::Buffers> mSourceBuffers;
+   std::vector<std::optional<size_t>> mSourceResults;
+   std::vector<std::exception_ptr> mSourceErrors;
+
+   //! Acquire from all sources on the pool and the calling thread, leaving
+   //! results in the per-source buffers
+   /*!
+    Rethrows the exception of the first source that threw, if any, after
+    releasing the others
+    */
+   void RenderSources(size_t maxToProcess);
+   //! Release the sources from the given index on that produced results
+   void ReleaseSources(size_t first);
+
 public:
 
+   /*!
+    @param pPool if not null, must have a lifetime enclosing this object's,
+    and the sources must allow Acquire() from any thread.  The mix is
+    the same as without it.
+    */
    DownmixStage(std::vector<std::unique_ptr<DownmixSource>> downmixSources,
                 size_t numChannels,
                 size_t bufferSize,
-                ApplyVolume applyGain);
+                ApplyVolume applyGain,
+                audacity::concurrency::ThreadPool* pPool = nullptr);
 
    ~DownmixStage() override;
 
@@ -22,8 +22,11 @@
 #include "Dither.h"
 #include "Resample.h"
 #include "WideSampleSequence.h"
+#include "Prefs.h"
 #include "float_cast.h"
+#include "concurrency/ThreadPool.h"
 #include <numeric>
+#include <thread>
 
 #include "DownmixSource.h"
 
@@ -95,7 +98,7 @@ Mixer::Mixer(
    const double stopTime, const unsigned numOutChannels,
    const size_t outBufferSize, const bool outInterleaved, double outRate,
    sampleFormat outFormat, const bool highQuality, MixerSpec* const mixerSpec,
-   ApplyVolume applyVolume)
+   ApplyVolume applyVolume, bool parallel)
     : mNumChannels { numOutChannels }
     , mInputs { move(inputs) }
     , mMasterEffects { move(masterEffects) }
@@ -181,11 +184,18 @@ Mixer::Mixer(
 
       i += sequence->NChannels();
    }
-   
+
+   // The warp envelope is shared by all sources, and its evaluation caches
+   // a search position
+   const auto pPool = (parallel && mInputs.size() > 1 &&
+      !warpOptions.envelope && std::thread::hardware_concurrency() > 1)
+      ? &audacity::concurrency::ThreadPool::Shared() : nullptr;
+
    if (mMasterEffects && !mMasterEffects->empty())
    {
       mDownmixStage = std::make_unique<DownmixStage>(
-         std::move(downmixSources), mNumChannels, mBufferSize, ApplyVolume::MapChannels
+         std::move(downmixSources), mNumChannels, mBufferSize, ApplyVolume::MapChannels,
+         pPool
       );
 
       AudioGraph::Source* pDownstream = mDownmixStage.get();
@@ -213,7 +223,8 @@ Mixer::Mixer(
          std::move(downmixSources),
          mNumChannels,
          mBufferSize,
-         mApplyVolume
+         mApplyVolume,
+         pPool
       );
       mDownstream = mDownmixStage.get();
    }
@@ -316,6 +327,12 @@ size_t Mixer::Process(const size_t maxToProcess)
    if (!maxOut)
       return 0;
 
+   // Sources may have rendered concurrently, so gather their times here
+   for (const auto &source : mSources)
+      mTime = backwards
+         ? std::min(mTime, source.GetTime())
+         : std::max(mTime, source.GetTime());
+
    if (backwards)
       mTime = std::clamp(mTime, mT1, oldTime);
    else
@@ -440,3 +457,5 @@ std::unique_ptr<EffectStage>& Mixer::RegisterEffectStage(
    }
    return pNewDownstream;
 }
+
+BoolSetting MixerParallelSources{ L"/Mixer/ParallelSources", false };
@@ -21,6 +21,7 @@
 #include "DownmixStage.h"
 
 class sampleCount;
+class BoolSetting;
 class BoundedEnvelope;
 class EffectStage;
 class MixerSource;
@@ -59,6 +60,10 @@ public:
     @pre all sequences in `inputs` are non-null
     @pre !!masterEffects && mixerSpec == nullptr && numOutChannels <= 2
     @post `BufferSize() <= outBufferSize` (equality when no inputs have stages)
+
+    @param parallel whether to render inputs, with their stages, on worker
+    threads.  The output is the same either way.  Ignored when there is a
+    time warp envelope, which is not safe to evaluate concurrently.
     */
    Mixer(
       Inputs inputs, std::optional<Stages> masterEffects, bool mayThrow,
@@ -67,7 +72,8 @@ public:
       double outRate, sampleFormat outFormat, bool highQuality = true,
       //! Null or else must have a lifetime enclosing this object's
       MixerSpec* mixerSpec = nullptr,
-      ApplyVolume applyVolume = ApplyVolume::MapChannels);
+      ApplyVolume applyVolume = ApplyVolume::MapChannels,
+      bool parallel = false);
 
    Mixer(const Mixer&) = delete;
    Mixer(Mixer&&) noexcept = delete;
@@ -170,4 +176,8 @@ public:
    std::unique_ptr<AudioGraph::Source> mMasterDownmixStage;
    AudioGraph::Source* mDownstream{};
 };
+
+//! Whether mixers for export render their inputs in parallel
+extern MIXER_API BoolSetting MixerParallelSources;
+
 #endif
@@ -316,6 +316,11 @@ const WideSampleSequence &MixerSource::GetSequence() const
    return *mpSeq;
 }
 
+double MixerSource::GetTime() const
+{
+   return mSamplePos.as_double() / GetSequence().GetRate();
+}
+
 bool MixerSource::AcceptsBuffers(const Buffers &buffers) const
 {
    return AcceptsBlockSize(buffers.BufferSize());
@@ -335,8 +340,6 @@ std::optional<size_t> MixerSource::Acquire(Buffers &data, size_t bound)
    assert(bound <= data.BlockSize());
    assert(data.BlockSize() <= data.Remaining());
 
-   auto &[mT0, mT1, _, mTime] = *mTimesAndSpeed;
-   const bool backwards = (mT1 < mT0);
    // TODO: more-than-two-channels
    const auto maxChannels = mMaxChannels = data.Channels();
    const auto limit = std::min<size_t>(mnChannels, maxChannels);
@@ -350,11 +353,6 @@ std::optional<size_t> MixerSource::Acquire(Buffers &data, size_t bound)
       ? MixVariableRates(limit, bound, pFloats)
       : MixSameRate(limit, bound, pFloats);
    maxTrack = std::max(maxTrack, result);
-   auto newT = mSamplePos.as_double() / rate;
-   if (backwards)
-      mTime = std::min(mTime, newT);
-   else
-      mTime = std::max(mTime, newT);
    for (size_t j = 0; j < limit; ++j) {
       mixed[j] = result;
    }
@@ -49,6 +49,11 @@ public:
    unsigned Channels() const { return mnChannels; }
    const WideSampleSequence &GetSequence() const;
 
+   //! Time of the next sample to fetch
+   /*! Acquire() leaves the mixer's current time to be updated from this, so
+    that sources of one mixer may acquire concurrently */
+   double GetTime() const;
+
    bool AcceptsBuffers(const Buffers &buffers) const override;
    bool AcceptsBlockSize(size_t blockSize) const override;
    std::optional<size_t> Acquire(Buffers &data, size_t bound) override;
@@ -14,14 +14,13 @@
 #ifndef __AUDACITY_WIDE_SAMPLE_SOURCE__
 #define __AUDACITY_WIDE_SAMPLE_SOURCE__
 
-#include "AudioGraphSource.h" // to inherit
-#include "SampleCount.h"
+#include "AudioGraphFetchingSource.h" // to inherit
 #include <functional>
 
 class WideSampleSequence;
 
 //! Adapts WideSampleSequence to the interface AudioGraph::Source
-class MIXER_API WideSampleSource final : public AudioGraph::Source {
+class MIXER_API WideSampleSource final : public AudioGraph::FetchingSource {
 public:
    //! Type of function returning false if user cancels progress
    using Poller = std::function<bool(sampleCount blockSize)>;
@@ -38,22 +37,15 @@ public:
    //! number of channels is positive
    bool AcceptsBuffers(const Buffers &buffers) const override;
 
-   //! Always true
-   bool AcceptsBlockSize(size_t blockSize) const override;
-
-   std::optional<size_t> Acquire(Buffers &data, size_t bound) override;
-   sampleCount Remaining() const override;
    //! Can test for user cancellation
    bool Release() override;
 private:
+   void Fetch(Buffers &data, size_t offset, size_t len) override;
+
    const WideSampleSequence &mSequence;
    const size_t mnChannels;
    const Poller mPollUser;
 
    sampleCount mPos{};
-   sampleCount mOutputRemaining{};
-   size_t mLastProduced{};
-   size_t mFetched{};
-   bool mInitialized{ false };
 };
 #endif
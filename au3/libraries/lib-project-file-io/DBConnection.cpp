@@ -11,6 +11,8 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 #include "DBConnection.h"
 
+#include <cstdint>
+
 #include "sqlite3.h"
 
 #include <wx/string.h>
@@ -26,6 +28,16 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 #define AUDACITY_PROJECT_PAGE_SIZE 65536
 
+// Upper limit of the file region that Sqlite maps into the address space;
+// Sqlite may silently reduce it to its compile time maximum.  A 32 bit
+// process has too little address space to spare a gigabyte for each open
+// project
+#if SIZE_MAX > 0xFFFFFFFFu
+#define AUDACITY_PROJECT_MMAP_SIZE 1073741824
+#else
+#define AUDACITY_PROJECT_MMAP_SIZE 67108864
+#endif
+
 #define xstr(a) str(a)
 #define str(a) #a
 
@@ -33,6 +45,18 @@ static const char* PageSizeConfig =
    "PRAGMA <schema>.page_size = " xstr(AUDACITY_PROJECT_PAGE_SIZE) ";"
    "VACUUM;";
 
+// The same, also making the file for incremental vacuum, which can be
+// chosen only before any table is made, or else by VACUUM
+static const char* IncrementalPageSizeConfig =
+   "PRAGMA <schema>.auto_vacuum = INCREMENTAL;"
+   "PRAGMA <schema>.page_size = " xstr(AUDACITY_PROJECT_PAGE_SIZE) ";"
+   "VACUUM;";
+
+// Lets reads of pages not in the write ahead log come straight from the
+// memory mapped file, without copying them into the page cache
+static const char* MmapConfig =
+   "PRAGMA <schema>.mmap_size = " xstr(AUDACITY_PROJECT_MMAP_SIZE) ";";
+
 // Configuration to provide "safe" connections
 static const char* SafeConfig =
    "PRAGMA <schema>.busy_timeout = 5000;"
@@ -144,6 +168,12 @@ int DBConnection::Open(const FilePath fileName)
    wxASSERT(mDB == nullptr);
    int rc;
 
+   // Block ids will be chosen again for the file
+   {
+      std::lock_guard<std::mutex> guard(mSampleBlockIDMutex);
+      mNextSampleBlockID = 0;
+   }
+
    // Initialize checkpoint controls
    mCheckpointStop = false;
    mCheckpointPending = false;
@@ -202,6 +232,11 @@ int DBConnection::OpenStepByStep(const FilePath fileName)
       return rc;
    }
 
+   // Memory mapping is only an optimization of reads, so don't fail the
+   // open if it is refused; ModeConfig has logged the reason
+   if (SampleBlockMappedReads.Read())
+      ModeConfig(mDB, "main", MmapConfig);
+
    rc = sqlite3_open(name, &mCheckpointDB);
    if (rc != SQLITE_OK)
    {
@@ -387,7 +422,8 @@ int DBConnection::SetPageSize(const char* schema)
       }
    }
 
-   return ModeConfig(mDB, schema, PageSizeConfig);
+   return ModeConfig(mDB, schema, IncrementalCompaction.Read()
+      ? IncrementalPageSizeConfig : PageSizeConfig);
 }
 
 int DBConnection::ModeConfig(sqlite3 *db, const char *schema, const char *config)
@@ -438,6 +474,22 @@ const wxString DBConnection::GetLastMessage() const
 
 sqlite3_stmt *DBConnection::Prepare(enum StatementID id, const char *sql)
 {
+   switch (id) {
+   case InsertSampleBlock:
+   case InsertSampleBlocks:
+   case DeleteSampleBlock:
+   case InsertDerivedData:
+   case InsertDerivedDataBlock:
+   case DeleteDerivedData:
+   case InsertBlockHash:
+   case InsertBlockHashes:
+      // The caller steps the statement next
+      AwaitWriter();
+      break;
+   default:
+      break;
+   }
+
    std::lock_guard<std::mutex> guard(mStatementMutex);
 
    int rc;
@@ -490,6 +542,83 @@ sqlite3_stmt *DBConnection::Prepare(enum StatementID id, const char *sql)
    return stmt;
 }
 
+DBConnection::WriteScope::WriteScope(
+   DBConnection &connection, std::thread::id waiter)
+   : mConnection{ connection }
+{
+   std::lock_guard<std::mutex> guard(mConnection.mWriterMutex);
+   wxASSERT(mConnection.mWriter == std::thread::id{});
+   mConnection.mWriter = std::this_thread::get_id();
+   mConnection.mWaiter = waiter;
+}
+
+DBConnection::WriteScope::~WriteScope()
+{
+   {
+      std::lock_guard<std::mutex> guard(mConnection.mWriterMutex);
+      mConnection.mWriter = {};
+      mConnection.mWaiter = {};
+   }
+   mConnection.mWriterCondition.notify_all();
+}
+
+void DBConnection::AwaitWriter()
+{
+   if (IsWaitingForWriter())
+      // Waiting would stop the dispatch of events, which the writer may
+      // need
+      ThrowException(true);
+   std::unique_lock<std::mutex> lock(mWriterMutex);
+   mWriterCondition.wait(lock, [this]{
+      return mWriter == std::thread::id{} ||
+         mWriter == std::this_thread::get_id();
+   });
+}
+
+bool DBConnection::IsWaitingForWriter()
+{
+   std::lock_guard<std::mutex> guard(mWriterMutex);
+   return mWriter != std::thread::id{} &&
+      mWaiter == std::this_thread::get_id();
+}
+
+long long DBConnection::ReserveSampleBlockID()
+{
+   std::lock_guard<std::mutex> guard(mSampleBlockIDMutex);
+
+   if (mNextSampleBlockID == 0)
+   {
+      // Never reuse the id of a deleted block, just as AUTOINCREMENT would not
+      sqlite3_stmt *stmt = nullptr;
+      int rc = sqlite3_prepare_v2(mDB,
+         "SELECT max("
+         "  ifnull((SELECT seq FROM sqlite_sequence"
+         "          WHERE name = 'sampleblocks'), 0),"
+         "  ifnull((SELECT max(blockid) FROM sampleblocks), 0));",
+         -1, &stmt, nullptr);
+      auto finalizer = finally([&stmt] { sqlite3_finalize(stmt); });
+
+      if (rc == SQLITE_OK)
+         rc = sqlite3_step(stmt);
+      if (rc != SQLITE_ROW)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::ReserveSampleBlockID");
+
+         wxLogMessage("Failed to find the largest sample block id in %s\n"
+                      "\tError: %s\n",
+                      sqlite3_db_filename(mDB, nullptr),
+                      sqlite3_errmsg(mDB));
+
+         ThrowException( false );
+      }
+
+      mNextSampleBlockID = sqlite3_column_int64(stmt, 0) + 1;
+   }
+
+   return mNextSampleBlockID++;
+}
+
 void DBConnection::CheckpointThread(sqlite3 *db, const FilePath &fileName)
 {
    int rc = SQLITE_OK;
@@ -599,6 +728,8 @@ int DBConnection::CheckpointHook(void *data, sqlite3 *db, const char *schema, in
 
 // Install an implementation of TransactionScope
 #include "TransactionScope.h"
+#include "SampleBlock.h"
+#include "WaveTrack.h"
 
 struct DBConnectionTransactionScopeImpl final : TransactionScopeImpl {
    explicit DBConnectionTransactionScopeImpl(DBConnection &connection)
@@ -614,9 +745,13 @@ struct DBConnectionTransactionScopeImpl final : TransactionScopeImpl {
 static TransactionScope::Factory::Scope scope {
 [](AudacityProject &project) -> std::unique_ptr<TransactionScopeImpl> {
    auto &connectionPtr = ConnectionPtr::Get(project);
-   if (auto pConnection = connectionPtr.mpConnection.get())
+   if (auto pConnection = connectionPtr.mpConnection.get()) {
+      // Rows of sample blocks made before the transaction must not be
+      // discarded by its rollback
+      WaveTrackFactory::Get(project).GetSampleBlockFactory()->Flush();
       return
          std::make_unique<DBConnectionTransactionScopeImpl>(*pConnection);
+   }
    else
       return nullptr;
 } };
@@ -625,6 +760,8 @@ DBConnectionTransactionScopeImpl::~DBConnectionTransactionScopeImpl() = default;
 
 bool DBConnectionTransactionScopeImpl::TransactionStart(const wxString &name)
 {
+   mConnection.AwaitWriter();
+
    char *errmsg = nullptr;
 
    int rc = sqlite3_exec(mConnection.DB(),
@@ -733,3 +870,17 @@ const ConnectionPtr &ConnectionPtr::Get( const AudacityProject &project )
    return Get( const_cast< AudacityProject & >( project ) );
 }
 
+BoolSetting SampleBlockMappedReads{
+   L"/ProjectFileIO/SampleBlockMappedReads", false };
+
+BoolSetting SampleBlockWriteBehind{
+   L"/ProjectFileIO/SampleBlockWriteBehind", true };
+
+BoolSetting SampleBlockReadAhead{
+   L"/ProjectFileIO/SampleBlockReadAhead", true };
+
+BoolSetting IncrementalCompaction{
+   L"/ProjectFileIO/IncrementalCompaction", false };
+
+BoolSetting SampleBlockDeduplication{
+   L"/ProjectFileIO/SampleBlockDeduplication", false };
@@ -22,6 +22,7 @@ Paul Licameli -- split from ProjectFileIO.h
 
 #include "ClientData.h"
 #include "Identifier.h"
+#include "Prefs.h"
 
 struct sqlite3;
 struct sqlite3_stmt;
@@ -78,12 +79,63 @@ public:
       GetSummary64k,
       LoadSampleBlock,
       InsertSampleBlock,
+      InsertSampleBlocks,
       DeleteSampleBlock,
       GetSampleBlockSize,
-      GetAllSampleBlocksSize
+      GetAllSampleBlocksSize,
+      GetDerivedData,
+      GetDerivedDataSize,
+      GetOldestDerivedData,
+      InsertDerivedData,
+      InsertDerivedDataBlock,
+      DeleteDerivedData,
+      GetBlockHashes,
+      InsertBlockHash,
+      InsertBlockHashes
    };
    sqlite3_stmt *Prepare(enum StatementID id, const char *sql);
 
+   //! Choose the id for a new row of the sampleblocks table
+   /*!
+    Ids are unique for the lifetime of the connection and continue after any
+    ever used in the file, as AUTOINCREMENT would, but are known before the
+    row is inserted.  All insertions of sample blocks through this connection
+    must use reserved ids.
+    Callable from any thread.
+    */
+   long long ReserveSampleBlockID();
+
+   //! While it exists, writes through the connection on threads other than
+   //! the one that made it wait for its destruction
+   /*!
+    So that a worker may write in a transaction of its own, while another
+    thread dispatches events.  That thread must not wait for the worker,
+    which might wait for it in turn, and so its writes fail at once instead.
+    */
+   class WriteScope final
+   {
+   public:
+      //! @param waiter the thread that dispatches events until the scope is
+      //! destroyed
+      WriteScope(DBConnection &connection, std::thread::id waiter);
+      WriteScope(const WriteScope &) = delete;
+      WriteScope &operator=(const WriteScope &) = delete;
+      ~WriteScope();
+   private:
+      DBConnection &mConnection;
+   };
+
+   //! Wait until no WriteScope exists for another thread
+   /*!
+    Called before each write, and at the start of each transaction
+    @throws FileException without waiting, if this thread is the waiter of
+    the scope
+    */
+   void AwaitWriter();
+
+   //! Whether AwaitWriter() would throw in this thread
+   bool IsWaitingForWriter();
+
    void SetBypass( bool bypass );
    bool ShouldBypass();
 
@@ -122,6 +174,17 @@ private:
    using StatementIndex = std::pair<enum StatementID, std::thread::id>;
    std::map<StatementIndex, sqlite3_stmt *> mStatements;
 
+   std::mutex mSampleBlockIDMutex;
+   //! Zero until the first reservation queries the database
+   long long mNextSampleBlockID{ 0 };
+
+   std::mutex mWriterMutex;
+   std::condition_variable mWriterCondition;
+   //! The thread of the WriteScope, if there is one
+   std::thread::id mWriter;
+   //! The thread dispatching events while the WriteScope exists
+   std::thread::id mWaiter;
+
    std::shared_ptr<DBConnectionErrors> mpErrors;
    CheckpointFailureCallback mCallback;
 
@@ -131,6 +194,44 @@ private:
 
 using Connection = std::unique_ptr<DBConnection>;
 
+//! When true, connections memory-map the project file and sample blocks read
+//! their samples through incremental blob I/O, copying only the requested
+//! range straight into the destination; when false, the whole blob is
+//! selected and copied, as before
+/*!
+ Read when a connection is opened or a sample block factory is made.
+ False by default:  an I/O error in a mapped page, as when a removable or
+ network drive goes away, raises SIGBUS and ends the process, where a read
+ would fail with SQLITE_IOERR, which is reported
+ */
+extern PROJECT_FILE_IO_API BoolSetting SampleBlockMappedReads;
+
+//! When true, new sample blocks are stored in batches:  their summaries are
+//! computed in worker threads, and their rows are inserted several at a time
+//! with one statement, at the latest when a Sequence is flushed or the block
+//! is first read or saved; when false, each block is stored as it is created
+/*! Read when a sample block factory is made */
+extern PROJECT_FILE_IO_API BoolSetting SampleBlockWriteBehind;
+
+//! When true, a project starts loading with one query for the rows of all its
+//! sample blocks, except the samples; when false, each row is read as the
+//! block is created
+/*! Read when a project starts loading */
+extern PROJECT_FILE_IO_API BoolSetting SampleBlockReadAhead;
+
+//! When true, new project files are made for incremental vacuum, and such
+//! files are compacted in place, returning free pages to the file system,
+//! rather than copied; other files are compacted by copying, as before, into
+//! a new file made for incremental vacuum
+/*! Read when a project file is made or compacted */
+extern PROJECT_FILE_IO_API BoolSetting IncrementalCompaction;
+
+//! When true, a new sample block with the same samples as a block still in
+//! use is that block again, found through an index of hashes of samples kept
+//! in the project file; when false, every new block has its own row
+/*! Read when a sample block factory is made */
+extern PROJECT_FILE_IO_API BoolSetting SampleBlockDeduplication;
+
 // This object attached to the project simply holds the pointer to the
 // project's current database connection, which is initialized on demand,
 // and may be redirected, temporarily or permanently, to another connection
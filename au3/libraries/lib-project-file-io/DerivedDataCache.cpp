@@ -0,0 +1,258 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file DerivedDataCache.cpp
+@brief Implements DerivedDataCache
+
+**********************************************************************/
+
+#include "DerivedDataCache.h"
+
+#include "sqlite3.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "AudacityException.h"
+#include "DBConnection.h"
+#include "MemoryX.h"
+#include "Project.h"
+
+namespace {
+// Bound on the total size of the data in one project file
+constexpr long long MaxBytes = 256 << 20;
+
+// Schema of the cache, created when first used; it is not in
+// ProjectFileSchema, so that the file changes only if the cache is enabled
+const char *DerivedDataSchema =
+   // CREATE SQL deriveddata
+   // Rows are found by a hash of the key; the key is stored too, to resolve
+   // collisions.  Rows are immutable -- never updated after addition, but
+   // may be deleted, the oldest first to make room.
+   "CREATE TABLE IF NOT EXISTS main.deriveddata"
+   "("
+   "  id                   INTEGER PRIMARY KEY,"
+   "  hash                 INTEGER,"
+   "  key                  BLOB,"
+   "  data                 BLOB"
+   ");"
+   "CREATE INDEX IF NOT EXISTS main.deriveddata_hash"
+   "  ON deriveddata (hash);"
+   ""
+   // CREATE SQL deriveddatablocks
+   // The sample blocks each row of deriveddata was computed from
+   "CREATE TABLE IF NOT EXISTS main.deriveddatablocks"
+   "("
+   "  blockid              INTEGER,"
+   "  id                   INTEGER,"
+   "  PRIMARY KEY (blockid, id)"
+   ") WITHOUT ROWID;"
+   "CREATE INDEX IF NOT EXISTS main.deriveddatablocks_id"
+   "  ON deriveddatablocks (id);"
+   ""
+   // Deleting a sample block, in any way, deletes what was computed from it
+   "CREATE TRIGGER IF NOT EXISTS main.deriveddata_sampleblock_deleted"
+   "  AFTER DELETE ON sampleblocks"
+   "  BEGIN"
+   "    DELETE FROM deriveddata WHERE id IN"
+   "      (SELECT id FROM deriveddatablocks WHERE blockid = OLD.blockid);"
+   "  END;"
+   "CREATE TRIGGER IF NOT EXISTS main.deriveddata_deleted"
+   "  AFTER DELETE ON deriveddata"
+   "  BEGIN"
+   "    DELETE FROM deriveddatablocks WHERE id = OLD.id;"
+   "  END;"
+   ""
+   // Data may have been stored for blocks that were discarded before they
+   // were written
+   "DELETE FROM main.deriveddata WHERE id IN"
+   "  (SELECT id FROM deriveddatablocks WHERE blockid NOT IN"
+   "    (SELECT blockid FROM sampleblocks));";
+
+sqlite3_int64 Hash(const std::string &key)
+{
+   // FNV-1a
+   unsigned long long hash = 14695981039346656037ull;
+   for (unsigned char c : key) {
+      hash ^= c;
+      hash *= 1099511628211ull;
+   }
+   return static_cast<sqlite3_int64>(hash);
+}
+}
+
+static const AudacityProject::AttachedObjects::RegisteredFactory
+sDerivedDataCacheKey{
+   [](AudacityProject &project){
+      return std::make_shared<DerivedDataCache>(project);
+   }
+};
+
+DerivedDataCache &DerivedDataCache::Get(AudacityProject &project)
+{
+   return project.AttachedObjects::Get<DerivedDataCache>(
+      sDerivedDataCacheKey);
+}
+
+DerivedDataCache::DerivedDataCache(AudacityProject &project)
+   : mProject{ project }
+{
+}
+
+DerivedDataCache::~DerivedDataCache() = default;
+
+sqlite3 *DerivedDataCache::DB()
+{
+   const auto pConnection = ConnectionPtr::Get(mProject).mpConnection.get();
+   const auto db = pConnection ? pConnection->DB() : nullptr;
+   if (!db || db == mDB)
+      return db;
+
+   mDB = nullptr;
+   if (sqlite3_exec(db, DerivedDataSchema, nullptr, nullptr, nullptr)
+      != SQLITE_OK)
+      return nullptr;
+
+   auto stmt = pConnection->Prepare(DBConnection::GetDerivedDataSize,
+      "SELECT total(length(data)) FROM deriveddata;");
+   mBytes = sqlite3_step(stmt) == SQLITE_ROW
+      ? sqlite3_column_int64(stmt, 0) : 0;
+   sqlite3_reset(stmt);
+
+   mDB = db;
+   return db;
+}
+
+bool DerivedDataCache::Load(const std::string &key, void *buffer, size_t size)
+{
+   try {
+      if (!DB())
+         return false;
+      const auto pConnection = ConnectionPtr::Get(mProject).mpConnection.get();
+
+      // Prepare and cache statement...automatically finalized at DB close
+      auto stmt = pConnection->Prepare(DBConnection::GetDerivedData,
+         "SELECT key, data FROM deriveddata WHERE hash = ?1;");
+      bool found = false;
+      if (sqlite3_bind_int64(stmt, 1, Hash(key)) == SQLITE_OK)
+         while (!found && sqlite3_step(stmt) == SQLITE_ROW) {
+            const auto storedKey = sqlite3_column_blob(stmt, 0);
+            const auto keySize = sqlite3_column_bytes(stmt, 0);
+            if (keySize != static_cast<int>(key.size()) ||
+                memcmp(storedKey, key.data(), keySize) != 0)
+               continue;
+            const auto data = sqlite3_column_blob(stmt, 1);
+            if (sqlite3_column_bytes(stmt, 1) == static_cast<int>(size)) {
+               memcpy(buffer, data, size);
+               found = true;
+            }
+         }
+
+      // Clear statement bindings and rewind statement
+      sqlite3_clear_bindings(stmt);
+      sqlite3_reset(stmt);
+      return found;
+   }
+   catch (const AudacityException &) {
+      return false;
+   }
+}
+
+void DerivedDataCache::Store(const std::string &key,
+   const std::vector<SampleBlockID> &blockIDs, const void *data, size_t size)
+{
+   try {
+      const auto db = DB();
+      if (!db || static_cast<long long>(size) > MaxBytes)
+         return;
+      const auto pConnection = ConnectionPtr::Get(mProject).mpConnection.get();
+
+      // Not only the insertion, but the savepoint and the deletions that
+      // make room, must wait for a writer in another thread
+      pConnection->AwaitWriter();
+      if (sqlite3_exec(db, "SAVEPOINT deriveddata;", nullptr, nullptr, nullptr)
+         != SQLITE_OK)
+         return;
+
+      bool released = false;
+      // Roll back and release the savepoint on every failure, including
+      // exceptions
+      Finally Do{ [&]{
+         if (released)
+            return;
+         // Rollback AND REMOVE the savepoint
+         sqlite3_exec(db,
+            "ROLLBACK TO deriveddata; RELEASE deriveddata;",
+            nullptr, nullptr, nullptr);
+         // The total is unknown after a partial eviction
+         mDB = nullptr;
+      } };
+
+      MakeRoom(size);
+
+      auto stmt = pConnection->Prepare(DBConnection::InsertDerivedData,
+         "INSERT INTO deriveddata (hash, key, data) VALUES (?1, ?2, ?3);");
+      bool ok =
+         sqlite3_bind_int64(stmt, 1, Hash(key)) == SQLITE_OK &&
+         sqlite3_bind_blob(stmt, 2, key.data(), key.size(), SQLITE_STATIC)
+            == SQLITE_OK &&
+         sqlite3_bind_blob(stmt, 3, data, size, SQLITE_STATIC) == SQLITE_OK &&
+         sqlite3_step(stmt) == SQLITE_DONE;
+      sqlite3_clear_bindings(stmt);
+      sqlite3_reset(stmt);
+
+      const auto id = sqlite3_last_insert_rowid(db);
+      stmt = pConnection->Prepare(DBConnection::InsertDerivedDataBlock,
+         "INSERT OR IGNORE INTO deriveddatablocks (blockid, id)"
+         "  VALUES (?1, ?2);");
+      for (auto blockID : blockIDs) {
+         // Silent blocks are not in the database and never change
+         if (!ok || blockID < 0)
+            continue;
+         ok = sqlite3_bind_int64(stmt, 1, blockID) == SQLITE_OK &&
+            sqlite3_bind_int64(stmt, 2, id) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_DONE;
+         sqlite3_clear_bindings(stmt);
+         sqlite3_reset(stmt);
+      }
+
+      released = ok &&
+         sqlite3_exec(db, "RELEASE deriveddata;", nullptr, nullptr, nullptr)
+            == SQLITE_OK;
+      if (released)
+         mBytes += size;
+   }
+   catch (const AudacityException &) {
+   }
+}
+
+void DerivedDataCache::MakeRoom(size_t size)
+{
+   const auto pConnection = ConnectionPtr::Get(mProject).mpConnection.get();
+   while (mBytes > 0 && mBytes + static_cast<long long>(size) > MaxBytes) {
+      auto stmt = pConnection->Prepare(DBConnection::GetOldestDerivedData,
+         "SELECT id, length(data) FROM deriveddata ORDER BY id LIMIT 1;");
+      if (sqlite3_step(stmt) != SQLITE_ROW) {
+         sqlite3_reset(stmt);
+         mBytes = 0;
+         break;
+      }
+      const auto id = sqlite3_column_int64(stmt, 0);
+      const auto bytes = sqlite3_column_int64(stmt, 1);
+      sqlite3_reset(stmt);
+
+      stmt = pConnection->Prepare(DBConnection::DeleteDerivedData,
+         "DELETE FROM deriveddata WHERE id = ?1;");
+      const bool deleted = sqlite3_bind_int64(stmt, 1, id) == SQLITE_OK &&
+         sqlite3_step(stmt) == SQLITE_DONE;
+      sqlite3_clear_bindings(stmt);
+      sqlite3_reset(stmt);
+      if (!deleted)
+         break;
+      mBytes = std::max(0LL, mBytes - bytes);
+   }
+}
+
+BoolSetting DerivedDataInProject{
+   L"/ProjectFileIO/DerivedDataInProject", false };
@@ -0,0 +1,78 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file DerivedDataCache.h
+@brief Declare DerivedDataCache, which keeps data computed from sample blocks
+in the project file
+
+**********************************************************************/
+
+#ifndef __AUDACITY_DERIVED_DATA_CACHE__
+#define __AUDACITY_DERIVED_DATA_CACHE__
+
+#include <string>
+#include <vector>
+
+#include "ClientData.h"
+#include "Prefs.h"
+#include "SampleBlock.h" // SampleBlockID
+
+class AudacityProject;
+struct sqlite3;
+
+//! Persistent cache of data that are expensive to compute from sample blocks,
+//! such as spectrograms, so that reopening a project need not compute them
+//! again
+/*!
+ Entries are stored in the project database, under keys chosen by the
+ callers, and are deleted with any of the sample blocks they were computed
+ from; because blocks are immutable and their ids are never reused, an entry
+ can't become stale while its key names its blocks.
+
+ The total size is bounded, the oldest entries being deleted first.
+
+ Failures are not reported: the data can always be computed again.
+
+ Use only on the main thread.
+ */
+class PROJECT_FILE_IO_API DerivedDataCache final : public ClientData::Base
+{
+public:
+   static DerivedDataCache &Get(AudacityProject &project);
+
+   explicit DerivedDataCache(AudacityProject &project);
+   ~DerivedDataCache() override;
+
+   //! Fetch the data stored under the key
+   /*!
+    @return whether there were exactly `size` bytes to copy into `buffer`
+    */
+   bool Load(const std::string &key, void *buffer, size_t size);
+
+   //! Store data under the key, replacing any
+   /*!
+    @param blockIDs the blocks the data were computed from; silent blocks,
+    with negative ids, may be included and are ignored
+    */
+   void Store(const std::string &key,
+      const std::vector<SampleBlockID> &blockIDs,
+      const void *data, size_t size);
+
+private:
+   //! Create the tables if this is a connection not yet seen
+   sqlite3 *DB();
+   void MakeRoom(size_t size);
+
+   AudacityProject &mProject;
+   sqlite3 *mDB{};
+   //! Total of stored data, in bytes
+   long long mBytes{ 0 };
+};
+
+//! When true, spectrograms are stored in the project file as they are
+//! computed
+/*! Read when spectrogram columns are requested */
+extern PROJECT_FILE_IO_API BoolSetting DerivedDataInProject;
+
+#endif
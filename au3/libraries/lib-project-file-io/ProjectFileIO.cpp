@@ -10,10 +10,13 @@ Paul Licameli split from AudacityProject.cpp
 
 #include "ProjectFileIO.h"
 
+#include <algorithm>
 #include <atomic>
+#include <exception>
 #include <sqlite3.h>
 #include <optional>
 #include <cstring>
+#include <thread>
 
 #include <wx/crt.h>
 #include <wx/log.h>
@@ -23,6 +26,7 @@ Paul Licameli split from AudacityProject.cpp
 #include "ActiveProjects.h"
 #include "CodeConversions.h"
 #include "DBConnection.h"
+#include "Envelope.h"
 #include "FileNames.h"
 #include "PendingTracks.h"
 #include "Project.h"
@@ -33,6 +37,7 @@ Paul Licameli split from AudacityProject.cpp
 #include "SampleBlock.h"
 #include "TempDirectory.h"
 #include "TransactionScope.h"
+#include "WaveClip.h"
 #include "WaveTrack.h"
 #include "WaveTrackUtilities.h"
 #include "BasicUI.h"
@@ -167,6 +172,179 @@ static const char *ProjectFileSchema =
    "  samples              BLOB"
    ");";
 
+// Schema of the autosave document written in parts, created when first used;
+// it is not in ProjectFileSchema, so that the file changes only if
+// IncrementalAutoSave is enabled
+static const char *AutoSavePartsSchema =
+   // CREATE SQL autosaveparts
+   // The autosave document, divided so that unchanged parts need not be
+   // written again:  the part with id 0 holds the dictionary and the document
+   // up to the first track, each next part one track, and the last the rest.
+   // Parts are read in order of id, which are consecutive.
+   // hash identifies the contents of doc.
+   "CREATE TABLE IF NOT EXISTS main.autosaveparts"
+   "("
+   "  id                   INTEGER PRIMARY KEY,"
+   "  hash                 INTEGER,"
+   "  dict                 BLOB,"
+   "  doc                  BLOB"
+   ");";
+
+namespace {
+bool TableExists(sqlite3 *db, const char *table)
+{
+   return sqlite3_table_column_metadata(db, "main", table, "id",
+      nullptr, nullptr, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+constexpr uint64_t FnvOffsetBasis = 14695981039346656037ull;
+
+//! Continue the FNV-1a hash of bytes
+uint64_t Hash(uint64_t hash, const void *data, size_t size)
+{
+   const auto bytes = static_cast<const uint8_t *>(data);
+   for (size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+   }
+   return hash;
+}
+
+//! Copy the bytes of the stream in [begin, end), and hash them
+void CopyPart(const MemoryStream &stream, size_t begin, size_t end,
+   std::vector<uint8_t> &bytes, uint64_t &hash)
+{
+   bytes.clear();
+   bytes.reserve(end - begin);
+   hash = FnvOffsetBasis;
+   size_t position = 0;
+   for (auto chunk : stream) {
+      const auto data = static_cast<const uint8_t *>(chunk.first);
+      const auto chunkEnd = position + chunk.second;
+      const auto first = std::max(position, begin);
+      const auto last = std::min(chunkEnd, end);
+      if (first < last) {
+         bytes.insert(bytes.end(),
+            data + (first - position), data + (last - position));
+         hash = Hash(hash, data + (first - position), last - first);
+      }
+      position = chunkEnd;
+      if (position >= end)
+         break;
+   }
+}
+
+//! Counts the changes of a clip's samples, which would be costly to compare
+struct ClipChangeCounter final : WaveClipListener
+{
+   //! Unique among the states of all clips in this run, so that a new clip at
+   //! the address of a deleted one does not seem unchanged
+   static uint64_t NextState()
+   {
+      static std::atomic<uint64_t> state{ 0 };
+      return ++state;
+   }
+
+   void MarkChanged() noexcept override { mState = NextState(); }
+   void Invalidate() override { mState = NextState(); }
+   void MakeStereo(WaveClipListener &&, bool) override
+      { mState = NextState(); }
+   void SwapChannels() override { mState = NextState(); }
+   void Erase(size_t) override { mState = NextState(); }
+
+   std::unique_ptr<WaveClipListener> Clone() const override
+   {
+      return std::make_unique<ClipChangeCounter>();
+   }
+
+   std::atomic<uint64_t> mState{ NextState() };
+};
+
+static WaveClip::Attachments::RegisteredFactory sClipChangeCounterKey{
+   [](WaveClip &) { return std::make_unique<ClipChangeCounter>(); }
+};
+
+//! Hashes values, and what is written to it as XML
+class ShapeWriter final : public XMLWriter
+{
+public:
+   template<typename T> void Add(const T &value)
+   {
+      static_assert(std::is_arithmetic_v<T>);
+      mHash = Hash(mHash, &value, sizeof value);
+   }
+   void Add(const wxString &string)
+   {
+      mHash = Hash(mHash,
+         string.wx_str(), string.length() * sizeof(wxStringCharType));
+   }
+   uint64_t GetHash() const { return mHash; }
+
+   using XMLWriter::WriteAttr;
+   // Not formatted, so that no digits are lost
+   void WriteAttr(const wxString &name, float value, int = -1) override
+      { Add(name); Add(value); }
+   void WriteAttr(const wxString &name, double value, int = -1) override
+      { Add(name); Add(value); }
+   void Write(const wxString &data) override { Add(data); }
+
+private:
+   uint64_t mHash{ FnvOffsetBasis };
+};
+
+//! What WaveClip::WriteXML writes, except samples, which are summarized by
+//! the ClipChangeCounter
+void AddShape(ShapeWriter &writer, const WaveClip &clip)
+{
+   writer.Add(clip.Attachments::Get<const ClipChangeCounter>(
+      sClipChangeCounterKey).mState.load(std::memory_order_relaxed));
+   writer.Add(clip.NChannels());
+   writer.Add(clip.GetSequenceStartTime());
+   writer.Add(clip.GetTrimLeft());
+   writer.Add(clip.GetTrimRight());
+   writer.Add(clip.GetCentShift());
+   writer.Add(static_cast<int>(clip.GetPitchAndSpeedPreset()));
+   writer.Add(clip.GetStretchRatio());
+   writer.Add(clip.GetName());
+   clip.Attachments::ForEach([&](const WaveClipListener &listener){
+      listener.WriteXMLAttributes(writer);
+   });
+
+   const auto &envelope = clip.GetEnvelope();
+   writer.Add(envelope.GetOffset());
+   writer.Add(envelope.GetTrackLen());
+   writer.Add(envelope.GetDefaultValue());
+   const auto nPoints = envelope.GetNumberOfPoints();
+   writer.Add(nPoints);
+   for (size_t ii = 0; ii < nPoints; ++ii) {
+      const auto &point = envelope[static_cast<int>(ii)];
+      writer.Add(point.GetT());
+      writer.Add(point.GetVal());
+   }
+
+   writer.Add(clip.NumCutLines());
+   for (const auto &pCutLine : clip.GetCutLines())
+      AddShape(writer, *pCutLine);
+}
+
+//! Summarize what WaveTrack::WriteXML writes, for much less than it costs
+uint64_t Shape(const WaveTrack &track)
+{
+   ShapeWriter writer;
+   track.Track::WriteCommonXMLAttributes(writer);
+   track.PlayableTrack::WriteXMLAttributes(writer);
+   WaveTrackIORegistry::Get().CallWriters(track, writer);
+   writer.Add(track.NChannels());
+   writer.Add(track.GetRate());
+   writer.Add(track.GetVolume());
+   writer.Add(track.GetPan());
+   writer.Add(static_cast<long>(track.GetSampleFormat()));
+   for (const auto &pClip : track.Intervals())
+      AddShape(writer, *pClip);
+   return writer.GetHash();
+}
+}
+
 
 class SQLiteBlobStream final
 {
@@ -293,11 +471,11 @@ private:
 class BufferedProjectBlobStream : public BufferedStreamReader
 {
 public:
-   static constexpr std::array<const char*, 2> Columns = { "dict", "doc" };
+   //! Row ids and columns of blobs to read one after the other
+   using Blobs = std::vector<std::pair<int64_t, const char*>>;
 
    BufferedProjectBlobStream(
-      sqlite3* db, const char* schema, const char* table,
-      int64_t rowID)
+      sqlite3* db, const char* schema, const char* table, Blobs blobs)
        // Despite we use 64k pages in SQLite - it is impossible to guarantee
        // that read is satisfied from a single page.
        // Reading 64k proved to be slower, (64k - 8) gives no measurable difference
@@ -307,21 +485,22 @@ public:
        , mDB(db)
        , mSchema(schema)
        , mTable(table)
-       , mRowID(rowID)
+       , mBlobs(std::move(blobs))
    {
    }
 
 private:
    bool OpenBlob(size_t index)
    {
-      if (index >= Columns.size())
+      if (index >= mBlobs.size())
       {
          mBlobStream.reset();
          return false;
       }
 
       mBlobStream = SQLiteBlobStream::Open(
-         mDB, mSchema, mTable, Columns[index], mRowID, true);
+         mDB, mSchema, mTable, mBlobs[index].second, mBlobs[index].first,
+         true);
 
       return mBlobStream.has_value();
    }
@@ -332,12 +511,12 @@ private:
    sqlite3* mDB;
    const char* mSchema;
    const char* mTable;
-   const int64_t mRowID;
+   const Blobs mBlobs;
 
 protected:
    bool HasMoreData() const override
    {
-      return mBlobStream.has_value() || mNextBlobIndex < Columns.size();
+      return mBlobStream.has_value() || mNextBlobIndex < mBlobs.size();
    }
 
    size_t ReadData(void* buffer, size_t maxBytes) override
@@ -357,7 +536,7 @@ protected:
          // Reading has failed, close the stream and do not allow opening
          // the next one
          mBlobStream = {};
-         mNextBlobIndex = Columns.size();
+         mNextBlobIndex = mBlobs.size();
 
          return 0;
       }
@@ -370,8 +549,6 @@ protected:
    }
 };
 
-constexpr std::array<const char*, 2> BufferedProjectBlobStream::Columns;
-
 bool ProjectFileIO::InitializeSQL()
 {
    if (audacity::sqlite::Initialize().IsError())
@@ -566,6 +743,10 @@ void ProjectFileIO::SaveConnection()
    // Should do nothing in proper usage, but be sure not to leak a connection:
    DiscardConnection();
 
+   // Rows of sample blocks still pending belong in this connection
+   if (CurrConn())
+      WaveTrackFactory::Get(mProject).GetSampleBlockFactory()->Flush();
+
    mPrevConn = std::move(CurrConn());
    mPrevFileName = mFileName;
    mPrevTemporary = mTemporary;
@@ -795,6 +976,9 @@ bool ProjectFileIO::InstallSchema(sqlite3 *db, const char *schema /* = "main" */
 
    wxString sql;
    sql.Printf(ProjectFileSchema, ProjectFileID, BaseProjectFormatVersion.GetPacked());
+   // Effective only before the first table is made
+   if (IncrementalCompaction.Read())
+      sql.Prepend("PRAGMA <schema>.auto_vacuum = INCREMENTAL;");
    sql.Replace("<schema>", schema);
 
    rc = sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
@@ -1415,12 +1599,21 @@ void ProjectFileIO::Compact(
    // at project close time will still occur.
    mHadUnused = true;
 
+   // Pages freed since the last compaction can be returned cheaply, if the
+   // file allows incremental vacuum
+   int64_t autoVacuum = 0;
+   int64_t freePages = 0;
+   const bool inPlace = IncrementalCompaction.Read() &&
+      GetValue("PRAGMA main.auto_vacuum;", autoVacuum, true) &&
+      autoVacuum == 2 /* INCREMENTAL */ &&
+      GetValue("PRAGMA main.freelist_count;", freePages, true);
+
    // If forcing compaction, bypass inspection.
    if (!force)
    {
       // Don't compact if this is a temporary project or if it's determined there are not
       // enough unused blocks to make it worthwhile.
-      if (IsTemporary() || !ShouldCompact(tracks))
+      if (IsTemporary() || (!ShouldCompact(tracks) && !(inPlace && freePages > 0)))
       {
          // Delete the AutoSave doc it if exists
          if (IsModified())
@@ -1439,6 +1632,12 @@ void ProjectFileIO::Compact(
       }
    }
 
+   if (inPlace && CompactInPlace(tracks))
+   {
+      mWasCompacted = true;
+      return;
+   }
+
    wxString origName = mFileName;
    wxString backName = origName + "_compact_back";
    wxString tempName = origName + "_compact_temp";
@@ -1538,6 +1737,117 @@ void ProjectFileIO::Compact(
    return;
 }
 
+bool ProjectFileIO::CompactInPlace(const std::vector<const TrackList *> &tracks)
+{
+   using namespace BasicUI;
+
+   auto db = DB();
+
+   // The blocks to keep, as CopyTo() would prune; or if there are no tracks,
+   // all that might still be used
+   BlockIDs blockids;
+   if (!tracks.empty())
+   {
+      for (auto trackList : tracks)
+         if (trackList)
+            WaveTrackUtilities::InspectBlocks(*trackList, {}, &blockids);
+   }
+   else
+      blockids = WaveTrackFactory::Get(mProject)
+         .GetSampleBlockFactory()->GetActiveBlockIDs();
+
+   // Write the doc, as CopyTo() would into the new file
+   ProjectSerializer doc;
+   WriteXMLHeader(doc);
+   WriteXML(doc, false, tracks.empty() ? nullptr : tracks[0]);
+
+   {
+      // These are flags of the project, not of the compaction
+      const auto recovered = mRecovered;
+      const auto modified = mModified;
+      auto restore = finally([&]{
+         mRecovered = recovered;
+         mModified = modified;
+      });
+
+      TransactionScope transaction(mProject, "Compact");
+      if (!DeleteBlocks(blockids, true) ||
+          !AutoSaveDelete(db) ||
+          !WriteDoc(IsTemporary() ? "autosave" : "project", doc) ||
+          !transaction.Commit())
+         return false;
+   }
+
+   // Return the free pages a slice at a time, so that each statement is
+   // brief; what is left if cancelled is reused for new blocks, or returned
+   // by the next compaction.
+   // The slices run here under the progress dialog, not from idle time:
+   // closing the project closes the connection just after this returns, and
+   // the Compact commands report the space freed as soon as it returns.
+   constexpr int64_t SlicePages = 256;
+   int64_t pageSize = 0;
+   int64_t freePages = 0;
+   if (!GetValue("PRAGMA main.page_size;", pageSize, true) ||
+       !GetValue("PRAGMA main.freelist_count;", freePages, true))
+      return true;
+
+   /* i18n-hint: This title appears on a dialog that indicates the progress
+      in doing something.*/
+   auto progress = MakeProgress(
+      XO("Progress"), XO("Compacting project"), ProgressShowCancel);
+
+   const auto start = std::chrono::steady_clock::now();
+   int64_t remaining = freePages;
+   while (remaining > 0)
+   {
+      if (sqlite3_exec(db,
+         wxString::Format("PRAGMA main.incremental_vacuum(%lld);",
+            static_cast<long long>(SlicePages)),
+         nullptr, nullptr, nullptr) != SQLITE_OK)
+         break;
+
+      int64_t left = 0;
+      if (!GetValue("PRAGMA main.freelist_count;", left, true) ||
+          left >= remaining)
+         break;
+      remaining = left;
+
+      if (progress &&
+          progress->Poll(freePages - remaining, freePages) !=
+             ProgressResult::Success)
+         break;
+   }
+
+   // The file shrinks when the log is written back into it.  This waits as
+   // long as the busy timeout for the checkpoint thread of the connection,
+   // or for readers; if they still hold the log, a later checkpoint shrinks
+   // the file
+   const auto rc = sqlite3_wal_checkpoint_v2(
+      db, "main", SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr);
+   if (rc == SQLITE_BUSY)
+      wxLogMessage(
+         "Compaction left the log of %s busy; the file shrinks at the next "
+         "checkpoint",
+         mFileName);
+   else if (rc != SQLITE_OK)
+      wxLogMessage("Failed to checkpoint %s after compaction\n"
+                   "\tErrCode: %d\n"
+                   "\tErrMsg: %s",
+                   mFileName,
+                   sqlite3_errcode(db),
+                   sqlite3_errmsg(db));
+
+   const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+   const auto bytes = (freePages - remaining) * pageSize;
+   wxLogMessage(
+      "Compaction reclaimed %lld bytes in %lld ms (%.1f MB/s)",
+      static_cast<long long>(bytes), static_cast<long long>(ms),
+      ms > 0 ? bytes / 1048576.0 / (ms / 1000.0) : 0.0);
+
+   return true;
+}
+
 bool ProjectFileIO::WasCompacted()
 {
    return mWasCompacted;
@@ -1744,7 +2054,9 @@ void ProjectFileIO::WriteXMLHeader(XMLWriter &xmlFile) const
 
 void ProjectFileIO::WriteXML(XMLWriter &xmlFile,
                              bool recording /* = false */,
-                             const TrackList *tracks /* = nullptr */)
+                             const TrackList *tracks /* = nullptr */,
+                             const std::function<void(const Track *)>
+                                &writeTrack /* = {} */)
 // may throw
 {
    auto &proj = mProject;
@@ -1777,9 +2089,14 @@ void ProjectFileIO::WriteXML(XMLWriter &xmlFile,
          // when pushing.  Don't auto-save it.
          return;
       }
-      useTrack->WriteXML(xmlFile);
+      if (writeTrack)
+         writeTrack(useTrack);
+      else
+         useTrack->WriteXML(xmlFile);
    });
 
+   if (writeTrack)
+      writeTrack(nullptr);
    xmlFile.EndTag(wxT("project"));
 
    //TIMER_STOP( xml_writer_timer );
@@ -1789,15 +2106,77 @@ bool ProjectFileIO::AutoSave(bool recording)
 {
    ProjectSerializer autosave;
    WriteXMLHeader(autosave);
-   WriteXML(autosave, recording);
 
-   if (WriteDoc("autosave", autosave))
-   {
-      mModified = true;
-      return true;
+   bool success = false;
+   if (IncrementalAutoSave.Read()) {
+      if (!mTrackListSubscription)
+         mTrackListSubscription = TrackList::Get(mProject)
+            .Subscribe([this](const TrackListEvent &event)
+         {
+            // Events come in idle time, possibly after the next autosave, so
+            // GetAutoSavePart() also compares the shapes of tracks
+            if (event.mType == TrackListEvent::PERMUTED)
+               // Order is not in any one part
+               return;
+            if (const auto pTrack = event.mpTrack.lock())
+               mAutoSaveParts.erase(pTrack.get());
+            else
+               mAutoSaveParts.clear();
+         });
+
+      // The tracks, each serialized only if it changed, between the start
+      // and the end of the document, serialized each time
+      AutoSavePart head, tail;
+      std::vector<const AutoSavePart *> parts{ &head };
+      size_t boundary = 0;
+      WriteXML(autosave, recording, nullptr, [&](const Track *pTrack){
+         if (pTrack)
+            parts.push_back(&GetAutoSavePart(*pTrack));
+         else
+            boundary = autosave.GetData().GetSize();
+      });
+      parts.push_back(&tail);
+      const auto &data = autosave.GetData();
+      CopyPart(data, 0, boundary, head.bytes, head.hash);
+      CopyPart(data, boundary, data.GetSize(), tail.bytes, tail.hash);
+
+      // Forget tracks that are gone
+      for (auto iter = mAutoSaveParts.begin(); iter != mAutoSaveParts.end();)
+         if (iter->second.pTrack.expired())
+            iter = mAutoSaveParts.erase(iter);
+         else
+            ++iter;
+
+      success = WriteDocParts(autosave.GetDict(), parts);
+   }
+   else {
+      WriteXML(autosave, recording);
+      success = WriteDoc("autosave", autosave);
    }
 
-   return false;
+   if (success)
+      mModified = true;
+   return success;
+}
+
+auto ProjectFileIO::GetAutoSavePart(const Track &track)
+   -> const AutoSavePart &
+{
+   auto &part = mAutoSaveParts[&track];
+   // Other kinds of tracks are small enough to serialize each time
+   const auto pWaveTrack = track_cast<const WaveTrack *>(&track);
+   const auto shape = pWaveTrack ? Shape(*pWaveTrack) : 0;
+   if (pWaveTrack &&
+       part.pTrack.lock().get() == &track && part.shape == shape)
+      return part;
+
+   ProjectSerializer serializer;
+   track.WriteXML(serializer);
+   const auto &data = serializer.GetData();
+   CopyPart(data, 0, data.GetSize(), part.bytes, part.hash);
+   part.pTrack = track.shared_from_this();
+   part.shape = shape;
+   return part;
 }
 
 bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
@@ -1810,6 +2189,9 @@ bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
    }
 
    rc = sqlite3_exec(db, "DELETE FROM autosave;", nullptr, nullptr, nullptr);
+   if (rc == SQLITE_OK && TableExists(db, "autosaveparts"))
+      rc = sqlite3_exec(
+         db, "DELETE FROM autosaveparts;", nullptr, nullptr, nullptr);
    if (rc != SQLITE_OK)
    {
       ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
@@ -1828,7 +2210,9 @@ bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
 
 bool ProjectFileIO::WriteDoc(const char *table,
                              const ProjectSerializer &autosave,
-                             const char *schema /* = "main" */)
+                             const char *schema /* = "main" */,
+                             const std::function<bool(size_t, size_t)>
+                                &progress /* = {} */)
 {
    auto db = DB();
 
@@ -1923,7 +2307,10 @@ bool ProjectFileIO::WriteDoc(const char *table,
       return false;
    }
 
-   const auto writeStream = [db, schema, table, rowID, this](const char* column, const MemoryStream& stream) {
+   const auto total = dict.GetSize() + data.GetSize();
+   size_t written = 0;
+   const auto writeStream = [db, schema, table, rowID, this, total, &written,
+      &progress](const char* column, const MemoryStream& stream) {
 
       auto blobStream =
          SQLiteBlobStream::Open(db, schema, table, column, rowID, false);
@@ -1949,6 +2336,10 @@ bool ProjectFileIO::WriteDoc(const char *table,
             SetDBError(XO("Unable to bind to blob"));
             return false;
          }
+         written += chunk.second;
+         // Stopping rolls back the transaction
+         if (progress && !progress(written, total))
+            return false;
       }
 
       if (blobStream->Close() != SQLITE_OK)
@@ -1988,6 +2379,157 @@ bool ProjectFileIO::WriteDoc(const char *table,
    return transaction.Commit();
 }
 
+bool ProjectFileIO::WriteDocParts(
+   const MemoryStream &dict, const std::vector<const AutoSavePart *> &parts)
+{
+   auto db = DB();
+
+   TransactionScope transaction(mProject, "UpdateProject");
+
+   const auto reportError = [this](auto sql) {
+      SetDBError(
+         XO("Failed to update the project file.\nThe following command failed:\n\n%s")
+            .Format(sql));
+   };
+
+   if (sqlite3_exec(db, AutoSavePartsSchema, nullptr, nullptr, nullptr)
+      != SQLITE_OK)
+   {
+      reportError(AutoSavePartsSchema);
+      return false;
+   }
+
+   std::vector<sqlite3_stmt *> statements;
+   auto cleanup = finally([&]
+   {
+      for (auto stmt : statements)
+         sqlite3_finalize(stmt);
+   });
+   const auto prepare = [&](const char *sql) -> sqlite3_stmt * {
+      sqlite3_stmt *stmt = nullptr;
+      if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.query", sql);
+         ADD_EXCEPTION_CONTEXT(
+            "sqlite3.rc", std::to_string(sqlite3_errcode(db)));
+         ADD_EXCEPTION_CONTEXT(
+            "sqlite3.context", "ProjectGileIO::WriteDocParts::prepare");
+
+         SetDBError(
+            XO("Unable to prepare project file command:\n\n%s").Format(sql)
+         );
+         return nullptr;
+      }
+      statements.push_back(stmt);
+      return stmt;
+   };
+
+   const auto partsCount = parts.size();
+
+   // Find which parts are already stored
+   std::vector<bool> stored(partsCount, false);
+   {
+      const char *sql = "SELECT id, hash, length(doc) FROM main.autosaveparts;";
+      auto stmt = prepare(sql);
+      if (!stmt)
+         return false;
+      int rc;
+      while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+         const auto id = sqlite3_column_int64(stmt, 0);
+         if (id < 0 || id >= static_cast<sqlite3_int64>(partsCount))
+            continue;
+         const auto &part = *parts[id];
+         stored[id] =
+            sqlite3_column_int64(stmt, 1) ==
+               static_cast<sqlite3_int64>(part.hash) &&
+            sqlite3_column_int64(stmt, 2) ==
+               static_cast<sqlite3_int64>(part.bytes.size());
+      }
+      if (rc != SQLITE_DONE)
+      {
+         reportError(sql);
+         return false;
+      }
+   }
+
+   // Write the others; always the first, for the dictionary, which may have
+   // grown
+   stored[0] = false;
+   {
+      const char *sql =
+         "INSERT INTO main.autosaveparts(id, hash, dict, doc)"
+         "       VALUES(?1, ?2, ?3, ?4)"
+         "       ON CONFLICT(id) DO UPDATE"
+         "          SET hash = ?2, dict = ?3, doc = ?4;";
+      auto stmt = prepare(sql);
+      if (!stmt)
+         return false;
+      for (size_t part = 0; part < partsCount; ++part) {
+         if (stored[part])
+            continue;
+         const auto &bytes = parts[part]->bytes;
+         const bool bound =
+            sqlite3_bind_int64(stmt, 1, part) == SQLITE_OK &&
+            sqlite3_bind_int64(stmt, 2,
+               static_cast<sqlite3_int64>(parts[part]->hash)) == SQLITE_OK &&
+            (part == 0
+               ? sqlite3_bind_blob(stmt, 3, dict.GetData(),
+                    static_cast<int>(dict.GetSize()), SQLITE_STATIC)
+               : sqlite3_bind_null(stmt, 3)) == SQLITE_OK &&
+            // Not null even if empty, so that the blob can be opened
+            (bytes.empty()
+               ? sqlite3_bind_zeroblob(stmt, 4, 0)
+               : sqlite3_bind_blob(stmt, 4, bytes.data(),
+                    static_cast<int>(bytes.size()), SQLITE_STATIC)) == SQLITE_OK;
+         if (!bound || sqlite3_step(stmt) != SQLITE_DONE)
+         {
+            ADD_EXCEPTION_CONTEXT("sqlite3.query", sql);
+            ADD_EXCEPTION_CONTEXT(
+               "sqlite3.rc", std::to_string(sqlite3_errcode(db)));
+            ADD_EXCEPTION_CONTEXT(
+               "sqlite3.context", "ProjectGileIO::WriteDocParts::step");
+
+            reportError(sql);
+            return false;
+         }
+         sqlite3_reset(stmt);
+         sqlite3_clear_bindings(stmt);
+      }
+   }
+
+   // Remove parts beyond the end, and a whole autosave document, which
+   // would take precedence when loading
+   {
+      const char *sql = "DELETE FROM main.autosaveparts WHERE id >= ?1;";
+      auto stmt = prepare(sql);
+      if (!stmt)
+         return false;
+      if (sqlite3_bind_int64(stmt, 1, partsCount) != SQLITE_OK ||
+          sqlite3_step(stmt) != SQLITE_DONE)
+      {
+         reportError(sql);
+         return false;
+      }
+   }
+   if (sqlite3_exec(db, "DELETE FROM main.autosave;", nullptr, nullptr, nullptr)
+      != SQLITE_OK)
+   {
+      reportError("DELETE FROM main.autosave;");
+      return false;
+   }
+
+   const wxString setVersionSql =
+      wxString::Format("PRAGMA user_version = %u", BaseProjectFormatVersion.GetPacked());
+
+   if (!Query(setVersionSql.c_str(), [](auto...) { return 0; }))
+   {
+      reportError(setVersionSql);
+      return false;
+   }
+
+   return transaction.Commit();
+}
+
 ProjectFileIO::
 TentativeConnection::TentativeConnection(ProjectFileIO &projectFileIO)
    : mProjectFileIO{ projectFileIO }
@@ -2043,6 +2585,18 @@ auto ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
       !ignoreAutosave &&
       GetValue("SELECT ROWID FROM main.autosave WHERE id = 1;", rowId, true);
 
+   // Else the autosave doc may have been written in parts
+   int64_t partsCount = 0;
+   int64_t lastPart = -1;
+   const bool useAutosaveParts =
+      !ignoreAutosave && !useAutosave &&
+      GetValue("SELECT COUNT(1) FROM main.autosaveparts;", partsCount, true) &&
+      partsCount > 0 &&
+      GetValue("SELECT MAX(id) FROM main.autosaveparts;", lastPart, true) &&
+      lastPart == partsCount - 1;
+   if (useAutosaveParts)
+      useAutosave = true;
+
    int64_t rowsCount = 0;
    // If we didn't have an autosave doc, load the project doc instead
    if (
@@ -2063,10 +2617,30 @@ auto ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
    else
    {
       // Load 'er up
-      BufferedProjectBlobStream stream(
-         DB(), "main", useAutosave ? "autosave" : "project", rowId);
-
-      success = ProjectSerializer::Decode(stream, this);
+      BufferedProjectBlobStream::Blobs blobs;
+      if (useAutosaveParts)
+      {
+         blobs.emplace_back(0, "dict");
+         for (int64_t part = 0; part < partsCount; ++part)
+            blobs.emplace_back(part, "doc");
+      }
+      else
+         blobs = { { rowId, "dict" }, { rowId, "doc" } };
+
+      BufferedProjectBlobStream stream(DB(), "main",
+         useAutosaveParts ? "autosaveparts" :
+            useAutosave ? "autosave" : "project",
+         std::move(blobs));
+
+      // Let the rows of the sample blocks be read at once, rather than as
+      // the document names them
+      const auto pFactory =
+         WaveTrackFactory::Get( mProject ).GetSampleBlockFactory();
+      pFactory->BeginLoad();
+      {
+         auto endLoad = finally([&]{ pFactory->EndLoad(); });
+         success = ProjectSerializer::Decode(stream, this);
+      }
 
       if (!success)
       {
@@ -2078,9 +2652,7 @@ auto ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
 
       // Check for orphans blocks...sets mRecovered if any were deleted
       
-      auto blockids = WaveTrackFactory::Get( mProject )
-         .GetSampleBlockFactory()
-            ->GetActiveBlockIDs();
+      auto blockids = pFactory->GetActiveBlockIDs();
       if (blockids.size() > 0)
       {
          success = DeleteBlocks(blockids, true);
@@ -2124,24 +2696,92 @@ auto ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
 
 bool ProjectFileIO::UpdateSaved(const TrackList *tracks)
 {
+   return DoUpdateSaved(tracks, false) == BasicUI::ProgressResult::Success;
+}
+
+BasicUI::ProgressResult
+ProjectFileIO::DoUpdateSaved(const TrackList *tracks, bool cancellable)
+{
+   using namespace BasicUI;
+
+   // Take the snapshot in this thread, before the dialog dispatches any events
    ProjectSerializer doc;
    WriteXMLHeader(doc);
    WriteXML(doc, false, tracks);
 
-   if (!WriteDoc("project", doc))
+   // Open any delayed connection in this thread
+   auto &connection = GetConnection();
+
+   // Write in a thread, so that the progress dialog stays responsive for
+   // large projects.  The write can be cancelled until it is complete.
+   std::atomic<size_t> written{ 0 };
+   std::atomic<size_t> total{ 1 };
+   std::atomic_bool cancelled{ false };
+   std::atomic_bool started{ false };
+   std::atomic_bool done{ false };
+   bool success = false;
+   std::exception_ptr pException;
+   auto thread = std::thread([&, waiter = std::this_thread::get_id()]
    {
-      return false;
+      {
+         // Handlers of events that the dialog dispatches must not write into
+         // the transaction of this thread.  The scope ends with the writing,
+         // not when this thread is joined, so that writes waiting for it do
+         // not wait for the dialog; and writes in the dispatching thread fail
+         // rather than wait
+         DBConnection::WriteScope writeScope{ connection, waiter };
+         started = true;
+         try {
+            success = WriteDoc("project", doc, "main",
+               [&](size_t soFar, size_t size){
+                  written = soFar;
+                  total = size;
+                  return !cancelled;
+               });
+         }
+         catch (...) {
+            pException = std::current_exception();
+         }
+      }
+      done = true;
+   });
+
+   {
+      auto join = finally([&]{ thread.join(); });
+
+      // Dispatch no events before the scope exists
+      while (!started)
+         std::this_thread::yield();
+
+      auto progress = MakeProgress(XO("Progress"), XO("Saving project"),
+         cancellable ? unsigned(ProgressShowCancel) : 0u);
+      while (!done)
+      {
+         using namespace std::chrono;
+         std::this_thread::sleep_for(10ms);
+         if (progress &&
+             progress->Poll(written, total) != ProgressResult::Success)
+            cancelled = true;
+      }
+   }
+
+   if (pException)
+      std::rethrow_exception(pException);
+
+   if (!success)
+   {
+      return cancelled ? ProgressResult::Cancelled : ProgressResult::Failed;
    }
 
    // Autosave no longer needed
    if (!AutoSaveDelete())
    {
-      return false;
+      return ProgressResult::Failed;
    }
 
    ProjectFileIOExtensionRegistry::OnUpdateSaved(mProject, doc);
 
-   return true;
+   return ProgressResult::Success;
 }
 
 // REVIEW: This function is believed to report an error to the user in all cases
@@ -2150,6 +2790,9 @@ bool ProjectFileIO::UpdateSaved(const TrackList *tracks)
 bool ProjectFileIO::SaveProject(
    const FilePath &fileName, const TrackList *lastSaved)
 {
+   // Only a plain save may be cancelled, which leaves the file as it was
+   const bool cancellable = !IsTemporary() && mFileName == fileName;
+
    // In the case where we're saving a temporary project to a permanent project,
    // we'll try to simply rename the project to save a bit of time. We then fall
    // through to the normal Save (not SaveAs) processing.
@@ -2327,12 +2970,14 @@ bool ProjectFileIO::SaveProject(
       UseConnection(std::move(newConn), fileName);
    }
 
-   if (!UpdateSaved())
+   if (const auto result = DoUpdateSaved(nullptr, cancellable);
+       result != BasicUI::ProgressResult::Success)
    {
-      ShowError(
-         {}, XO("Error Saving Project"),
-         FileException::WriteFailureMessage(fileName),
-         "Error:_Disk_full_or_not_writable");
+      if (result == BasicUI::ProgressResult::Failed)
+         ShowError(
+            {}, XO("Error Saving Project"),
+            FileException::WriteFailureMessage(fileName),
+            "Error:_Disk_full_or_not_writable");
       return false;
    }
 
@@ -2679,3 +3324,6 @@ static ProjectHistory::AutoSave::Scope scope {
          "Error:_Disk_full_or_not_writable"
       };
 } };
+
+BoolSetting IncrementalAutoSave{
+   L"/ProjectFileIO/IncrementalAutoSave", false };
@@ -11,8 +11,10 @@ Paul Licameli split from AudacityProject.h
 #ifndef __AUDACITY_PROJECT_FILE_IO__
 #define __AUDACITY_PROJECT_FILE_IO__
 
+#include <functional>
 #include <memory>
 #include <optional>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <wx/event.h>
@@ -30,12 +32,17 @@ struct sqlite3_value;
 class AudacityProject;
 class DBConnection;
 struct DBConnectionErrors;
+class MemoryStream;
 class ProjectSerializer;
 class SqliteSampleBlock;
+class Track;
 class TrackList;
 class WaveTrack;
 
-namespace BasicUI{ class WindowPlacement; }
+namespace BasicUI{
+   class WindowPlacement;
+   enum class ProgressResult : unsigned;
+}
 
 using WaveTrackArray = std::vector < std::shared_ptr < WaveTrack > >;
 
@@ -232,8 +239,12 @@ private:
    void OnCheckpointFailure();
 
    void WriteXMLHeader(XMLWriter &xmlFile) const;
+   //! @param writeTrack if given, called in place of writing each track,
+   //! and then with null before the end
    void WriteXML(XMLWriter &xmlFile, bool recording = false,
-      const TrackList *tracks = nullptr) /* not override */;
+      const TrackList *tracks = nullptr,
+      const std::function<void(const Track *)> &writeTrack = {})
+      /* not override */;
 
    // XMLTagHandler callback methods
    bool HandleXMLTag(const std::string_view& tag, const AttributesList &attrs) override;
@@ -273,7 +284,32 @@ private:
    bool InstallSchema(sqlite3 *db, const char *schema = "main");
 
    // Write project or autosave XML (binary) documents
-   bool WriteDoc(const char *table, const ProjectSerializer &autosave, const char *schema = "main");
+   //! @param progress if given, called between pieces of the write with the
+   //! bytes written and the total; returning false stops and rolls back
+   bool WriteDoc(const char *table, const ProjectSerializer &autosave,
+      const char *schema = "main",
+      const std::function<bool(size_t, size_t)> &progress = {});
+   //! Serialize the project, write the document in a worker thread, and
+   //! delete autosave
+   BasicUI::ProgressResult
+      DoUpdateSaved(const TrackList *tracks, bool cancellable);
+
+   //! One track, or the start or end, of the autosave document
+   struct AutoSavePart {
+      std::vector<uint8_t> bytes;
+      uint64_t hash{};
+      //! For a track, the one serialized, and a summary of its state that
+      //! can change without notification
+      std::weak_ptr<const Track> pTrack;
+      uint64_t shape{};
+   };
+
+   //! Serialize the track, unless it did not change since the last autosave
+   const AutoSavePart &GetAutoSavePart(const Track &track);
+
+   // Write the autosave document in parts, only those that changed
+   bool WriteDocParts(const MemoryStream &dict,
+      const std::vector<const AutoSavePart *> &parts);
 
    // Application defined function to verify blockid exists is in set of blockids
    static void InSet(sqlite3_context *context, int argc, sqlite3_value **argv);
@@ -301,6 +337,16 @@ private:
 
    bool ShouldCompact(const std::vector<const TrackList *> &tracks);
 
+   //! Compact without copying, if the file was made for incremental vacuum
+   /*!
+    Deletes the blocks not in the tracks, or if there are none, not in
+    memory; writes the document as CopyTo() would; then returns free pages
+    to the file system a slice at a time, until done or cancelled.
+    @return false if the file does not allow it, or it failed; the file is
+    then as before
+    */
+   bool CompactInPlace(const std::vector<const TrackList *> &tracks);
+
 private:
    Connection &CurrConn();
 
@@ -332,6 +378,10 @@ private:
    Connection mPrevConn;
    FilePath mPrevFileName;
    bool mPrevTemporary;
+
+   //! Tracks as serialized by the last incremental autosave
+   std::unordered_map<const Track *, AutoSavePart> mAutoSaveParts;
+   Observer::Subscription mTrackListSubscription;
 };
 
 //! Makes a temporary project that doesn't display on the screen
@@ -348,4 +398,10 @@ private:
    std::shared_ptr<AudacityProject> mpProject;
 };
 
+//! When true, the autosave document is stored in parts, one per track, and
+//! only the parts that changed are written; older versions recover instead
+//! the last saved project from such a file
+/*! Read at each autosave */
+extern PROJECT_FILE_IO_API BoolSetting IncrementalAutoSave;
+
 #endif
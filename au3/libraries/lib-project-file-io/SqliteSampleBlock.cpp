@@ -15,6 +15,7 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 #include "DBConnection.h"
 #include "ProjectFileIO.h"
 #include "SampleFormat.h"
+#include "SummaryKernels.h"
 #include "AudioSegmentSampleView.h"
 #include "XMLTagHandler.h"
 
@@ -25,12 +26,56 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 #include "WaveTrackUtilities.h"
 
 #include "SentryHelper.h"
+#include "concurrency/ThreadPool.h"
 #include <wx/log.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
 
 class SqliteSampleBlockFactory;
 
+//! Computes the summaries of a deferred block once, either in the shared
+//! pool or in the first thread that needs them
+/*!
+ Pool threads read blocks too, and must not wait for a task that is queued
+ behind them in the same pool
+ */
+struct SummaryTask
+{
+   explicit SummaryTask(std::function<void()> calculation)
+      : task{ std::move(calculation) }
+   {}
+
+   //! Does nothing if another thread already began
+   void Run()
+   {
+      if (!claimed.exchange(true, std::memory_order_acq_rel))
+         task();
+   }
+
+   std::atomic<bool> claimed{ false };
+   std::packaged_task<void()> task;
+};
+
+//! The columns of a row of the sampleblocks table, except the samples
+struct SampleBlockRow
+{
+   sampleFormat format;
+   double sumMin;
+   double sumMax;
+   double sumRms;
+   size_t sampleBytes;
+};
+
 ///\brief Implementation of @ref SampleBlock using Sqlite database
 class SqliteSampleBlock final : public SampleBlock
 {
@@ -55,6 +100,14 @@ public:
    using Sizes = std::pair< size_t, size_t >;
    void Commit(Sizes sizes);
 
+   //! Bind the values of one row of the sampleblocks table, in the order
+   //! (blockid, sampleformat, summin, summax, sumrms, summary256, summary64k,
+   //! samples), starting at parameter index `first`
+   /*! @return nonzero sqlite result code on failure */
+   int BindRow(sqlite3_stmt *stmt, int first, Sizes sizes) const;
+   //! Release memory not needed after the row is inserted
+   void OnCommitted();
+
    void Delete();
 
    SampleBlockID GetBlockID() const override;
@@ -83,7 +136,25 @@ public:
 
 private:
    bool IsSilent() const { return mBlockID <= 0; }
+   //! If the row of this block is not yet inserted, have the factory insert
+   //! it now, if this is the factory's thread
+   /*!
+    @return in another thread, if the row is still pending, a lock that keeps
+    the factory from releasing the data held in memory, though it may be
+    inserting the row meanwhile
+    */
+   std::unique_lock<std::mutex> Settle() const;
+   //! Read from the samples held in memory
+   /*! @pre a lock from Settle() is held */
+   size_t ReadPendingSamples(samplePtr dest, sampleFormat destformat,
+      size_t sampleoffset, size_t numsamples) const;
+   //! Compute the summaries now, if deferred and not yet begun, or else wait
+   //! for the thread computing them
+   void AwaitSummary() const;
+   //! Read the row, except the samples
    void Load(SampleBlockID sbid);
+   //! Take the row, except the samples, as Load() would read it
+   void Load(SampleBlockID sbid, const SampleBlockRow &row);
    bool GetSummary(float *dest,
                    size_t frameoffset,
                    size_t numframes,
@@ -95,6 +166,12 @@ private:
                   sampleFormat srcformat,
                   size_t srcoffset,
                   size_t srcbytes);
+   size_t ReadBlob(void *dest,
+                   sampleFormat destformat,
+                   const char *column,
+                   sampleFormat srcformat,
+                   size_t srcoffset,
+                   size_t srcbytes);
 
    enum {
       fields = 3, /* min, max, rms */
@@ -118,6 +195,13 @@ private:
    bool mValid{ false };
    bool mLocked = false;
 
+   //! True while the factory holds the block for deferred insertion
+   std::atomic<bool> mPending{ false };
+   //! Non-null only if summaries are deferred
+   std::shared_ptr<SummaryTask> mpSummaryTask;
+   //! Valid only if summaries are deferred
+   std::shared_future<void> mSummaryDone;
+
    SampleBlockID mBlockID{ 0 };
 
    ArrayOf<char> mSamples;
@@ -142,6 +226,59 @@ private:
 static std::map< SampleBlockID, std::shared_ptr<SqliteSampleBlock> >
    sSilentBlocks;
 
+// Block ids are reserved before insertion; see
+// DBConnection::ReserveSampleBlockID
+static const char *InsertSampleBlockSql =
+   "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax, sumrms,"
+   "                          summary256, summary64k, samples)"
+   "                         VALUES(?1,?2,?3,?4,?5,?6,?7,?8);";
+
+// Index of sample blocks by a hash of their samples, created when first
+// used; it is not in ProjectFileSchema, so that the file changes only if
+// deduplication is enabled
+static const char *BlockHashesSchema =
+   // CREATE SQL blockhashes
+   // Rows may be added before the block's row is inserted, so the block may
+   // be missing
+   "CREATE TABLE IF NOT EXISTS main.blockhashes"
+   "("
+   "  blockid              INTEGER PRIMARY KEY,"
+   "  hash                 INTEGER"
+   ");"
+   "CREATE INDEX IF NOT EXISTS main.blockhashes_hash"
+   "  ON blockhashes (hash);"
+   ""
+   // Deleting a sample block, in any way, deletes its hash
+   "CREATE TRIGGER IF NOT EXISTS main.blockhashes_sampleblock_deleted"
+   "  AFTER DELETE ON sampleblocks"
+   "  BEGIN"
+   "    DELETE FROM blockhashes WHERE blockid = OLD.blockid;"
+   "  END;"
+   ""
+   // Hashes may have been stored for blocks that were discarded before they
+   // were written
+   "DELETE FROM main.blockhashes WHERE blockid NOT IN"
+   "  (SELECT blockid FROM sampleblocks);";
+
+static sqlite3_int64 ContentHash(constSamplePtr src, size_t bytes)
+{
+   // FNV-1a, a word at a time; equal hashes are confirmed by comparing the
+   // samples, so weaker mixing costs only an occasional comparison
+   unsigned long long hash = 14695981039346656037ull;
+   size_t ii = 0;
+   for (; ii + sizeof(hash) <= bytes; ii += sizeof(hash)) {
+      unsigned long long word;
+      memcpy(&word, src + ii, sizeof(word));
+      hash ^= word;
+      hash *= 1099511628211ull;
+   }
+   for (; ii < bytes; ++ii) {
+      hash ^= static_cast<unsigned char>(src[ii]);
+      hash *= 1099511628211ull;
+   }
+   return static_cast<sqlite3_int64>(hash);
+}
+
 ///\brief Implementation of @ref SampleBlockFactory using Sqlite database
 class SqliteSampleBlockFactory final
    : public SampleBlockFactory
@@ -169,6 +306,11 @@ public:
    SampleBlockPtr DoCreateFromId(
       sampleFormat srcformat, SampleBlockID id) override;
 
+   void Flush() override;
+
+   void BeginLoad() override;
+   void EndLoad() override;
+
    void OnSampleBlockDtor(const SampleBlock&)
    {
       if (mSampleBlockDeletionCallback)
@@ -179,6 +321,30 @@ private:
    void OnBeginPurge(size_t begin, size_t end);
    void OnEndPurge();
 
+   //! Store the samples in the block, and summarize and insert them later
+   void Defer(const std::shared_ptr<SqliteSampleBlock> &sb,
+      constSamplePtr src, size_t numsamples, sampleFormat srcformat);
+
+   bool IsOwner() const { return std::this_thread::get_id() == mOwner; }
+   //! Have the owning thread flush when it is next idle
+   void PostFlush();
+   //! Insert the rows of pending blocks; called only by the owning thread
+   /*!
+    @param demanded if false, insert only the blocks whose summaries are
+    ready, and while a transaction is open, only those made by this thread
+    */
+   void DoFlush(bool demanded);
+
+   //! Create the hash index if this is a connection not yet seen
+   /*! @return null on failure */
+   sqlite3 *HashesDB();
+   //! An extant block with the same samples, or null
+   std::shared_ptr<SqliteSampleBlock> FindDuplicate(sqlite3_int64 hash,
+      constSamplePtr src, size_t numsamples, sampleFormat srcformat);
+   //! Insert pending hashes, a full batch with each statement
+   /*! @param all if true, insert the remainder too, a row at a time */
+   void WriteHashes(bool all);
+
    friend SqliteSampleBlock;
 
    AudacityProject &mProject;
@@ -186,6 +352,64 @@ private:
    std::function<void()> mSampleBlockDeletionCallback;
    const std::shared_ptr<ConnectionPtr> mppConnection;
 
+   //! Whether samples are read with incremental blob I/O; fixed for the
+   //! lifetime of the factory, so that the setting is not read in worker
+   //! threads
+   const bool mMappedReads;
+
+   //! Whether new blocks with the samples of extant blocks are those blocks
+   //! again; fixed for the lifetime of the factory
+   const bool mDeduplicate;
+   //! The connection in which the hash index was last made
+   sqlite3 *mHashesDB{};
+
+   //! Blocks are inserted with one statement when this many are pending
+   static constexpr size_t WriteBatchRows = 16;
+
+   struct PendingHash {
+      SampleBlockID id;
+      sqlite3_int64 hash;
+      //! Where the id was reserved
+      const DBConnection *pConnection;
+   };
+   //! Hashes of new blocks not yet inserted; like mHashesDB, used only by
+   //! the owning thread, which alone deduplicates
+   std::vector<PendingHash> mPendingHashes;
+
+   //! The thread that made the factory, which opens all transactions; only
+   //! it inserts the rows of pending blocks, so that they never go into a
+   //! transaction that another thread may roll back
+   const std::thread::id mOwner{ std::this_thread::get_id() };
+
+   struct PendingBlock {
+      // Weak, so that a block discarded before insertion is never inserted
+      std::weak_ptr<SqliteSampleBlock> pBlock;
+      SqliteSampleBlock::Sizes sizes;
+      //! Where the id was reserved, and so where the row must go
+      const DBConnection *pConnection;
+      bool ownerMade;
+   };
+
+   //! Guards mPendingBlocks, which may grow in one thread while another
+   //! thread flushes
+   std::mutex mPendingMutex;
+   std::vector<PendingBlock> mPendingBlocks;
+   //! Held briefly while inserted blocks release their memory, and by other
+   //! threads while they read the samples of pending blocks from it; not
+   //! while rows are inserted
+   std::mutex mFlushMutex;
+   //! Whether a flush is posted to the owning thread and not yet done
+   std::atomic<bool> mFlushPosted{ false };
+
+   //! Whether summaries of new blocks are computed in the shared pool, and
+   //! their rows inserted later
+   const bool mWriteBehind;
+
+   //! Rows of all blocks in the file, read by BeginLoad() in one query, if
+   //! read-ahead is on; empty after EndLoad()
+   std::unordered_map<SampleBlockID, SampleBlockRow> mLoadRows;
+   bool mLoading{ false };
+
    // Track all blocks that this factory has created, but don't control
    // their lifetimes (so use weak_ptr)
    // (Must also use weak pointers because the blocks have shared pointers
@@ -198,6 +422,9 @@ private:
 SqliteSampleBlockFactory::SqliteSampleBlockFactory( AudacityProject &project )
    : mProject{ project }
    , mppConnection{ ConnectionPtr::Get(project).shared_from_this() }
+   , mMappedReads{ SampleBlockMappedReads.Read() }
+   , mDeduplicate{ SampleBlockDeduplication.Read() }
+   , mWriteBehind{ SampleBlockWriteBehind.Read() }
 {
    mUndoSubscription = UndoManager::Get(project)
       .Subscribe([this](UndoRedoMessage message){
@@ -217,13 +444,401 @@ SqliteSampleBlockFactory::~SqliteSampleBlockFactory() = default;
 SampleBlockPtr SqliteSampleBlockFactory::DoCreate(
    constSamplePtr src, size_t numsamples, sampleFormat srcformat )
 {
+   // Blocks are immutable, so sharing an equal one is as good as a copy,
+   // and its row is deleted only when the last sequence drops it.
+   // Not for samples that the audio thread appends while recording:  they
+   // copy nothing, and hashing and querying would only delay the capture
+   const bool deduplicate = mDeduplicate && IsOwner();
+   sqlite3_int64 hash = 0;
+   if (deduplicate) {
+      hash = ContentHash(src, numsamples * SAMPLE_SIZE(srcformat));
+      if (auto pBlock = FindDuplicate(hash, src, numsamples, srcformat))
+         return pBlock;
+   }
+
    auto sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
-   sb->SetSamples(src, numsamples, srcformat);
-   // block id has now been assigned
-   mAllBlocks[ sb->GetBlockID() ] = sb;
+   if (mWriteBehind)
+      Defer(sb, src, numsamples, srcformat);
+   else
+      sb->SetSamples(src, numsamples, srcformat);
+   // block id has now been assigned (don't call GetBlockID(), which would
+   // settle a deferred block at once)
+   mAllBlocks[ sb->mBlockID ] = sb;
+   if (deduplicate) {
+      // Inserted with later rows, not with a statement for each block
+      mPendingHashes.push_back({ sb->mBlockID, hash, sb->Conn() });
+      if (mPendingHashes.size() >= WriteBatchRows)
+         WriteHashes(false);
+   }
    return sb;
 }
 
+sqlite3 *SqliteSampleBlockFactory::HashesDB()
+{
+   auto &pConnection = mppConnection->mpConnection;
+   const auto db = pConnection ? pConnection->DB() : nullptr;
+   if (!db || db == mHashesDB)
+      return db;
+
+   mHashesDB = nullptr;
+   if (sqlite3_exec(db, BlockHashesSchema, nullptr, nullptr, nullptr)
+      != SQLITE_OK)
+      return nullptr;
+   mHashesDB = db;
+   return db;
+}
+
+std::shared_ptr<SqliteSampleBlock> SqliteSampleBlockFactory::FindDuplicate(
+   sqlite3_int64 hash,
+   constSamplePtr src, size_t numsamples, sampleFormat srcformat)
+{
+   // Failures only lose sharing
+   try {
+      if (!HashesDB())
+         return {};
+      const auto pConnection = mppConnection->mpConnection.get();
+
+      // Prepare and cache statement...automatically finalized at DB close
+      auto stmt = pConnection->Prepare(DBConnection::GetBlockHashes,
+         "SELECT blockid FROM blockhashes WHERE hash = ?1;");
+      std::vector<SampleBlockID> ids;
+      if (sqlite3_bind_int64(stmt, 1, hash) == SQLITE_OK)
+         while (sqlite3_step(stmt) == SQLITE_ROW)
+            ids.push_back(sqlite3_column_int64(stmt, 0));
+      sqlite3_clear_bindings(stmt);
+      sqlite3_reset(stmt);
+      for (const auto &entry : mPendingHashes)
+         if (entry.hash == hash)
+            ids.push_back(entry.id);
+
+      const auto bytes = numsamples * SAMPLE_SIZE(srcformat);
+      SampleBuffer buffer;
+      for (auto id : ids) {
+         // Only blocks still in use, which no other thread can be deleting
+         const auto iter = mAllBlocks.find(id);
+         if (iter == mAllBlocks.end())
+            continue;
+         auto pBlock = iter->second.lock();
+         if (!pBlock ||
+             pBlock->GetSampleFormat() != srcformat ||
+             pBlock->GetSampleCount() != numsamples)
+            continue;
+
+         // Equal hashes are not yet equal samples
+         if (!buffer.ptr())
+            buffer.Allocate(numsamples, srcformat);
+         if (pBlock->GetSamples(buffer.ptr(), srcformat, 0, numsamples, false)
+               == numsamples &&
+             memcmp(buffer.ptr(), src, bytes) == 0)
+            return pBlock;
+      }
+   }
+   catch (const AudacityException &) {
+   }
+   return {};
+}
+
+void SqliteSampleBlockFactory::WriteHashes(bool all)
+{
+   const auto nTaken = all ? mPendingHashes.size()
+      : mPendingHashes.size() / WriteBatchRows * WriteBatchRows;
+   if (nTaken == 0)
+      return;
+   std::vector<PendingHash> hashes{ mPendingHashes.begin(),
+      mPendingHashes.begin() + nTaken };
+   mPendingHashes.erase(mPendingHashes.begin(),
+      mPendingHashes.begin() + nTaken);
+
+   // Failures only lose sharing
+   try {
+      if (!HashesDB())
+         return;
+      const auto pConnection = mppConnection->mpConnection.get();
+
+      // Ids reserved in another connection mean nothing in this one
+      hashes.erase(std::remove_if(hashes.begin(), hashes.end(),
+         [&](const PendingHash &entry){
+            return entry.pConnection != pConnection; }),
+         hashes.end());
+      const auto nHashes = hashes.size();
+
+      // Prepare and cache statements...automatically finalized at DB close
+      static const std::string batchSql = []{
+         std::string sql =
+            "INSERT OR REPLACE INTO blockhashes (blockid, hash) VALUES";
+         for (size_t ii = 0; ii < WriteBatchRows; ++ii)
+            sql += (ii ? ",(?,?)" : "(?,?)");
+         return sql + ";";
+      }();
+
+      for (size_t first = 0; first < nHashes;) {
+         const auto nRows = (nHashes - first >= WriteBatchRows)
+            ? WriteBatchRows : 1;
+         auto stmt = (nRows > 1)
+            ? pConnection->Prepare(DBConnection::InsertBlockHashes,
+               batchSql.c_str())
+            : pConnection->Prepare(DBConnection::InsertBlockHash,
+               "INSERT OR REPLACE INTO blockhashes (blockid, hash) VALUES (?1, ?2);");
+         int rc = SQLITE_OK;
+         for (size_t ii = 0; !rc && ii < nRows; ++ii)
+            (rc = sqlite3_bind_int64(stmt, 1 + 2 * ii, hashes[first + ii].id)) ||
+            (rc = sqlite3_bind_int64(stmt, 2 + 2 * ii, hashes[first + ii].hash));
+         if (!rc)
+            sqlite3_step(stmt);
+         sqlite3_clear_bindings(stmt);
+         sqlite3_reset(stmt);
+         first += nRows;
+      }
+   }
+   catch (const AudacityException &) {
+   }
+}
+
+void SqliteSampleBlockFactory::Defer(
+   const std::shared_ptr<SqliteSampleBlock> &sb,
+   constSamplePtr src, size_t numsamples, sampleFormat srcformat)
+{
+   const auto sizes = sb->SetSizes(numsamples, srcformat);
+   sb->mSamples.reinit(sb->mSampleBytes);
+   memcpy(sb->mSamples.get(), src, sb->mSampleBytes);
+
+   // The id is known now, though the row does not yet exist
+   sb->mBlockID = sb->Conn()->ReserveSampleBlockID();
+   sb->mValid = true;
+
+   // The block runs this task or waits for it to finish before it is
+   // destroyed, so the raw pointer remains valid while it runs
+   auto task = std::make_shared<SummaryTask>(
+      [pBlock = sb.get(), sizes]{ pBlock->CalcSummary(sizes); });
+   sb->mSummaryDone = task->task.get_future().share();
+   sb->mpSummaryTask = task;
+   sb->mPending.store(true, std::memory_order_release);
+   audacity::concurrency::ThreadPool::Shared().Enqueue([task]{ task->Run(); });
+
+   bool full;
+   {
+      std::lock_guard<std::mutex> lock{ mPendingMutex };
+      mPendingBlocks.push_back({ sb, sizes, sb->Conn(), IsOwner() });
+      full = mPendingBlocks.size() >= WriteBatchRows;
+   }
+   if (!full)
+      return;
+   if (IsOwner())
+      DoFlush(false);
+   else
+      PostFlush();
+}
+
+void SqliteSampleBlockFactory::Flush()
+{
+   if (IsOwner()) {
+      DoFlush(true);
+      return;
+   }
+
+   // Wait for the owning thread to insert the rows, so that the blocks are
+   // as durable on return as in that thread; the owning thread must not be
+   // waiting for this one meanwhile
+   auto pDone = std::make_shared<std::promise<void>>();
+   auto done = pDone->get_future();
+   BasicUI::CallAfter([wFactory = weak_from_this(), pDone]{
+      try {
+         if (auto pFactory = wFactory.lock())
+            pFactory->DoFlush(true);
+         pDone->set_value();
+      }
+      catch (...) {
+         pDone->set_exception(std::current_exception());
+      }
+   });
+   // Rethrows the failure of the insertion, or throws std::future_error if
+   // the owning thread discarded the flush without doing it
+   done.get();
+}
+
+void SqliteSampleBlockFactory::PostFlush()
+{
+   if (mFlushPosted.exchange(true))
+      return;
+   BasicUI::CallAfter([wFactory = weak_from_this()]{
+      if (auto pFactory = wFactory.lock()) {
+         pFactory->mFlushPosted.store(false);
+         GuardedCall([&]{ pFactory->DoFlush(false); });
+      }
+   });
+}
+
+void SqliteSampleBlockFactory::DoFlush(bool demanded)
+{
+   assert(IsOwner());
+
+   // While this thread dispatches events for a writer in another, leave the
+   // blocks pending for a later flush, unless demanded; then fail before
+   // taking any of them
+   if (const auto conn = mppConnection->mpConnection.get();
+       conn && conn->IsWaitingForWriter()) {
+      if (demanded)
+         conn->ThrowException(true);
+      return;
+   }
+
+   // Blocks discarded meanwhile by their sequences are destroyed, and their
+   // rows deleted, on return
+   std::vector<std::shared_ptr<SqliteSampleBlock>> blocks;
+   std::vector<PendingBlock> pending;
+   std::vector<PendingBlock> deferred;
+   std::exception_ptr pError;
+
+   // Blocks not inserted now go back to the front of the queue
+   const auto requeue = finally([&]{
+      if (deferred.empty())
+         return;
+      std::lock_guard<std::mutex> lock{ mPendingMutex };
+      mPendingBlocks.insert(mPendingBlocks.begin(),
+         std::make_move_iterator(deferred.begin()),
+         std::make_move_iterator(deferred.end()));
+   });
+
+   {
+      std::lock_guard<std::mutex> lock{ mPendingMutex };
+      pending.swap(mPendingBlocks);
+   }
+
+   const auto conn = mppConnection->mpConnection.get();
+   const auto inTransaction = conn && !sqlite3_get_autocommit(conn->DB());
+   {
+      std::vector<PendingBlock> ready;
+      for (auto &entry : pending) {
+         auto pBlock = entry.pBlock.lock();
+         if (!pBlock)
+            continue;
+         auto &done = pBlock->mSummaryDone;
+         if (!demanded && (
+            (inTransaction && !entry.ownerMade) ||
+            done.wait_for(std::chrono::seconds{ 0 }) !=
+               std::future_status::ready))
+            deferred.push_back(std::move(entry));
+         else if (entry.pConnection != conn) {
+            // The connection changed under the block; its id means nothing
+            // in the new one
+            if (!pError)
+               pError = std::make_exception_ptr(SimpleMessageBoxException{
+                  ExceptionType::Internal,
+                  XO("Sample data were not written before the project file "
+                     "changed"),
+                  XO("Warning"),
+                  "Error:_Disk_full_or_not_writable"
+               });
+            deferred.push_back(std::move(entry));
+         }
+         else {
+            // Report any exception from the calculation of summaries, before
+            // any binding, but insert the other blocks first
+            try {
+               pBlock->AwaitSummary();
+               done.get();
+               blocks.push_back(std::move(pBlock));
+               ready.push_back(std::move(entry));
+            }
+            catch (...) {
+               if (!pError)
+                  pError = std::current_exception();
+               deferred.push_back(std::move(entry));
+            }
+         }
+      }
+      pending.swap(ready);
+   }
+
+   if (!blocks.empty()) {
+      auto db = conn->DB();
+
+      // Prepare and cache statements...automatically finalized at DB close
+      static const std::string batchSql = []{
+         std::string sql =
+            "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax, sumrms,"
+            "                          summary256, summary64k, samples)"
+            "                         VALUES";
+         for (size_t ii = 0; ii < WriteBatchRows; ++ii)
+            sql += (ii ? ",(?,?,?,?,?,?,?,?)" : "(?,?,?,?,?,?,?,?)");
+         return sql + ";";
+      }();
+
+      const auto nBlocks = blocks.size();
+      for (size_t first = 0; first < nBlocks;) {
+         // One statement, and so one transaction unless the caller is
+         // already in one, for a full batch; a row at a time for the
+         // remainder
+         const auto nRows = (nBlocks - first >= WriteBatchRows)
+            ? WriteBatchRows : 1;
+         auto stmt = (nRows > 1)
+            ? conn->Prepare(DBConnection::InsertSampleBlocks, batchSql.c_str())
+            : conn->Prepare(DBConnection::InsertSampleBlock,
+               InsertSampleBlockSql);
+
+         // Bind statement parameters
+         // Might return SQLITE_MISUSE which means it's our mistake that we violated
+         // preconditions; should return SQL_OK which is 0
+         int rc = SQLITE_OK;
+         for (size_t ii = 0; !rc && ii < nRows; ++ii)
+            rc = blocks[first + ii]->BindRow(
+               stmt, 1 + 8 * ii, pending[first + ii].sizes);
+         if (rc)
+         {
+            ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(sqlite3_errcode(db)));
+            ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlockFactory::Flush::bind");
+
+            wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+         }
+
+         // Execute the statement
+         rc = sqlite3_step(stmt);
+
+         // Clear statement bindings and rewind statement
+         sqlite3_clear_bindings(stmt);
+         sqlite3_reset(stmt);
+
+         if (rc != SQLITE_DONE)
+         {
+            ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+            ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlockFactory::Flush::step");
+
+            wxLogDebug(wxT("SqliteSampleBlockFactory::Flush - SQLITE error %s"), sqlite3_errmsg(db));
+
+            // These rows and the rest remain pending, and a later flush
+            // tries again
+            deferred.insert(deferred.end(),
+               std::make_move_iterator(pending.begin() + first),
+               std::make_move_iterator(pending.end()));
+
+            // Just showing the user a simple message, not the library error too
+            // which isn't internationalized
+            conn->ThrowException( true );
+         }
+
+         // Only now are these rows inserted.  Other threads may have read the
+         // samples from memory during the insertion, which only reads them
+         // too; now wait for any such reader to finish before releasing them
+         {
+            std::lock_guard<std::mutex> flushLock{ mFlushMutex };
+            for (size_t ii = 0; ii < nRows; ++ii) {
+               auto &pBlock = blocks[first + ii];
+               pBlock->OnCommitted();
+               pBlock->mPending.store(false, std::memory_order_release);
+            }
+         }
+         first += nRows;
+      }
+   }
+
+   // The hashes of new blocks follow their rows; those of a partial batch
+   // wait for more, unless the flush was demanded
+   WriteHashes(demanded);
+
+   if (pError)
+      std::rethrow_exception(pError);
+}
+
 auto SqliteSampleBlockFactory::GetActiveBlockIDs() -> SampleBlockIDs
 {
    SampleBlockIDs result;
@@ -291,6 +906,17 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromId(
    auto ssb           = std::make_shared<SqliteSampleBlock>(shared_from_this());
    wb                 = ssb;
    ssb->mSampleFormat = srcformat;
+
+   if (mLoading) {
+      // Loading a project:  take the row that BeginLoad() read; if there is
+      // none, Load() reports it as before
+      const auto iter = mLoadRows.find(id);
+      if (iter != mLoadRows.end()) {
+         ssb->Load(id, iter->second);
+         return ssb;
+      }
+   }
+
    // This may throw database errors
    // It initializes the rest of the fields
    ssb->Load(static_cast<SampleBlockID>(id));
@@ -298,6 +924,55 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromId(
    return ssb;
 }
 
+void SqliteSampleBlockFactory::BeginLoad()
+{
+   if (mLoading || !SampleBlockReadAhead.Read())
+      return;
+
+   auto &pConnection = mppConnection->mpConnection;
+   if (!pConnection)
+      return;
+   const auto db = pConnection->DB();
+
+   // One pass over the table, in place of a query for each block; the
+   // lengths of the samples come from the records, without their contents
+   const char *sql =
+      "SELECT blockid, sampleformat, summin, summax, sumrms,"
+      "       length(samples)"
+      "  FROM sampleblocks;";
+   sqlite3_stmt *stmt = nullptr;
+   auto cleanup = finally([&]{ sqlite3_finalize(stmt); });
+   if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+      // Fall back to a query for each block
+      return;
+
+   std::unordered_map<SampleBlockID, SampleBlockRow> rows;
+   int rc;
+   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+      rows.emplace(sqlite3_column_int64(stmt, 0), SampleBlockRow{
+         static_cast<sampleFormat>(sqlite3_column_int(stmt, 1)),
+         sqlite3_column_double(stmt, 2),
+         sqlite3_column_double(stmt, 3),
+         sqlite3_column_double(stmt, 4),
+         static_cast<size_t>(sqlite3_column_int(stmt, 5)),
+      });
+   if (rc != SQLITE_DONE) {
+      wxLogDebug(wxT("SqliteSampleBlockFactory::BeginLoad - SQLITE error %s"),
+         sqlite3_errmsg(db));
+      return;
+   }
+
+   mLoadRows.swap(rows);
+   mLoading = true;
+}
+
+void SqliteSampleBlockFactory::EndLoad()
+{
+   mLoading = false;
+   // Release the memory
+   std::unordered_map<SampleBlockID, SampleBlockRow>{}.swap(mLoadRows);
+}
+
 BlockSampleView SqliteSampleBlock::GetFloatSampleView(bool mayThrow)
 {
    assert(mSampleCount > 0);
@@ -308,6 +983,15 @@ BlockSampleView SqliteSampleBlock::GetFloatSampleView(bool mayThrow)
    auto cache = mCache.lock();
    if (cache)
       return cache;
+   // Not while holding the lock, which the insertion also takes
+   if (auto pendingLock = Settle()) {
+      // Not cached, because insertion releases the memory
+      const auto result =
+         std::make_shared<std::vector<float>>(mSampleCount);
+      ReadPendingSamples(reinterpret_cast<samplePtr>(result->data()),
+         floatSample, 0, mSampleCount);
+      return result;
+   }
    std::lock_guard<std::mutex> lock(mCacheMutex);
    cache = mCache.lock();
    if (cache)
@@ -350,6 +1034,9 @@ SqliteSampleBlock::~SqliteSampleBlock()
       mpFactory->OnSampleBlockDtor(*this);
    }
 
+   // A worker thread may still be summarizing the samples
+   AwaitSummary();
+
    if (IsSilent()) {
       // The block object was constructed but failed to Load() or Commit().
       // Or it's a silent block with no row in the database.
@@ -362,7 +1049,9 @@ SqliteSampleBlock::~SqliteSampleBlock()
 
    // See ProjectFileIO::Bypass() for a description of mIO.mBypass
    GuardedCall( [this]{
-      if (!mLocked && !Conn()->ShouldBypass())
+      // A block destroyed while still pending has no row to delete
+      if (!mLocked && !mPending.load(std::memory_order_acquire) &&
+          !Conn()->ShouldBypass())
       {
          // In case Delete throws, don't let an exception escape a destructor,
          // but we can still enqueue the delayed handler so that an error message
@@ -392,6 +1081,44 @@ DBConnection *SqliteSampleBlock::Conn() const
    return pConnection.get();
 }
 
+std::unique_lock<std::mutex> SqliteSampleBlock::Settle() const
+{
+   if (!mPending.load(std::memory_order_acquire))
+      return {};
+   auto &factory = *mpFactory;
+   if (factory.IsOwner()) {
+      factory.Flush();
+      return {};
+   }
+   // Not under the lock, so that the factory need not wait for the summary
+   // to release other blocks
+   AwaitSummary();
+   std::unique_lock<std::mutex> lock{ factory.mFlushMutex };
+   if (!mPending.load(std::memory_order_acquire))
+      return {};
+   return lock;
+}
+
+size_t SqliteSampleBlock::ReadPendingSamples(samplePtr dest,
+   sampleFormat destformat, size_t sampleoffset, size_t numsamples) const
+{
+   if (sampleoffset >= mSampleCount)
+      return 0;
+   numsamples = std::min(numsamples, mSampleCount - sampleoffset);
+   // No dithering, as in GetBlob()
+   CopySamples(mSamples.get() + sampleoffset * SAMPLE_SIZE(mSampleFormat),
+      mSampleFormat, dest, destformat, numsamples);
+   return numsamples;
+}
+
+void SqliteSampleBlock::AwaitSummary() const
+{
+   if (mpSummaryTask)
+      mpSummaryTask->Run();
+   if (mSummaryDone.valid())
+      mSummaryDone.wait();
+}
+
 void SqliteSampleBlock::CloseLock() noexcept
 {
    mLocked = true;
@@ -399,6 +1126,9 @@ void SqliteSampleBlock::CloseLock() noexcept
 
 SampleBlockID SqliteSampleBlock::GetBlockID() const
 {
+   // Whoever asks for the id in the factory's thread may record it, so the
+   // row must exist; in other threads, the id is good only as a key
+   Settle();
    return mBlockID;
 }
 
@@ -423,6 +1153,17 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
       return numsamples;
    }
 
+   if (auto lock = Settle())
+      return ReadPendingSamples(dest, destformat, sampleoffset, numsamples);
+
+   if (mpFactory->mMappedReads)
+      return ReadBlob(dest,
+                      destformat,
+                      "samples",
+                      mSampleFormat,
+                      sampleoffset * SAMPLE_SIZE(mSampleFormat),
+                      numsamples * SAMPLE_SIZE(mSampleFormat)) / SAMPLE_SIZE(mSampleFormat);
+
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::GetSamples,
       "SELECT samples FROM sampleblocks WHERE blockid = ?1;");
@@ -475,6 +1216,21 @@ bool SqliteSampleBlock::GetSummary(float *dest,
    if (!silent) {
       // Not a silent block
       try {
+         if (auto lock = Settle()) {
+            const auto &summary = (id == DBConnection::GetSummary256)
+               ? mSummary256 : mSummary64k;
+            const auto frames64k = (mSampleCount + 65535) / 65536;
+            const auto frames = (id == DBConnection::GetSummary256)
+               ? frames64k * 256 : frames64k;
+            const auto copied = frameoffset < frames
+               ? std::min(numframes, frames - frameoffset) : 0;
+            memcpy(dest, summary.get() + frameoffset * bytesPerFrame,
+               copied * bytesPerFrame);
+            memset(dest + copied * fields, 0,
+               (numframes - copied) * bytesPerFrame);
+            return true;
+         }
+
          // Prepare and cache statement...automatically finalized at DB close
          auto stmt = Conn()->Prepare(id, sql);
          // Note GetBlob returns a size_t, not a bool
@@ -522,7 +1278,7 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
 
    float min = FLT_MAX;
    float max = -FLT_MAX;
-   float sumsq = 0;
+   double sumsq = 0;
 
    if (!mValid)
    {
@@ -538,21 +1294,12 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
       float *samples = (float *) blockData.ptr();
 
       size_t copied = DoGetSamples((samplePtr) samples, floatSample, start, len);
-      for (size_t i = 0; i < copied; ++i, ++samples)
+      if (copied > 0)
       {
-         float sample = *samples;
-
-         if (sample > max)
-         {
-            max = sample;
-         }
-
-         if (sample < min)
-         {
-            min = sample;
-         }
-
-         sumsq += (sample * sample);
+         const auto stats = ComputeMinMaxSumSq(samples, copied);
+         min = stats.min;
+         max = stats.max;
+         sumsq = stats.sumsq;
       }
    }
 
@@ -564,6 +1311,7 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
 /// these values are already computed.
 MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS() const
 {
+   AwaitSummary();
    return { (float) mSumMin, (float) mSumMax, (float) mSumRms };
 }
 
@@ -571,8 +1319,10 @@ size_t SqliteSampleBlock::GetSpaceUsage() const
 {
    if (IsSilent())
       return 0;
-   else
-      return ProjectFileIO::GetDiskUsage(*Conn(), mBlockID);
+   if (auto lock = Settle())
+      // Not yet in the database; approximate by the samples alone
+      return mSampleBytes;
+   return ProjectFileIO::GetDiskUsage(*Conn(), mBlockID);
 }
 
 size_t SqliteSampleBlock::GetBlob(void *dest,
@@ -699,6 +1449,98 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
    return srcbytes;
 }
 
+/// Like GetBlob, but instead of selecting the whole column value into a
+/// buffer owned by Sqlite, opens a blob handle on the row and reads only the
+/// requested byte range.  When no conversion of format is needed, the bytes
+/// go directly into the destination, which with a memory mapped database file
+/// is the only copy made.
+size_t SqliteSampleBlock::ReadBlob(void *dest,
+                                   sampleFormat destformat,
+                                   const char *column,
+                                   sampleFormat srcformat,
+                                   size_t srcoffset,
+                                   size_t srcbytes)
+{
+   auto db = DB();
+
+   wxASSERT(!IsSilent());
+
+   if (!mValid)
+   {
+      Load(mBlockID);
+   }
+
+   // Handles are not kept open between calls:  an open handle would hold a
+   // read transaction, which defers the commit of inserts in autocommit mode
+   // and stops checkpoints from resetting the write ahead log
+   sqlite3_blob *blob = nullptr;
+   int rc = sqlite3_blob_open(
+      db, "main", "sampleblocks", column, mBlockID, 0, &blob);
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::ReadBlob::open");
+
+      wxLogDebug(wxT("SqliteSampleBlock::ReadBlob - SQLITE error %s"), sqlite3_errmsg(db));
+
+      // sqlite3_blob_open may assign a handle even on failure
+      sqlite3_blob_close(blob);
+
+      // Just showing the user a simple message, not the library error too
+      // which isn't internationalized
+      Conn()->ThrowException( false );
+   }
+   auto cleanup = finally([blob]{ sqlite3_blob_close(blob); });
+
+   size_t blobbytes = (size_t) sqlite3_blob_bytes(blob);
+
+   srcoffset = std::min(srcoffset, blobbytes);
+   const size_t minbytes = std::min(srcbytes, blobbytes - srcoffset);
+
+   // See the comments in GetBlob about dithering
+   wxASSERT(destformat == floatSample || destformat == srcformat);
+
+   if (minbytes > 0)
+   {
+      SampleBuffer converted;
+      void *target = dest;
+      if (destformat != srcformat)
+      {
+         converted.Allocate(minbytes / SAMPLE_SIZE(srcformat), srcformat);
+         target = converted.ptr();
+      }
+
+      rc = sqlite3_blob_read(blob, target, (int) minbytes, (int) srcoffset);
+      if (rc != SQLITE_OK)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::ReadBlob::read");
+
+         wxLogDebug(wxT("SqliteSampleBlock::ReadBlob - SQLITE error %s"), sqlite3_errmsg(db));
+
+         Conn()->ThrowException( false );
+      }
+
+      if (target != dest)
+         CopySamples(converted.ptr(),
+                     srcformat,
+                     (samplePtr) dest,
+                     destformat,
+                     minbytes / SAMPLE_SIZE(srcformat));
+   }
+
+   // As in GetBlob, zero-fill the part of the request beyond the blob
+   // (counting bytes in the source format)
+   dest = ((samplePtr) dest) + minbytes;
+
+   if (srcbytes - minbytes)
+   {
+      memset(dest, 0, srcbytes - minbytes);
+   }
+
+   return srcbytes;
+}
+
 void SqliteSampleBlock::Load(SampleBlockID sbid)
 {
    auto db = DB();
@@ -752,45 +1594,49 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
    }
 
    // Retrieve returned data
-   mBlockID = sbid;
-   mSampleFormat = (sampleFormat) sqlite3_column_int(stmt, 0);
-   mSumMin = sqlite3_column_double(stmt, 1);
-   mSumMax = sqlite3_column_double(stmt, 2);
-   mSumRms = sqlite3_column_double(stmt, 3);
-   mSampleBytes = sqlite3_column_int(stmt, 4);
-   mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
+   const SampleBlockRow row{
+      static_cast<sampleFormat>(sqlite3_column_int(stmt, 0)),
+      sqlite3_column_double(stmt, 1),
+      sqlite3_column_double(stmt, 2),
+      sqlite3_column_double(stmt, 3),
+      static_cast<size_t>(sqlite3_column_int(stmt, 4)),
+   };
 
    // Clear statement bindings and rewind statement
    sqlite3_clear_bindings(stmt);
    sqlite3_reset(stmt);
 
+   Load(sbid, row);
+}
+
+void SqliteSampleBlock::Load(SampleBlockID sbid, const SampleBlockRow &row)
+{
+   mBlockID = sbid;
+   mSampleFormat = row.format;
+   mSumMin = row.sumMin;
+   mSumMax = row.sumMax;
+   mSumRms = row.sumRms;
+   mSampleBytes = row.sampleBytes;
+   mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
+
    mValid = true;
 }
 
 void SqliteSampleBlock::Commit(Sizes sizes)
 {
-   const auto mSummary256Bytes = sizes.first;
-   const auto mSummary64kBytes = sizes.second;
-
    auto db = DB();
    int rc;
 
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::InsertSampleBlock,
-      "INSERT INTO sampleblocks (sampleformat, summin, summax, sumrms,"
-      "                          summary256, summary64k, samples)"
-      "                         VALUES(?1,?2,?3,?4,?5,?6,?7);");
+      InsertSampleBlockSql);
+
+   mBlockID = Conn()->ReserveSampleBlockID();
 
    // Bind statement parameters
    // Might return SQLITE_MISUSE which means it's our mistake that we violated
    // preconditions; should return SQL_OK which is 0
-   if (sqlite3_bind_int(stmt, 1, static_cast<int>(mSampleFormat)) ||
-       sqlite3_bind_double(stmt, 2, mSumMin) ||
-       sqlite3_bind_double(stmt, 3, mSumMax) ||
-       sqlite3_bind_double(stmt, 4, mSumRms) ||
-       sqlite3_bind_blob(stmt, 5, mSummary256.get(), mSummary256Bytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 6, mSummary64k.get(), mSummary64kBytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 7, mSamples.get(), mSampleBytes, SQLITE_STATIC))
+   if (BindRow(stmt, 1, sizes))
    {
 
       ADD_EXCEPTION_CONTEXT(
@@ -814,14 +1660,44 @@ void SqliteSampleBlock::Commit(Sizes sizes)
       sqlite3_clear_bindings(stmt);
       sqlite3_reset(stmt);
 
+      // The block owns no row
+      mBlockID = 0;
+
       // Just showing the user a simple message, not the library error too
       // which isn't internationalized
       Conn()->ThrowException( true );
    }
 
-   // Retrieve returned data
-   mBlockID = sqlite3_last_insert_rowid(db);
+   OnCommitted();
+
+   // Clear statement bindings and rewind statement
+   sqlite3_clear_bindings(stmt);
+   sqlite3_reset(stmt);
+
+   mValid = true;
+}
+
+int SqliteSampleBlock::BindRow(
+   sqlite3_stmt *stmt, int first, Sizes sizes) const
+{
+   const auto mSummary256Bytes = sizes.first;
+   const auto mSummary64kBytes = sizes.second;
+
+   // Stop at the first failure
+   int rc;
+   (rc = sqlite3_bind_int64(stmt, first, mBlockID)) ||
+   (rc = sqlite3_bind_int(stmt, first + 1, static_cast<int>(mSampleFormat))) ||
+   (rc = sqlite3_bind_double(stmt, first + 2, mSumMin)) ||
+   (rc = sqlite3_bind_double(stmt, first + 3, mSumMax)) ||
+   (rc = sqlite3_bind_double(stmt, first + 4, mSumRms)) ||
+   (rc = sqlite3_bind_blob(stmt, first + 5, mSummary256.get(), mSummary256Bytes, SQLITE_STATIC)) ||
+   (rc = sqlite3_bind_blob(stmt, first + 6, mSummary64k.get(), mSummary64kBytes, SQLITE_STATIC)) ||
+   (rc = sqlite3_bind_blob(stmt, first + 7, mSamples.get(), mSampleBytes, SQLITE_STATIC));
+   return rc;
+}
 
+void SqliteSampleBlock::OnCommitted()
+{
    // Reset local arrays
    mSamples.reset();
    mSummary256.reset();
@@ -830,12 +1706,6 @@ void SqliteSampleBlock::Commit(Sizes sizes)
       std::lock_guard<std::mutex> lock(mCacheMutex);
       mCache.reset();
    }
-
-   // Clear statement bindings and rewind statement
-   sqlite3_clear_bindings(stmt);
-   sqlite3_reset(stmt);
-
-   mValid = true;
 }
 
 void SqliteSampleBlock::Delete()
@@ -886,7 +1756,7 @@ void SqliteSampleBlock::Delete()
 
 void SqliteSampleBlock::SaveXML(XMLWriter &xmlFile)
 {
-   xmlFile.WriteAttr(wxT("blockid"), mBlockID);
+   xmlFile.WriteAttr(wxT("blockid"), GetBlockID());
 }
 
 auto SqliteSampleBlock::SetSizes(
@@ -944,10 +1814,6 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
 
    for (int i = 0; i < sumLen; ++i)
    {
-      min = samples[i * 256];
-      max = samples[i * 256];
-      sumsq = min * min;
-
       int jcount = 256;
       if (jcount > mSampleCount - i * 256)
       {
@@ -955,27 +1821,16 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
          fraction = 1.0 - (jcount / 256.0);
       }
 
-      for (int j = 1; j < jcount; ++j)
-      {
-         float f1 = samples[i * 256 + j];
-         sumsq += f1 * f1;
-
-         if (f1 < min)
-         {
-            min = f1;
-         }
-         else if (f1 > max)
-         {
-            max = f1;
-         }
-      }
+      const auto stats = ComputeMinMaxSumSq(samples + i * 256, jcount);
+      min = stats.min;
+      max = stats.max;
 
-      totalSquares += sumsq;
+      totalSquares += stats.sumsq;
 
       summary256[i * fields] = min;
       summary256[i * fields + 1] = max;
       // The rms is correct, but this may be for less than 256 samples in last loop.
-      summary256[i * fields + 2] = (float) sqrt(sumsq / jcount);
+      summary256[i * fields + 2] = (float) sqrt(stats.sumsq / jcount);
    }
 
    for (int i = sumLen, frames256 = mSummary256Bytes / bytesPerFrame;
@@ -0,0 +1,180 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleBlockReadTests.cpp
+
+**********************************************************************/
+#include "BenchmarkUtils.h"
+
+#include <catch2/catch.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+using BenchmarkUtils::Clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+constexpr size_t BlockBytes = 1 << 20;
+constexpr size_t ChunkBytes = 1 << 16;
+
+// As in ProjectFileIO and SqliteSampleBlock
+const char* Schema =
+   "CREATE TABLE sampleblocks"
+   "("
+   "  blockid              INTEGER PRIMARY KEY AUTOINCREMENT,"
+   "  sampleformat         INTEGER,"
+   "  summin               REAL,"
+   "  summax               REAL,"
+   "  sumrms               REAL,"
+   "  summary256           BLOB,"
+   "  summary64k           BLOB,"
+   "  samples              BLOB"
+   ");";
+
+//! A file of nBlocks sample blocks, deleted at destruction
+class BlockFile final
+{
+public:
+   explicit BlockFile(size_t nBlocks)
+       : mPath { std::filesystem::temp_directory_path() /
+                 "SampleBlockReadTests.aup3" }
+   {
+      Remove();
+      REQUIRE(sqlite3_open(mPath.string().c_str(), &mDB) == SQLITE_OK);
+      REQUIRE(
+         sqlite3_exec(
+            mDB,
+            "PRAGMA journal_mode = WAL; PRAGMA page_size = 65536;", nullptr,
+            nullptr, nullptr) == SQLITE_OK);
+      REQUIRE(sqlite3_exec(mDB, Schema, nullptr, nullptr, nullptr) == SQLITE_OK);
+
+      const auto samples = BenchmarkUtils::RandomSamples(BlockBytes / 4, 0);
+      sqlite3_stmt* stmt {};
+      REQUIRE(
+         sqlite3_prepare_v2(
+            mDB, "INSERT INTO sampleblocks (sampleformat, samples) VALUES (1, ?1);",
+            -1, &stmt, nullptr) == SQLITE_OK);
+      sqlite3_exec(mDB, "BEGIN;", nullptr, nullptr, nullptr);
+      for (size_t ii = 0; ii < nBlocks; ++ii)
+      {
+         sqlite3_bind_blob(
+            stmt, 1, samples.data(), BlockBytes, SQLITE_STATIC);
+         REQUIRE(sqlite3_step(stmt) == SQLITE_DONE);
+         sqlite3_reset(stmt);
+      }
+      sqlite3_exec(mDB, "COMMIT;", nullptr, nullptr, nullptr);
+      sqlite3_finalize(stmt);
+      sqlite3_exec(
+         mDB, "PRAGMA wal_checkpoint(TRUNCATE);", nullptr, nullptr, nullptr);
+   }
+
+   ~BlockFile()
+   {
+      sqlite3_close(mDB);
+      Remove();
+   }
+
+   sqlite3* DB() const { return mDB; }
+
+private:
+   void Remove()
+   {
+      std::error_code ec;
+      for (auto suffix : { "", "-wal", "-shm" })
+         std::filesystem::remove(mPath.string() + suffix, ec);
+   }
+
+   const std::filesystem::path mPath;
+   sqlite3* mDB {};
+};
+
+//! The read of SqliteSampleBlock::GetBlob:  select the whole value
+void SelectRead(
+   sqlite3_stmt* stmt, sqlite3_int64 id, char* dest, size_t offset,
+   size_t bytes)
+{
+   sqlite3_bind_int64(stmt, 1, id);
+   REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+   const auto src = static_cast<const char*>(sqlite3_column_blob(stmt, 0));
+   memcpy(dest, src + offset, bytes);
+   sqlite3_reset(stmt);
+}
+
+//! The read of SqliteSampleBlock::ReadBlob:  only the range, through a
+//! blob handle
+void BlobRead(
+   sqlite3* db, sqlite3_int64 id, char* dest, size_t offset, size_t bytes)
+{
+   sqlite3_blob* blob {};
+   REQUIRE(
+      sqlite3_blob_open(db, "main", "sampleblocks", "samples", id, 0, &blob) ==
+      SQLITE_OK);
+   REQUIRE(
+      sqlite3_blob_read(blob, dest, static_cast<int>(bytes),
+                        static_cast<int>(offset)) == SQLITE_OK);
+   sqlite3_blob_close(blob);
+}
+} // namespace
+
+TEST_CASE("Sample block read paths", "[.][benchmark][SampleBlockRead]")
+{
+   // Larger than most page caches, smaller than the map of a connection
+   constexpr size_t nBlocks = 512;
+   BlockFile file { nBlocks };
+   const auto db = file.DB();
+
+   std::vector<sqlite3_int64> ids(nBlocks);
+   std::iota(ids.begin(), ids.end(), 1);
+   auto shuffled = ids;
+   std::mt19937 engine { 0 };
+   std::shuffle(shuffled.begin(), shuffled.end(), engine);
+   std::vector<size_t> offsets(nBlocks);
+   for (auto& offset : offsets)
+      offset = engine() % (BlockBytes - ChunkBytes);
+
+   sqlite3_stmt* stmt {};
+   REQUIRE(
+      sqlite3_prepare_v2(
+         db, "SELECT samples FROM sampleblocks WHERE blockid = ?1;", -1,
+         &stmt, nullptr) == SQLITE_OK);
+   std::vector<char> buffer(BlockBytes);
+
+   for (const auto mapped : { false, true })
+   {
+      // As DBConnection configures it
+      sqlite3_exec(
+         db, mapped ? "PRAGMA mmap_size = 1073741824;" : "PRAGMA mmap_size = 0;",
+         nullptr, nullptr, nullptr);
+      const auto read = [&](sqlite3_int64 id, size_t offset, size_t bytes) {
+         if (mapped)
+            BlobRead(db, id, buffer.data(), offset, bytes);
+         else
+            SelectRead(stmt, id, buffer.data(), offset, bytes);
+      };
+
+      auto start = Clock::now();
+      for (auto id : ids)
+         read(id, 0, BlockBytes);
+      const Milliseconds sequential = Clock::now() - start;
+
+      start = Clock::now();
+      for (size_t ii = 0; ii < nBlocks; ++ii)
+         read(shuffled[ii], offsets[ii], ChunkBytes);
+      const Milliseconds random = Clock::now() - start;
+
+      std::cout << (mapped ? "Mapped" : "Selected")
+                << " block reads: sequential " << sequential.count()
+                << " ms, random " << random.count() << " ms\n";
+   }
+   sqlite3_finalize(stmt);
+}
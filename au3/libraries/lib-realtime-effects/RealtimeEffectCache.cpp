@@ -0,0 +1,166 @@
+/**********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file RealtimeEffectCache.cpp
+
+ **********************************************************************/
+#include "RealtimeEffectCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+size_t BlockFloats(unsigned nChannels)
+{
+   // Input and output
+   return 2 * nChannels * RealtimeEffectCache::BlockSize;
+}
+}
+
+RealtimeEffectCachePool::RealtimeEffectCachePool(
+   unsigned nChannels, size_t bytes)
+   : mnChannels{ nChannels }
+   , mnBlocks{ nChannels == 0
+      ? 0 : bytes / (BlockFloats(nChannels) * sizeof(float)) }
+   // Not value-initialized, so that pages are not touched until used
+   , mStorage{ new float[mnBlocks * BlockFloats(nChannels)] }
+{
+}
+
+RealtimeEffectCachePool::~RealtimeEffectCachePool() = default;
+
+float *RealtimeEffectCachePool::Take()
+{
+   auto next = mNext.load(std::memory_order_relaxed);
+   do {
+      if (next >= mnBlocks)
+         return nullptr;
+   } while (!mNext.compare_exchange_weak(next, next + 1,
+      std::memory_order_relaxed));
+   return mStorage.get() + next * BlockFloats(mnChannels);
+}
+
+RealtimeEffectCache::RealtimeEffectCache(RealtimeEffectCachePool &pool)
+   : mPool{ pool }
+   , mnChannels{ pool.GetChannels() }
+{
+   // No cache can hold more than the whole pool
+   mBlocks.reserve(pool.Capacity());
+   mFree.reserve(pool.Capacity());
+}
+
+RealtimeEffectCache::~RealtimeEffectCache() = default;
+
+void RealtimeEffectCache::Validate(size_t signature)
+{
+   if (signature != mSignature) {
+      Clear();
+      mSignature = signature;
+   }
+}
+
+void RealtimeEffectCache::Clear()
+{
+   for (const auto &block : mBlocks)
+      mFree.push_back(block.input);
+   mBlocks.clear();
+   mLooping = false;
+}
+
+void RealtimeEffectCache::Locate(sampleCount position, size_t len)
+{
+   if (position != mNext &&
+      !(mLooping && position == mLoopStart && mNext == mLoopEnd)
+   ) {
+      // Stored output followed from samples that did not come just before
+      // these
+      const auto end = mNext;
+      Clear();
+      if (mWarm && position < end) {
+         mLooping = true;
+         mLoopStart = position;
+         mLoopEnd = end;
+      }
+   }
+   mNext = position + len;
+}
+
+auto RealtimeEffectCache::Find(long long index) const
+   -> Blocks::const_iterator
+{
+   const auto iter =
+      std::lower_bound(mBlocks.begin(), mBlocks.end(), index, Before);
+   if (iter == mBlocks.end() || iter->index != index)
+      return mBlocks.end();
+   return iter;
+}
+
+bool RealtimeEffectCache::Lookup(
+   sampleCount position, float *const *buffers, size_t len) const
+{
+   const auto iter = Find(position.as_long_long() / BlockSize);
+   if (iter == mBlocks.end())
+      return false;
+   const auto &block = *iter;
+   const auto offset = (position % BlockSize).as_size_t();
+   if (offset < block.begin || offset + len > block.end)
+      return false;
+
+   // Compare bits, not values, so that stored NaNs match too
+   for (unsigned iChannel = 0; iChannel < mnChannels; ++iChannel)
+      if (memcmp(buffers[iChannel],
+         block.input + iChannel * BlockSize + offset,
+         len * sizeof(float)) != 0)
+         return false;
+
+   for (unsigned iChannel = 0; iChannel < mnChannels; ++iChannel)
+      std::copy_n(block.output + iChannel * BlockSize + offset, len,
+         buffers[iChannel]);
+   return true;
+}
+
+bool RealtimeEffectCache::Store(sampleCount position,
+   const float *const *input, const float *const *output, size_t len)
+{
+   if (!mLooping)
+      return false;
+
+   const long long index = position.as_long_long() / BlockSize;
+   auto iter =
+      std::lower_bound(mBlocks.begin(), mBlocks.end(), index, Before);
+   if (iter == mBlocks.end() || iter->index != index) {
+      float *storage{};
+      if (!mFree.empty()) {
+         storage = mFree.back();
+         mFree.pop_back();
+      }
+      else if (!(storage = mPool.Take()))
+         return false;
+
+      // Within the reserved capacity, so this does not allocate
+      iter = mBlocks.insert(iter,
+         { index, storage, storage + mnChannels * BlockSize });
+   }
+
+   auto &block = *iter;
+   const auto offset = (position % BlockSize).as_size_t();
+   for (unsigned iChannel = 0; iChannel < mnChannels; ++iChannel) {
+      std::copy_n(input[iChannel], len,
+         block.input + iChannel * BlockSize + offset);
+      std::copy_n(output[iChannel], len,
+         block.output + iChannel * BlockSize + offset);
+   }
+
+   // Extend the valid range if the new one touches it, else replace it
+   if (block.begin < block.end &&
+       offset <= block.end && block.begin <= offset + len) {
+      block.begin = std::min(block.begin, offset);
+      block.end = std::max(block.end, offset + len);
+   }
+   else {
+      block.begin = offset;
+      block.end = offset + len;
+   }
+   return true;
+}
@@ -0,0 +1,140 @@
+/**********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file RealtimeEffectCache.h
+ @brief Remembers the output of a group's effect stack for repeated input
+
+ **********************************************************************/
+
+#ifndef __AUDACITY_REALTIME_EFFECT_CACHE__
+#define __AUDACITY_REALTIME_EFFECT_CACHE__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "SampleCount.h"
+
+//! Storage for the blocks of all caches of one playback
+/*!
+ Allocated by the main thread before playback, so that the threads that
+ process groups never allocate
+ */
+class REALTIME_EFFECTS_API RealtimeEffectCachePool final
+{
+public:
+   //! @param bytes the most memory to allocate; a block is
+   //! `2 * nChannels * RealtimeEffectCache::BlockSize` floats
+   RealtimeEffectCachePool(unsigned nChannels, size_t bytes);
+   ~RealtimeEffectCachePool();
+
+   unsigned GetChannels() const { return mnChannels; }
+   //! How many blocks the pool holds in all
+   size_t Capacity() const { return mnBlocks; }
+
+   //! Take storage for one block, never to be given back
+   /*!
+    Thread safe
+    @return null if all were taken
+    */
+   float *Take();
+
+private:
+   const unsigned mnChannels;
+   const size_t mnBlocks;
+   std::unique_ptr<float[]> mStorage;
+   std::atomic<size_t> mNext{ 0 };
+};
+
+//! Output of one group's effect stack, kept for replay of the same input
+/*!
+ Positions are in the group's timeline at the playback rate.  Samples are
+ kept in blocks aligned to multiples of BlockSize; each block keeps the input
+ and the output of one contiguous range of its samples.  A lookup succeeds
+ only if the input is the same as what was stored, so that edits of the
+ samples need no notification.
+
+ Output is stored only after the first wrap of looped play.  What the effects
+ produce in the first pass depends on what they heard before the loop, but
+ from the second pass on, the same loop precedes each pass.
+
+ To be used only by the thread that processes the group.
+ */
+class REALTIME_EFFECTS_API RealtimeEffectCache final
+{
+public:
+   static constexpr size_t BlockSize = 4096;
+
+   //! Blocks come from the pool when first needed; the pool must outlive
+   //! this
+   explicit RealtimeEffectCache(RealtimeEffectCachePool &pool);
+   ~RealtimeEffectCache();
+
+   //! Forget everything, if the signature differs from the previous one
+   void Validate(size_t signature);
+   //! Forget everything, keeping the storage for reuse
+   void Clear();
+
+   //! Whether the last samples given to the effects followed from the ones
+   //! before them, so that what they produce continues what was cached
+   bool IsWarm() const { return mWarm; }
+   void SetWarm(bool warm) { mWarm = warm; }
+
+   //! Note where the next samples start, before Lookup() or Store() of them
+   /*!
+    A jump backward while warm begins looped play between the position and
+    the end of the previous samples.  Any other jump, or a wrap to some
+    other loop, forgets everything.
+    */
+   void Locate(sampleCount position, size_t len);
+   //! Whether the effects repeat a loop, so that their output may be stored
+   bool IsLooping() const { return mLooping; }
+
+   //! Replace input with the output remembered for it, if any
+   /*!
+    @pre `position >= 0`
+    @pre `position % BlockSize + len <= BlockSize`
+    @return whether the output was found
+    */
+   bool Lookup(sampleCount position, float *const *buffers, size_t len) const;
+
+   //! Remember output for input
+   /*!
+    Does not allocate
+    @pre `position >= 0`
+    @pre `position % BlockSize + len <= BlockSize`
+    @return false if not looping, or if there was no room
+    */
+   bool Store(sampleCount position,
+      const float *const *input, const float *const *output, size_t len);
+
+private:
+   struct Block {
+      long long index{};
+      //! Channel-major, BlockSize samples each
+      float *input{}, *output{};
+      //! The range of valid samples
+      size_t begin{}, end{};
+   };
+   //! Sorted by index; capacity reserved for all the blocks of the pool
+   using Blocks = std::vector<Block>;
+
+   static bool Before(const Block &block, long long index)
+      { return block.index < index; }
+   Blocks::const_iterator Find(long long index) const;
+
+   RealtimeEffectCachePool &mPool;
+   const unsigned mnChannels;
+   Blocks mBlocks;
+   //! Storage taken from the pool, not now in use
+   std::vector<float *> mFree;
+   size_t mSignature{};
+   //! Where samples following the last located ones would start
+   sampleCount mNext{ -1 };
+   sampleCount mLoopStart{ 0 }, mLoopEnd{ 0 };
+   bool mWarm{ false };
+   bool mLooping{ false };
+};
+
+#endif
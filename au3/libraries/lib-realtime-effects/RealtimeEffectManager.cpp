@@ -8,15 +8,79 @@
 
  **********************************************************************/
 #include "RealtimeEffectManager.h"
+#include "RealtimeEffectCache.h"
 #include "RealtimeEffectState.h"
 #include "Channel.h"
 
 #include <memory>
+#include "MemoryX.h"
+#include "Prefs.h"
 #include "Project.h"
+#include "concurrency/ThreadPool.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <thread>
 #include <wx/time.h>
 
+BoolSetting RealtimeEffectManager::ParallelSetting{
+   L"/RealtimeEffects/ParallelGroups", false };
+
+IntSetting RealtimeEffectManager::CacheSizeSetting{
+   L"/RealtimeEffects/CacheMegabytes", 0 };
+
+namespace {
+//! How many scratch buffers processing needs for groups of the given width
+size_t ScratchBuffersCount(unsigned numPlaybackChannels)
+{
+   return 3 * numPlaybackChannels + 1;
+}
+
+//! Make room for processing at most maxSamples
+void ReserveScratch(RealtimeEffectManager::ScratchBuffers &buffers,
+   unsigned numPlaybackChannels, size_t maxSamples)
+{
+   const auto count = ScratchBuffersCount(numPlaybackChannels);
+   if (buffers.size() < count)
+      buffers.resize(count);
+   for (auto &buffer : buffers)
+      if (buffer.size() < maxSamples)
+         buffer.resize(maxSamples);
+}
+}
+
+//! Groups shared by the threads of one ProcessGroups() call
+/*!
+ Owned jointly by the workers, some of which may start only after the call
+ returns; those find nothing left to claim, and touch nothing else
+ */
+struct RealtimeEffectManager::GroupBatch
+{
+   GroupBatch(RealtimeEffects::GroupBuffers *groups, size_t nGroups,
+      bool suspended)
+      : groups{ groups }, nGroups{ nGroups }, suspended{ suspended }
+   {}
+
+   RealtimeEffects::GroupBuffers *const groups;
+   const size_t nGroups;
+   const bool suspended;
+
+   //! @return the index of a group for the caller to process, or nGroups
+   //! or more when all are claimed
+   size_t Claim() { return next.fetch_add(1, std::memory_order_relaxed); }
+
+   std::atomic<size_t> next{ 0 };
+
+   std::mutex mutex;
+   std::condition_variable finished;
+   size_t done{ 0 };
+   //! The first exception from any thread, rethrown by ProcessGroups()
+   std::exception_ptr pException;
+};
+
 static const AttachedProjectObjects::RegisteredFactory manager
 {
    [](AudacityProject &project)
@@ -53,11 +117,24 @@ bool RealtimeEffectManager::IsActive() const noexcept
 void RealtimeEffectManager::Initialize(
    RealtimeEffects::InitializationScope &scope,
    unsigned numPlaybackChannels,
-   double sampleRate)
+   double sampleRate, size_t maxSamples)
 {
    // (Re)Set processor parameters
    mRates.clear();
    mGroups.clear();
+   mNumPlaybackChannels = numPlaybackChannels;
+   mMaxSamples = maxSamples;
+   mpPool = nullptr;
+   // Allocate now, so that the audio thread does not
+   mScratch.clear();
+   ReserveScratch(mScratch, numPlaybackChannels, maxSamples);
+   // Processed samples are remembered for one playback only, because the
+   // signatures of effect settings are not comparable between playbacks
+   mCaches.clear();
+   mpCachePool.reset();
+   if (const auto megabytes = CacheSizeSetting.Read(); megabytes > 0)
+      mpCachePool = std::make_unique<RealtimeEffectCachePool>(
+         numPlaybackChannels, size_t(megabytes) << 20);
 
    // RealtimeAdd/RemoveEffect() needs to know when we're active so it can
    // initialize newly added effects
@@ -83,6 +160,14 @@ void RealtimeEffectManager::AddGroup(
    mGroups.push_back(&group);
    mRates.insert({&group, rate});
 
+   if (mGroups.size() == 2 && ParallelSetting.Read() &&
+       std::thread::hardware_concurrency() > 1)
+      mpPool = &audacity::concurrency::ThreadPool::Shared();
+
+   if (mpCachePool)
+      mCaches.emplace(&group,
+         std::make_unique<RealtimeEffectCache>(*mpCachePool));
+
    VisitGroup(&group,
       [&](RealtimeEffectState & state, bool) {
          scope.mInstances.push_back(state.AddGroup(&group, chans, rate));
@@ -95,11 +180,16 @@ void RealtimeEffectManager::Finalize() noexcept
    // Reenter suspended state
    SetSuspended(true);
 
+   mpPool = nullptr;
+
    VisitAll([](RealtimeEffectState &state, bool){ state.Finalize(); });
 
    // Reset processor parameters
    mGroups.clear();
    mRates.clear();
+   mScratch.clear();
+   mCaches.clear();
+   mpCachePool.reset();
 
    // No longer active
    mActive = false;
@@ -172,6 +262,201 @@ size_t RealtimeEffectManager::Process(bool suspended,
    return discardable;
 }
 
+// This will be called in a thread other than the main GUI thread.
+//
+void RealtimeEffectManager::ProcessGroups(bool suspended,
+   RealtimeEffects::GroupBuffers *groups, size_t nGroups)
+{
+   if (!mpPool || nGroups < 2)
+      for (size_t i = 0; i < nGroups; ++i)
+         ProcessGroup(suspended, groups[i], mScratch);
+   else
+      ProcessBatch(suspended, groups, nGroups);
+}
+
+void RealtimeEffectManager::ProcessBatch(bool suspended,
+   RealtimeEffects::GroupBuffers *groups, size_t nGroups)
+{
+   const auto pBatch =
+      std::make_shared<GroupBatch>(groups, nGroups, suspended);
+   const auto nWorkers = std::min(mpPool->GetThreadsCount(), nGroups - 1);
+   for (size_t i = 0; i < nWorkers; ++i)
+      mpPool->Enqueue([this, pBatch]{
+         // Claim before touching this, which may be gone when the task
+         // starts after the audio thread claimed all; while a claimed group
+         // is not done, the audio thread waits for it
+         const auto first = pBatch->Claim();
+         if (first >= pBatch->nGroups)
+            return;
+         // Each pool thread keeps its own scratch, allocated on first use
+         thread_local ScratchBuffers scratch;
+         ProcessClaimed(*pBatch, first, scratch);
+      });
+
+   // This thread claims groups too, so that when the workers are slow to
+   // start, it waits only for the groups they already began, and never for
+   // a worker to be scheduled
+   if (const auto first = pBatch->Claim(); first < nGroups)
+      ProcessClaimed(*pBatch, first, mScratch);
+
+   // Wait for the groups that workers began.  That takes no longer than
+   // processing them here would have, and so each effect sees every block,
+   // in order, and its output is always played
+   std::unique_lock lock{ pBatch->mutex };
+   pBatch->finished.wait(lock, [&]{ return pBatch->done == nGroups; });
+   if (pBatch->pException)
+      std::rethrow_exception(pBatch->pException);
+}
+
+void RealtimeEffectManager::ProcessClaimed(
+   GroupBatch &batch, size_t first, ScratchBuffers &scratch)
+{
+   size_t processed = 0;
+   for (size_t i = first; i < batch.nGroups; i = batch.Claim(), ++processed)
+   {
+      auto &group = batch.groups[i];
+      try {
+         ReserveScratch(scratch, mNumPlaybackChannels, mMaxSamples);
+         ProcessGroup(batch.suspended, group, scratch);
+      }
+      catch (...) {
+         // Leave the samples of this group as they are; ProcessGroups()
+         // rethrows
+         group.discardable = 0;
+         std::lock_guard lock{ batch.mutex };
+         if (!batch.pException)
+            batch.pException = std::current_exception();
+      }
+   }
+
+   if (processed > 0) {
+      {
+         std::lock_guard lock{ batch.mutex };
+         batch.done += processed;
+      }
+      batch.finished.notify_one();
+   }
+}
+
+void RealtimeEffectManager::ProcessGroup(bool suspended,
+   RealtimeEffects::GroupBuffers &group, ScratchBuffers &scratchBuffers)
+{
+   const auto nBuffers = mNumPlaybackChannels;
+   assert(group.numSamples <= mMaxSamples);
+
+   const auto buffers =
+      static_cast<float **>(alloca(nBuffers * sizeof(float *)));
+   const auto scratch =
+      static_cast<float **>(alloca(nBuffers * sizeof(float *)));
+   for (unsigned i = 0; i < nBuffers; ++i) {
+      scratch[i] = scratchBuffers[i].data();
+      buffers[i] = group.buffers[i];
+      if (!buffers[i]) {
+         // Various effects may crash without some input buffer
+         buffers[i] = scratchBuffers[nBuffers + 1 + i].data();
+         std::fill_n(buffers[i], group.numSamples, 0.0f);
+      }
+   }
+   const auto dummy = scratchBuffers[nBuffers].data();
+
+   const auto iter = mCaches.find(group.group);
+   const auto pCache = iter == mCaches.end() ? nullptr : iter->second.get();
+   if (pCache && !suspended && group.position >= 0) {
+      const auto saved =
+         static_cast<float **>(alloca(nBuffers * sizeof(float *)));
+      for (unsigned i = 0; i < nBuffers; ++i)
+         saved[i] = scratchBuffers[2 * nBuffers + 1 + i].data();
+      group.discardable = ProcessCached(suspended, *pCache, group,
+         buffers, scratch, dummy, saved);
+      return;
+   }
+
+   group.discardable = Process(suspended, group.group,
+      buffers, scratch, dummy, nBuffers, group.numSamples);
+   if (pCache && !suspended)
+      // The effects saw these samples, even if they can't be cached
+      pCache->SetWarm(true);
+}
+
+size_t RealtimeEffectManager::ProcessCached(bool suspended,
+   RealtimeEffectCache &cache, const RealtimeEffects::GroupBuffers &group,
+   float *const *buffers, float *const *scratch, float *dummy,
+   float *const *saved)
+{
+   const auto nBuffers = mNumPlaybackChannels;
+   cache.Validate(Signature(group.group));
+
+   const auto pieceBuffers =
+      static_cast<float **>(alloca(nBuffers * sizeof(float *)));
+   const auto pieceSaved =
+      static_cast<const float **>(alloca(nBuffers * sizeof(float *)));
+
+   // Process in pieces that do not cross the blocks of the cache.  Samples
+   // kept after discarding for latency are compacted leftward to `kept`
+   size_t done = 0, kept = 0;
+   while (done < group.numSamples) {
+      const auto position = group.position + done;
+      const auto len = std::min(group.numSamples - done,
+         RealtimeEffectCache::BlockSize -
+            (position % RealtimeEffectCache::BlockSize).as_size_t());
+      for (unsigned i = 0; i < nBuffers; ++i) {
+         pieceBuffers[i] = buffers[i] + done;
+         pieceSaved[i] = saved[i] + done;
+      }
+
+      size_t discardable = 0;
+      cache.Locate(position, len);
+      if (cache.Lookup(position, pieceBuffers, len))
+         // The effects did not see these samples
+         cache.SetWarm(false);
+      else {
+         if (!cache.IsWarm())
+            // The effects will continue from some other samples than those
+            // that led to the remembered output, so it can't be trusted
+            // to match what they would produce now
+            cache.Clear();
+         const bool storing = cache.IsLooping();
+         if (storing)
+            for (unsigned i = 0; i < nBuffers; ++i)
+               std::copy_n(pieceBuffers[i], len, saved[i] + done);
+         discardable = Process(suspended, group.group,
+            pieceBuffers, scratch, dummy, nBuffers, len);
+         if (storing && discardable == 0)
+            cache.Store(position, pieceSaved, pieceBuffers, len);
+         cache.SetWarm(true);
+      }
+
+      if (discardable > 0 || kept < done)
+         for (unsigned i = 0; i < nBuffers; ++i)
+            memmove(buffers[i] + kept, buffers[i] + done + discardable,
+               (len - discardable) * sizeof(float));
+      kept += len - discardable;
+      done += len;
+   }
+
+   // The caller discards from the start, so put the kept samples at the end
+   const auto discardable = group.numSamples - kept;
+   if (discardable > 0)
+      for (unsigned i = 0; i < nBuffers; ++i)
+         memmove(buffers[i] + discardable, buffers[i], kept * sizeof(float));
+   return discardable;
+}
+
+size_t RealtimeEffectManager::Signature(const ChannelGroup *group)
+{
+   // Sensitive to the order of the states, their settings, and activation
+   size_t result = 0;
+   const auto combine = [&result](size_t value) {
+      result ^= value + 0x9e3779b9 + (result << 6) + (result >> 2);
+   };
+   VisitGroup(group, [&](RealtimeEffectState &state, bool listIsActive) {
+      combine(reinterpret_cast<size_t>(&state));
+      combine(state.GetWorkerCounter());
+      combine(state.IsActive() && listIsActive);
+   });
+   return result;
+}
+
 //
 // This will be called in a different thread than the main GUI thread.
 //
@@ -23,13 +23,38 @@
 #include "Observer.h"
 #include "PluginProvider.h" // for PluginID
 #include "RealtimeEffectList.h"
+#include "SampleCount.h"
 
+class BoolSetting;
 class ChannelGroup;
 class EffectInstance;
+class IntSetting;
+class RealtimeEffectCache;
+class RealtimeEffectCachePool;
+
+namespace audacity::concurrency
+{
+class ThreadPool;
+}
 
 namespace RealtimeEffects {
    class InitializationScope;
    class ProcessingScope;
+
+   //! One group's samples, to be transformed by its effect stack
+   struct GroupBuffers {
+      const ChannelGroup *group{};
+      //! One pointer for each playback channel; null pointers stand for
+      //! channels the group lacks, and are supplied as silence
+      float *const *buffers{};
+      size_t numSamples{};
+      //! Where the samples begin in the group's timeline, at the playback
+      //! rate, if they are a contiguous and unwarped part of it; else
+      //! negative, and they are not cached
+      sampleCount position{ -1 };
+      //! Result: how many samples to discard for latency
+      size_t discardable{};
+   };
 }
 
 ///Posted when effect is being added or removed to/from channel group or project
@@ -55,6 +80,9 @@ public:
    static constexpr ChannelGroup* MasterGroup = nullptr;
 
    using Latency = std::chrono::microseconds;
+   //! The scratch outputs, the dummy output, the silent inputs, and the
+   //! saved inputs that processing of one group needs
+   using ScratchBuffers = std::vector<std::vector<float>>;
 
    RealtimeEffectManager(AudacityProject &project);
    ~RealtimeEffectManager();
@@ -62,6 +90,13 @@ public:
    static RealtimeEffectManager & Get(AudacityProject &project);
    static const RealtimeEffectManager & Get(const AudacityProject &project);
 
+   //! Whether playback transforms different groups in parallel
+   static BoolSetting ParallelSetting;
+   //! Megabytes of processed samples that one playback may keep, so that
+   //! replaying the same input, as in looped play, skips the effects;
+   //! reserved when playback starts; 0 disables the cache
+   static IntSetting CacheSizeSetting;
+
    // Realtime effect processing
 
    //! To be called only from main thread
@@ -135,8 +170,9 @@ private:
       const PluginID &id);
 
    //! Main thread begins to define a set of groups for playback
+   /*! @param maxSamples bounds the numbers of samples that groups will give */
    void Initialize(RealtimeEffects::InitializationScope &scope,
-      unsigned numPlaybackChannels, double sampleRate);
+      unsigned numPlaybackChannels, double sampleRate, size_t maxSamples);
    //! Main thread adds one group (passing the first of one or more
    //! channels), still before playback
    void AddGroup(RealtimeEffects::InitializationScope &scope,
@@ -153,8 +189,32 @@ private:
       const ChannelGroup *group,
       float *const *buffers, float *const *scratch, float *dummy,
       unsigned nBuffers, size_t numSamples);
+   /*! @copydoc ProcessScope::ProcessGroups */
+   void ProcessGroups(bool suspended,
+      RealtimeEffects::GroupBuffers *groups, size_t nGroups);
    void ProcessEnd(bool suspended) noexcept;
 
+   struct GroupBatch;
+   //! Share the groups with the workers, waiting for all of them
+   void ProcessBatch(bool suspended,
+      RealtimeEffects::GroupBuffers *groups, size_t nGroups);
+   //! Process the claimed group `first` of the batch, then others not yet
+   //! claimed by other threads
+   void ProcessClaimed(
+      GroupBatch &batch, size_t first, ScratchBuffers &scratch);
+   //! Process one group in place
+   void ProcessGroup(bool suspended,
+      RealtimeEffects::GroupBuffers &group, ScratchBuffers &scratchBuffers);
+   //! Process one group in pieces within the blocks of its cache
+   /*! @return how many samples to discard for latency */
+   size_t ProcessCached(bool suspended, RealtimeEffectCache &cache,
+      const RealtimeEffects::GroupBuffers &group,
+      float *const *buffers, float *const *scratch, float *dummy,
+      float *const *saved);
+   //! Changes when the effects of the group or their settings change
+   /*! To be called only in a processing scope */
+   size_t Signature(const ChannelGroup *group);
+
    RealtimeEffectManager(const RealtimeEffectManager&) = delete;
    RealtimeEffectManager &operator=(const RealtimeEffectManager&) = delete;
 
@@ -205,6 +265,22 @@ private:
    std::vector<const ChannelGroup *> mGroups; //!< all are non-null
 
    std::unordered_map<const ChannelGroup *, double> mRates;
+
+   // These members also are mutated only while there is no playback
+   unsigned mNumPlaybackChannels{};
+   size_t mMaxSamples{};
+   //! The shared pool, processing groups besides the audio thread; null
+   //! unless ParallelSetting is on and there are several groups
+   audacity::concurrency::ThreadPool *mpPool{};
+   //! The audio thread's scratch; each worker has its own
+   ScratchBuffers mScratch;
+
+   //! Storage for all caches; null unless caching is enabled
+   std::unique_ptr<RealtimeEffectCachePool> mpCachePool;
+   //! One for each group, when caching is enabled; each used only by the
+   //! thread processing its group
+   std::unordered_map<const ChannelGroup *,
+      std::unique_ptr<RealtimeEffectCache>> mCaches;
 };
 
 namespace RealtimeEffects {
@@ -212,9 +288,10 @@ namespace RealtimeEffects {
 class InitializationScope {
 public:
    InitializationScope() {}
+   //! @param maxSamples bounds the numbers of samples of each ProcessGroups()
    explicit InitializationScope(
       std::weak_ptr<AudacityProject> wProject, double sampleRate,
-      unsigned numPlaybackChannels
+      unsigned numPlaybackChannels, size_t maxSamples
    )  : mSampleRate{ sampleRate }
       , mwProject{ move(wProject) }
       , mNumPlaybackChannels{ numPlaybackChannels }
@@ -224,7 +301,8 @@ public:
          RealtimeEffectManager::Get(*pProject).Initialize(
             *this,
             numPlaybackChannels,
-            sampleRate
+            sampleRate,
+            maxSamples
          );
       }
    }
@@ -289,6 +367,26 @@ public:
       return 0; // consider them trivially processed
    }
 
+   //! Transform several groups, perhaps in parallel
+   /*!
+    Use this instead of repeated Process() calls, but not for the master
+    group, which must see the results of all the others.  The groups must
+    be distinct, and each give no more samples than the InitializationScope
+    allowed.
+
+    Returns when all groups are done.  An exception from another thread is
+    rethrown here.
+    */
+   void ProcessGroups(GroupBuffers *groups, size_t nGroups)
+   {
+      if (const auto pProject = mwProject.lock())
+         RealtimeEffectManager::Get(*pProject)
+            .ProcessGroups(mSuspended, groups, nGroups);
+      else
+         for (size_t i = 0; i < nGroups; ++i)
+            groups[i].discardable = 0;
+   }
+
 private:
    std::weak_ptr<AudacityProject> mwProject;
    bool mSuspended{};
@@ -96,6 +96,11 @@ public:
    //! Test only in the worker thread, or else when there is no processing
    bool IsActive() const noexcept;
 
+   //! Changes whenever the worker thread receives new settings or messages
+   //! Test only in the worker thread
+   unsigned GetWorkerCounter() const noexcept
+      { return mWorkerSettings.counter; }
+
    //! Set only in the main thread
    void SetActive(bool active);
 
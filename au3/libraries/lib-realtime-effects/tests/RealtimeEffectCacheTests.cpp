@@ -0,0 +1,195 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealtimeEffectCacheTests.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "RealtimeEffectCache.h"
+
+#include <vector>
+
+namespace {
+constexpr auto BlockSize = RealtimeEffectCache::BlockSize;
+constexpr size_t BlockBytes = 2 * BlockSize * sizeof(float);
+
+//! One channel of samples that differ with the position
+struct Piece {
+   Piece(sampleCount position, size_t len, float offset = 0)
+      : samples(len)
+   {
+      for (size_t i = 0; i < len; ++i)
+         samples[i] = (position.as_long_long() + i) % 1000 + offset;
+      pointer = samples.data();
+   }
+   std::vector<float> samples;
+   float *pointer{};
+};
+
+//! What the effects "produce" for a piece
+Piece Output(sampleCount position, size_t len)
+{
+   return { position, len, 0.5f };
+}
+
+//! Simulate processing, as RealtimeEffectManager::ProcessCached does
+bool Play(RealtimeEffectCache &cache, sampleCount position, size_t len)
+{
+   Piece piece{ position, len };
+   cache.Locate(position, len);
+   if (cache.Lookup(position, &piece.pointer, len)) {
+      cache.SetWarm(false);
+      REQUIRE(piece.samples == Output(position, len).samples);
+      return true;
+   }
+   if (!cache.IsWarm())
+      cache.Clear();
+   const auto output = Output(position, len);
+   cache.Store(position, &piece.pointer, &output.pointer, len);
+   cache.SetWarm(true);
+   return false;
+}
+
+//! Play the loop [0, end) in pieces; return how many were found
+size_t PlayPass(RealtimeEffectCache &cache, sampleCount end)
+{
+   size_t found = 0;
+   for (sampleCount position = 0; position < end; position += BlockSize)
+      found += Play(cache, position, BlockSize);
+   return found;
+}
+}
+
+TEST_CASE("RealtimeEffectCache", "[RealtimeEffectCache]")
+{
+   const sampleCount loopEnd = 4 * BlockSize;
+
+   SECTION("stores nothing in the first pass of a loop")
+   {
+      RealtimeEffectCachePool pool{ 1, 16 * BlockBytes };
+      RealtimeEffectCache cache{ pool };
+      REQUIRE(PlayPass(cache, loopEnd) == 0);
+      REQUIRE(!cache.IsLooping());
+
+      // The second pass follows the first, which the effects heard, and
+      // then the third replays it
+      REQUIRE(PlayPass(cache, loopEnd) == 0);
+      REQUIRE(cache.IsLooping());
+      REQUIRE(PlayPass(cache, loopEnd) == 4);
+   }
+
+   SECTION("does not store across a jump forward")
+   {
+      RealtimeEffectCachePool pool{ 1, 16 * BlockBytes };
+      RealtimeEffectCache cache{ pool };
+      PlayPass(cache, loopEnd);
+      PlayPass(cache, loopEnd);
+      REQUIRE(cache.IsLooping());
+      Play(cache, 10 * BlockSize, BlockSize);
+      REQUIRE(!cache.IsLooping());
+      REQUIRE(PlayPass(cache, loopEnd) == 0);
+   }
+
+   SECTION("forgets a loop for a different one")
+   {
+      RealtimeEffectCachePool pool{ 1, 16 * BlockBytes };
+      RealtimeEffectCache cache{ pool };
+      PlayPass(cache, loopEnd);
+      PlayPass(cache, loopEnd);
+      // Wrapping from the end of the loop finds the stored output, but then
+      // the loop becomes shorter
+      REQUIRE(PlayPass(cache, 2 * BlockSize) == 2);
+      // The effects did not hear the end of the shorter loop
+      REQUIRE(PlayPass(cache, 2 * BlockSize) == 0);
+      REQUIRE(!cache.IsLooping());
+      REQUIRE(PlayPass(cache, 2 * BlockSize) == 0);
+      REQUIRE(cache.IsLooping());
+      REQUIRE(PlayPass(cache, 2 * BlockSize) == 2);
+   }
+
+   SECTION("does not replay for different input")
+   {
+      RealtimeEffectCachePool pool{ 1, 16 * BlockBytes };
+      RealtimeEffectCache cache{ pool };
+      PlayPass(cache, loopEnd);
+      PlayPass(cache, loopEnd);
+      Piece edited{ 0, BlockSize, 3.0f };
+      cache.Locate(0, BlockSize);
+      REQUIRE(!cache.Lookup(0, &edited.pointer, BlockSize));
+   }
+
+   SECTION("forgets everything when the signature changes")
+   {
+      RealtimeEffectCachePool pool{ 1, 16 * BlockBytes };
+      RealtimeEffectCache cache{ pool };
+      cache.Validate(1);
+      PlayPass(cache, loopEnd);
+      PlayPass(cache, loopEnd);
+      cache.Validate(2);
+      REQUIRE(!cache.IsLooping());
+      REQUIRE(PlayPass(cache, loopEnd) == 0);
+   }
+
+   SECTION("stores no more than the pool holds, and reuses cleared blocks")
+   {
+      RealtimeEffectCachePool pool{ 1, 2 * BlockBytes };
+      REQUIRE(pool.Capacity() == 2);
+      RealtimeEffectCache cache{ pool };
+      PlayPass(cache, loopEnd);
+      PlayPass(cache, loopEnd);
+      // Found the first two blocks, then the effects missed the third,
+      // which forgets everything
+      REQUIRE(PlayPass(cache, loopEnd) == 2);
+      REQUIRE(pool.Take() == nullptr);
+
+      PlayPass(cache, loopEnd);
+      REQUIRE(PlayPass(cache, loopEnd) == 2);
+   }
+
+   SECTION("shares the pool between caches")
+   {
+      RealtimeEffectCachePool pool{ 1, 3 * BlockBytes };
+      RealtimeEffectCache cache1{ pool }, cache2{ pool };
+      PlayPass(cache1, 2 * BlockSize);
+      PlayPass(cache1, 2 * BlockSize);
+      PlayPass(cache2, 2 * BlockSize);
+      PlayPass(cache2, 2 * BlockSize);
+      REQUIRE(PlayPass(cache1, 2 * BlockSize) == 2);
+      REQUIRE(PlayPass(cache2, 2 * BlockSize) == 1);
+   }
+
+   SECTION("stores ranges within blocks")
+   {
+      RealtimeEffectCachePool pool{ 2, 4 * 2 * BlockBytes };
+      RealtimeEffectCache cache{ pool };
+      const sampleCount end = 1000;
+      const size_t len = 100;
+      const auto playPass = [&]{
+         size_t found = 0;
+         for (sampleCount position = 0; position < end; position += len) {
+            Piece left{ position, len }, right{ position, len, 1.0f };
+            float *const buffers[]{ left.pointer, right.pointer };
+            cache.Locate(position, len);
+            if (cache.Lookup(position, buffers, len)) {
+               cache.SetWarm(false);
+               REQUIRE(left.samples == Output(position, len).samples);
+               ++found;
+               continue;
+            }
+            if (!cache.IsWarm())
+               cache.Clear();
+            const auto output = Output(position, len);
+            const float *const outputs[]{ output.pointer, output.pointer };
+            cache.Store(position, buffers, outputs, len);
+            cache.SetWarm(true);
+         }
+         return found;
+      };
+      REQUIRE(playPass() == 0);
+      REQUIRE(playPass() == 0);
+      REQUIRE(playPass() == 10);
+   }
+}
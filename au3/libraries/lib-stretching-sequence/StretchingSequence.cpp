@@ -118,6 +118,12 @@ bool StretchingSequence::GetMute() const
    return mSequence.GetMute();
 }
 
+void StretchingSequence::VisitPrefetchItems(
+   double t0, double t1, const PrefetchVisitor &visitor) const
+{
+   mSequence.VisitPrefetchItems(t0, t1, visitor);
+}
+
 double StretchingSequence::GetStartTime() const
 {
    return mSequence.GetStartTime();
@@ -55,6 +55,8 @@ public:
    const ChannelGroup *FindChannelGroup() const override;
    bool GetSolo() const override;
    bool GetMute() const override;
+   void VisitPrefetchItems(
+      double t0, double t1, const PrefetchVisitor &visitor) const override;
 
    // AudioGraph::Channel
    AudioGraph::ChannelType GetChannelType() const override;
@@ -0,0 +1,169 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file MPSCQueue.h
+  @brief Bounded queue for many producer threads and one consumer thread
+
+**********************************************************************/
+#pragma once
+
+#include "SPSCQueue.h"
+
+//! Bounded queue for any number of producer threads and one consumer thread
+/*!
+ Each cell carries a sequence number telling whether it is free for the
+ producer that claims it or full for the consumer.  Producers claim cells by
+ compare-and-swap on a shared tail, so pushes are lock-free; pops are
+ wait-free.  A claimed cell becomes visible to the consumer only when its
+ producer finishes writing it, so a slow producer delays the items pushed
+ after its own.
+
+ T must be default-constructible and move-assignable.
+ */
+template<typename T>
+class MPSCQueue : public SharedNonInterfering<MPSCQueue<T>>
+{
+public:
+   //! @param capacity rounded up to a power of two
+   explicit MPSCQueue(size_t capacity)
+      : mMask{ QueueCapacity(capacity) - 1 }
+      , mCells{ std::make_unique<Cell[]>(mMask + 1) }
+   {
+      for (size_t i = 0; i <= mMask; ++i)
+         mCells[i].sequence.store(i, std::memory_order_relaxed);
+   }
+
+   size_t Capacity() const { return mMask + 1; }
+
+   //! May be called from any thread, but is only a snapshot
+   size_t Size() const
+   {
+      const auto head = mHead.load(std::memory_order_acquire);
+      const auto tail = mTail.load(std::memory_order_acquire);
+      // Claimed but unwritten cells count too
+      return tail - std::min(head, tail);
+   }
+
+   //! @name Producers
+   //! @{
+
+   //! @return false if the queue was full
+   template<typename U> bool TryPush(U &&item)
+   {
+      auto tail = mTail.load(std::memory_order_relaxed);
+      while (true) {
+         auto &cell = mCells[tail & mMask];
+         const auto sequence = cell.sequence.load(std::memory_order_acquire);
+         if (sequence == tail) {
+            if (mTail.compare_exchange_weak(tail, tail + 1,
+               std::memory_order_relaxed)) {
+               cell.item = std::forward<U>(item);
+               cell.sequence.store(tail + 1, std::memory_order_release);
+               return true;
+            }
+         }
+         else if (sequence < tail)
+            // The consumer has not yet freed the cell
+            return false;
+         else
+            tail = mTail.load(std::memory_order_relaxed);
+      }
+   }
+
+   //! Copies items from the front of the range, as many as fit
+   /*!
+    The items are pushed with one claim, so that items of other producers do
+    not come between them
+    @return how many were pushed
+    */
+   size_t TryPushBatch(const T *items, size_t count)
+   {
+      auto tail = mTail.load(std::memory_order_relaxed);
+      while (true) {
+         // Estimate room from the consumer, then check the last cell to claim
+         const auto head = mHead.load(std::memory_order_acquire);
+         const auto room = Capacity() - (tail - std::min(head, tail));
+         const auto n = std::min(count, room);
+         if (n == 0)
+            return 0;
+         const auto last = tail + n - 1;
+         const auto sequence =
+            mCells[last & mMask].sequence.load(std::memory_order_acquire);
+         if (sequence == last) {
+            if (mTail.compare_exchange_weak(tail, tail + n,
+               std::memory_order_relaxed)) {
+               for (size_t i = 0; i < n; ++i) {
+                  auto &cell = mCells[(tail + i) & mMask];
+                  cell.item = items[i];
+                  cell.sequence.store(tail + i + 1, std::memory_order_release);
+               }
+               return n;
+            }
+         }
+         else
+            tail = mTail.load(std::memory_order_relaxed);
+      }
+   }
+
+   //! @}
+
+   //! @name Consumer only
+   //! @{
+
+   //! @return false if the queue was empty
+   bool TryPop(T &item)
+   {
+      const auto head = mHead.load(std::memory_order_relaxed);
+      auto &cell = mCells[head & mMask];
+      if (cell.sequence.load(std::memory_order_acquire) != head + 1)
+         return false;
+      item = std::move(cell.item);
+      cell.sequence.store(head + Capacity(), std::memory_order_release);
+      mHead.store(head + 1, std::memory_order_release);
+      return true;
+   }
+
+   //! Moves items to the front of the range, as many as are available
+   //! @return how many were popped
+   size_t TryPopBatch(T *items, size_t count)
+   {
+      const auto head = mHead.load(std::memory_order_relaxed);
+      size_t n = 0;
+      for (; n < count; ++n) {
+         auto &cell = mCells[(head + n) & mMask];
+         if (cell.sequence.load(std::memory_order_acquire) != head + n + 1)
+            break;
+         items[n] = std::move(cell.item);
+         cell.sequence.store(head + n + Capacity(), std::memory_order_release);
+      }
+      // One store for the estimate that batch pushes use
+      if (n > 0)
+         mHead.store(head + n, std::memory_order_release);
+      return n;
+   }
+
+   //! Discards everything that is fully pushed
+   void Clear()
+   {
+      T item;
+      while (TryPop(item))
+         ;
+   }
+
+   //! @}
+
+private:
+   struct Cell {
+      //! Equals the index when free, the index + 1 when full
+      std::atomic<size_t> sequence;
+      T item;
+   };
+
+   NonInterfering<std::atomic<size_t>> mTail{ 0 };
+   NonInterfering<std::atomic<size_t>> mHead{ 0 };
+
+   const size_t mMask;
+   const std::unique_ptr<Cell[]> mCells;
+};
@@ -0,0 +1,151 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SPSCQueue.h
+  @brief Bounded wait-free queue for one producer and one consumer thread
+
+**********************************************************************/
+#pragma once
+
+#include "MemoryX.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+
+//! Rounds up to a power of two, at least 2
+inline size_t QueueCapacity(size_t requested)
+{
+   size_t result = 2;
+   while (result < requested)
+      result <<= 1;
+   return result;
+}
+
+//! Bounded queue for one producer thread and one consumer thread
+/*!
+ All operations are wait-free.  Each side keeps its index, with a cached copy
+ of the other side's, on its own cache line, and reads the other side's index
+ only when the cached copy says the queue is full or empty.
+
+ T must be default-constructible and move-assignable.
+ */
+template<typename T>
+class SPSCQueue : public SharedNonInterfering<SPSCQueue<T>>
+{
+public:
+   //! @param capacity rounded up to a power of two
+   explicit SPSCQueue(size_t capacity)
+      : mMask{ QueueCapacity(capacity) - 1 }
+      , mItems{ std::make_unique<T[]>(mMask + 1) }
+   {
+   }
+
+   size_t Capacity() const { return mMask + 1; }
+
+   //! May be called from either side, but is only a snapshot
+   size_t Size() const
+   {
+      return mProducer.tail.load(std::memory_order_acquire) -
+         mConsumer.head.load(std::memory_order_acquire);
+   }
+
+   //! @name Producer only
+   //! @{
+
+   //! @return false if the queue was full
+   template<typename U> bool TryPush(U &&item)
+   {
+      const auto tail = mProducer.tail.load(std::memory_order_relaxed);
+      if (tail - mProducer.cachedHead == Capacity()) {
+         mProducer.cachedHead =
+            mConsumer.head.load(std::memory_order_acquire);
+         if (tail - mProducer.cachedHead == Capacity())
+            return false;
+      }
+      mItems[tail & mMask] = std::forward<U>(item);
+      mProducer.tail.store(tail + 1, std::memory_order_release);
+      return true;
+   }
+
+   //! Copies items from the front of the range, as many as fit
+   //! @return how many were pushed
+   size_t TryPushBatch(const T *items, size_t count)
+   {
+      const auto tail = mProducer.tail.load(std::memory_order_relaxed);
+      if (Capacity() - (tail - mProducer.cachedHead) < count)
+         mProducer.cachedHead =
+            mConsumer.head.load(std::memory_order_acquire);
+      count = std::min(count, Capacity() - (tail - mProducer.cachedHead));
+      for (size_t i = 0; i < count; ++i)
+         mItems[(tail + i) & mMask] = items[i];
+      // One store publishes all
+      mProducer.tail.store(tail + count, std::memory_order_release);
+      return count;
+   }
+
+   //! @}
+
+   //! @name Consumer only
+   //! @{
+
+   //! @return false if the queue was empty
+   bool TryPop(T &item)
+   {
+      const auto head = mConsumer.head.load(std::memory_order_relaxed);
+      if (head == mConsumer.cachedTail) {
+         mConsumer.cachedTail =
+            mProducer.tail.load(std::memory_order_acquire);
+         if (head == mConsumer.cachedTail)
+            return false;
+      }
+      item = std::move(mItems[head & mMask]);
+      mConsumer.head.store(head + 1, std::memory_order_release);
+      return true;
+   }
+
+   //! Moves items to the front of the range, as many as are available
+   //! @return how many were popped
+   size_t TryPopBatch(T *items, size_t count)
+   {
+      const auto head = mConsumer.head.load(std::memory_order_relaxed);
+      if (mConsumer.cachedTail - head < count)
+         mConsumer.cachedTail =
+            mProducer.tail.load(std::memory_order_acquire);
+      count = std::min(count, mConsumer.cachedTail - head);
+      for (size_t i = 0; i < count; ++i)
+         items[i] = std::move(mItems[(head + i) & mMask]);
+      // One store frees all
+      mConsumer.head.store(head + count, std::memory_order_release);
+      return count;
+   }
+
+   //! Discards everything pushed so far
+   void Clear()
+   {
+      mConsumer.cachedTail = mProducer.tail.load(std::memory_order_acquire);
+      mConsumer.head.store(mConsumer.cachedTail, std::memory_order_release);
+   }
+
+   //! @}
+
+private:
+   // Indices only increase, and wrap around harmlessly because the capacity
+   // is a power of two
+   struct ProducerState {
+      std::atomic<size_t> tail{ 0 };
+      size_t cachedHead{ 0 };
+   };
+   struct ConsumerState {
+      std::atomic<size_t> head{ 0 };
+      size_t cachedTail{ 0 };
+   };
+
+   NonInterfering<ProducerState> mProducer;
+   NonInterfering<ConsumerState> mConsumer;
+
+   const size_t mMask;
+   const std::unique_ptr<T[]> mItems;
+};
@@ -0,0 +1,137 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MPSCQueueTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "MPSCQueue.h"
+#include "QueueTestUtils.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Item
+{
+   size_t producer {};
+   size_t value {};
+};
+} // namespace
+
+TEST_CASE("MPSCQueue", "[MPSCQueue]")
+{
+   SECTION("holds exactly its capacity")
+   {
+      MPSCQueue<int> queue{ 4 };
+      for (int i = 0; i < 4; ++i)
+         REQUIRE(queue.TryPush(i));
+      REQUIRE(!queue.TryPush(4));
+      REQUIRE(queue.Size() == 4);
+      int value = -1;
+      for (int i = 0; i < 4; ++i) {
+         REQUIRE(queue.TryPop(value));
+         REQUIRE(value == i);
+      }
+      REQUIRE(!queue.TryPop(value));
+      REQUIRE(queue.TryPush(5));
+      queue.Clear();
+      REQUIRE(!queue.TryPop(value));
+   }
+
+   SECTION("batches wrap around the end of storage")
+   {
+      MPSCQueue<int> queue{ 8 };
+      int in[6], out[8];
+      int next = 0;
+      for (int round = 0; round < 10; ++round) {
+         for (auto &value : in)
+            value = next++;
+         REQUIRE(queue.TryPushBatch(in, 6) == 6);
+         REQUIRE(queue.TryPushBatch(in, 6) == 2);
+         REQUIRE(queue.TryPushBatch(in, 6) == 0);
+         REQUIRE(queue.TryPopBatch(out, 8) == 8);
+         for (int i = 0; i < 6; ++i)
+            REQUIRE(out[i] == next - 6 + i);
+      }
+   }
+
+   SECTION("delivers everything between threads, in order per producer")
+   {
+      constexpr size_t nProducers = 4;
+      constexpr size_t count = 250'000;
+      MPSCQueue<Item> queue{ 64 };
+      std::vector<std::thread> producers;
+      for (size_t iProducer = 0; iProducer < nProducers; ++iProducer)
+         producers.emplace_back([&queue, iProducer] {
+            Item items[3];
+            for (size_t next = 0; next < count;) {
+               // Odd producers push in batches
+               if (iProducer % 2 == 0) {
+                  if (queue.TryPush(Item{ iProducer, next }))
+                     ++next;
+                  else
+                     std::this_thread::yield();
+               }
+               else {
+                  const auto n = std::min<size_t>(3, count - next);
+                  for (size_t i = 0; i < n; ++i)
+                     items[i] = { iProducer, next + i };
+                  if (const auto pushed = queue.TryPushBatch(items, n))
+                     next += pushed;
+                  else
+                     std::this_thread::yield();
+               }
+            }
+         });
+
+      std::vector<size_t> expected(nProducers);
+      bool ordered = true;
+      Item items[5];
+      for (size_t received = 0; received < nProducers * count;) {
+         const auto n = queue.TryPopBatch(items, 5);
+         if (n == 0)
+            std::this_thread::yield();
+         for (size_t i = 0; i < n; ++i) {
+            auto &next = expected[items[i].producer];
+            ordered = ordered && items[i].value == next++;
+         }
+         received += n;
+      }
+      for (auto &producer : producers)
+         producer.join();
+      REQUIRE(ordered);
+      REQUIRE(queue.Size() == 0);
+   }
+}
+
+TEST_CASE("MPSCQueue latency", "[.][benchmark][MPSCQueue]")
+{
+   constexpr size_t nProducers = 3;
+   constexpr size_t count = 100'000;
+   MPSCQueue<QueueTestUtils::Clock::time_point> queue{ 1024 };
+   QueueTestUtils::Histogram histogram;
+   std::vector<std::thread> producers;
+   for (size_t iProducer = 0; iProducer < nProducers; ++iProducer)
+      producers.emplace_back([&queue] {
+         for (size_t i = 0; i < count;)
+            if (queue.TryPush(QueueTestUtils::Clock::now()))
+               ++i;
+            else
+               std::this_thread::yield();
+      });
+   QueueTestUtils::Clock::time_point stamp;
+   for (size_t i = 0; i < nProducers * count;)
+      if (queue.TryPop(stamp)) {
+         histogram.Add(QueueTestUtils::Clock::now() - stamp);
+         ++i;
+      }
+   for (auto &producer : producers)
+      producer.join();
+   histogram.Print("MPSCQueue push to pop");
+}
@@ -0,0 +1,60 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  QueueTestUtils.h
+
+**********************************************************************/
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+
+namespace QueueTestUtils
+{
+using Clock = std::chrono::steady_clock;
+
+//! Counts durations in power-of-two nanosecond buckets
+class Histogram
+{
+public:
+   void Add(Clock::duration duration)
+   {
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+                   .count();
+      size_t bucket = 0;
+      while (ns > 1 && bucket + 1 < mBuckets.size()) {
+         ns >>= 1;
+         ++bucket;
+      }
+      ++mBuckets[bucket];
+      ++mTotal;
+   }
+
+   //! Upper bound in nanoseconds of the bucket holding the given fraction
+   long long Percentile(double fraction) const
+   {
+      const auto target = static_cast<size_t>(fraction * mTotal);
+      size_t sum = 0;
+      for (size_t bucket = 0; bucket < mBuckets.size(); ++bucket) {
+         sum += mBuckets[bucket];
+         if (sum > target)
+            return 2ll << bucket;
+      }
+      return 2ll << (mBuckets.size() - 1);
+   }
+
+   void Print(const char *title) const
+   {
+      printf("%s, %zu samples, nanoseconds below:\n", title, mTotal);
+      for (auto fraction : { 0.5, 0.9, 0.99, 0.999 })
+         printf("   p%g: %lld\n", fraction * 100, Percentile(fraction));
+   }
+
+private:
+   std::array<size_t, 40> mBuckets{};
+   size_t mTotal{};
+};
+} // namespace QueueTestUtils
@@ -0,0 +1,133 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SPSCQueueTest.cpp
+
+**********************************************************************/
+#include <catch2/catch.hpp>
+
+#include "QueueTestUtils.h"
+#include "SPSCQueue.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+TEST_CASE("SPSCQueue", "[SPSCQueue]")
+{
+   SECTION("rounds capacity up to a power of two")
+   {
+      REQUIRE(SPSCQueue<int>{ 0 }.Capacity() == 2);
+      REQUIRE(SPSCQueue<int>{ 5 }.Capacity() == 8);
+      REQUIRE(SPSCQueue<int>{ 16 }.Capacity() == 16);
+   }
+
+   SECTION("holds exactly its capacity")
+   {
+      SPSCQueue<int> queue{ 4 };
+      for (int i = 0; i < 4; ++i)
+         REQUIRE(queue.TryPush(i));
+      REQUIRE(!queue.TryPush(4));
+      REQUIRE(queue.Size() == 4);
+      int value = -1;
+      for (int i = 0; i < 4; ++i) {
+         REQUIRE(queue.TryPop(value));
+         REQUIRE(value == i);
+      }
+      REQUIRE(!queue.TryPop(value));
+      REQUIRE(queue.Size() == 0);
+   }
+
+   SECTION("batches wrap around the end of storage")
+   {
+      SPSCQueue<int> queue{ 8 };
+      std::vector<int> in(6), out(8);
+      int next = 0, expected = 0;
+      for (int round = 0; round < 10; ++round) {
+         std::iota(in.begin(), in.end(), next);
+         REQUIRE(queue.TryPushBatch(in.data(), in.size()) == 6);
+         next += 6;
+         // Only two more fit
+         REQUIRE(queue.TryPushBatch(in.data(), in.size()) == 2);
+         REQUIRE(queue.TryPopBatch(out.data(), 6) == 6);
+         for (int i = 0; i < 6; ++i)
+            REQUIRE(out[i] == expected++);
+         // Drop the two extra
+         queue.Clear();
+         expected = next;
+      }
+   }
+
+   SECTION("moves items through")
+   {
+      SPSCQueue<std::unique_ptr<int>> queue{ 2 };
+      REQUIRE(queue.TryPush(std::make_unique<int>(7)));
+      std::unique_ptr<int> item;
+      REQUIRE(queue.TryPop(item));
+      REQUIRE(*item == 7);
+   }
+
+   SECTION("delivers everything in order between threads")
+   {
+      constexpr size_t count = 1'000'000;
+      SPSCQueue<size_t> queue{ 64 };
+      std::thread producer{ [&] {
+         size_t values[5];
+         for (size_t next = 0; next < count;) {
+            // Mix single and batch pushes
+            if (next % 3 == 0) {
+               if (queue.TryPush(next))
+                  ++next;
+               else
+                  std::this_thread::yield();
+            }
+            else {
+               const auto n = std::min<size_t>(5, count - next);
+               std::iota(values, values + n, next);
+               if (const auto pushed = queue.TryPushBatch(values, n))
+                  next += pushed;
+               else
+                  std::this_thread::yield();
+            }
+         }
+      } };
+
+      size_t expected = 0, values[7];
+      bool ordered = true;
+      while (expected < count) {
+         const auto n = queue.TryPopBatch(values, 7);
+         if (n == 0)
+            std::this_thread::yield();
+         for (size_t i = 0; i < n; ++i)
+            ordered = ordered && values[i] == expected++;
+      }
+      producer.join();
+      REQUIRE(ordered);
+      REQUIRE(queue.Size() == 0);
+   }
+}
+
+TEST_CASE("SPSCQueue latency", "[.][benchmark][SPSCQueue]")
+{
+   SPSCQueue<QueueTestUtils::Clock::time_point> queue{ 1024 };
+   QueueTestUtils::Histogram histogram;
+   constexpr size_t count = 200'000;
+   std::thread producer{ [&] {
+      for (size_t i = 0; i < count;)
+         if (queue.TryPush(QueueTestUtils::Clock::now()))
+            ++i;
+         else
+            std::this_thread::yield();
+   } };
+   QueueTestUtils::Clock::time_point stamp;
+   for (size_t i = 0; i < count;)
+      if (queue.TryPop(stamp)) {
+         histogram.Add(QueueTestUtils::Clock::now() - stamp);
+         ++i;
+      }
+   producer.join();
+   histogram.Print("SPSCQueue push to pop");
+}
@@ -0,0 +1,241 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SpectrogramTiles.cpp
+
+**********************************************************************/
+#include "SpectrogramTiles.h"
+
+#include "BasicUI.h"
+#include "SampleBlock.h"
+#include "Sequence.h"
+#include "Spectrum.h"
+#include "WaveClip.h"
+#include "concurrency/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace SpectrogramTiles {
+namespace {
+struct TilesPublisher final : Observer::Publisher<Message> {
+   using Publisher::Publish;
+};
+
+TilesPublisher &GetTilesPublisher()
+{
+   static TilesPublisher publisher;
+   return publisher;
+}
+
+// Called from the pool
+void NotifyTilesReady()
+{
+   // One message for all the tiles finished before the main thread gets to it
+   static std::atomic<bool> pending{ false };
+   if (!pending.exchange(true))
+      BasicUI::CallAfter([]{
+         pending.store(false);
+         GetTilesPublisher().Publish({});
+      });
+}
+}
+
+Observer::Publisher<Message> &GetPublisher()
+{
+   return GetTilesPublisher();
+}
+
+long long FloorDiv(long long numerator, long long denominator)
+{
+   return numerator >= 0
+      ? numerator / denominator
+      : -((denominator - 1 - numerator) / denominator);
+}
+
+sampleCount ColumnSample(long long column, double samplesPerPixel)
+{
+   // Add half a sample to round, and offset the display half a sample more,
+   // as fillWhere does with addBias
+   return sampleCount(floor(1.0 + column * samplesPerPixel));
+}
+
+void ComputeGainFactors(size_t fftLen, double rate, int frequencyGain,
+   std::vector<float> &gainFactors)
+{
+   if (frequencyGain > 0) {
+      // Compute a frequency-dependent gain factor
+      // scaled such that 1000 Hz gets a gain of 0dB
+
+      // This is the reciprocal of the bin number of 1000 Hz:
+      const double factor = ((double)rate / (double)fftLen) / 1000.0;
+
+      auto half = fftLen / 2;
+      gainFactors.reserve(half);
+      // Don't take logarithm of zero!  Let bin 0 replicate the gain factor for bin 1.
+      gainFactors.push_back(frequencyGain*log10(factor));
+      for (decltype(half) x = 1; x < half; x++) {
+         gainFactors.push_back(frequencyGain*log10(factor * x));
+      }
+   }
+}
+
+void ComputeSpectrumUsingRealFFTf(
+   float * __restrict buffer, const FFTParam *hFFT,
+   const float * __restrict window, size_t len, float * __restrict out)
+{
+   size_t i;
+   if(len > hFFT->Points * 2)
+      len = hFFT->Points * 2;
+   for(i = 0; i < len; i++)
+      buffer[i] *= window[i];
+   for( ; i < (hFFT->Points * 2); i++)
+      buffer[i] = 0; // zero pad as needed
+   RealFFTf(buffer, hFFT);
+   // Handle the (real-only) DC
+   float power = buffer[0] * buffer[0];
+   if(power <= 0)
+      out[0] = -160.0;
+   else
+      out[0] = 10.0 * log10f(power);
+   for(i = 1; i < hFFT->Points; i++) {
+      const int index = hFFT->BitReversed[i];
+      const float re = buffer[index], im = buffer[index + 1];
+      power = re * re + im * im;
+      if(power <= 0)
+         out[i] = -160.0;
+      else
+         out[i] = 10.0*log10f(power);
+   }
+}
+
+std::vector<ColumnInput> FetchColumns(const WaveChannelInterval &clip,
+   long long index, double samplesPerPixel, size_t windowSize)
+{
+   const auto numSamples = clip.GetSequence().GetNumSamples();
+   // GetSampleView counts from the play start
+   const auto sequenceOffset = clip.TimeToSamples(clip.GetTrimLeft());
+   std::vector<ColumnInput> columns(TileWidth);
+   for (long long xx = 0; xx < TileWidth; ++xx) {
+      auto from = ColumnSample(index * TileWidth + xx, samplesPerPixel);
+      if (from < 0 || from >= numSamples)
+         continue;
+      auto &column = columns[xx];
+      auto myLen = windowSize;
+      from -= windowSize >> 1;
+      if (from < 0) {
+         column.leftZeros = static_cast<size_t>(-from.as_long_long());
+         myLen -= column.leftZeros;
+         from = 0;
+      }
+      if (from + myLen >= numSamples)
+         myLen = (numSamples - from).as_size_t();
+      constexpr auto mayThrow = false; // Don't throw just for display
+      column.samples.emplace(clip.GetSampleView(from, myLen, mayThrow));
+      column.start = from + sequenceOffset;
+      column.length = myLen;
+   }
+   return columns;
+}
+
+void MakeKey(const Sequence &sequence, const std::string &prefix,
+   const std::vector<ColumnInput> &columns, Tile &tile)
+{
+   std::optional<sampleCount> start, end;
+   for (auto &column : columns)
+      if (column.samples) {
+         start = std::min(start.value_or(column.start), column.start);
+         end = std::max(end.value_or(0), column.start + column.length);
+      }
+   end = std::min(end.value_or(0), sequence.GetNumSamples());
+   if (!start || *start >= *end)
+      return;
+
+   auto &key = tile.key;
+   key = prefix;
+   for (auto &column : columns) {
+      AppendToKey(key, static_cast<char>(column.samples.has_value()));
+      if (column.samples) {
+         AppendToKey(key, (column.start - *start).as_long_long());
+         AppendToKey(key, static_cast<unsigned long long>(column.leftZeros));
+         AppendToKey(key, static_cast<unsigned long long>(column.length));
+      }
+   }
+
+   // The blocks from the one containing start, and the offset into it
+   const auto &blocks = sequence.GetBlockArray();
+   auto iter = std::upper_bound(blocks.begin(), blocks.end(), *start,
+      [](sampleCount position, const SeqBlock &block){
+         return position < block.start; });
+   if (iter == blocks.begin()) {
+      key.clear();
+      return;
+   }
+   --iter;
+   AppendToKey(key, (*start - iter->start).as_long_long());
+   for (; iter != blocks.end() && iter->start < *end; ++iter) {
+      const auto id = iter->sb->GetBlockID();
+      AppendToKey(key, id);
+      tile.blockIDs.push_back(id);
+   }
+}
+
+void ComputeTile(const Parameters &parameters,
+   const std::vector<ColumnInput> &columns, std::vector<float> &freq)
+{
+   const auto nBins = parameters.nBins;
+   const auto windowSize = parameters.windowSize;
+   std::vector<float> scratch(parameters.fftLen);
+   freq.resize(nBins * columns.size());
+   for (size_t xx = 0; xx < columns.size(); ++xx) {
+      const auto &column = columns[xx];
+      float *const results = &freq[nBins * xx];
+      if (!column.samples) {
+         // Pixel column is out of bounds of the clip
+         std::fill(results, results + nBins, 0.0f);
+         continue;
+      }
+
+      // Take the window centered at the column, padded with zeroes past the
+      // ends of the clip.  As in SpecCache::CalculateOneSpectrum, the window
+      // for the FFT has zeroes in the padding zones, so those need no
+      // initialization
+      float *const adj = scratch.data() + parameters.padding;
+      std::fill(adj, adj + column.leftZeros, 0.0f);
+      column.samples->Copy(adj + column.leftZeros, column.length);
+      std::fill(adj + column.leftZeros + column.length, adj + windowSize, 0.0f);
+
+      if (parameters.autocorrelation)
+         ComputeSpectrum(scratch.data(), windowSize, windowSize, results,
+            true, parameters.windowType);
+      else {
+         ComputeSpectrumUsingRealFFTf(scratch.data(), parameters.hFFT.get(),
+            parameters.window.get(), parameters.fftLen, results);
+         const auto &gainFactors = parameters.gainFactors;
+         if (!gainFactors.empty()) {
+            // Apply a frequency-dependent gain factor
+            for (size_t ii = 0; ii < nBins; ++ii)
+               results[ii] += gainFactors[ii];
+         }
+      }
+   }
+}
+
+void Enqueue(std::shared_ptr<Tile> pTile,
+   std::shared_ptr<const Parameters> pParameters,
+   std::vector<ColumnInput> columns)
+{
+   audacity::concurrency::ThreadPool::Shared().Enqueue(
+      [pTile = move(pTile), pParameters = move(pParameters),
+         columns = move(columns)]{
+         int expected = Tile::Queued;
+         if (!pTile->state.compare_exchange_strong(expected, Tile::Running))
+            return;
+         ComputeTile(*pParameters, columns, pTile->freq);
+         pTile->state.store(Tile::Ready, std::memory_order_release);
+         NotifyTilesReady();
+      });
+}
+}
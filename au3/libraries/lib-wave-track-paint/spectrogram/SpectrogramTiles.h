@@ -0,0 +1,140 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SpectrogramTiles.h
+
+**********************************************************************/
+#pragma once
+
+#include "AudioSegmentSampleView.h"
+#include "Observer.h"
+#include "RealFFTf.h"
+#include "SampleCount.h"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class Sequence;
+class WaveClipChannel;
+using WaveChannelInterval = WaveClipChannel;
+using SampleBlockID = long long;
+using Floats = ArrayOf<float>;
+
+//! Spectrogram columns computed in tiles, on the threads of the shared pool
+/*!
+ Columns are on a grid anchored at the clip start, so that tiles can be
+ reused while scrolling.  Samples are fetched on the main thread, where the
+ clip may change, and only the computation is left to the pool.  Everything
+ that depends on the settings, and the caching of tiles, is for the caller.
+ */
+namespace SpectrogramTiles {
+
+//! Columns in one tile, which is the unit of work of the pool
+constexpr long long TileWidth = 64;
+
+//! What the computation needs of the settings, which are listeners of
+//! preferences and stay on the main thread
+struct Parameters {
+   HFFT hFFT;
+   Floats window;
+   std::vector<float> gainFactors;
+   size_t windowSize{};
+   size_t fftLen{};
+   size_t padding{};
+   size_t nBins{};
+   int windowType{};
+   bool autocorrelation{};
+};
+
+//! Samples of the window centered at one column
+struct ColumnInput {
+   //! Sample position of the window start, in the sequence
+   sampleCount start;
+   //! Absent if the column is out of bounds of the clip
+   std::optional<AudioSegmentSampleView> samples;
+   //! Zeroes before the samples, near the start of the clip
+   size_t leftZeros{};
+   size_t length{};
+};
+
+struct Tile {
+   enum State : int { Queued, Running, Ready, Cancelled };
+   std::atomic<int> state{ Queued };
+   //! TileWidth columns of nBins values, written before state becomes Ready
+   std::vector<float> freq;
+
+   //! Used only on the main thread, to store the tile in the project:
+   //! a description of its input, and the blocks it was computed from
+   std::string key;
+   std::vector<SampleBlockID> blockIDs;
+
+   //! Keep a tile from starting; one already running is left to finish
+   bool Cancel()
+   {
+      int expected = Queued;
+      return state.compare_exchange_strong(expected, Cancelled);
+   }
+};
+
+//! Sent on the main thread when tiles computed in the pool are ready, so
+//! that views showing them can repaint
+struct Message {};
+
+WAVE_TRACK_PAINT_API Observer::Publisher<Message> &GetPublisher();
+
+//! Rounds toward negative infinity
+WAVE_TRACK_PAINT_API
+long long FloorDiv(long long numerator, long long denominator);
+
+//! @return the sample, relative to the play start, at which a column of the
+//! grid is centered
+WAVE_TRACK_PAINT_API
+sampleCount ColumnSample(long long column, double samplesPerPixel);
+
+template<typename T> void AppendToKey(std::string &key, T value)
+{
+   key.append(reinterpret_cast<const char *>(&value), sizeof value);
+}
+
+//! Append gain factors for the bins, making 1000 Hz 0 dB, if frequencyGain
+//! is positive
+WAVE_TRACK_PAINT_API void ComputeGainFactors(size_t fftLen, double rate,
+   int frequencyGain, std::vector<float> &gainFactors);
+
+//! Window the buffer and write the power of each bin in dB
+WAVE_TRACK_PAINT_API void ComputeSpectrumUsingRealFFTf(
+   float * __restrict buffer, const FFTParam *hFFT,
+   const float * __restrict window, size_t len, float * __restrict out);
+
+//! Fetch the samples of the columns of a tile, in the main thread
+/*!
+ The views keep their blocks of samples alive for the pool.
+ */
+WAVE_TRACK_PAINT_API std::vector<ColumnInput> FetchColumns(
+   const WaveChannelInterval &clip, long long index, double samplesPerPixel,
+   size_t windowSize);
+
+//! Describe the input of a tile in its key and block ids, to store the tile
+/*!
+ The key tells where the columns are, relative to the samples they need,
+ and which blocks hold those samples.  Blocks are immutable, so equal keys
+ mean equal results.  The key is left empty if the tile needs no samples.
+ */
+WAVE_TRACK_PAINT_API void MakeKey(const Sequence &sequence,
+   const std::string &prefix, const std::vector<ColumnInput> &columns,
+   Tile &tile);
+
+WAVE_TRACK_PAINT_API void ComputeTile(const Parameters &parameters,
+   const std::vector<ColumnInput> &columns, std::vector<float> &freq);
+
+//! Compute the tile in the shared pool, unless it is cancelled first, and
+//! publish a Message when it is ready
+WAVE_TRACK_PAINT_API void Enqueue(std::shared_ptr<Tile> pTile,
+   std::shared_ptr<const Parameters> pParameters,
+   std::vector<ColumnInput> columns);
+}
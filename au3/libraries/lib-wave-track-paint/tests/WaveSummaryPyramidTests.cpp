@@ -0,0 +1,180 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ WaveSummaryPyramidTests.cpp
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "WaveSummaryPyramid.h"
+
+namespace
+{
+std::vector<float> MakeSamples(size_t count)
+{
+   std::vector<float> samples(count);
+   for (size_t i = 0; i < count; ++i)
+      samples[i] = 0.7f * std::sin(i * 0.001) * std::sin(i * 0.37);
+   return samples;
+}
+
+//! (min, max, rms) of frames of the samples, as a sample block computes them
+std::vector<float>
+Summarize(const std::vector<float>& samples, size_t frameSize)
+{
+   std::vector<float> result;
+   for (size_t first = 0; first < samples.size(); first += frameSize)
+   {
+      const auto last = std::min(samples.size(), first + frameSize);
+      float min = samples[first], max = samples[first];
+      double squares = 0;
+      for (auto i = first; i < last; ++i)
+      {
+         min = std::min(min, samples[i]);
+         max = std::max(max, samples[i]);
+         squares += double(samples[i]) * samples[i];
+      }
+      result.insert(
+         result.end(), { min, max, float(std::sqrt(squares / (last - first))) });
+   }
+   return result;
+}
+
+struct Source final
+{
+   explicit Source(std::vector<float> samples_)
+       : samples { std::move(samples_) }
+   {
+   }
+
+   WaveSummaryPyramid::Source Get()
+   {
+      return [this](size_t frameSize, float* dest, size_t framesCount)
+      {
+         if (fail || (frameSize != 256 && frameSize != 64 * 1024))
+            return false;
+         (frameSize == 256 ? reads256 : reads64k)++;
+         const auto summary = Summarize(samples, frameSize);
+         REQUIRE(summary.size() == 3 * framesCount);
+         std::copy(summary.begin(), summary.end(), dest);
+         return true;
+      };
+   }
+
+   const std::vector<float> samples;
+   bool fail { false };
+   int reads256 { 0 };
+   int reads64k { 0 };
+};
+
+void RequireEnvelope(
+   const std::vector<float>& expected, const std::vector<float>& actual)
+{
+   REQUIRE(expected.size() == actual.size());
+   constexpr auto tolerance = 1e-3f;
+   for (size_t i = 0; i < expected.size(); i += 3)
+   {
+      // Never narrower, and only a little wider
+      REQUIRE(actual[i] <= expected[i]);
+      REQUIRE(actual[i] > expected[i] - tolerance);
+      REQUIRE(actual[i + 1] >= expected[i + 1]);
+      REQUIRE(actual[i + 1] < expected[i + 1] + tolerance);
+      REQUIRE(std::abs(actual[i + 2] - expected[i + 2]) < tolerance);
+   }
+}
+} // namespace
+
+TEST_CASE("WaveSummaryPyramid levels", "[WaveSummaryPyramid]")
+{
+   REQUIRE(WaveSummaryPyramid::FrameSize(4, 0) == 256);
+   REQUIRE(WaveSummaryPyramid::FrameSize(4, 3) == 16 * 1024);
+   REQUIRE(WaveSummaryPyramid::FrameSize(8, 2) == 16 * 1024);
+
+   REQUIRE(WaveSummaryPyramid::LevelFor(4, 100) == 0);
+   REQUIRE(WaveSummaryPyramid::LevelFor(4, 1023) == 0);
+   REQUIRE(WaveSummaryPyramid::LevelFor(4, 1024) == 1);
+   REQUIRE(WaveSummaryPyramid::LevelFor(4, 70000) == 4);
+   REQUIRE(WaveSummaryPyramid::LevelFor(2, 70000) == 8);
+
+   const WaveSummaryPyramid pyramid { 4, 300000 };
+   REQUIRE(pyramid.FramesCount(0) == 1172);
+   REQUIRE(pyramid.FramesCount(4) == 5);
+   REQUIRE(pyramid.FramesCount(5) == 2);
+   REQUIRE(pyramid.FramesCount(6) == 1);
+   // Coarser levels are the same as the first with a single frame
+   REQUIRE(pyramid.FramesCount(20) == 1);
+}
+
+TEST_CASE("WaveSummaryPyramid frames", "[WaveSummaryPyramid]")
+{
+   // A partial last frame at every level
+   const size_t samplesCount = 300000;
+
+   for (size_t factor : { 2, 3, 4, 16 })
+   {
+      Source source { MakeSamples(samplesCount) };
+      WaveSummaryPyramid pyramid { factor, samplesCount };
+
+      // Coarse to fine, then fine to coarse, exercising each way of making
+      // a level
+      std::vector<size_t> levels;
+      for (size_t level = 0;
+           WaveSummaryPyramid::FrameSize(factor, level) < 2 * samplesCount;
+           ++level)
+         levels.push_back(level);
+      auto order = levels;
+      order.insert(order.begin(), levels.rbegin(), levels.rend());
+
+      for (auto level : order)
+      {
+         std::vector<float> frames(3 * pyramid.FramesCount(level));
+         pyramid.Get(level, source.Get(), frames.data());
+         RequireEnvelope(
+            Summarize(
+               source.samples, WaveSummaryPyramid::FrameSize(factor, level)),
+            frames);
+      }
+
+      // Each stored summary read at most once
+      REQUIRE(source.reads256 == 1);
+      REQUIRE(source.reads64k <= 1);
+   }
+}
+
+TEST_CASE("WaveSummaryPyramid sources", "[WaveSummaryPyramid]")
+{
+   const size_t samplesCount = 256 * 1024;
+
+   SECTION("Coarse levels come from coarse stored summaries")
+   {
+      Source source { MakeSamples(samplesCount) };
+      WaveSummaryPyramid pyramid { 4, samplesCount };
+      std::vector<float> frames(3 * pyramid.FramesCount(5));
+      pyramid.Get(5, source.Get(), frames.data());
+      REQUIRE(source.reads64k == 1);
+      REQUIRE(source.reads256 == 0);
+   }
+
+   SECTION("Failed reads are not kept")
+   {
+      Source source { MakeSamples(samplesCount) };
+      source.fail = true;
+      WaveSummaryPyramid pyramid { 4, samplesCount };
+      std::vector<float> frames(3 * pyramid.FramesCount(1));
+      pyramid.Get(1, source.Get(), frames.data());
+      REQUIRE(pyramid.GetSpaceUsage() == WaveSummaryPyramid { 4, samplesCount }
+                                            .GetSpaceUsage());
+
+      source.fail = false;
+      pyramid.Get(1, source.Get(), frames.data());
+      REQUIRE(source.reads256 == 1);
+      RequireEnvelope(Summarize(source.samples, 1024), frames);
+   }
+}
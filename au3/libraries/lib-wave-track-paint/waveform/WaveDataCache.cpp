@@ -15,11 +15,15 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <map>
+#include <memory>
 
 #include "SampleBlock.h"
 #include "SampleFormat.h"
 #include "Sequence.h"
+#include "SummaryKernels.h"
 #include "WaveClip.h"
+#include "WaveSummaryPyramid.h"
 
 #include "RoundUpUnsafe.h"
 
@@ -38,17 +42,18 @@ public:
    {
       if (
          mFirstClipSampleID != clip.GetSequence(0)->GetNumSamples() ||
-         mSampleType != outBlock.DataType)
+         mSampleType != outBlock.DataType || mFrameSize != outBlock.FrameSize)
       {
          mFirstClipSampleID   = clip.GetSequence(0)->GetNumSamples();
          mLastProcessedSample = 0;
          mSampleType          = outBlock.DataType;
+         mFrameSize           = outBlock.FrameSize;
 
          if (mSampleType != WaveCacheSampleBlock::Type::Samples)
          {
             mCachedData.clear();
-            mCachedData.resize(
-               RoundUpUnsafe(clip.GetSequence(0)->GetMaxBlockSize(), 256));
+            mCachedData.resize(RoundUpUnsafe(
+               clip.GetSequence(0)->GetMaxBlockSize(), mFrameSize));
          }
       }
 
@@ -68,13 +73,8 @@ public:
          std::copy(appendBuffer, appendBuffer + appendedSamples, outBuffer);
       }
       break;
-      case WaveCacheSampleBlock::Type::MinMaxRMS256:
-         FillBlocksFromAppendBuffer<256>(
-            appendBuffer, appendedSamples, outBlock);
-         break;
-      case WaveCacheSampleBlock::Type::MinMaxRMS64k:
-         FillBlocksFromAppendBuffer<64 * 1024>(
-            appendBuffer, appendedSamples, outBlock);
+      case WaveCacheSampleBlock::Type::MinMaxRMS:
+         FillBlocksFromAppendBuffer(appendBuffer, appendedSamples, outBlock);
          break;
       default:
          return false;
@@ -121,11 +121,13 @@ private:
       return mConvertedAppendBufferData.data();
    }
 
-   template<size_t blockSize>
    void FillBlocksFromAppendBuffer(
       const float* bufferSamples, size_t samplesCount,
       WaveCacheSampleBlock& outBlock)
    {
+      const size_t blockSize = mFrameSize;
+      // Only the last frame, which may have grown, and the new ones need
+      // computing
       const size_t startingBlock = mLastProcessedSample / blockSize;
       const size_t blocksCount   = RoundUpUnsafe(samplesCount, blockSize);
 
@@ -135,29 +137,13 @@ private:
          const size_t samplesInBlock =
             std::min(blockSize, samplesCount - blockIndex * blockSize);
 
-         float min = std::numeric_limits<float>::infinity();
-         float max = -std::numeric_limits<float>::infinity();
-
-         double sqSum = 0.0;
-
-         auto samples = bufferSamples + blockIndex * blockSize;
-
-         for (size_t sampleIndex = 0; sampleIndex < samplesInBlock;
-              ++sampleIndex)
-         {
-            const float sample = *samples++;
-
-            min = std::min(min, sample);
-            max = std::max(max, sample);
+         const auto stats = ComputeMinMaxSumSq(
+            bufferSamples + blockIndex * blockSize, samplesInBlock);
 
-            const double dbl = sample;
-
-            sqSum += dbl * dbl;
-         }
+         const auto rms =
+            static_cast<float>(std::sqrt(stats.sumsq / samplesInBlock));
 
-         const auto rms = static_cast<float>(std::sqrt(sqSum / samplesInBlock));
-
-         mCachedData[blockIndex] = { min, max, rms };
+         mCachedData[blockIndex] = { stats.min, stats.max, rms };
       }
 
       mLastProcessedSample = samplesCount;
@@ -170,6 +156,7 @@ private:
    WaveCacheSampleBlock::Type mSampleType {
       WaveCacheSampleBlock::Type::Samples
    };
+   size_t mFrameSize { 1 };
    sampleCount mFirstClipSampleID { 0 };
 
    struct CacheItem final
@@ -184,13 +171,121 @@ private:
    size_t mLastProcessedSample { 0 };
 };
 
-WaveDataCache::DataProvider
-MakeDefaultDataProvider(const WaveClip& clip, int channelIndex)
+//! Summary pyramids of the recently used blocks of a sequence
+class SummaryPyramids final
+{
+public:
+   explicit SummaryPyramids(size_t factor)
+       : mFactor { factor }
+   {
+   }
+
+   void Fill(
+      const std::shared_ptr<SampleBlock>& block, size_t frameSize,
+      WaveCacheSampleBlock& outBlock)
+   {
+      auto iter = mPyramids.find(block);
+      if (iter == mPyramids.end())
+      {
+         MakeRoom();
+         iter = mPyramids
+                   .emplace(
+                      std::piecewise_construct, std::forward_as_tuple(block),
+                      std::forward_as_tuple(mFactor, block->GetSampleCount()))
+                   .first;
+         mBytes += iter->second.bytes;
+      }
+
+      auto& entry = iter->second;
+      entry.lastUse = ++mUseCount;
+
+      const auto level = WaveSummaryPyramid::LevelFor(mFactor, frameSize);
+      auto& pyramid = entry.pyramid;
+      float* ptr = outBlock.GetWritePointer(3 * pyramid.FramesCount(level));
+      pyramid.Get(
+         level,
+         [&block](size_t size, float* dest, size_t framesCount)
+         {
+            if (size == WaveSummaryPyramid::BaseFrameSize)
+               return block->GetSummary256(dest, 0, framesCount);
+            if (size == 64 * 1024)
+               return block->GetSummary64k(dest, 0, framesCount);
+            return false;
+         },
+         ptr);
+
+      mBytes -= entry.bytes;
+      entry.bytes = pyramid.GetSpaceUsage();
+      mBytes += entry.bytes;
+   }
+
+private:
+   //! Bound on the memory used, per channel of a clip
+   static constexpr size_t MaxBytes = 1024 * 1024;
+
+   struct Entry final
+   {
+      Entry(size_t factor, size_t samplesCount)
+          : pyramid { factor, samplesCount }
+          , bytes { pyramid.GetSpaceUsage() }
+      {
+      }
+
+      WaveSummaryPyramid pyramid;
+      size_t bytes;
+      uint64_t lastUse { 0 };
+   };
+
+   void MakeRoom()
+   {
+      if (mBytes < MaxBytes)
+         return;
+
+      // Blocks no longer in any sequence go first
+      for (auto iter = mPyramids.begin(); iter != mPyramids.end();)
+      {
+         if (iter->first.expired())
+         {
+            mBytes -= iter->second.bytes;
+            iter = mPyramids.erase(iter);
+         }
+         else
+            ++iter;
+      }
+
+      // Then the least recently used, until well under the bound, so that
+      // this scan is not repeated for each new block
+      while (mBytes > MaxBytes * 3 / 4 && !mPyramids.empty())
+      {
+         auto oldest = std::min_element(
+            mPyramids.begin(), mPyramids.end(),
+            [](const auto& a, const auto& b)
+            { return a.second.lastUse < b.second.lastUse; });
+         mBytes -= oldest->second.bytes;
+         mPyramids.erase(oldest);
+      }
+   }
+
+   const size_t mFactor;
+   // Weak, so that the cache does not keep blocks alive, and keyed by owner,
+   // so that a new block at the address of a destroyed one is not confused
+   // with it
+   std::map<
+      std::weak_ptr<SampleBlock>, Entry,
+      std::owner_less<std::weak_ptr<SampleBlock>>>
+      mPyramids;
+   size_t mBytes { 0 };
+   uint64_t mUseCount { 0 };
+};
+
+WaveDataCache::DataProvider MakeDefaultDataProvider(
+   const WaveClip& clip, int channelIndex, size_t pyramidFactor)
 {
    return [sequence = clip.GetSequence(channelIndex), clip = &clip,
-           channelIndex, appendBufferHelper = AppendBufferHelper()](
+           channelIndex, appendBufferHelper = AppendBufferHelper(),
+           pyramids = SummaryPyramids(pyramidFactor)](
              int64_t requiredSample, WaveCacheSampleBlock::Type dataType,
-             WaveCacheSampleBlock& outBlock) mutable
+             size_t frameSize, WaveCacheSampleBlock& outBlock) mutable
    {
       if (requiredSample < 0)
          return false;
@@ -204,6 +299,7 @@ MakeDefaultDataProvider(const WaveClip& clip, int channelIndex)
             return false;
 
          outBlock.DataType    = dataType;
+         outBlock.FrameSize   = frameSize;
          outBlock.FirstSample = sequenceSampleCount.as_long_long();
          outBlock.NumSamples  = clip->GetAppendBufferLen(channelIndex);
 
@@ -239,31 +335,15 @@ MakeDefaultDataProvider(const WaveClip& clip, int channelIndex)
             ptr, floatSample, 0, outBlock.NumSamples, false);
       }
       break;
-      case WaveCacheSampleBlock::Type::MinMaxRMS256:
-      {
-         size_t framesCount = RoundUpUnsafe(outBlock.NumSamples, 256);
-
-         float* ptr =
-            static_cast<float*>(outBlock.GetWritePointer(framesCount * 3));
-
-         inputBlock.sb->GetSummary256(ptr, 0, framesCount);
-      }
-      break;
-      case WaveCacheSampleBlock::Type::MinMaxRMS64k:
-      {
-         size_t framesCount = RoundUpUnsafe(outBlock.NumSamples, 64 * 1024);
-
-         float* ptr =
-            static_cast<float*>(outBlock.GetWritePointer(framesCount * 3));
-
-         inputBlock.sb->GetSummary64k(ptr, 0, framesCount);
-      }
-      break;
+      case WaveCacheSampleBlock::Type::MinMaxRMS:
+         pyramids.Fill(inputBlock.sb, frameSize, outBlock);
+         break;
       default:
          return false;
       }
 
-      outBlock.DataType = dataType;
+      outBlock.DataType  = dataType;
+      outBlock.FrameSize = frameSize;
 
       return true;
    };
@@ -271,11 +351,14 @@ MakeDefaultDataProvider(const WaveClip& clip, int channelIndex)
 
 } // namespace
 
-WaveDataCache::WaveDataCache(const WaveClip& waveClip, int channelIndex)
+WaveDataCache::WaveDataCache(
+   const WaveClip& waveClip, int channelIndex, size_t pyramidFactor)
     : GraphicsDataCache<WaveCacheElement>(
          waveClip.GetRate() / waveClip.GetStretchRatio(),
          [] { return std::make_unique<WaveCacheElement>(); })
-    , mProvider { MakeDefaultDataProvider(waveClip, channelIndex) }
+    , mProvider { MakeDefaultDataProvider(
+         waveClip, channelIndex, pyramidFactor) }
+    , mPyramidFactor { pyramidFactor }
     , mWaveClip { waveClip }
     , mStretchChangedSubscription {
        const_cast<WaveClip&>(waveClip)
@@ -305,13 +388,20 @@ bool WaveDataCache::InitializeElement(
       samplesPerColumn * WaveDataCache::CacheElementWidth;
    size_t processedSamples = 0;
 
+   // The coarsest summaries with frames no wider than a column
    const WaveCacheSampleBlock::Type blockType =
-      samplesPerColumn >= 64 * 1024 ?
-         WaveCacheSampleBlock::Type::MinMaxRMS64k :
-         (samplesPerColumn >= 256 ? WaveCacheSampleBlock::Type::MinMaxRMS256 :
-                                    WaveCacheSampleBlock::Type::Samples);
-
-   if (blockType != mCachedBlock.DataType)
+      samplesPerColumn >= WaveSummaryPyramid::BaseFrameSize ?
+         WaveCacheSampleBlock::Type::MinMaxRMS :
+         WaveCacheSampleBlock::Type::Samples;
+   const size_t frameSize =
+      blockType == WaveCacheSampleBlock::Type::Samples ?
+         1 :
+         WaveSummaryPyramid::FrameSize(
+            mPyramidFactor,
+            WaveSummaryPyramid::LevelFor(mPyramidFactor, samplesPerColumn));
+
+   if (blockType != mCachedBlock.DataType ||
+       frameSize != mCachedBlock.FrameSize)
       mCachedBlock.Reset();
 
    size_t columnIndex = 0;
@@ -326,7 +416,7 @@ bool WaveDataCache::InitializeElement(
       while (samplesLeft != 0)
       {
          if (!mCachedBlock.ContainsSample(firstSample))
-            if (!mProvider(firstSample, blockType, mCachedBlock))
+            if (!mProvider(firstSample, blockType, frameSize, mCachedBlock))
                break;
 
          summary = mCachedBlock.GetSummary(firstSample, samplesLeft, summary);
@@ -404,9 +494,8 @@ void WaveCacheSampleBlock::Reset() noexcept
 
 namespace
 {
-template<size_t blockSize>
 void processBlock(
-   const float* input, int64_t from, size_t count,
+   size_t blockSize, const float* input, int64_t from, size_t count,
    WaveCacheSampleBlock::Summary& summary)
 {
    input = input + 3 * (from / blockSize);
@@ -443,8 +532,6 @@ WaveCacheSampleBlock::Summary WaveCacheSampleBlock::GetSummary(
    samplesCount =
       std::min<size_t>(samplesCount, std::max<int64_t>(0, NumSamples - from));
 
-   const auto to = from + samplesCount;
-
    const float* data =
       static_cast<const float*>(static_cast<const void*>(mData.data()));
 
@@ -457,24 +544,21 @@ WaveCacheSampleBlock::Summary WaveCacheSampleBlock::GetSummary(
    case WaveCacheSampleBlock::Type::Samples:
       summary.SumItemsCount += samplesCount;
 
-      for (auto sampleIndex = from; sampleIndex < to; ++sampleIndex)
+      if (samplesCount > 0)
       {
-         const float sample = data[sampleIndex];
+         const auto stats = ComputeMinMaxSumSq(data + from, samplesCount);
 
-         summary.Min = std::min(summary.Min, sample);
-         summary.Max = std::max(summary.Max, sample);
+         summary.Min = std::min(summary.Min, stats.min);
+         summary.Max = std::max(summary.Max, stats.max);
 
-         summary.SquaresSum += double(sample) * double(sample);
+         summary.SquaresSum += stats.sumsq;
       }
 
       assert(summary.Min <= summary.Max);
 
       break;
-   case WaveCacheSampleBlock::Type::MinMaxRMS256:
-      processBlock<256>(data, from, samplesCount, summary);
-      break;
-   case WaveCacheSampleBlock::Type::MinMaxRMS64k:
-      processBlock<64 * 1024>(data, from, samplesCount, summary);
+   case WaveCacheSampleBlock::Type::MinMaxRMS:
+      processBlock(FrameSize, data, from, samplesCount, summary);
       break;
    default:
       break;
@@ -32,14 +32,9 @@ struct WAVE_TRACK_PAINT_API WaveCacheSampleBlock final
       Samples,
       /*!
        * Each element of the resulting array is a tuple (min, max, rms)
-       * calculated over 256 samples.
+       * calculated over FrameSize samples.
        */
-      MinMaxRMS256,
-      /*!
-       * Each element of the resulting array is a tuple (min, max, rms)
-       * calculated over 256 samples.
-       */
-      MinMaxRMS64k,
+      MinMaxRMS,
    };
 
    //! Summary calculated over the requested range
@@ -56,6 +51,8 @@ struct WAVE_TRACK_PAINT_API WaveCacheSampleBlock final
    };
 
    Type DataType { Type::Samples };
+   //! Samples in each (min, max, rms) tuple; 1 for Type::Samples
+   size_t FrameSize { 1 };
    int64_t FirstSample { 0 };
    size_t NumSamples { 0 };
 
@@ -93,15 +90,26 @@ class WAVE_TRACK_PAINT_API WaveDataCache final :
     public GraphicsDataCache<WaveCacheElement>
 {
 public:
-   using DataProvider = std::function<bool (int64_t requiredSample, WaveCacheSampleBlock::Type dataType, WaveCacheSampleBlock& block)>;
+   using DataProvider = std::function<bool (int64_t requiredSample, WaveCacheSampleBlock::Type dataType, size_t frameSize, WaveCacheSampleBlock& block)>;
+
+   //! Ratio of the frame sizes of consecutive levels of summaries
+   static constexpr size_t DefaultPyramidFactor = 4;
 
-   WaveDataCache(const WaveClip& waveClip, int channelIndex);
+   /*!
+    @param pyramidFactor columns are computed from summaries over frames of
+    256 samples times a power of this, the biggest not wider than a column
+    @pre `pyramidFactor >= 2`
+    */
+   WaveDataCache(
+      const WaveClip& waveClip, int channelIndex,
+      size_t pyramidFactor = DefaultPyramidFactor);
 
 private:
    bool InitializeElement(
       const GraphicsDataCacheKey& key, WaveCacheElement& element) override;
 
    DataProvider mProvider;
+   const size_t mPyramidFactor;
 
    WaveCacheSampleBlock mCachedBlock;
 
@@ -0,0 +1,228 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WaveSummaryPyramid.cpp
+
+**********************************************************************/
+#include "WaveSummaryPyramid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "RoundUpUnsafe.h"
+
+namespace
+{
+//! Frames of this size are stored with sample blocks too
+constexpr size_t StoredFrameSize = 64 * 1024;
+
+//! The peak maps to one unit less than the maximum, so that rounding the
+//! maximum up can't overflow
+constexpr float QuantizedPeak = std::numeric_limits<int16_t>::max() - 1;
+
+int16_t Quantize(double value)
+{
+   if (std::isnan(value))
+      return 0;
+   return static_cast<int16_t>(std::clamp<double>(
+      value, std::numeric_limits<int16_t>::min(),
+      std::numeric_limits<int16_t>::max()));
+}
+} // namespace
+
+WaveSummaryPyramid::WaveSummaryPyramid(size_t factor, size_t samplesCount)
+    : mFactor { factor }
+    , mSamplesCount { samplesCount }
+{
+   assert(factor >= 2);
+
+   size_t levelsCount = 1;
+   for (size_t frameSize = BaseFrameSize; frameSize < samplesCount &&
+                                          frameSize <= samplesCount / factor;
+        frameSize *= factor)
+      ++levelsCount;
+
+   // The first level with a single frame
+   if (RoundUpUnsafe(samplesCount, FrameSize(factor, levelsCount - 1)) > 1)
+      ++levelsCount;
+
+   mLevels.resize(levelsCount);
+}
+
+size_t WaveSummaryPyramid::FrameSize(size_t factor, size_t level) noexcept
+{
+   size_t frameSize = BaseFrameSize;
+   for (; level > 0; --level)
+      frameSize *= factor;
+   return frameSize;
+}
+
+size_t
+WaveSummaryPyramid::LevelFor(size_t factor, double samplesPerColumn) noexcept
+{
+   size_t level = 0;
+   for (double frameSize = BaseFrameSize * factor;
+        frameSize <= samplesPerColumn &&
+        frameSize <= std::numeric_limits<uint32_t>::max();
+        frameSize *= factor)
+      ++level;
+   return level;
+}
+
+size_t WaveSummaryPyramid::FramesCount(size_t level) const noexcept
+{
+   level = std::min(level, mLevels.size() - 1);
+   return RoundUpUnsafe(mSamplesCount, FrameSize(mFactor, level));
+}
+
+void WaveSummaryPyramid::Get(size_t level, const Source& source, float* dest)
+{
+   level = std::min(level, mLevels.size() - 1);
+
+   if (Make(level, source))
+      Decode(mLevels[level], dest);
+   else
+      std::fill(dest, dest + 3 * FramesCount(level), 0.0f);
+}
+
+size_t WaveSummaryPyramid::GetSpaceUsage() const noexcept
+{
+   size_t result = sizeof(*this) + mLevels.size() * sizeof(Level);
+   for (const auto& level : mLevels)
+      result += level.data.size() * sizeof(int16_t);
+   return result;
+}
+
+bool WaveSummaryPyramid::Make(size_t level, const Source& source)
+{
+   auto& stored = mLevels[level];
+   if (!stored.data.empty())
+      return true;
+
+   std::vector<float> frames(3 * FramesCount(level));
+   // Don't keep the zeroes of a failed read
+   if (!Compute(level, source, frames.data()))
+      return false;
+   Encode(frames.data(), FramesCount(level), stored);
+   return true;
+}
+
+bool WaveSummaryPyramid::Compute(
+   size_t level, const Source& source, float* dest)
+{
+   if (level == 0)
+      return source(BaseFrameSize, dest, FramesCount(0));
+
+   // Combine the frames of the nearest finer level that is made, or else
+   // of the finest
+   auto finer = level - 1;
+   while (finer > 0 && mLevels[finer].data.empty())
+      --finer;
+
+   // But coarse levels are much cheaper from the frames stored with the
+   // block
+   const auto frameSize = FrameSize(mFactor, level);
+   if (mLevels[finer].data.empty() && frameSize % StoredFrameSize == 0)
+   {
+      if (frameSize == StoredFrameSize &&
+          source(StoredFrameSize, dest, FramesCount(level)))
+         return true;
+
+      // Through the level of the stored size, if any, so that it is read
+      // only once
+      if (const auto storedLevel = LevelFor(mFactor, StoredFrameSize);
+          frameSize > StoredFrameSize &&
+          FrameSize(mFactor, storedLevel) == StoredFrameSize &&
+          Make(storedLevel, source))
+         finer = storedLevel;
+      else if (frameSize > StoredFrameSize)
+      {
+         std::vector<float> children(
+            3 * RoundUpUnsafe(mSamplesCount, StoredFrameSize));
+         if (source(StoredFrameSize, children.data(), children.size() / 3))
+         {
+            Derive(children.data(), StoredFrameSize, level, dest);
+            return true;
+         }
+      }
+   }
+
+   if (!Make(finer, source))
+      return false;
+
+   std::vector<float> children(3 * FramesCount(finer));
+   Decode(mLevels[finer], children.data());
+   Derive(children.data(), FrameSize(mFactor, finer), level, dest);
+   return true;
+}
+
+void WaveSummaryPyramid::Decode(const Level& level, float* dest) const
+{
+   std::transform(
+      level.data.begin(), level.data.end(), dest,
+      [scale = level.scale](int16_t value) { return value * scale; });
+}
+
+void WaveSummaryPyramid::Encode(
+   const float* frames, size_t framesCount, Level& level)
+{
+   float peak = 0;
+   for (size_t i = 0; i < 3 * framesCount; ++i)
+      if (std::isfinite(frames[i]))
+         peak = std::max(peak, std::abs(frames[i]));
+
+   level.scale = peak > 0 ? peak / QuantizedPeak : 1.0f;
+   level.data.resize(3 * framesCount);
+
+   const double scale = level.scale;
+   for (size_t i = 0; i < framesCount; ++i)
+   {
+      const auto frame = frames + 3 * i;
+      level.data[3 * i] = Quantize(std::floor(frame[0] / scale));
+      level.data[3 * i + 1] = Quantize(std::ceil(frame[1] / scale));
+      level.data[3 * i + 2] = Quantize(std::round(frame[2] / scale));
+   }
+}
+
+void WaveSummaryPyramid::Derive(
+   const float* children, size_t childFrameSize, size_t level,
+   float* dest) const
+{
+   const auto frameSize = FrameSize(mFactor, level);
+   assert(frameSize % childFrameSize == 0);
+
+   const auto ratio = frameSize / childFrameSize;
+   const auto childrenCount = RoundUpUnsafe(mSamplesCount, childFrameSize);
+   const auto framesCount = FramesCount(level);
+
+   for (size_t frame = 0; frame < framesCount; ++frame)
+   {
+      float min = std::numeric_limits<float>::infinity();
+      float max = -std::numeric_limits<float>::infinity();
+      double squaresSum = 0;
+      size_t samplesCount = 0;
+
+      const auto last = std::min(childrenCount, (frame + 1) * ratio);
+      for (auto child = frame * ratio; child < last; ++child)
+      {
+         // The last frame of the block may be partial
+         const auto childSamples =
+            std::min(childFrameSize, mSamplesCount - child * childFrameSize);
+         const auto input = children + 3 * child;
+
+         min = std::min(min, input[0]);
+         max = std::max(max, input[1]);
+         squaresSum += double(input[2]) * input[2] * childSamples;
+         samplesCount += childSamples;
+      }
+
+      dest[3 * frame] = min;
+      dest[3 * frame + 1] = max;
+      dest[3 * frame + 2] =
+         samplesCount > 0 ? std::sqrt(squaresSum / samplesCount) : 0.0f;
+   }
+}
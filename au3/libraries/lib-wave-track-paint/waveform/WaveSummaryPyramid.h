@@ -0,0 +1,91 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WaveSummaryPyramid.h
+
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//! Min, max and RMS of the samples of one block, at resolutions that differ
+//! by a constant factor from each level to the next
+/*!
+ Level 0 has frames of BaseFrameSize samples, and each next level has frames
+ Factor() times as big.  A level is made when first requested, from the
+ nearest finer level already made, or else from summaries stored with the
+ block, making the finer levels it needs on the way.  Levels coarser than
+ the first with a single frame are the same as that one.
+
+ Levels are kept quantized to 16 bits relative to their peak, rounding minima
+ down and maxima up, so that the envelope drawn is never narrower than that
+ of the samples.
+ */
+class WAVE_TRACK_PAINT_API WaveSummaryPyramid final
+{
+public:
+   //! Samples in a frame of level 0
+   static constexpr size_t BaseFrameSize = 256;
+
+   //! Writes (min, max, rms) of the first frames of the block
+   /*!
+    @param frameSize BaseFrameSize, or a bigger size that the block might
+    store
+    @return false if frames of that size are not available, or could not be
+    read
+    */
+   using Source =
+      std::function<bool(size_t frameSize, float* dest, size_t framesCount)>;
+
+   //! @pre `factor >= 2`
+   WaveSummaryPyramid(size_t factor, size_t samplesCount);
+
+   size_t Factor() const noexcept { return mFactor; }
+
+   //! Samples in a frame of the level
+   static size_t FrameSize(size_t factor, size_t level) noexcept;
+
+   //! The coarsest level whose frames are no bigger than samplesPerColumn,
+   //! or 0
+   static size_t LevelFor(size_t factor, double samplesPerColumn) noexcept;
+
+   //! Frames in the level; the last may be partial
+   size_t FramesCount(size_t level) const noexcept;
+
+   //! Write (min, max, rms) of all frames of the level, making it if needed
+   /*! @pre `dest` has room for `3 * FramesCount(level)` values */
+   void Get(size_t level, const Source& source, float* dest);
+
+   //! Bytes of memory used by the levels made so far
+   size_t GetSpaceUsage() const noexcept;
+
+private:
+   struct Level final
+   {
+      //! Value of a unit of the quantized data
+      float scale { 1 };
+      //! (min, max, rms) of each frame; empty if the level is not made
+      std::vector<int16_t> data;
+   };
+
+   //! Store the level if not already stored
+   /*! @return false if the source failed */
+   bool Make(size_t level, const Source& source);
+   //! Write the frames of the level into dest without storing them
+   /*! @return false if the source failed */
+   bool Compute(size_t level, const Source& source, float* dest);
+   void Decode(const Level& level, float* dest) const;
+   static void Encode(const float* frames, size_t framesCount, Level& level);
+   //! Combine frames of childFrameSize samples into those of the level
+   void Derive(const float* children, size_t childFrameSize, size_t level,
+      float* dest) const;
+
+   const size_t mFactor;
+   const size_t mSamplesCount;
+   std::vector<Level> mLevels;
+};
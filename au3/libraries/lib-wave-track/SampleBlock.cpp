@@ -23,6 +23,18 @@ SampleBlockFactoryPtr SampleBlockFactory::New( AudacityProject &project )
 
 SampleBlockFactory::~SampleBlockFactory() = default;
 
+void SampleBlockFactory::Flush()
+{
+}
+
+void SampleBlockFactory::BeginLoad()
+{
+}
+
+void SampleBlockFactory::EndLoad()
+{
+}
+
 SampleBlockPtr SampleBlockFactory::Create(constSamplePtr src,
    size_t numsamples,
    sampleFormat srcformat)
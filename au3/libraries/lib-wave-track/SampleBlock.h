@@ -146,6 +146,28 @@ public:
    /*! @return ids of all sample blocks created by this factory and still extant */
    virtual SampleBlockIDs GetActiveBlockIDs() = 0;
 
+   //! Make durable the storage of all blocks created so far
+   /*!
+    Implementations may defer the storage of new blocks so that it can be done
+    in batches, and may store them only in the thread that made the factory,
+    so that in other threads this waits for that thread to store them; the
+    default does nothing.
+    May throw.
+    */
+   virtual void Flush();
+
+   //! Blocks are about to be created from many ids, as when a project is
+   //! loaded
+   /*!
+    Implementations may then read what the blocks need all at once; the
+    default does nothing.  Each BeginLoad() must be matched by EndLoad().
+    */
+   virtual void BeginLoad();
+
+   //! Release what BeginLoad() read
+   /*! The default does nothing */
+   virtual void EndLoad();
+
 protected:
    // The override should throw more informative exceptions on error than the
    // default InconsistencyException thrown by Create
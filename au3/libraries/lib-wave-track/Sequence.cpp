@@ -1138,6 +1138,19 @@ AudioSegmentSampleView Sequence::GetFloatSampleView(
    return { std::move(blockViews), sequenceOffset, length };
 }
 
+void Sequence::VisitBlocks(sampleCount start, sampleCount end,
+   const std::function<void(const SeqBlock::SampleBlockPtr &)> &visitor) const
+{
+   start = std::max<sampleCount>(start, 0);
+   end = std::min(end, mNumSamples);
+   if (start >= end)
+      return;
+
+   const size_t numBlocks = mBlockCount.load(std::memory_order_relaxed);
+   for (size_t b = FindBlock(start); b < numBlocks && mBlock[b].start < end; ++b)
+      visitor(mBlock[b].sb);
+}
+
 bool Sequence::Get(samplePtr buffer, sampleFormat format,
    sampleCount start, size_t len, bool mayThrow) const
 {
@@ -1544,6 +1557,9 @@ void Sequence::Flush()
       // Change our effective format now that DoAppend didn't throw
       mSampleFormats.UpdateEffective(mAppendEffectiveFormat);
    }
+
+   // The factory may still hold blocks appended here or earlier
+   mpFactory->Flush();
 }
 
 void Sequence::Blockify(SampleBlockFactory &factory,
@@ -107,6 +107,10 @@ class WAVE_TRACK_API Sequence final : public XMLTagHandler{
    AudioSegmentSampleView
    GetFloatSampleView(sampleCount start, size_t len, bool mayThrow) const;
 
+   //! Visit the blocks that overlap samples [start, end)
+   void VisitBlocks(sampleCount start, sampleCount end,
+      const std::function<void(const SeqBlock::SampleBlockPtr &)> &visitor) const;
+
    //! Pass nullptr to set silence
    /*! Note that len is not size_t, because nullptr may be passed for buffer, in
       which case, silence is inserted, possibly a large amount. */
@@ -2346,6 +2346,39 @@ bool WaveTrack::GetSolo() const
    return PlayableTrack::GetSolo();
 }
 
+void WaveTrack::VisitPrefetchItems(
+   double t0, double t1, const PrefetchVisitor &visitor) const
+{
+   for (const auto &pClip : mClips) {
+      const auto clipStart = pClip->GetPlayStartTime();
+      const auto clipEnd = pClip->GetPlayEndTime();
+      if (clipEnd <= t0 || clipStart >= t1)
+         continue;
+
+      // Map play times to samples of the sequences as
+      // WaveClip::GetSampleView does:  a stretched clip consumes
+      // 1 / ratio sequence samples per play sample.  Round outward, so that
+      // blocks only partly in the interval are visited too.
+      const auto rate = pClip->GetRate() / pClip->GetStretchRatio();
+      const auto trim = pClip->TimeToSamples(pClip->GetTrimLeft());
+      const auto start = trim +
+         sampleCount(floor((std::max(t0, clipStart) - clipStart) * rate));
+      const auto end = trim +
+         sampleCount(ceil((std::min(t1, clipEnd) - clipStart) * rate));
+
+      for (size_t ii = 0, nChannels = pClip->NChannels(); ii < nChannels; ++ii)
+         pClip->GetSequence(ii)->VisitBlocks(start, end,
+            [&](const SampleBlockPtr &pBlock) {
+               // Silent blocks need no reading
+               if (const auto id = pBlock->GetBlockID(); id > 0)
+                  visitor({ id, [pBlock]{
+                     return std::shared_ptr<const void>{
+                        pBlock->GetFloatSampleView(false) };
+                  } });
+            });
+   }
+}
+
 const char *WaveTrack::WaveTrack_tag = "wavetrack";
 
 static constexpr auto Offset_attr = "offset";
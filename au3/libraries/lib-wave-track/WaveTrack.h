@@ -463,6 +463,8 @@ public:
    const ChannelGroup *FindChannelGroup() const override;
    bool GetMute() const override;
    bool GetSolo() const override;
+   void VisitPrefetchItems(
+      double t0, double t1, const PrefetchVisitor &visitor) const override;
    //! @}
 
    ///
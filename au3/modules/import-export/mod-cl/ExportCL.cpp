@@ -45,6 +45,7 @@
 
 #include "ExportOptionsEditor.h"
 #include "ExportOptionsUIServices.h"
+#include "ExportMixer.h"
 #include "ExportPluginHelpers.h"
 #include "ExportPluginRegistry.h"
 
@@ -425,7 +426,7 @@ class CLExportProcessor : public ExportProcessor
       unsigned channels;
       wxString cmd;
       bool showOutput;
-      std::unique_ptr<Mixer> mixer;
+      std::unique_ptr<ExportMixer> mixer;
       wxString output;
       std::unique_ptr<ExportCLProcess> process;
    } context;
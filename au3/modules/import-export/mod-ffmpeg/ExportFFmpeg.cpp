@@ -40,6 +40,7 @@ function.
 #include "SelectFile.h"
 #include "ShuttleGui.h"
 
+#include "ExportMixer.h"
 #include "ExportPluginHelpers.h"
 #include "PlainExportOptionsEditor.h"
 #include "FFmpegDefines.h"
@@ -608,7 +609,7 @@ public:
    /// Flushes audio encoder
    bool Finalize();
 
-   std::unique_ptr<Mixer> CreateMixer(
+   std::unique_ptr<ExportMixer> CreateMixer(
       const AudacityProject& project, bool selectionOnly, double startTime,
       double stopTime, MixerOptions::Downmix* mixerSpec);
 
@@ -668,7 +669,7 @@ class FFmpegExportProcessor final : public ExportProcessor
       TranslatableString status;
       double t0;
       double t1;
-      std::unique_ptr<Mixer> mixer;
+      std::unique_ptr<ExportMixer> mixer;
       std::unique_ptr<FFmpegExporter> exporter;
    } context;
 
@@ -725,7 +726,7 @@ FFmpegExporter::FFmpegExporter(std::shared_ptr<FFmpegFunctions> ffmpeg,
    }
 }
 
-std::unique_ptr<Mixer> FFmpegExporter::CreateMixer(
+std::unique_ptr<ExportMixer> FFmpegExporter::CreateMixer(
    const AudacityProject& project, bool selectionOnly, double startTime,
    double stopTime, MixerOptions::Downmix* mixerSpec)
 {
@@ -16,12 +16,16 @@ Joshua Haberman
 
 #include <rapidjson/document.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "Export.h"
 
 #include <wx/ffile.h>
 #include <wx/log.h>
 
 #include "FLAC++/encoder.h"
+#include "FLAC/export.h"
 
 #include "float_cast.h"
 #include "Mix.h"
@@ -32,6 +36,7 @@ Joshua Haberman
 
 #include "wxFileNameWrapper.h"
 
+#include "ExportMixer.h"
 #include "ExportPluginHelpers.h"
 #include "ExportPluginRegistry.h"
 #include "PlainExportOptionsEditor.h"
@@ -184,7 +189,7 @@ class FLACExportProcessor final : public ExportProcessor
       sampleFormat format;
       FLAC::Encoder::File encoder;
       wxFFile f;
-      std::unique_ptr<Mixer> mixer;
+      std::unique_ptr<ExportMixer> mixer;
    } context;
 
 public:
@@ -372,6 +377,14 @@ bool FLACExportProcessor::Initialize(AudacityProject& project,
    encoder.set_rice_parameter_search_dist(flacLevels[levelPref].rice_parameter_search_dist) &&
    encoder.set_max_lpc_order(flacLevels[levelPref].max_lpc_order);
 
+#if FLAC_API_VERSION_CURRENT >= 14
+   // libFLAC 1.5 can encode frames in parallel.  The output does not depend
+   // on the number of threads; if refused, encoding is single threaded.
+   if (success)
+      encoder.set_num_threads(
+         std::clamp(std::thread::hardware_concurrency(), 1u, 64u));
+#endif
+
    if (!success) {
       // TODO: more precise message
       throw ExportErrorException("FLAC:336");
@@ -28,6 +28,7 @@
 #include "Import.h"
 #include "ImportPlugin.h"
 #include "ImportProgressListener.h"
+#include "ImportStream.h"
 
 #include "Tags.h"
 
@@ -43,6 +44,9 @@ static const auto exts = {
 #include <wx/file.h>
 #include <wx/ffile.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "FLAC++/decoder.h"
 
 #include "WaveTrack.h"
@@ -63,6 +67,7 @@ extern "C" {
 
 
 class FLACImportFileHandle;
+class FLACImportStream;
 
 class MyFLACFile final : public FLAC::Decoder::File
 {
@@ -81,6 +86,8 @@ class MyFLACFile final : public FLAC::Decoder::File
    }
 
    ImportProgressListener *mImportProgressListener {nullptr};
+   //! When not null, decoded frames go here instead of to a track
+   FLACImportStream *mpStream {nullptr};
 
  private:
    friend class FLACImportFileHandle;
@@ -139,6 +146,8 @@ public:
    void SetStreamUsage(wxInt32 WXUNUSED(StreamID), bool WXUNUSED(Use)) override
    {}
 
+   std::unique_ptr<ImportStream> OpenStream() override;
+
 private:
    sampleFormat          mFormat;
    std::unique_ptr<MyFLACFile> mFile;
@@ -153,6 +162,90 @@ private:
 };
 
 
+#ifndef LEGACY_FLAC
+//! Decodes one frame at a time, as the reader needs more
+class FLACImportStream final : public ImportStream
+{
+public:
+   FLACImportStream(std::unique_ptr<MyFLACFile> pFile,
+      unsigned long numChannels, unsigned long sampleRate,
+      FLAC__uint64 numSamples)
+      : mpFile{ std::move(pFile) }
+      , mNumChannels{ numChannels }
+      , mSampleRate{ sampleRate }
+      , mNumSamples{ numSamples }
+      , mPending(numChannels)
+   {
+      mpFile->mpStream = this;
+   }
+
+   ~FLACImportStream() override
+   {
+      mpFile->mpStream = nullptr;
+      mpFile->finish();
+   }
+
+   double GetRate() const override { return mSampleRate; }
+   size_t NChannels() const override { return mNumChannels; }
+   sampleCount GetLength() const override
+   {
+      return static_cast<long long>(mNumSamples);
+   }
+
+   size_t Read(float *const *buffers, size_t len) override
+   {
+      size_t done = 0;
+      while (done < len) {
+         const auto available = mPending[0].size() - mPendingPos;
+         if (available == 0) {
+            mPendingPos = 0;
+            for (auto &pending : mPending)
+               pending.clear();
+            if (mpFile->get_state() == FLAC__STREAM_DECODER_END_OF_STREAM ||
+                !mpFile->process_single())
+               break;
+            continue;
+         }
+         const auto count = std::min(len - done, available);
+         for (size_t c = 0; c < mNumChannels; ++c)
+            std::copy_n(mPending[c].data() + mPendingPos, count,
+               buffers[c] + done);
+         mPendingPos += count;
+         done += count;
+      }
+      return done;
+   }
+
+   //! Called back by the decoder, within process_single()
+   void OnFrame(const FLAC__Frame *frame, const FLAC__int32 * const buffer[])
+   {
+      const auto blocksize = frame->header.blocksize;
+      const auto nChannels =
+         std::min<size_t>(mNumChannels, frame->header.channels);
+      const float scale = 1.0f / (1u << (frame->header.bits_per_sample - 1));
+      for (size_t c = 0; c < mNumChannels; ++c) {
+         auto &pending = mPending[c];
+         pending.resize(blocksize);
+         if (c < nChannels)
+            for (unsigned s = 0; s < blocksize; ++s)
+               pending[s] = buffer[c][s] * scale;
+         else
+            std::fill(pending.begin(), pending.end(), 0.0f);
+      }
+   }
+
+private:
+   const std::unique_ptr<MyFLACFile> mpFile;
+   const unsigned long mNumChannels;
+   const unsigned long mSampleRate;
+   const FLAC__uint64 mNumSamples;
+
+   //! Samples of the last decoded frame, per channel
+   std::vector<std::vector<float>> mPending;
+   size_t mPendingPos { 0 };
+};
+#endif
+
 void MyFLACFile::metadata_callback(const FLAC__StreamMetadata *metadata)
 {
    switch (metadata->type)
@@ -221,6 +314,10 @@ FLAC__StreamDecoderWriteStatus MyFLACFile::write_callback(const FLAC__Frame *fra
 {
    // Don't let C++ exceptions propagate through libflac
    return GuardedCall< FLAC__StreamDecoderWriteStatus > ( [&] {
+      if (mpStream) {
+         mpStream->OnFrame(frame, buffer);
+         return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+      }
       auto tmp = ArrayOf< short >{ frame->header.blocksize };
 
       unsigned chn = 0;
@@ -465,7 +562,21 @@ void FLACImportFileHandle::Import(
                                    : ImportProgressListener::ImportResult::Success);
 }
 
+std::unique_ptr<ImportStream> FLACImportFileHandle::OpenStream()
+{
+#ifdef LEGACY_FLAC
+   return nullptr;
+#else
+   // The length must be known in advance
+   if (!mStreamInfoDone || mNumSamples == 0 || mNumChannels < 1)
+      return nullptr;
+   return std::make_unique<FLACImportStream>(
+      std::move(mFile), mNumChannels, mSampleRate, mNumSamples);
+#endif
+}
+
 FLACImportFileHandle::~FLACImportFileHandle()
 {
-   mFile->finish();
+   if (mFile)
+      mFile->finish();
 }
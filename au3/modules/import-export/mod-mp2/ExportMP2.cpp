@@ -44,6 +44,7 @@
 #include "Tags.h"
 #include "Track.h"
 
+#include "ExportMixer.h"
 #include "ExportPluginHelpers.h"
 #include "PlainExportOptionsEditor.h"
 
@@ -252,7 +253,7 @@ class MP2ExportProcessor final : public ExportProcessor
       double t0;
       double t1;
       wxFileNameWrapper fName;
-      std::unique_ptr<Mixer> mixer;
+      std::unique_ptr<ExportMixer> mixer;
       ArrayOf<char> id3buffer;
       int id3len;
       twolame_options* encodeOptions{};
@@ -96,6 +96,7 @@
 #endif
 
 #include "ExportOptionsEditor.h"
+#include "ExportMixer.h"
 #include "ExportPluginHelpers.h"
 #include "ExportPluginRegistry.h"
 #include "SelectFile.h"
@@ -1601,7 +1602,7 @@ class MP3ExportProcessor final : public ExportProcessor
       wxFileOffset infoTagPos;
       size_t bufferSize;
       int inSamples;
-      std::unique_ptr<Mixer> mixer;
+      std::unique_ptr<ExportMixer> mixer;
    } context;
 
 public:
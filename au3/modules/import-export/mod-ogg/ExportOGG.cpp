@@ -19,6 +19,7 @@
 #include <vorbis/vorbisenc.h>
 
 #include "wxFileNameWrapper.h"
+#include "ExportMixer.h"
 #include "ExportPluginHelpers.h"
 #include "ExportPluginRegistry.h"
 #include "FileIO.h"
@@ -107,7 +108,7 @@ class OGGExportProcessor final : public ExportProcessor
       double t0;
       double t1;
       unsigned numChannels;
-      std::unique_ptr<Mixer> mixer;
+      std::unique_ptr<ExportMixer> mixer;
       std::unique_ptr<FileIO> outFile;
       wxFileNameWrapper fName;
 
@@ -27,6 +27,7 @@
 #include "Track.h"
 #include "Tags.h"
 
+#include "ExportMixer.h"
 #include "ExportPluginHelpers.h"
 #include "ExportOptionsEditor.h"
 #include "ExportPluginRegistry.h"
@@ -346,7 +347,7 @@ class OpusExportProcessor final : public ExportProcessor
       unsigned numChannels {};
       wxFileNameWrapper fName;
       wxFile outFile;
-      std::unique_ptr<Mixer> mixer;
+      std::unique_ptr<ExportMixer> mixer;
       std::unique_ptr<Tags> metadata;
 
       // Encoder properties
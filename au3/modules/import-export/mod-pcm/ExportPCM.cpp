@@ -27,6 +27,7 @@
 #include "Export.h"
 #include "ExportOptionsEditor.h"
 
+#include "ExportMixer.h"
 #include "ExportPluginHelpers.h"
 #include "ExportPluginRegistry.h"
 
@@ -384,7 +385,7 @@ class PCMExportProcessor final : public ExportProcessor
       int subformat;
       double t0;
       double t1;
-      std::unique_ptr<Mixer> mixer;
+      std::unique_ptr<ExportMixer> mixer;
       TranslatableString status;
       SF_INFO info;
       sampleFormat format;
@@ -37,10 +37,12 @@
 #include "GetAcidizerTags.h"
 #include "ImportPlugin.h"
 #include "ImportProgressListener.h"
+#include "ImportStream.h"
 #include "ImportUtils.h"
 #include "WaveTrack.h"
 
 #include <algorithm>
+#include <vector>
 
 #ifdef USE_LIBID3TAG
    #include <id3tag.h>
@@ -97,6 +99,8 @@ public:
    void SetStreamUsage(wxInt32 WXUNUSED(StreamID), bool WXUNUSED(Use)) override
    {}
 
+   std::unique_ptr<ImportStream> OpenStream() override;
+
 private:
    SFFile                mFile;
    const SF_INFO         mInfo;
@@ -104,6 +108,49 @@ private:
    sampleFormat          mFormat;
 };
 
+//! Reads floats from libsndfile, which normalizes integer formats
+class PCMImportStream final : public ImportStream
+{
+public:
+   PCMImportStream(SFFile &&file, const SF_INFO &info)
+      : mFile(std::move(file))
+      , mInfo(info)
+      , mInterleaved(ChunkFrames * info.channels)
+   {
+   }
+
+   double GetRate() const override { return mInfo.samplerate; }
+   size_t NChannels() const override { return mInfo.channels; }
+   sampleCount GetLength() const override { return mInfo.frames; }
+
+   size_t Read(float *const *buffers, size_t len) override
+   {
+      const auto nChannels = NChannels();
+      size_t done = 0;
+      while (done < len) {
+         const sf_count_t block = std::min(len - done, ChunkFrames);
+         const auto read = SFCall<sf_count_t>(
+            sf_readf_float, mFile.get(), mInterleaved.data(), block);
+         if (read <= 0)
+            break;
+         for (size_t c = 0; c < nChannels; ++c) {
+            auto dst = buffers[c] + done;
+            for (sf_count_t j = 0; j < read; ++j)
+               dst[j] = mInterleaved[nChannels * j + c];
+         }
+         done += read;
+      }
+      return done;
+   }
+
+private:
+   static constexpr size_t ChunkFrames = 4096;
+
+   SFFile                mFile;
+   const SF_INFO         mInfo;
+   std::vector<float>    mInterleaved;
+};
+
 TranslatableString PCMImportPlugin::GetPluginFormatDescription()
 {
     return DESC;
@@ -278,6 +325,14 @@ struct id3_tag_deleter {
 using id3_tag_holder = std::unique_ptr<id3_tag, id3_tag_deleter>;
 #endif
 
+std::unique_ptr<ImportStream> PCMImportFileHandle::OpenStream()
+{
+   wxASSERT(mFile.get());
+   if (mInfo.channels < 1)
+      return nullptr;
+   return std::make_unique<PCMImportStream>(std::move(mFile), mInfo);
+}
+
 void PCMImportFileHandle::Import(
    ImportProgressListener& progressListener, WaveTrackFactory* trackFactory,
    TrackHolders& outTracks, Tags* tags,
@@ -25,6 +25,7 @@
 #include "Track.h"
 #include "Tags.h"
 
+#include "ExportMixer.h"
 #include "ExportPluginHelpers.h"
 #include "ExportOptionsEditor.h"
 #include "ExportPluginRegistry.h"
@@ -256,7 +257,7 @@ class WavPackExportProcessor final : public ExportProcessor
       sampleFormat format;
       WriteId outWvFile, outWvcFile;
       WavpackContext *wpc{};
-      std::unique_ptr<Mixer> mixer;
+      std::unique_ptr<ExportMixer> mixer;
       std::unique_ptr<Tags> metadata;
    } context;
 public:
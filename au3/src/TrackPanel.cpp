@@ -84,6 +84,7 @@ is time to refresh some aspect of the screen.
 #include "WaveTrack.h"
 
 #include "FrameStatistics.h"
+#include "spectrogram/SpectrogramTiles.h"
 
 #include "tracks/ui/TrackControls.h"
 #include "tracks/ui/ChannelView.h"
@@ -343,6 +344,9 @@ TrackPanel::TrackPanel(wxWindow * parent, wxWindowID id,
       ProjectTimeRuler::Get(*theProject).GetRuler().Subscribe([this](auto mode) { Refresh(); });
    mSelectionSubscription = viewInfo->selectedRegion
       .Subscribe([this](auto&){ Refresh(false); });
+   // Show spectrogram columns as they are computed in the background
+   mSpectrogramTilesSubscription = SpectrogramTiles::GetPublisher()
+      .Subscribe([this](auto&){ Refresh(false); });
 
    UpdatePrefs();
 }
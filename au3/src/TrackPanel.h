@@ -186,6 +186,7 @@ protected:
       , mSyncLockSubscription
       , mProjectRulerInvalidatedSubscription
       , mSelectionSubscription
+      , mSpectrogramTilesSubscription
    ;
 
    std::shared_ptr<TrackList> mTracks;
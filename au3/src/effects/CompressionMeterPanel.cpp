@@ -185,7 +185,7 @@ void CompressionMeterPanel::OnTimer(wxTimerEvent& evt)
    MeterValues values;
    auto lowestCompressionGain = 0.f;
    auto highestOutputGain = std::numeric_limits<float>::lowest();
-   while (mMeterValuesQueue->Get(values))
+   while (mMeterValuesQueue->TryPop(values))
    {
       lowestCompressionGain =
          std::min(values.compressionGainDb, lowestCompressionGain);
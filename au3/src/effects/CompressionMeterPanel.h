@@ -12,7 +12,7 @@
 
 #include "DynamicRangeProcessorPanelCommon.h"
 #include "DynamicRangeProcessorTypes.h"
-#include "LockFreeQueue.h"
+#include "SPSCQueue.h"
 #include "MeterValueProvider.h"
 #include "Observer.h"
 #include "wxPanelWrapper.h"
@@ -502,7 +502,7 @@ void DynamicRangeProcessorHistoryPanel::OnTimer(wxTimerEvent& evt)
 {
    mPacketBuffer.clear();
    DynamicRangeProcessorOutputPacket packet;
-   while (mOutputQueue->Get(packet))
+   while (mOutputQueue->TryPop(packet))
       mPacketBuffer.push_back(packet);
    mHistory->Push(mPacketBuffer);
 
@@ -10,6 +10,8 @@
 
 #include "SpectrumCache.h"
 
+#include "DerivedDataCache.h"
+#include "Prefs.h"
 #include "SpectrogramSettings.h"
 #include "RealFFTf.h"
 #include "Sequence.h"
@@ -17,60 +19,243 @@
 #include "WaveClipUIUtilities.h"
 #include "WaveTrack.h"
 #include "WideSampleSequence.h"
+#include "spectrogram/SpectrogramTiles.h"
+#include <algorithm>
 #include <cmath>
+#include <list>
+#include <map>
+
+using namespace SpectrogramTiles;
 
 namespace {
+// Compute the columns of the spectrogram in the shared pool, except for
+// reassignment, whose columns are not independent
+BoolSetting SpectrogramInBackground{ L"/Spectrum/ComputeInBackground", true };
+
+// Tiles requested on each side of those in view, to be ready for scrolling
+constexpr long long PrefetchTiles = 1;
+// Zoom levels (or settings) whose tiles are kept for each channel
+constexpr size_t MaxTileSets = 4;
+// Memory for the tiles of one channel, beyond which tiles are discarded
+constexpr size_t MaxTileBytes = 64 << 20;
+}
 
-static void ComputeSpectrumUsingRealFFTf
-   (float * __restrict buffer, const FFTParam *hFFT,
-    const float * __restrict window, size_t len, float * __restrict out)
-{
-   size_t i;
-   if(len > hFFT->Points * 2)
-      len = hFFT->Points * 2;
-   for(i = 0; i < len; i++)
-      buffer[i] *= window[i];
-   for( ; i < (hFFT->Points * 2); i++)
-      buffer[i] = 0; // zero pad as needed
-   RealFFTf(buffer, hFFT);
-   // Handle the (real-only) DC
-   float power = buffer[0] * buffer[0];
-   if(power <= 0)
-      out[0] = -160.0;
-   else
-      out[0] = 10.0 * log10f(power);
-   for(i = 1; i < hFFT->Points; i++) {
-      const int index = hFFT->BitReversed[i];
-      const float re = buffer[index], im = buffer[index + 1];
-      power = re * re + im * im;
-      if(power <= 0)
-         out[i] = -160.0;
-      else
-         out[i] = 10.0*log10f(power);
+//! Tiles of spectrogram columns of one channel of a clip, computed in the
+//! shared pool and kept for a few zoom levels; used only on the main thread
+class SpectrogramTileCache {
+public:
+   //! Tiles for one version of the clip, zoom level, and settings
+   struct TileSet {
+      bool Matches(int dirty_, double samplesPerPixel, double leftTrim_,
+         double rightTrim_, const SpectrogramSettings &settings,
+         sampleCount numSamples) const
+      {
+         // Columns far into the clip must not drift by as much as a sample
+         const bool sppMatch =
+            fabs(samplesPerPixel - spp) * numSamples.as_double() / spp < 1.0;
+         return sppMatch &&
+            dirty == dirty_ &&
+            leftTrim == leftTrim_ &&
+            rightTrim == rightTrim_ &&
+            algorithm == settings.algorithm &&
+            windowType == settings.windowType &&
+            windowSize == settings.WindowSize() &&
+            zeroPaddingFactor == settings.ZeroPaddingFactor() &&
+            frequencyGain == settings.frequencyGain;
+      }
+
+      const Tile *GetReady(long long index) const
+      {
+         const auto iter = tiles.find(index);
+         if (iter != tiles.end() &&
+             iter->second->state.load(std::memory_order_acquire) ==
+                Tile::Ready)
+            return iter->second.get();
+         return nullptr;
+      }
+
+      void CancelAll()
+      {
+         for (auto &[index, pTile] : tiles)
+            pTile->Cancel();
+      }
+
+      size_t Bytes() const
+      {
+         return tiles.size() * TileWidth * pParameters->nBins * sizeof(float);
+      }
+
+      int dirty;
+      double spp;
+      double leftTrim;
+      double rightTrim;
+      int algorithm;
+      int windowType;
+      size_t windowSize;
+      size_t zeroPaddingFactor;
+      int frequencyGain;
+      std::shared_ptr<const Parameters> pParameters;
+      // Start of the keys of stored tiles, describing the settings
+      std::string keyPrefix;
+      std::map<long long, std::shared_ptr<Tile>> tiles;
+   };
+
+   ~SpectrogramTileCache()
+   {
+      for (auto &set : mSets)
+         set.CancelAll();
    }
-}
 
-void ComputeSpectrogramGainFactors
-   (size_t fftLen, double rate, int frequencyGain, std::vector<float> &gainFactors)
-{
-   if (frequencyGain > 0) {
-      // Compute a frequency-dependent gain factor
-      // scaled such that 1000 Hz gets a gain of 0dB
-
-      // This is the reciprocal of the bin number of 1000 Hz:
-      const double factor = ((double)rate / (double)fftLen) / 1000.0;
-
-      auto half = fftLen / 2;
-      gainFactors.reserve(half);
-      // Don't take logarithm of zero!  Let bin 0 replicate the gain factor for bin 1.
-      gainFactors.push_back(frequencyGain*log10(factor));
-      for (decltype(half) x = 1; x < half; x++) {
-         gainFactors.push_back(frequencyGain*log10(factor * x));
+   //! Find or make the set, and make it the most recently used
+   TileSet &GetSet(const WaveChannelInterval &clip, int dirty,
+      double samplesPerPixel, const SpectrogramSettings &settings)
+   {
+      // Tiles of older versions of the clip are useless
+      mSets.remove_if([&](TileSet &set){
+         if (set.dirty == dirty)
+            return false;
+         set.CancelAll();
+         return true;
+      });
+
+      const auto leftTrim = clip.GetTrimLeft();
+      const auto rightTrim = clip.GetTrimRight();
+      const auto numSamples = clip.GetSequence().GetNumSamples();
+      const auto iter = std::find_if(mSets.begin(), mSets.end(),
+         [&](const TileSet &set){ return set.Matches(dirty, samplesPerPixel,
+            leftTrim, rightTrim, settings, numSamples); });
+      if (iter != mSets.end()) {
+         mSets.splice(mSets.begin(), mSets, iter);
+         return mSets.front();
       }
+
+      // Cache the windows in a copy, and take them from it
+      auto copy = settings;
+      copy.CacheWindows();
+      auto pParameters = std::make_shared<Parameters>();
+      pParameters->windowSize = copy.WindowSize();
+      pParameters->fftLen = copy.WindowSize() * copy.ZeroPaddingFactor();
+      pParameters->padding =
+         (copy.WindowSize() * (copy.ZeroPaddingFactor() - 1)) / 2;
+      pParameters->nBins = copy.NBins();
+      pParameters->windowType = copy.windowType;
+      pParameters->autocorrelation =
+         copy.algorithm == SpectrogramSettings::algPitchEAC;
+      if (!pParameters->autocorrelation)
+         ComputeGainFactors(pParameters->fftLen, clip.GetRate(),
+            copy.frequencyGain, pParameters->gainFactors);
+      pParameters->hFFT = std::move(copy.hFFT);
+      pParameters->window = std::move(copy.window);
+
+      // Identify what the computation depends on, besides the samples
+      std::string keyPrefix = "spectrogram1";
+      AppendToKey(keyPrefix, settings.algorithm);
+      AppendToKey(keyPrefix, settings.windowType);
+      AppendToKey(keyPrefix, settings.WindowSize());
+      AppendToKey(keyPrefix, settings.ZeroPaddingFactor());
+      AppendToKey(keyPrefix, settings.frequencyGain);
+      AppendToKey(keyPrefix, clip.GetRate());
+
+      mSets.push_front({ dirty, samplesPerPixel, leftTrim, rightTrim,
+         settings.algorithm, settings.windowType, settings.WindowSize(),
+         settings.ZeroPaddingFactor(), settings.frequencyGain,
+         std::move(pParameters), std::move(keyPrefix), {} });
+      if (mSets.size() > MaxTileSets) {
+         mSets.back().CancelAll();
+         mSets.pop_back();
+      }
+      return mSets.front();
    }
-}
 
-}
+   //! Queue the tiles in [begin, end) not already requested, or load them
+   //! if stored
+   void Request(const WaveChannelInterval &clip, TileSet &set,
+      long long begin, long long end, DerivedDataCache *pStore)
+   {
+      for (auto index = begin; index < end; ++index) {
+         if (set.tiles.count(index))
+            continue;
+
+         // Fetch samples here, because the clip may change on this thread
+         auto columns = FetchColumns(
+            clip, index, set.spp, set.pParameters->windowSize);
+
+         auto pTile = std::make_shared<Tile>();
+         if (pStore) {
+            MakeKey(clip.GetSequence(), set.keyPrefix, columns, *pTile);
+            const auto bytes =
+               TileWidth * set.pParameters->nBins * sizeof(float);
+            pTile->freq.resize(bytes / sizeof(float));
+            if (!pTile->key.empty() &&
+                pStore->Load(pTile->key, pTile->freq.data(), bytes)) {
+               pTile->state.store(Tile::Ready);
+               pTile->key.clear();
+               set.tiles.emplace(index, std::move(pTile));
+               continue;
+            }
+         }
+         Enqueue(pTile, set.pParameters, std::move(columns));
+         set.tiles.emplace(index, std::move(pTile));
+      }
+   }
+
+   //! Store finished tiles that were not loaded or stored already
+   void Store(TileSet &set, DerivedDataCache &store)
+   {
+      for (auto &[index, pTile] : set.tiles) {
+         if (pTile->key.empty() ||
+             pTile->state.load(std::memory_order_acquire) != Tile::Ready)
+            continue;
+         store.Store(pTile->key, pTile->blockIDs,
+            pTile->freq.data(), pTile->freq.size() * sizeof(float));
+         pTile->key.clear();
+         pTile->blockIDs.clear();
+      }
+   }
+
+   //! Don't let the workers compute tiles scrolled out of [begin, end) before
+   //! those in it, and stay within the memory budget
+   void Trim(TileSet &set, long long begin, long long end)
+   {
+      for (auto iter = set.tiles.begin(); iter != set.tiles.end();) {
+         if ((iter->first < begin || iter->first >= end) &&
+             iter->second->Cancel())
+            iter = set.tiles.erase(iter);
+         else
+            ++iter;
+      }
+
+      // Give up other zoom levels first, least recently used first
+      const auto bytes = [this]{
+         size_t result = 0;
+         for (auto &set : mSets)
+            result += set.Bytes();
+         return result;
+      };
+      while (mSets.size() > 1 && bytes() > MaxTileBytes) {
+         mSets.back().CancelAll();
+         mSets.pop_back();
+      }
+
+      // Then the tiles farthest from view
+      auto &tiles = set.tiles;
+      while (!tiles.empty() && set.Bytes() > MaxTileBytes) {
+         const auto first = tiles.begin();
+         const auto last = std::prev(tiles.end());
+         const auto before = begin - first->first;
+         const auto after = last->first - (end - 1);
+         if (before <= 0 && after <= 0)
+            break;
+         const auto iter = before >= after ? first : last;
+         iter->second->Cancel();
+         tiles.erase(iter);
+      }
+   }
+
+private:
+   // Most recently used first
+   std::list<TileSet> mSets;
+};
 
 bool SpecCache::Matches(
    int dirty_, double samplesPerPixel,
@@ -363,7 +548,7 @@ void SpecCache::Populate(
 
    std::vector<float> gainFactors;
    if (!autocorrelation)
-      ComputeSpectrogramGainFactors(
+      ComputeGainFactors(
          fftLen, sampleRate, frequencyGainSetting, gainFactors);
 
    // Loop over the ranges before and after the copied portion and compute anew.
@@ -462,7 +647,7 @@ bool WaveClipSpectrumCache::GetSpectrogram(
    const WaveChannelInterval &clip,
    const float*& spectrogram, SpectrogramSettings& settings,
    const sampleCount*& where, size_t numPixels, double t0,
-   double pixelsPerSecond)
+   double pixelsPerSecond, AudacityProject *pProject)
 
 {
    auto &mSpecCache = mSpecCaches[clip.GetChannelIndex()];
@@ -471,6 +656,11 @@ bool WaveClipSpectrumCache::GetSpectrogram(
    const auto stretchRatio = clip.GetStretchRatio();
    const auto samplesPerPixel = sampleRate / pixelsPerSecond / stretchRatio;
 
+   if (settings.algorithm != SpectrogramSettings::algReassignment &&
+       SpectrogramInBackground.Read())
+      return GetTiledSpectrogram(clip, spectrogram, settings, where,
+         numPixels, t0, samplesPerPixel, pProject);
+
    //Trim offset comparison failure forces spectrogram cache rebuild
    //and skip copying "unchanged" data after clip border was trimmed.
    bool match = mSpecCache && mSpecCache->leftTrim == clip.GetTrimLeft() &&
@@ -572,9 +762,97 @@ bool WaveClipSpectrumCache::GetSpectrogram(
    return true;
 }
 
+bool WaveClipSpectrumCache::GetTiledSpectrogram(
+   const WaveChannelInterval &clip,
+   const float*& spectrogram, SpectrogramSettings& settings,
+   const sampleCount*& where, size_t numPixels, double t0,
+   double samplesPerPixel, AudacityProject *pProject)
+{
+   const auto iChannel = clip.GetChannelIndex();
+   auto &pTileCache = mTileCaches[iChannel];
+   if (!pTileCache)
+      pTileCache = std::make_unique<SpectrogramTileCache>();
+   auto &tileSet =
+      pTileCache->GetSet(clip, mDirty, samplesPerPixel, settings);
+
+   // The first column is the one of the grid nearest to t0
+   const auto firstColumn = std::llround(
+      t0 * clip.GetRate() / clip.GetStretchRatio() / samplesPerPixel);
+   const auto firstTile = FloorDiv(firstColumn, TileWidth);
+   const auto endTile = 1 + FloorDiv(
+      firstColumn + std::max<long long>(numPixels, 1) - 1, TileWidth);
+
+   const auto pStore = pProject && DerivedDataInProject.Read()
+      ? &DerivedDataCache::Get(*pProject) : nullptr;
+   if (pStore)
+      pTileCache->Store(tileSet, *pStore);
+
+   // Request the tiles in view before their neighbors
+   pTileCache->Trim(
+      tileSet, firstTile - PrefetchTiles, endTile + PrefetchTiles);
+   pTileCache->Request(clip, tileSet, firstTile, endTile, pStore);
+   pTileCache->Request(
+      clip, tileSet, firstTile - PrefetchTiles, firstTile, pStore);
+   pTileCache->Request(
+      clip, tileSet, endTile, endTile + PrefetchTiles, pStore);
+
+   size_t readyTiles = 0;
+   for (auto index = firstTile; index < endTile; ++index)
+      if (tileSet.GetReady(index))
+         ++readyTiles;
+
+   auto &mSpecCache = mSpecCaches[iChannel];
+   const bool match = mSpecCache->len == numPixels &&
+      mSpecCache->start == t0 &&
+      mSpecCache->leftTrim == clip.GetTrimLeft() &&
+      mSpecCache->rightTrim == clip.GetTrimRight() &&
+      mSpecCache->tiles == size_t(endTile - firstTile) &&
+      mSpecCache->readyTiles == readyTiles &&
+      mSpecCache->Matches(mDirty, samplesPerPixel, settings);
+   if (match) {
+      spectrogram = mSpecCache->freq.data();
+      where = mSpecCache->where.data();
+      return false; // no tile finished since the last time
+   }
+
+   if (mSpecCache->freq.capacity() > 2.1 * mSpecCache->freq.size())
+      mSpecCache = std::make_unique<SpecCache>();
+   mSpecCache->Grow(numPixels, settings, samplesPerPixel, t0);
+   mSpecCache->leftTrim = clip.GetTrimLeft();
+   mSpecCache->rightTrim = clip.GetTrimRight();
+   mSpecCache->dirty = mDirty;
+   mSpecCache->tiles = endTile - firstTile;
+   mSpecCache->readyTiles = readyTiles;
+
+   for (size_t xx = 0; xx <= numPixels; ++xx)
+      mSpecCache->where[xx] = std::max<sampleCount>(
+         0, ColumnSample(firstColumn + xx, samplesPerPixel));
+
+   // Copy the finished tiles; show the others as silence until they are
+   const auto nBins = settings.NBins();
+   for (size_t xx = 0; xx < numPixels;) {
+      const auto column = firstColumn + xx;
+      const auto index = FloorDiv(column, TileWidth);
+      const auto offset = column - index * TileWidth;
+      const auto count =
+         std::min<size_t>(TileWidth - offset, numPixels - xx);
+      float *const results = &mSpecCache->freq[nBins * xx];
+      if (const auto pTile = tileSet.GetReady(index))
+         std::copy_n(&pTile->freq[nBins * offset], nBins * count, results);
+      else
+         std::fill_n(results, nBins * count, -160.0f);
+      xx += count;
+   }
+
+   spectrogram = mSpecCache->freq.data();
+   where = mSpecCache->where.data();
+   return true;
+}
+
 WaveClipSpectrumCache::WaveClipSpectrumCache(size_t nChannels)
    : mSpecCaches(nChannels)
    , mSpecPxCaches(nChannels)
+   , mTileCaches(nChannels)
 {
    for (auto &pCache : mSpecCaches)
       pCache = std::make_unique<SpecCache>();
@@ -611,6 +889,8 @@ void WaveClipSpectrumCache::Invalidate()
    // Invalidate the spectrum display cache
    for (auto &pCache : mSpecCaches)
       pCache = std::make_unique<SpecCache>();
+   for (auto &pTiles : mTileCaches)
+      pTiles.reset();
 }
 
 void WaveClipSpectrumCache::MakeStereo(WaveClipListener &&other, bool)
@@ -618,6 +898,7 @@ void WaveClipSpectrumCache::MakeStereo(WaveClipListener &&other, bool)
    auto pOther = dynamic_cast<WaveClipSpectrumCache *>(&other);
    assert(pOther); // precondition
    mSpecCaches.push_back(move(pOther->mSpecCaches[0]));
+   mTileCaches.push_back(move(pOther->mTileCaches[0]));
    mSpecPxCaches.push_back(move(pOther->mSpecPxCaches[0]));
 }
 
@@ -625,6 +906,8 @@ void WaveClipSpectrumCache::SwapChannels()
 {
    mSpecCaches.resize(2);
    std::swap(mSpecCaches[0], mSpecCaches[1]);
+   mTileCaches.resize(2);
+   std::swap(mTileCaches[0], mTileCaches[1]);
    mSpecPxCaches.resize(2);
    std::swap(mSpecPxCaches[0], mSpecPxCaches[1]);
 }
@@ -633,6 +916,8 @@ void WaveClipSpectrumCache::Erase(size_t index)
 {
    if (index < mSpecCaches.size())
       mSpecCaches.erase(mSpecCaches.begin() + index);
+   if (index < mTileCaches.size())
+      mTileCaches.erase(mTileCaches.begin() + index);
    if (index < mSpecPxCaches.size())
       mSpecPxCaches.erase(mSpecPxCaches.begin() + index);
 }
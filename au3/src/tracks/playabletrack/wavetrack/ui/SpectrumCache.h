@@ -11,8 +11,10 @@
 #ifndef __AUDACITY_WAVECLIP_SPECTRUM_CACHE__
 #define __AUDACITY_WAVECLIP_SPECTRUM_CACHE__
 
+class AudacityProject;
 class sampleCount;
 class SpectrogramSettings;
+class SpectrogramTileCache;
 class WaveClipChannel;
 using WaveChannelInterval = WaveClipChannel;
 class WideSampleSequence;
@@ -70,6 +72,11 @@ public:
 
    int          dirty;
 
+   // When filled from tiles computed in the background: how many tiles
+   // cover the cache, and how many of those were finished
+   size_t       tiles{ 0 };
+   size_t       readyTiles{ 0 };
+
 private:
    // Calculate one column of the spectrum
    bool CalculateOneSpectrum(
@@ -112,6 +119,8 @@ struct WaveClipSpectrumCache final : WaveClipListener
    // Cache of values to colour pixels of Spectrogram - used by TrackArtist
    std::vector<std::unique_ptr<SpecPxCache>> mSpecPxCaches;
    std::vector<std::unique_ptr<SpecCache>> mSpecCaches;
+   // Columns computed in the shared pool, reused across zoom levels
+   std::vector<std::unique_ptr<SpectrogramTileCache>> mTileCaches;
    int mDirty { 0 };
 
    static WaveClipSpectrumCache &Get(const WaveChannelInterval &clip);
@@ -128,11 +137,19 @@ struct WaveClipSpectrumCache final : WaveClipListener
       const float *&spectrogram,
       SpectrogramSettings &spectrogramSettings,
       const sampleCount *&where, size_t numPixels,
-      double t0 /*absolute time*/, double pixelsPerSecond);
+      double t0 /*absolute time*/, double pixelsPerSecond,
+      AudacityProject *pProject = nullptr /*where columns may be stored*/);
 
    void MakeStereo(WaveClipListener &&other, bool aligned) override;
    void SwapChannels() override;
    void Erase(size_t index) override;
+
+private:
+   bool GetTiledSpectrogram(const WaveChannelInterval &clip,
+      const float *&spectrogram,
+      SpectrogramSettings &spectrogramSettings,
+      const sampleCount *&where, size_t numPixels,
+      double t0, double samplesPerPixel, AudacityProject *pProject);
 };
 
 #endif
@@ -414,9 +414,10 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    const double binUnit = sampleRate / (2 * half);
    const float *freq = 0;
    const sampleCount *where = 0;
+   const auto pTrackList = channel.GetTrack().GetOwner();
    bool updated = WaveClipSpectrumCache::Get(clip).GetSpectrogram(
       clip, freq, settings, where, (size_t)hiddenMid.width, t0,
-      averagePixelsPerSecond);
+      averagePixelsPerSecond, pTrackList ? pTrackList->GetOwner() : nullptr);
    auto nBins = settings.NBins();
 
    float minFreq, maxFreq;
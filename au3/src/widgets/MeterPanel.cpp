@@ -905,7 +905,7 @@ void MeterPanel::UpdateDisplay(
    for(unsigned int j=0; j<mNumBars; j++)
       msg.rms[j] = sqrt(msg.rms[j]/numFrames);
 
-   mQueue.Put(msg);
+   mQueue.TryPush(msg);
 }
 
 // Vaughan, 2010-11-29: This not currently used. See comments in MixerTrackCluster::UpdateMeter().
@@ -950,7 +950,7 @@ void MeterPanel::UpdateDisplay(
 //      }
 //   }
 //
-//   mQueue.Put(msg);
+//   mQueue.TryPush(msg);
 //}
 
 void MeterPanel::OnMeterUpdate(wxTimerEvent & WXUNUSED(event))
@@ -970,7 +970,7 @@ void MeterPanel::OnMeterUpdate(wxTimerEvent & WXUNUSED(event))
    // popping them off until there are none left.  It is necessary
    // to process all of them, otherwise we won't handle peaks and
    // peak-hold bars correctly.
-   while(mQueue.Get(msg)) {
+   while(mQueue.TryPop(msg)) {
       numChanges++;
       double deltaT = msg.numFrames / mRate;
 
@@ -23,7 +23,7 @@
 #include <wx/timer.h> // member variable
 
 #include "ASlider.h"
-#include "LockFreeQueue.h"
+#include "SPSCQueue.h"
 #include "MeterPanelBase.h" // to inherit
 #include "Observer.h"
 #include "Prefs.h"
@@ -77,7 +77,7 @@ class MeterUpdateMsg
 // communicate between the audio thread and the GUI thread.
 // This class uses lock-free synchronization with atomics.
 //
-using MeterUpdateQueue = LockFreeQueue<MeterUpdateMsg>;
+using MeterUpdateQueue = SPSCQueue<MeterUpdateMsg>;
 
 class MeterAx;
 
@@ -0,0 +1,42 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BenchmarkUtils.h
+
+  Helpers for test cases tagged [.][benchmark], which run only on request
+
+**********************************************************************/
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace BenchmarkUtils
+{
+using Clock = std::chrono::steady_clock;
+using Microseconds = std::chrono::duration<double, std::micro>;
+
+//! Mean time of repeated calls of f
+template<typename F> Microseconds MeanTime(size_t repetitions, F&& f)
+{
+   const auto start = Clock::now();
+   for (size_t ii = 0; ii < repetitions; ++ii)
+      f();
+   return Microseconds { Clock::now() - start } / repetitions;
+}
+
+//! Uniformly distributed samples in -1.0...1.0, the same for the same seed
+inline std::vector<float> RandomSamples(size_t len, unsigned seed)
+{
+   std::mt19937 engine { seed };
+   std::uniform_real_distribution<float> distribution { -1.f, 1.f };
+   std::vector<float> samples(len);
+   for (auto& sample : samples)
+      sample = distribution(engine);
+   return samples;
+}
+} // namespace BenchmarkUtils
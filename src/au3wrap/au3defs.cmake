@@ -16,6 +16,7 @@ set(AU3_DEF
     -Dsafenew=new
 
     -DUTILITY_API=
+    -DCONCURRENCY_API=
     -DPROJECT_API=
     -DSTRINGS_API=
     -DEXCEPTIONS_API=
@@ -39,6 +40,7 @@ set(AU3_DEF
     -DTRACK_API=
     -DCHANNEL_API=
     -DTIME_AND_PITCH_API=
+    -DFFT_API=
     -DPROJECT_RATE_API=
     -DTRACK_SELECTION_API=
     -DAUDIO_DEVICES_API=
@@ -85,6 +87,7 @@ set(AU3_INCLUDE
     ${AU3_LIBRARIES}/lib-registries
     ${AU3_LIBRARIES}/lib-exceptions
     ${AU3_LIBRARIES}/lib-utility
+    ${AU3_LIBRARIES}/lib-concurrency
     ${AU3_LIBRARIES}/lib-strings
     ${AU3_LIBRARIES}/lib-string-utils
     ${AU3_LIBRARIES}/lib-preferences
@@ -106,6 +109,7 @@ set(AU3_INCLUDE
     ${AU3_LIBRARIES}/lib-track
     ${AU3_LIBRARIES}/lib-channel
     ${AU3_LIBRARIES}/lib-time-and-pitch
+    ${AU3_LIBRARIES}/lib-fft
     ${AU3_LIBRARIES}/lib-project-rate
     ${AU3_LIBRARIES}/lib-track-selection
     ${AU3_LIBRARIES}/lib-audio-devices
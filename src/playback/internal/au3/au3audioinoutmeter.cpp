@@ -14,6 +14,22 @@
 using namespace muse;
 using namespace muse::async;
 
+namespace {
+constexpr auto DISPLAY_INTERVAL = std::chrono::milliseconds(33);
+
+// Look for more peaked samples than this in a row
+constexpr int NUM_PEAK_SAMPLES_TO_CLIP = 3;
+}
+
+au::playback::InOutMeter::InOutMeter()
+    : m_pollTimer(DISPLAY_INTERVAL)
+{
+    m_pollTimer.onTimeout(this, [this]() {
+        poll();
+    });
+    m_pollTimer.start();
+}
+
 void au::playback::InOutMeter::Clear()
 {
 }
@@ -21,57 +37,118 @@ void au::playback::InOutMeter::Clear()
 void au::playback::InOutMeter::Reset(double sampleRate, bool resetClipping)
 {
     UNUSED(sampleRate);
-    UNUSED(resetClipping);
 
-    au::audio::volume_dbfs_t zero = static_cast<au::audio::volume_dbfs_t>(LINEAR_TO_DB(0));
+    // Start over with the next block, and drop the snapshot not yet taken,
+    // so that stale levels can't follow the silence sent here
+    m_resetRequested.store(true, std::memory_order_release);
+    m_middleIndex.fetch_and(~FRESH_SNAPSHOT, std::memory_order_acq_rel);
 
-    m_audioSignalChanges.send(0, au::audio::AudioSignalVal { 0, zero });
-    m_audioSignalChanges.send(1, au::audio::AudioSignalVal { 0, zero });
+    m_maxPeak.store(0.f, std::memory_order_relaxed);
+    if (resetClipping) {
+        m_clipping.store(false, std::memory_order_relaxed);
+    }
+
+    const std::array<ChannelLevels, MAX_CHANNELS> silence {};
+    sendLevels(m_sentChannels, silence.data());
 }
 
 void au::playback::InOutMeter::UpdateDisplay(unsigned int numChannels, unsigned long numFrames, const float* sampleData)
 {
-    auto sptr = sampleData;
-    unsigned int num = 2;
-
-    int numPeakSamplesToClip = 3;
-
-    std::vector<float> peak(num);
-    std::vector<float> rms(num);
-    std::vector<bool> clipping(num);
-    std::vector<unsigned long> headPeakCount(num);
-    std::vector<int> tailPeakCount(num);
-
-    for (unsigned long i = 0; i < numFrames; i++) {
-        for (unsigned int j = 0; j < num; j++) {
-            peak[j] = std::max(peak[j], static_cast<float>(fabs(sptr[j])));
-            rms[j] += sptr[j] * sptr[j];
-
-            // In addition to looking for mNumPeakSamplesToClip peaked
-            // samples in a row, also send the number of peaked samples
-            // at the head and tail, in case there's a run of peaked samples
-            // that crosses block boundaries
-            if (fabs(sptr[j]) >= MAX_AUDIO) {
-                if (headPeakCount[j] == i) {
-                    headPeakCount[j]++;
-                }
-                tailPeakCount[j]++;
-                if (tailPeakCount[j] > numPeakSamplesToClip) {
-                    clipping[j] = true;
+    if (numFrames == 0) {
+        return;
+    }
+
+    const unsigned num = std::min(numChannels, MAX_CHANNELS);
+
+    if (m_resetRequested.exchange(false, std::memory_order_acquire)) {
+        m_accumulators.fill({});
+    } else if (!(m_middleIndex.load(std::memory_order_acquire) & FRESH_SNAPSHOT)) {
+        // The poller took the last snapshot, so begin a new one; otherwise
+        // keep accumulating, so that no peak between polls is missed
+        for (auto& accumulator : m_accumulators) {
+            accumulator = { 0.f, 0.f, 0, false, accumulator.tailPeakCount };
+        }
+    }
+
+    for (unsigned int j = 0; j < num; j++) {
+        auto& accumulator = m_accumulators[j];
+        float peak = accumulator.peak;
+        float sumOfSquares = accumulator.sumOfSquares;
+        bool clipping = accumulator.clipping;
+        // A run of peaked samples may cross block boundaries
+        int tailPeakCount = accumulator.tailPeakCount;
+
+        auto sptr = sampleData + j;
+        for (unsigned long i = 0; i < numFrames; i++, sptr += numChannels) {
+            const float magnitude = std::fabs(*sptr);
+            peak = std::max(peak, magnitude);
+            sumOfSquares += *sptr * *sptr;
+            if (magnitude >= MAX_AUDIO) {
+                if (++tailPeakCount > NUM_PEAK_SAMPLES_TO_CLIP) {
+                    clipping = true;
                 }
             } else {
-                tailPeakCount[j] = 0;
+                tailPeakCount = 0;
             }
         }
-        sptr += numChannels;
+
+        accumulator.peak = peak;
+        accumulator.sumOfSquares = sumOfSquares;
+        accumulator.numFrames += numFrames;
+        accumulator.clipping = clipping;
+        accumulator.tailPeakCount = tailPeakCount;
     }
-    for (unsigned int j = 0; j < num; j++) {
-        rms[j] = sqrt(rms[j] / numFrames);
+
+    publish(num);
+}
+
+void au::playback::InOutMeter::publish(unsigned numChannels)
+{
+    auto& snapshot = m_snapshots[m_backIndex];
+    snapshot.numChannels = numChannels;
+
+    float maxPeak = 0.f;
+    bool clipping = false;
+    for (unsigned int j = 0; j < numChannels; j++) {
+        const auto& accumulator = m_accumulators[j];
+        snapshot.levels[j] = {
+            accumulator.peak,
+            std::sqrt(accumulator.sumOfSquares / accumulator.numFrames),
+            accumulator.clipping
+        };
+        maxPeak = std::max(maxPeak, accumulator.peak);
+        clipping = clipping || accumulator.clipping;
+    }
+
+    m_maxPeak.store(maxPeak, std::memory_order_relaxed);
+    if (clipping) {
+        m_clipping.store(true, std::memory_order_relaxed);
     }
 
-    m_audioSignalChanges.send(0, au::audio::AudioSignalVal { 0, static_cast<au::audio::volume_dbfs_t>(LINEAR_TO_DB(peak[0])) });
-    m_audioSignalChanges.send(1, au::audio::AudioSignalVal { 0, static_cast<au::audio::volume_dbfs_t>(LINEAR_TO_DB(peak[1])) });
-    // LOGD() << "=============== change " << LINEAR_TO_DB(peak[0]) << " - " << LINEAR_TO_DB(peak[1]);
+    // Swap the filled snapshot into the middle, and take the one there
+    m_backIndex = m_middleIndex.exchange(m_backIndex | FRESH_SNAPSHOT, std::memory_order_acq_rel) & ~FRESH_SNAPSHOT;
+}
+
+void au::playback::InOutMeter::poll()
+{
+    if (!(m_middleIndex.load(std::memory_order_relaxed) & FRESH_SNAPSHOT)) {
+        return;
+    }
+
+    // Only the audio thread sets FRESH_SNAPSHOT, so it is still set here
+    m_frontIndex = m_middleIndex.exchange(m_frontIndex, std::memory_order_acq_rel) & ~FRESH_SNAPSHOT;
+
+    const auto& snapshot = m_snapshots[m_frontIndex];
+    sendLevels(snapshot.numChannels, snapshot.levels.data());
+}
+
+void au::playback::InOutMeter::sendLevels(unsigned numChannels, const ChannelLevels* levels)
+{
+    for (unsigned int j = 0; j < numChannels; j++) {
+        const auto pressure = static_cast<au::audio::volume_dbfs_t>(LINEAR_TO_DB(levels[j].peak));
+        m_audioSignalChanges.send(j, au::audio::AudioSignalVal { 0, pressure });
+    }
+    m_sentChannels = numChannels;
 }
 
 bool au::playback::InOutMeter::IsMeterDisabled() const
@@ -82,14 +159,12 @@ bool au::playback::InOutMeter::IsMeterDisabled() const
 
 float au::playback::InOutMeter::GetMaxPeak() const
 {
-    NOT_IMPLEMENTED;
-    return 0.0;
+    return m_maxPeak.load(std::memory_order_relaxed);
 }
 
 bool au::playback::InOutMeter::IsClipping() const
 {
-    NOT_IMPLEMENTED;
-    return false;
+    return m_clipping.load(std::memory_order_relaxed);
 }
 
 int au::playback::InOutMeter::GetDBRange() const
@@ -4,18 +4,31 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+
 #include "global/async/asyncable.h"
 #include "global/async/promise.h"
 #include "global/async/channel.h"
+#include "global/timer.h"
 
 #include "au3audio/audiotypes.h"
 
 #include "libraries/lib-audio-devices/Meter.h"
 
 namespace au::playback {
+//! Meter fed by the audio thread and published to the UI at display rate
+/*!
+ UpdateDisplay() only accumulates levels into preallocated storage and hands
+ snapshots over through a lock-free triple buffer, so it never allocates,
+ locks, or notifies from the audio thread.  A timer on the main thread polls
+ for the latest snapshot and sends it on to signalChanges().
+ */
 class InOutMeter : public Meter, public muse::async::Asyncable
 {
 public:
+    InOutMeter();
+
     void Clear() override;
     void Reset(double sampleRate, bool resetClipping) override;
     void UpdateDisplay(unsigned numChannels, unsigned long numFrames, const float* sampleData) override;
@@ -27,6 +40,56 @@ public:
     muse::async::Promise<muse::async::Channel<au::audio::audioch_t, au::audio::AudioSignalVal> > signalChanges() const;
 
 private:
+    //! Channels beyond this count are not metered
+    static constexpr unsigned MAX_CHANNELS = 32;
+
+    struct ChannelLevels {
+        float peak = 0.f;
+        float rms = 0.f;
+        bool clipping = false;
+    };
+
+    struct Snapshot {
+        unsigned numChannels = 0;
+        std::array<ChannelLevels, MAX_CHANNELS> levels;
+    };
+
+    //! Levels of one channel since the last snapshot was taken by the poller
+    struct Accumulator {
+        float peak = 0.f;
+        float sumOfSquares = 0.f;
+        unsigned long numFrames = 0;
+        bool clipping = false;
+        //! Length of the run of peaked samples at the end of the last block
+        int tailPeakCount = 0;
+    };
+
+    // Audio thread
+    void publish(unsigned numChannels);
+
+    // Main thread
+    void poll();
+    void sendLevels(unsigned numChannels, const ChannelLevels* levels);
+
+    // Owned by the audio thread
+    std::array<Accumulator, MAX_CHANNELS> m_accumulators;
+    unsigned m_backIndex = 0;
+
+    // Owned by the main thread
+    unsigned m_frontIndex = 1;
+    unsigned m_sentChannels = 2;
+    muse::Timer m_pollTimer;
+
+    //! Index of the snapshot between the two threads, with FRESH_SNAPSHOT
+    //! set while it is not yet taken by the poller
+    static constexpr unsigned FRESH_SNAPSHOT = 4;
+    std::atomic<unsigned> m_middleIndex { 2 };
+    std::array<Snapshot, 3> m_snapshots;
+
+    std::atomic<bool> m_resetRequested { false };
+    std::atomic<float> m_maxPeak { 0.f };
+    std::atomic<bool> m_clipping { false };
+
     muse::async::Channel<au::audio::audioch_t, au::audio::AudioSignalVal> m_audioSignalChanges;
 };
 }